@@ -5,6 +5,9 @@
       'target_name': 'mysql_bindings',
       'sources': [
         'src/mysql_bindings.cc',
+        'src/mysql_bindings_aggregate.cc',
+        'src/mysql_bindings_batch.cc',
+        'src/mysql_bindings_cache.cc',
         'src/mysql_bindings_connection.cc',
         'src/mysql_bindings_result.cc',
         'src/mysql_bindings_statement.cc',
@@ -17,6 +20,12 @@
             '<!@(mysql_config --libs_r)'
           ],
         }],
+        ['OS=="linux"', {
+          # shm_open() for shared result cache
+          'libraries': [
+            '-lrt'
+          ],
+        }],
         ['OS=="mac"', {
           # cflags on OS X are stupid and have to be defined like this
           'xcode_settings': {
@@ -109,6 +109,15 @@ function parseDSN(dsn) {
   return args;
 }
 
+/** section: Exports
+ * MysqlLibmysqlclient.setProcessAdmissionLimitsSync(limits)
+ * - limits (Object): Limits, non-negative integers, 0 disables limit
+ *
+ * Sets admission control limits shared by all connections of the process,
+ * `maxQueued` for commands queued on all connections, 0 (unlimited) by default
+ **/
+exports.setProcessAdmissionLimitsSync = bindings.setProcessAdmissionLimitsSync;
+
 /** section: Exports
  * MysqlLibmysqlclient.createConnectionSync(hostname[, user[, password[, database[, port[, socket[, flags]]]]]]) -> MysqlConnection
  * MysqlLibmysqlclient.createConnectionSync(dsn) -> MysqlConnection
@@ -191,13 +200,16 @@ exports.createConnection = function createConnection() {
  * class MysqlConnectionQueued < MysqlConnection
  *
  * MySQL connection with queries queue
+ *
+ * Queries are queued by native connection,
+ * only queries called before connect() finished are buffered here
  **/
 var MysqlConnectionQueued = function MysqlConnectionQueued() {
   // Hacky inheritance
   var connection = new bindings.MysqlConnection();
   connection.__proto__ = MysqlConnectionQueued.prototype;
 
-  // Queries queue
+  // Queue for queries called during connect
   connection._queueBlocked = false;
   connection._queue = [];
 
@@ -210,54 +222,106 @@ MysqlConnectionQueued.prototype = new bindings.MysqlConnection();
 /*!
  * MysqlConnectionQueued#_processQueue()
  *
- * Process MysqlConnectionQueued internal queue for connect and queries
+ * Passes MysqlConnectionQueued internal queue to the native connection queue,
+ * stops on connect until it finished
  **/
 MysqlConnectionQueued.prototype._processQueue = function () {
-  if (this._queueBlocked) {
-    return;
-  }
-
-  if (this._queue.length == 0) {
-    return;
+  var data, method, methodArguments, callback, handle;
+
+  while (!this._queueBlocked && this._queue.length > 0) {
+    data = this._queue.shift();
+    method = data[0];
+    methodArguments = data[1];
+    callback = data[2];
+    handle = data[3];
+
+    switch (method) {
+      case 'connect':
+        this._queueBlocked = true;
+
+        methodArguments.push(this._connectCallback(callback));
+
+        bindings.MysqlConnection.prototype.connect.apply(this, methodArguments);
+        break;
+      case 'query':
+        methodArguments.push(callback);
+
+        handle._handle = bindings.MysqlConnection.prototype.query.apply(this, methodArguments);
+        break;
+      case 'querySend':
+        methodArguments.push(callback);
+
+        handle._handle = bindings.MysqlConnection.prototype.querySend.apply(this, methodArguments);
+        break;
+      default:
+        throw new Error("mysql-libmysqlclient internal error: wrong method in queue");
+    }
   }
+};
 
-  var data = this._queue.shift();
-  var method = data[0];
-  var methodArguments = data[1];
-  var callback = data[2];
-  data = null;
-
+/*!
+ * MysqlConnectionQueued#_connectCallback(callback) -> Function
+ *
+ * Wraps connect() callback to unblock queue after connect
+ **/
+MysqlConnectionQueued.prototype._connectCallback = function (callback) {
   var self = this;
-  var realCallback = function () {
-    var args = Array.prototype.slice.call(arguments);
 
-    process.nextTick(function () {
-      self._queueBlocked = false;
-      self._processQueue();
-    });
+  return function () {
+    self._queueBlocked = false;
 
     if (typeof callback == "function") {
-      callback.apply(null, args);
+      callback.apply(null, arguments);
     }
+
+    self._processQueue();
   };
+};
 
-  methodArguments.push(realCallback);
+/*!
+ * MysqlConnectionQueued#_queueQuery(method, args) -> Object
+ *
+ * Buffers query called during connect,
+ * returns handle which cancels it in buffer or in native connection
+ **/
+MysqlConnectionQueued.prototype._queueQuery = function (method, args) {
+  var self = this, data, callback;
 
-  self._queueBlocked = true;
+  args = Array.prototype.slice.call(args);
 
-  switch (method) {
-    case 'connect':
-      bindings.MysqlConnection.prototype.connect.apply(this, methodArguments);
-      break;
-    case 'query':
-      bindings.MysqlConnection.prototype.query.apply(this, methodArguments);
-      break;
-    case 'querySend':
-      bindings.MysqlConnection.prototype.querySend.apply(this, methodArguments);
-      break;
-    default:
-      throw new Error("mysql-libmysqlclient internal error: wrong method in queue");
+  // Last argument should be callback function
+  callback = args.pop();
+  if (typeof callback != 'function') {
+    args.push(callback);
+    callback = null;
   }
+
+  data = [method, args, callback, {
+    _handle: null,
+    cancel: function () {
+      if (this._handle) {
+        return this._handle.cancel();
+      }
+
+      var i = self._queue.indexOf(data);
+      if (i === -1) {
+        return false;
+      }
+      self._queue.splice(i, 1);
+
+      if (callback) {
+        process.nextTick(callback.bind(null, new Error("Query is canceled")));
+      }
+
+      return true;
+    }
+  }];
+
+  this._queue.push(data);
+
+  this._processQueue();
+
+  return data[3];
 };
 
 /**
@@ -282,29 +346,41 @@ MysqlConnectionQueued.prototype.connect = function query() {
 };
 
 /**
- * MysqlConnectionQueued#query(query[, callback])
+ * MysqlConnectionQueued#query(query[, options][, callback]) -> Object
  *
  * Performs a query on the database
  *
  * Uses mysql_real_query()
+ *
+ * Returns handle with cancel() method,
+ * `options.timeoutMs` deadline starts when query is passed to the native connection,
+ * `options.priority` selects native queue lane, used only to order commands of different connections,
+ * `options.coalesce` shares execution of identical concurrent SELECTs,
+ * `options.cacheTtlMs` and `options.cacheTags` use process-wide result cache
  **/
 MysqlConnectionQueued.prototype.query = function query(query, callback) {
-  this._queue.push(['query', [query], callback]);
+  if (!this._queueBlocked && this._queue.length === 0) {
+    return bindings.MysqlConnection.prototype.query.apply(this, arguments);
+  }
 
-  this._processQueue();
+  return this._queueQuery('query', arguments);
 };
 
 /**
- * MysqlConnectionQueued#querySend(query[, callback])
+ * MysqlConnectionQueued#querySend(query[, options][, callback]) -> Object
  *
  * Performs a query on the database
  *
  * Uses mysql_send_query()
+ *
+ * Returns handle with cancel() method, see MysqlConnectionQueued#query
  **/
 MysqlConnectionQueued.prototype.querySend = function querySend(query, callback) {
-  this._queue.push(['querySend', [query], callback]);
+  if (!this._queueBlocked && this._queue.length === 0) {
+    return bindings.MysqlConnection.prototype.querySend.apply(this, arguments);
+  }
 
-  this._processQueue();
+  return this._queueQuery('querySend', arguments);
 };
 
 /*!
@@ -419,7 +495,7 @@ MysqlConnectionHighlevel.prototype.setQueryTypeSync = function setQueryTypeSync(
 };
 
 /**
- * MysqlConnectionHighlevel#query(query[, callback])
+ * MysqlConnectionHighlevel#query(query[, options][, callback]) -> Object
  *
  * Performs a query on the database
  *
@@ -429,11 +505,9 @@ MysqlConnectionHighlevel.prototype.setQueryTypeSync = function setQueryTypeSync(
 MysqlConnectionHighlevel.prototype.query = function query(query, callback) {
   switch (this._queryType) {
     case 'query':
-      MysqlConnectionQueued.prototype.query.apply(this, arguments);
-      break;
+      return MysqlConnectionQueued.prototype.query.apply(this, arguments);
     case 'querySend':
-      MysqlConnectionQueued.prototype.querySend.apply(this, arguments);
-      break;
+      return MysqlConnectionQueued.prototype.querySend.apply(this, arguments);
     default:
       throw new Error("mysql-libmysqlclient error: wrong this._queryType");
   }
@@ -513,3 +587,1096 @@ exports.createConnectionHighlevel = function createConnectionHighlevel() {
  * Export MysqlConnectionQueued
  */
 exports.MysqlConnectionHighlevel = MysqlConnectionHighlevel;
+
+/*!
+ * quoteIdentifier(identifier) -> String
+ * - identifier (String): Table or column name
+ *
+ * Quotes MySQL identifier with backticks
+ **/
+function quoteIdentifier(identifier) {
+  return '`' + String(identifier).replace(/`/g, '``') + '`';
+}
+
+/*!
+ * canonicalNumber(value) -> String
+ * - value (String|Number): Decimal number
+ *
+ * Removes sign of zero, leading zeros and trailing zeros of fraction,
+ * so DECIMAL "1.00" and key 1 give the same string
+ **/
+function canonicalNumber(value) {
+  var match = /^([+\-]?)0*(\d*)(?:\.(\d*?)0*)?$/.exec(String(value)), integer, fraction;
+
+  if (!match) {
+    return String(value);
+  }
+
+  integer = match[2] || '0';
+  fraction = match[3] || '';
+
+  return (match[1] === '-' && (integer !== '0' || fraction) ? '-' : '') +
+         integer + (fraction ? '.' + fraction : '');
+}
+
+/*!
+ * lookupKeyNormalizer(fields, keyColumn) -> Function|null
+ * - fields (Array): Result fields metadata
+ * - keyColumn (String): Key column name
+ *
+ * Returns function that makes keys equal by column comparison rules equal strings,
+ * null if only exact match is possible.
+ * Non-binary strings are compared case-insensitively without trailing spaces,
+ * as with default `*_ci` PAD SPACE collations, numbers by value.
+ * Accent-insensitive matches of some collations are not normalized
+ **/
+function lookupKeyNormalizer(fields, keyColumn) {
+  var i, field = null;
+
+  for (i = 0; i < fields.length; i++) {
+    if (fields[i].name === keyColumn) {
+      field = fields[i];
+      break;
+    }
+  }
+
+  if (!field) {
+    return null;
+  }
+
+  switch (field.type) {
+  case 0:   // DECIMAL
+  case 1:   // TINYINT
+  case 2:   // SMALLINT
+  case 3:   // INT
+  case 4:   // FLOAT
+  case 5:   // DOUBLE
+  case 8:   // BIGINT
+  case 9:   // MEDIUMINT
+  case 13:  // YEAR
+  case 246: // NEWDECIMAL
+    return canonicalNumber;
+  case 15:  // VARCHAR
+  case 247: // ENUM
+  case 248: // SET
+  case 252: // TEXT
+  case 253: // VAR_STRING
+  case 254: // STRING
+    // BINARY_FLAG is set for binary strings and *_bin collations
+    if (field.flags & 128) {
+      return null;
+    }
+    return function (value) {
+      return String(value).replace(/ +$/, '').toLowerCase();
+    };
+  default:
+    return null;
+  }
+}
+
+/** section: Classes
+ * class MysqlLookupBatcher
+ *
+ * Collects point lookups by key made within one tick
+ * and fetches them with single `SELECT ... WHERE key IN (...)` query.
+ * Row is matched to key exactly, then by key column comparison rules,
+ * see lookupKeyNormalizer()
+ **/
+var MysqlLookupBatcher = function MysqlLookupBatcher(connection, table, keyColumn, columns, options) {
+  options = options || {};
+
+  columns = (columns && columns.length) ? columns.slice() : ['*'];
+  if (columns.indexOf('*') === -1 && columns.indexOf(keyColumn) === -1) {
+    columns.push(keyColumn);
+  }
+
+  this._connection = connection;
+  this._keyColumn = keyColumn;
+  this._queryPrefix = "SELECT " + columns.map(function (column) {
+    return column === '*' ? column : quoteIdentifier(column);
+  }).join(", ") + " FROM " + quoteIdentifier(table) + " WHERE " + quoteIdentifier(keyColumn) + " IN (";
+  // Default max_allowed_packet of MySQL 5.5 is 1Mb
+  this._maxQueryLength = options.maxQueryLength || 1048576;
+  // Keys like "__proto__" are ordinary keys here
+  this._pending = Object.create(null);
+  this._pendingKeys = [];
+  this._scheduled = false;
+};
+
+/**
+ * MysqlLookupBatcher#load(key, callback)
+ * - key (String|Number): Value of key column
+ * - callback (Function): Gets error and found row or null
+ *
+ * Adds key to current batch, batch is sent on next tick
+ **/
+MysqlLookupBatcher.prototype.load = function load(key, callback) {
+  var self = this, index = String(key);
+
+  if (!(index in this._pending)) {
+    this._pending[index] = [];
+    this._pendingKeys.push(key);
+  }
+  this._pending[index].push(callback);
+
+  if (!this._scheduled) {
+    this._scheduled = true;
+    process.nextTick(function () {
+      self._flush();
+    });
+  }
+};
+
+/*!
+ * MysqlLookupBatcher#_flush()
+ *
+ * Splits collected keys into queries shorter than maxQueryLength bytes and sends them
+ **/
+MysqlLookupBatcher.prototype._flush = function () {
+  var pending = this._pending, keys = this._pendingKeys, prefixLength = Buffer.byteLength(this._queryPrefix) + 1,
+    indexes = [], literals = [], length = prefixLength, literal, literalLength, i;
+
+  this._pending = Object.create(null);
+  this._pendingKeys = [];
+  this._scheduled = false;
+
+  for (i = 0; i < keys.length; i++) {
+    literal = typeof keys[i] === 'number' && isFinite(keys[i]) ?
+              String(keys[i]) :
+              "'" + this._connection.escapeSync(String(keys[i])) + "'";
+
+    literalLength = Buffer.byteLength(literal);
+
+    if (literals.length > 0 && length + literalLength + 2 > this._maxQueryLength) {
+      this._lookup(indexes, literals, pending);
+      indexes = [];
+      literals = [];
+      length = prefixLength;
+    }
+
+    indexes.push(String(keys[i]));
+    literals.push(literal);
+    length += literalLength + 2;
+  }
+
+  if (literals.length > 0) {
+    this._lookup(indexes, literals, pending);
+  }
+};
+
+/*!
+ * MysqlLookupBatcher#_lookup(indexes, literals, pending)
+ *
+ * Runs one IN() query and dispatches found rows to waiting callbacks
+ **/
+MysqlLookupBatcher.prototype._lookup = function (indexes, literals, pending) {
+  var self = this;
+
+  // Fields and indexBy need MysqlResult whatever result mode of connection is
+  this._connection.query(this._queryPrefix + literals.join(", ") + ")", {resultMode: 'store'}, function (err, res) {
+    var rows = null, normalize = null, normalized = null, row, key, callbacks, i, j;
+
+    if (!err) {
+      try {
+        normalize = lookupKeyNormalizer(res.fetchFieldsSync(), self._keyColumn);
+        rows = res.fetchAllSync({indexBy: self._keyColumn});
+      } catch (e) {
+        err = e;
+      }
+      res.freeSync();
+    }
+
+    if (!err && normalize) {
+      normalized = Object.create(null);
+      Object.keys(rows).forEach(function (found) {
+        var normalizedKey = normalize(found);
+        if (!(normalizedKey in normalized)) {
+          normalized[normalizedKey] = rows[found];
+        }
+      });
+    }
+
+    for (i = 0; i < indexes.length; i++) {
+      row = null;
+      if (!err) {
+        if (indexes[i] in rows) {
+          row = rows[indexes[i]];
+        } else if (normalized) {
+          key = normalize(indexes[i]);
+          row = key in normalized ? normalized[key] : null;
+        }
+      }
+
+      callbacks = pending[indexes[i]];
+      for (j = 0; j < callbacks.length; j++) {
+        if (err) {
+          callbacks[j](err);
+        } else {
+          callbacks[j](null, row);
+        }
+      }
+    }
+  });
+};
+
+/*!
+ * Export MysqlLookupBatcher
+ */
+exports.MysqlLookupBatcher = MysqlLookupBatcher;
+
+/**
+ * MysqlConnection#lookupBatcher(table, keyColumn[, columns][, options]) -> MysqlLookupBatcher
+ * - table (String): Table name
+ * - keyColumn (String): Column to look up rows by
+ * - columns (Array): Columns to fetch, all by default
+ * - options (Object): `maxQueryLength` splits large batches, 1Mb by default
+ *
+ * Creates batcher of point lookups on this connection
+ **/
+bindings.MysqlConnection.prototype.lookupBatcher = function lookupBatcher(table, keyColumn, columns, options) {
+  if (columns && !Array.isArray(columns)) {
+    options = columns;
+    columns = null;
+  }
+
+  return new MysqlLookupBatcher(this, table, keyColumn, columns, options);
+};
+
+/*!
+ * isIdempotentRead(query) -> Boolean
+ * - query (String): Query
+ *
+ * Checks that query is SELECT without locking clauses
+ **/
+function isIdempotentRead(query) {
+  return (/^[\s(]*SELECT\b/i).test(query) &&
+         !(/\bFOR\s+UPDATE\b|\bLOCK\s+IN\s+SHARE\s+MODE\b|\bFOR\s+SHARE\b/i).test(query);
+}
+
+/** section: Classes
+ * class MysqlHedgedReader
+ *
+ * Sends read query to the next replica connection
+ * if the first one has not answered within hedge delay,
+ * the first answer wins and the other query is canceled.
+ *
+ * Hedge delay is `delayMs` if set, otherwise percentile (`percentile`, 0.95)
+ * of latencies of recent `window` reads, not less than `minDelayMs`.
+ * Until `minSamples` (20) latencies are known it is `initialDelayMs` (100)
+ **/
+var MysqlHedgedReader = function MysqlHedgedReader(replicas, options) {
+  options = options || {};
+
+  if (!Array.isArray(replicas) || replicas.length === 0) {
+    throw new Error("mysql-libmysqlclient error: replicas array is required for MysqlHedgedReader");
+  }
+
+  this._replicas = replicas;
+  this._next = 0;
+
+  // Fixed delay, or percentile of recent latencies
+  // once there are enough of them, conservative delay before
+  this._delayMs = options.delayMs;
+  this._percentile = options.percentile || 0.95;
+  this._minDelayMs = options.minDelayMs || 1;
+  this._initialDelayMs = options.initialDelayMs || 100;
+  this._minSamples = options.minSamples || 20;
+  this._latencies = [];
+  this._latenciesWindow = options.window || 100;
+  this._latenciesPos = 0;
+  this._percentileDelayMs = null;
+
+  this._stats = {queries: 0, hedged: 0, hedgeWins: 0};
+};
+
+/**
+ * MysqlHedgedReader#hedgeDelaySync() -> Number
+ *
+ * Returns current hedge delay in milliseconds
+ **/
+MysqlHedgedReader.prototype.hedgeDelaySync = function hedgeDelaySync() {
+  if (typeof this._delayMs === 'number') {
+    return this._delayMs;
+  }
+
+  if (this._percentileDelayMs === null) {
+    var sorted = this._latencies.slice().sort(function (a, b) {
+      return a - b;
+    });
+
+    // Cold process does not know latencies yet, so it hedges only slow reads
+    this._percentileDelayMs = sorted.length >= Math.min(this._minSamples, this._latenciesWindow) ?
+      Math.max(this._minDelayMs, sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * this._percentile))]) :
+      this._initialDelayMs;
+  }
+
+  return this._percentileDelayMs;
+};
+
+/*!
+ * MysqlHedgedReader#_sample(latency)
+ *
+ * Stores latency of winning answer for percentile delay
+ **/
+MysqlHedgedReader.prototype._sample = function (latency) {
+  this._latencies[this._latenciesPos] = latency;
+  this._latenciesPos = (this._latenciesPos + 1) % this._latenciesWindow;
+  this._percentileDelayMs = null;
+};
+
+/**
+ * MysqlHedgedReader#query(query[, options], callback)
+ * - query (String): Idempotent SELECT query
+ * - options (Object): Query options, passed to connection query()
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Performs a hedged read, other queries are sent to one replica without hedging.
+ * Loser query is canceled with KILL QUERY, its late result is freed
+ **/
+MysqlHedgedReader.prototype.query = function query(query, options, callback) {
+  var
+    self = this,
+    replicas = this._replicas,
+    first = this._next,
+    sent = 0,
+    pending = 0,
+    handles = [],
+    done = false,
+    started = Date.now(),
+    timer = null,
+    lastError = null,
+    hedging = replicas.length > 1 && isIdempotentRead(query);
+
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+  options = options || {};
+
+  this._next = (this._next + 1) % replicas.length;
+  this._stats.queries++;
+
+  function send() {
+    var i = sent, replica = replicas[(first + i) % replicas.length];
+
+    sent++;
+    pending++;
+
+    handles[i] = replica.query(query, options, function (err, res) {
+      pending--;
+      handles[i] = null;
+
+      if (done) {
+        // Late answer of the loser
+        if (res && typeof res.freeSync === 'function') {
+          res.freeSync();
+        }
+        return;
+      }
+
+      if (err) {
+        lastError = err;
+
+        // Don't wait for the hedge delay after failure
+        if (hedging && sent < 2) {
+          if (timer) {
+            clearTimeout(timer);
+            timer = null;
+          }
+          self._stats.hedged++;
+          send();
+          return;
+        }
+
+        if (pending > 0) {
+          return;
+        }
+      }
+
+      done = true;
+      if (timer) {
+        clearTimeout(timer);
+      }
+
+      if (!err) {
+        self._sample(Date.now() - started);
+        if (i > 0) {
+          self._stats.hedgeWins++;
+        }
+      }
+
+      handles.forEach(function (handle) {
+        if (handle && typeof handle.cancel === 'function') {
+          handle.cancel();
+        }
+      });
+
+      if (callback) {
+        callback(err ? lastError : null, res);
+      }
+    });
+  }
+
+  send();
+
+  if (hedging) {
+    timer = setTimeout(function () {
+      timer = null;
+      if (!done && sent < 2) {
+        self._stats.hedged++;
+        send();
+      }
+    }, this.hedgeDelaySync());
+  }
+};
+
+/**
+ * MysqlHedgedReader#statsSync() -> Object
+ *
+ * Returns number of queries, hedged queries and queries won by hedge,
+ * and current hedge delay
+ **/
+MysqlHedgedReader.prototype.statsSync = function statsSync() {
+  return {
+    queries: this._stats.queries,
+    hedged: this._stats.hedged,
+    hedgeWins: this._stats.hedgeWins,
+    delayMs: this.hedgeDelaySync()
+  };
+};
+
+/*!
+ * Export MysqlHedgedReader
+ */
+exports.MysqlHedgedReader = MysqlHedgedReader;
+
+/** section: Classes
+ * class MysqlRouter
+ *
+ * Read/write splitting router over primary and replica connections.
+ * Idempotent SELECTs go to the least loaded replica with replication lag
+ * under `maxLagMs`, other statements and all statements inside
+ * transaction go to the primary. Router is one logical session,
+ * transaction is pinned to one primary connection.
+ * With `readYourWrites` replica reads wait up to `gtidWaitTimeoutMs`
+ * for GTIDs of router writes, and are retried on primary on timeout
+ **/
+var MysqlRouter = function MysqlRouter(options) {
+  var self = this;
+
+  options = options || {};
+
+  this._primaries = this._targets(options.primary);
+  this._replicas = this._targets(options.replicas);
+
+  if (this._primaries.length === 0) {
+    throw new Error("mysql-libmysqlclient error: primary connection is required for MysqlRouter");
+  }
+
+  this._maxLagMs = typeof options.maxLagMs === 'number' ? options.maxLagMs : 1000;
+  this._lagSampler = options.lagSampler || MysqlRouter.sampleReplicaLag;
+  this._next = 0;
+
+  // Primary connection of current transaction
+  this._pinned = null;
+
+  this._readYourWrites = !!options.readYourWrites;
+  this._gtidWaitTimeoutMs = typeof options.gtidWaitTimeoutMs === 'number' ? options.gtidWaitTimeoutMs : 1000;
+  if (this._readYourWrites) {
+    this._primaries.forEach(function (target) {
+      target.connection.enableGtidTrackingSync();
+    });
+  }
+
+  this._lagTimer = null;
+  if (this._replicas.length > 0) {
+    this.sampleLag();
+    this._lagTimer = setInterval(function () {
+      self.sampleLag();
+    }, options.lagSampleIntervalMs || 1000);
+    if (this._lagTimer.unref) {
+      this._lagTimer.unref();
+    }
+  }
+};
+
+/*!
+ * MysqlRouter#_targets(connections) -> Array
+ *
+ * Wraps connections with routing state
+ **/
+MysqlRouter.prototype._targets = function (connections) {
+  if (!connections) {
+    return [];
+  }
+  if (!Array.isArray(connections)) {
+    connections = [connections];
+  }
+
+  return connections.map(function (connection) {
+    return {connection: connection, inFlight: 0, queries: 0, lagMs: null, sampling: false, lastGtid: null};
+  });
+};
+
+/**
+ * MysqlRouter.sampleReplicaLag(connection, callback)
+ * - connection (MysqlConnection): Replica connection
+ * - callback (Function): Gets (error, lagMs), lagMs is null if replication is not running
+ *
+ * Default lag sampler, reads Seconds_Behind_Master of SHOW SLAVE STATUS
+ **/
+MysqlRouter.sampleReplicaLag = function sampleReplicaLag(connection, callback) {
+  connection.query("SHOW SLAVE STATUS", {priority: 'background', resultMode: 'store'}, function (err, res) {
+    if (err) {
+      callback(err);
+      return;
+    }
+
+    var rows = res.fetchAllSync();
+    res.freeSync();
+
+    if (rows.length === 0 || rows[0].Seconds_Behind_Master === null) {
+      callback(null, null);
+      return;
+    }
+
+    callback(null, Number(rows[0].Seconds_Behind_Master) * 1000);
+  });
+};
+
+/**
+ * MysqlRouter#sampleLag()
+ *
+ * Samples replication lag of all replicas, called periodically by router
+ **/
+MysqlRouter.prototype.sampleLag = function sampleLag() {
+  var self = this;
+
+  this._replicas.forEach(function (target) {
+    if (target.sampling) {
+      return;
+    }
+    target.sampling = true;
+
+    self._lagSampler(target.connection, function (err, lagMs) {
+      target.sampling = false;
+      target.lagMs = err ? null : lagMs;
+    });
+  });
+};
+
+/**
+ * MysqlRouter.isRead(query) -> Boolean
+ *
+ * Checks that query can be routed to replica
+ **/
+MysqlRouter.isRead = isIdempotentRead;
+
+/*!
+ * MysqlRouter#_leastLoaded(targets, filter) -> Object
+ *
+ * Returns target with minimal number of queries in flight,
+ * equal ones are taken in round-robin order
+ **/
+MysqlRouter.prototype._leastLoaded = function (targets, filter) {
+  var best = null, target, i;
+
+  for (i = 0; i < targets.length; i++) {
+    target = targets[(this._next + i) % targets.length];
+    if (filter && !filter(target)) {
+      continue;
+    }
+    if (!best || target.inFlight < best.inFlight) {
+      best = target;
+    }
+  }
+
+  this._next++;
+
+  return best;
+};
+
+/*!
+ * MysqlRouter#_route(query) -> Object
+ *
+ * Returns target for query and tracks transaction state
+ **/
+MysqlRouter.prototype._route = function (query) {
+  var maxLagMs = this._maxLagMs, target;
+
+  if (this._pinned) {
+    target = this._pinned;
+  } else if (isIdempotentRead(query)) {
+    target = this._leastLoaded(this._replicas, function (replica) {
+      return replica.lagMs !== null && replica.lagMs <= maxLagMs;
+    }) || this._leastLoaded(this._primaries);
+  } else {
+    target = this._leastLoaded(this._primaries);
+  }
+
+  if ((/^\s*(BEGIN|START\s+TRANSACTION)\b|^\s*SET\s+(@@(SESSION\.)?)?autocommit\s*=\s*(0|OFF)\b/i).test(query)) {
+    this._pinned = target;
+  } else if ((/^\s*(COMMIT|ROLLBACK(?!\s+(WORK\s+)?TO\b))\b|^\s*SET\s+(@@(SESSION\.)?)?autocommit\s*=\s*(1|ON)\b/i).test(query)) {
+    this._pinned = null;
+  }
+
+  return target;
+};
+
+/**
+ * MysqlRouter#route(query) -> MysqlConnection
+ * - query (String): Query
+ *
+ * Returns connection which query would be sent to,
+ * transaction statements change router state same way as in MysqlRouter#query()
+ **/
+MysqlRouter.prototype.route = function route(query) {
+  return this._route(query).connection;
+};
+
+/**
+ * MysqlRouter#query(query[, options], callback) -> Object
+ * - query (String): Query
+ * - options (Object): Query options, passed to connection query()
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Routes query and performs it, returns query handle
+ **/
+MysqlRouter.prototype.query = function query(query, options, callback) {
+  var self = this, target = this._route(query), isReplica, waitOptions, gtids, key;
+
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+  options = options || {};
+
+  isReplica = this._replicas.indexOf(target) !== -1;
+  waitOptions = options;
+
+  if (this._readYourWrites && isReplica) {
+    gtids = this._primaries.map(function (primary) {
+      return primary.lastGtid;
+    }).filter(function (gtid) {
+      return gtid !== null;
+    });
+
+    if (gtids.length > 0) {
+      waitOptions = {};
+      for (key in options) {
+        if (options.hasOwnProperty(key)) {
+          waitOptions[key] = options[key];
+        }
+      }
+      waitOptions.waitForGtid = gtids.join(',');
+      waitOptions.waitForGtidTimeoutMs = this._gtidWaitTimeoutMs;
+    }
+  }
+
+  target.inFlight++;
+  target.queries++;
+
+  return target.connection.query(query, waitOptions, function (err, res) {
+    target.inFlight--;
+
+    if (!err && self._readYourWrites && !isReplica) {
+      target.lastGtid = target.connection.lastGtidSync();
+    }
+
+    // Replica is behind router writes, primary has them
+    if (err && waitOptions !== options && err.code === "EGTIDTIMEOUT") {
+      target = self._leastLoaded(self._primaries);
+      target.inFlight++;
+      target.queries++;
+
+      target.connection.query(query, options, function (err, res) {
+        target.inFlight--;
+
+        if (callback) {
+          callback(err, res);
+        }
+      });
+      return;
+    }
+
+    if (callback) {
+      callback(err, res);
+    }
+  });
+};
+
+/**
+ * MysqlRouter#statsSync() -> Object
+ *
+ * Returns queries in flight, total queries and last sampled lag of every connection
+ **/
+MysqlRouter.prototype.statsSync = function statsSync() {
+  function stats(target) {
+    return {inFlight: target.inFlight, queries: target.queries, lagMs: target.lagMs};
+  }
+
+  return {
+    primary: this._primaries.map(stats),
+    replicas: this._replicas.map(stats),
+    inTransaction: this._pinned !== null
+  };
+};
+
+/**
+ * MysqlRouter#closeSync()
+ *
+ * Stops lag sampling, connections are not closed
+ **/
+MysqlRouter.prototype.closeSync = function closeSync() {
+  if (this._lagTimer) {
+    clearInterval(this._lagTimer);
+    this._lagTimer = null;
+  }
+};
+
+/*!
+ * Export MysqlRouter
+ */
+exports.MysqlRouter = MysqlRouter;
+
+/*!
+ * mul32(a, b) -> Number
+ *
+ * Multiplies 32-bit integers modulo 2^32, Math.imul is used if available
+ **/
+var mul32 = Math.imul || function (a, b) {
+  return ((a & 0xffff) * b + ((((a >>> 16) * b) & 0xffff) << 16)) | 0;
+};
+
+/*!
+ * hashKey(key) -> Number
+ * - key (String|Number): Shard key
+ *
+ * 32-bit FNV-1a hash of key with murmur3 finalizer.
+ * Numbers are hashed as their decimal strings, so 42 and "42"
+ * from result row go to the same shard
+ **/
+function hashKey(key) {
+  var h = 0x811c9dc5, i, c;
+
+  key = String(key);
+  for (i = 0; i < key.length; i++) {
+    c = key.charCodeAt(i);
+    h = mul32(h ^ (c & 0xff), 0x01000193);
+    if (c > 0xff) {
+      h = mul32(h ^ (c >>> 8), 0x01000193);
+    }
+  }
+
+  h = mul32(h ^ (h >>> 16), 0x85ebca6b);
+  h = mul32(h ^ (h >>> 13), 0xc2b2ae35);
+
+  return (h ^ (h >>> 16)) >>> 0;
+}
+
+/** section: Classes
+ * class MysqlShardMap
+ *
+ * Routes queries by shard key to groups of connections.
+ * Keys are placed on consistent hash ring with `pointsPerWeight` points
+ * per unit of shard weight, ring is flattened into 65536-bucket table,
+ * so key lookup is one hash and one array read. Changing shard weight
+ * moves only keys of ring ranges whose owner changes
+ **/
+var MysqlShardMap = function MysqlShardMap(shards, options) {
+  options = options || {};
+
+  if (!Array.isArray(shards) || shards.length === 0) {
+    throw new Error("mysql-libmysqlclient error: shards array is required for MysqlShardMap");
+  }
+
+  this._pointsPerWeight = options.pointsPerWeight || 160;
+
+  this._shards = shards.map(function (shard, index) {
+    var connections = Array.isArray(shard.connections) ? shard.connections : [shard.connections];
+
+    if (!shard.connections || connections.length === 0) {
+      throw new Error("mysql-libmysqlclient error: shard must have connections");
+    }
+
+    return {
+      name: shard.name !== undefined ? String(shard.name) : String(index),
+      weight: typeof shard.weight === 'number' ? shard.weight : 1,
+      connections: connections,
+      connectionsInFlight: connections.map(function () {
+        return 0;
+      }),
+      inFlight: 0,
+      queries: 0,
+      errors: 0,
+      totalMs: 0,
+      buckets: 0
+    };
+  });
+
+  this._table = new Uint16Array(65536);
+  this._rebuild();
+};
+
+/*!
+ * MysqlShardMap#_rebuild()
+ *
+ * Places shards on ring and fills bucket table
+ **/
+MysqlShardMap.prototype._rebuild = function () {
+  var points = [], shards = this._shards, table = this._table, pointsPerWeight = this._pointsPerWeight, p, b, bucketStart;
+
+  shards.forEach(function (shard, index) {
+    var count = Math.round(shard.weight * pointsPerWeight), i;
+
+    for (i = 0; i < count; i++) {
+      points.push({hash: hashKey(shard.name + "#" + i), shard: index});
+    }
+    shard.buckets = 0;
+  });
+
+  if (points.length === 0) {
+    throw new Error("mysql-libmysqlclient error: at least one shard must have positive weight");
+  }
+
+  points.sort(function (a, b) {
+    return a.hash - b.hash || a.shard - b.shard;
+  });
+
+  // Bucket belongs to the first ring point at or after its start
+  p = 0;
+  for (b = 0; b < 65536; b++) {
+    bucketStart = b * 65536;
+    while (p < points.length && points[p].hash < bucketStart) {
+      p++;
+    }
+    table[b] = points[p < points.length ? p : 0].shard;
+    shards[table[b]].buckets++;
+  }
+};
+
+/**
+ * MysqlShardMap#shardIndex(key) -> Number
+ * - key (String|Number): Shard key
+ *
+ * Returns index of shard owning key
+ **/
+MysqlShardMap.prototype.shardIndex = function shardIndex(key) {
+  return this._table[hashKey(key) >>> 16];
+};
+
+/**
+ * MysqlShardMap#shardName(key) -> String
+ * - key (String|Number): Shard key
+ *
+ * Returns name of shard owning key
+ **/
+MysqlShardMap.prototype.shardName = function shardName(key) {
+  return this._shards[this.shardIndex(key)].name;
+};
+
+/**
+ * MysqlShardMap#queryShard(key, query[, options], callback) -> Object
+ * - key (String|Number): Shard key
+ * - query (String): Query
+ * - options (Object): Query options, passed to connection query()
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Performs query on the least loaded connection of shard owning key,
+ * returns query handle
+ **/
+MysqlShardMap.prototype.queryShard = function queryShard(key, query, options, callback) {
+  var shard = this._shards[this._table[hashKey(key) >>> 16]], best = 0, started, i;
+
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+
+  for (i = 1; i < shard.connections.length; i++) {
+    if (shard.connectionsInFlight[i] < shard.connectionsInFlight[best]) {
+      best = i;
+    }
+  }
+
+  shard.inFlight++;
+  shard.queries++;
+  shard.connectionsInFlight[best]++;
+  started = Date.now();
+
+  return shard.connections[best].query(query, options || {}, function (err, res) {
+    shard.inFlight--;
+    shard.connectionsInFlight[best]--;
+    shard.totalMs += Date.now() - started;
+    if (err) {
+      shard.errors++;
+    }
+
+    if (callback) {
+      callback(err, res);
+    }
+  });
+};
+
+/**
+ * MysqlShardMap#setWeightSync(name, weight)
+ * - name (String): Shard name
+ * - weight (Number): New weight, 0 drains shard
+ *
+ * Changes shard weight and rebalances keys
+ **/
+MysqlShardMap.prototype.setWeightSync = function setWeightSync(name, weight) {
+  var shard = null, previous, i;
+
+  for (i = 0; i < this._shards.length; i++) {
+    if (this._shards[i].name === String(name)) {
+      shard = this._shards[i];
+    }
+  }
+
+  if (!shard) {
+    throw new Error("mysql-libmysqlclient error: unknown shard " + name);
+  }
+  if (typeof weight !== 'number' || weight < 0) {
+    throw new TypeError("mysql-libmysqlclient error: shard weight must be a non-negative number");
+  }
+
+  previous = shard.weight;
+  shard.weight = weight;
+
+  try {
+    this._rebuild();
+  } catch (e) {
+    shard.weight = previous;
+    this._rebuild();
+    throw e;
+  }
+};
+
+/**
+ * MysqlShardMap#statsSync() -> Array
+ *
+ * Returns weight, share of keys, queries in flight, total queries,
+ * errors and average latency of every shard
+ **/
+MysqlShardMap.prototype.statsSync = function statsSync() {
+  return this._shards.map(function (shard) {
+    var completed = shard.queries - shard.inFlight;
+
+    return {
+      name: shard.name,
+      weight: shard.weight,
+      keyShare: shard.buckets / 65536,
+      inFlight: shard.inFlight,
+      queries: shard.queries,
+      errors: shard.errors,
+      avgLatencyMs: completed > 0 ? shard.totalMs / completed : null
+    };
+  });
+};
+
+/*!
+ * Export MysqlShardMap
+ */
+exports.MysqlShardMap = MysqlShardMap;
+
+/*!
+ * parseOrderBy(orderBy) -> Array
+ * - orderBy (String|Array): ORDER BY clause like "a DESC, b" or array of {column, desc}
+ *
+ * Parses ORDER BY clause to mergeSortedSync() keys
+ **/
+function parseOrderBy(orderBy) {
+  if (typeof orderBy !== 'string') {
+    return orderBy;
+  }
+
+  return orderBy.split(',').map(function (key) {
+    var parts = key.trim().split(/\s+/);
+
+    return {
+      column: parts[0].replace(/^`|`$/g, ''),
+      desc: parts.length > 1 && parts[1].toUpperCase() === 'DESC'
+    };
+  });
+}
+
+/** section: Exports
+ * MysqlLibmysqlclient.scatter(connections, query[, options], callback)
+ * - connections (Array): Connections to shards
+ * - query (String): SELECT query, sorted by `orderBy` and limited on every shard
+ * - options (Object): `orderBy` (String or Array of {column, desc}), `limit`,
+ *   `asArray` and `queryOptions` passed to every connection query(),
+ *   results are always stored and neither cached nor coalesced
+ * - callback (Function): Callback function, gets (error, rows)
+ *
+ * Performs query on all connections in parallel and merges
+ * sorted shard results natively, only final rows are converted to JS values
+ **/
+exports.scatter = function scatter(connections, query, options, callback) {
+  var results = [], pending = connections.length, failure = null, queryOptions = {}, name;
+
+  if (typeof options === 'function') {
+    callback = options;
+    options = {};
+  }
+  options = options || {};
+
+  // Merge needs stored result sets, cached, coalesced and streamed results are row arrays
+  for (name in options.queryOptions) {
+    if (options.queryOptions.hasOwnProperty(name)
+        && name !== 'cacheTtlMs' && name !== 'cacheTags' && name !== 'coalesce' && name !== 'onChunk') {
+      queryOptions[name] = options.queryOptions[name];
+    }
+  }
+  queryOptions.resultMode = 'store';
+
+  function finish() {
+    var rows = [];
+
+    // Shard order is kept, so rows with equal keys are ordered by shard
+    results = results.filter(function (res) {
+      return res !== undefined;
+    });
+
+    if (!failure && results.length > 0) {
+      try {
+        rows = results[0].mergeSortedSync(results.slice(1), {
+          orderBy: options.orderBy !== undefined ? parseOrderBy(options.orderBy) : undefined,
+          limit: options.limit,
+          asArray: !!options.asArray
+        });
+      } catch (e) {
+        failure = e;
+      }
+    }
+
+    results.forEach(function (res) {
+      res.freeSync();
+    });
+
+    callback(failure, failure ? undefined : rows);
+  }
+
+  if (pending === 0) {
+    process.nextTick(finish);
+    return;
+  }
+
+  connections.forEach(function (connection, i) {
+    connection.query(query, queryOptions, function (err, res) {
+      if (err) {
+        failure = failure || err;
+      } else if (res instanceof bindings.MysqlResult) {
+        results[i] = res;
+      } else {
+        failure = failure || new Error("mysql-libmysqlclient error: scatter query must return stored result set");
+      }
+
+      pending--;
+      if (pending === 0) {
+        finish();
+      }
+    });
+  });
+};
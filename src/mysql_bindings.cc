@@ -46,6 +46,16 @@
     }  // namespace node
 #endif
 
+/*!
+ * libmysqlclient global state must be set up once per process,
+ * mysql_init() does it implicitly, but not in a thread-safe way
+ */
+static pthread_once_t library_init_once = PTHREAD_ONCE_INIT;
+
+static void InitMysqlLibrary() {
+    mysql_library_init(0, NULL, NULL);
+}
+
 /*!
  * Init V8 structures
  *
@@ -58,6 +68,8 @@
 void InitMysqlLibmysqlclient(Handle<Object> target) {
     HandleScope scope;
 
+    pthread_once(&library_init_once, InitMysqlLibrary);
+
     //// Populate classes constructors
     MysqlConnection::Init(target);
     MysqlResult::Init(target);
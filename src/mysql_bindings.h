@@ -78,6 +78,12 @@ return ThrowException(Exception::TypeError( \
 String::New("Argument " #I " must be an array"))); \
 Local<Array> VAR = Local<Array>::Cast(args[I]);
 
+#define REQ_OBJ_ARG(I, VAR) \
+if (args.Length() <= (I) || !args[I]->IsObject()) \
+return ThrowException(Exception::TypeError( \
+String::New("Argument " #I " must be an object"))); \
+Local<Object> VAR = args[I]->ToObject();
+
 #define REQ_EXT_ARG(I, VAR) \
 if (args.Length() <= (I) || !args[I]->IsExternal()) \
 return ThrowException(Exception::TypeError( \
@@ -0,0 +1,575 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#include "./mysql_bindings_aggregate.h"
+#include "./mysql_bindings_result.h"
+
+// Length of NULL value in group key
+#define AGGREGATE_NULL_LENGTH 0xFFFFFFFFU
+
+static const char *accumulator_prefixes[MysqlAggregator::ACC_KINDS] = {"sum_", "min_", "max_"};
+
+MysqlAggregator::MysqlAggregator():
+    group_columns(NULL),
+    group_column_count(0),
+    acc_stride(0),
+    count(false),
+    groups(NULL),
+    acc(NULL),
+    group_count(0),
+    group_capacity(0),
+    slots(NULL),
+    slot_count(0),
+    key_buffer(NULL),
+    key_buffer_len(0) {
+    for (int kind = 0; kind < ACC_KINDS; kind++) {
+        this->acc_columns[kind] = NULL;
+        this->acc_column_count[kind] = 0;
+    }
+}
+
+MysqlAggregator::~MysqlAggregator() {
+    uint32_t i;
+
+    for (i = 0; i < this->group_column_count; i++) {
+        delete[] this->group_columns[i].name;
+    }
+    delete[] this->group_columns;
+
+    for (int kind = 0; kind < ACC_KINDS; kind++) {
+        for (i = 0; i < this->acc_column_count[kind]; i++) {
+            delete[] this->acc_columns[kind][i].name;
+        }
+        delete[] this->acc_columns[kind];
+    }
+
+    for (i = 0; i < this->group_count; i++) {
+        delete[] this->groups[i].key;
+    }
+    for (size_t a = 0; a < static_cast<size_t>(this->group_count) * this->acc_stride; a++) {
+        delete[] this->acc[a].text;
+    }
+    delete[] this->groups;
+    delete[] this->acc;
+    delete[] this->slots;
+    delete[] this->key_buffer;
+}
+
+void MysqlAggregator::AddColumn(column **columns, uint32_t *count, const char *name) {
+    column *grown = new column[*count + 1];
+
+    if (*count) {
+        memcpy(grown, *columns, *count * sizeof(column));
+    }
+    delete[] *columns;
+    *columns = grown;
+
+    column *added = &grown[(*count)++];
+    size_t name_len = strlen(name);
+    added->name = new char[name_len + 1];
+    memcpy(added->name, name, name_len + 1);
+    added->field = 0;
+    added->type = MYSQL_TYPE_NULL;
+    added->flags = 0;
+    added->decimals = 0;
+    added->numeric = NUMERIC_SIGNED;
+}
+
+void MysqlAggregator::AddGroupColumn(const char *name) {
+    AddColumn(&this->group_columns, &this->group_column_count, name);
+}
+
+void MysqlAggregator::AddAccumulator(accumulator_kind kind, const char *name) {
+    AddColumn(&this->acc_columns[kind], &this->acc_column_count[kind], name);
+    this->acc_stride++;
+}
+
+void MysqlAggregator::SetCount(bool count) {
+    this->count = count;
+}
+
+const char *MysqlAggregator::BindColumns(column *columns, uint32_t count,
+                                         MYSQL_FIELD *fields, uint32_t num_fields,
+                                         bool numeric) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t j;
+        for (j = 0; j < num_fields && strcmp(fields[j].name, columns[i].name); j++) {}
+
+        if (j == num_fields) {
+            return "Column from aggregation options is not found in result";
+        }
+
+        columns[i].field = j;
+        columns[i].type = fields[j].type;
+        columns[i].flags = fields[j].flags;
+        columns[i].decimals = fields[j].decimals;
+
+        if (!numeric) {
+            continue;
+        }
+
+        switch (fields[j].type) {
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONGLONG:
+            case MYSQL_TYPE_YEAR:
+                columns[i].numeric = (fields[j].flags & UNSIGNED_FLAG) ? NUMERIC_UNSIGNED : NUMERIC_SIGNED;
+                columns[i].decimals = 0;
+                break;
+            case MYSQL_TYPE_FLOAT:
+            case MYSQL_TYPE_DOUBLE:
+                columns[i].numeric = NUMERIC_REAL;
+                break;
+            case MYSQL_TYPE_DECIMAL:
+            case MYSQL_TYPE_NEWDECIMAL:
+                columns[i].numeric = NUMERIC_DECIMAL;
+                break;
+            default:
+                return "Column of sum, min or max must be numeric";
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+ * Resolves column names, called in the threadpool after mysql_use_result()
+ */
+const char *MysqlAggregator::Bind(MYSQL_FIELD *fields, uint32_t num_fields) {
+    const char *error = BindColumns(this->group_columns, this->group_column_count, fields, num_fields, false);
+
+    for (int kind = 0; !error && kind < ACC_KINDS; kind++) {
+        error = BindColumns(this->acc_columns[kind], this->acc_column_count[kind], fields, num_fields, true);
+    }
+
+    return error;
+}
+
+/*!
+ * Compares DECIMAL values in text form exactly
+ */
+int MysqlAggregator::CompareDecimalText(const char *a, const char *b) {
+    bool a_negative = *a == '-', b_negative = *b == '-';
+    if (*a == '-' || *a == '+') {
+        a++;
+    }
+    if (*b == '-' || *b == '+') {
+        b++;
+    }
+
+    // -0.00 is not less than 0.00
+    if (a_negative && !a[strspn(a, "0.")]) {
+        a_negative = false;
+    }
+    if (b_negative && !b[strspn(b, "0.")]) {
+        b_negative = false;
+    }
+    if (a_negative != b_negative) {
+        return a_negative ? -1 : 1;
+    }
+
+    a += strspn(a, "0");
+    b += strspn(b, "0");
+
+    // Magnitudes are compared by length of integer part, then digit by digit
+    size_t a_int = strspn(a, "0123456789"), b_int = strspn(b, "0123456789");
+    int r = a_int < b_int ? -1 : (a_int > b_int ? 1 : memcmp(a, b, a_int));
+
+    if (!r) {
+        a += a_int;
+        b += b_int;
+        if (*a == '.') {
+            a++;
+        }
+        if (*b == '.') {
+            b++;
+        }
+        while (!r && (*a || *b)) {
+            char a_digit = *a ? *a++ : '0', b_digit = *b ? *b++ : '0';
+            r = a_digit - b_digit;
+        }
+    }
+
+    r = r < 0 ? -1 : (r > 0 ? 1 : 0);
+
+    return a_negative ? -r : r;
+}
+
+/*!
+ * Compares NUL-terminated values of numeric column
+ */
+int MysqlAggregator::CompareValues(const column &col, const char *a, const char *b) {
+    switch (col.numeric) {
+        case NUMERIC_SIGNED: {
+            long long a_value = strtoll(a, NULL, 10), b_value = strtoll(b, NULL, 10); // NOLINT
+            return a_value < b_value ? -1 : (a_value > b_value ? 1 : 0);
+        }
+        case NUMERIC_UNSIGNED: {
+            unsigned long long a_value = strtoull(a, NULL, 10), b_value = strtoull(b, NULL, 10); // NOLINT
+            return a_value < b_value ? -1 : (a_value > b_value ? 1 : 0);
+        }
+        case NUMERIC_REAL: {
+            double a_value = strtod(a, NULL), b_value = strtod(b, NULL);
+            return a_value < b_value ? -1 : (a_value > b_value ? 1 : 0);
+        }
+        default:
+            return CompareDecimalText(a, b);
+    }
+}
+
+/*!
+ * Adds integer or DECIMAL value in text form to exact sum scaled by 10^scale
+ */
+void MysqlAggregator::AddExact(accumulator *a, const char *value, unsigned int scale) {
+    char digits[9 * EXACT_LIMBS];
+    size_t n = 0;
+    unsigned int fraction = 0;
+
+    bool negative = *value == '-';
+    if (*value == '-' || *value == '+') {
+        value++;
+    }
+
+    for (; *value >= '0' && *value <= '9'; value++) {
+        if (n < sizeof(digits)) {
+            digits[n++] = *value;
+        }
+    }
+    if (*value == '.') {
+        for (value++; *value >= '0' && *value <= '9' && fraction < scale; value++, fraction++) {
+            if (n < sizeof(digits)) {
+                digits[n++] = *value;
+            }
+        }
+    }
+    for (; fraction < scale && n < sizeof(digits); fraction++) {
+        digits[n++] = '0';
+    }
+
+    uint32_t *limbs = negative ? a->negative : a->positive;
+    uint64_t carry = 0;
+
+    // Digits are added from the least significant ones, 9 per limb
+    for (uint32_t l = 0; l < EXACT_LIMBS && (n > 0 || carry); l++) {
+        size_t start = n > 9 ? n - 9 : 0;
+        uint32_t chunk = 0;
+
+        for (size_t d = start; d < n; d++) {
+            chunk = chunk * 10 + (digits[d] - '0');
+        }
+        n = start;
+
+        uint64_t sum = static_cast<uint64_t>(limbs[l]) + chunk + carry;
+        limbs[l] = static_cast<uint32_t>(sum % 1000000000);
+        carry = sum / 1000000000;
+    }
+}
+
+/*!
+ * Returns exact sum as DECIMAL text with scale digits after point
+ */
+char *MysqlAggregator::ExactSumText(const accumulator *a, unsigned int scale) {
+    const uint32_t *larger = a->positive, *smaller = a->negative;
+    bool negative = false;
+    int l;
+
+    for (l = EXACT_LIMBS - 1; l >= 0 && larger[l] == smaller[l]; l--) {}
+    if (l >= 0 && larger[l] < smaller[l]) {
+        larger = a->negative;
+        smaller = a->positive;
+        negative = true;
+    }
+
+    uint32_t difference[EXACT_LIMBS];
+    uint32_t borrow = 0;
+    for (uint32_t i = 0; i < EXACT_LIMBS; i++) {
+        int64_t d = static_cast<int64_t>(larger[i]) - smaller[i] - borrow;
+        borrow = d < 0 ? 1 : 0;
+        difference[i] = static_cast<uint32_t>(d < 0 ? d + 1000000000 : d);
+    }
+
+    // Most significant limb first
+    char digits[9 * EXACT_LIMBS + 1];
+    for (uint32_t i = 0; i < EXACT_LIMBS; i++) {
+        snprintf(digits + 9 * i, 10, "%09u", difference[EXACT_LIMBS - 1 - i]);
+    }
+
+    size_t n = 9 * EXACT_LIMBS;
+    size_t first = 0;
+    while (first + scale + 1 < n && digits[first] == '0') {
+        first++;
+    }
+
+    char *text = new char[n - first + 3];
+    char *t = text;
+    if (negative) {
+        *t++ = '-';
+    }
+    memcpy(t, digits + first, n - scale - first);
+    t += n - scale - first;
+    if (scale) {
+        *t++ = '.';
+        memcpy(t, digits + n - scale, scale);
+        t += scale;
+    }
+    *t = '\0';
+
+    return text;
+}
+
+void MysqlAggregator::GrowSlots() {
+    uint32_t new_slot_count = this->slot_count ? this->slot_count * 2 : 64;
+    uint32_t *new_slots = new uint32_t[new_slot_count];
+
+    memset(new_slots, 0, new_slot_count * sizeof(uint32_t));
+
+    for (uint32_t g = 0; g < this->group_count; g++) {
+        uint32_t s = this->groups[g].hash & (new_slot_count - 1);
+        while (new_slots[s]) {
+            s = (s + 1) & (new_slot_count - 1);
+        }
+        new_slots[s] = g + 1;
+    }
+
+    delete[] this->slots;
+    this->slots = new_slots;
+    this->slot_count = new_slot_count;
+}
+
+uint32_t MysqlAggregator::NewGroup(uint32_t hash, const char *key, size_t key_len) {
+    if (this->group_count == this->group_capacity) {
+        uint32_t capacity = this->group_capacity ? this->group_capacity * 2 : 16;
+
+        group *grown_groups = new group[capacity];
+        accumulator *grown_acc = new accumulator[static_cast<size_t>(capacity) * this->acc_stride + 1];
+
+        if (this->group_count) {
+            memcpy(grown_groups, this->groups, this->group_count * sizeof(group));
+            memcpy(grown_acc, this->acc, this->group_count * this->acc_stride * sizeof(accumulator));
+        }
+
+        delete[] this->groups;
+        delete[] this->acc;
+
+        this->groups = grown_groups;
+        this->acc = grown_acc;
+        this->group_capacity = capacity;
+    }
+
+    uint32_t g = this->group_count++;
+
+    this->groups[g].hash = hash;
+    this->groups[g].key = new char[key_len + 1];
+    memcpy(this->groups[g].key, key, key_len);
+    this->groups[g].key_len = key_len;
+    this->groups[g].count = 0;
+
+    memset(this->acc + static_cast<size_t>(g) * this->acc_stride, 0, this->acc_stride * sizeof(accumulator));
+
+    return g;
+}
+
+uint32_t MysqlAggregator::FindGroup(MYSQL_ROW row, unsigned long *lengths) {
+    size_t key_len = 0;
+    uint32_t i;
+
+    for (i = 0; i < this->group_column_count; i++) {
+        uint32_t f = this->group_columns[i].field;
+        key_len += sizeof(uint32_t) + (row[f] ? lengths[f] : 0);
+    }
+
+    if (key_len > this->key_buffer_len) {
+        delete[] this->key_buffer;
+        this->key_buffer_len = key_len * 2;
+        this->key_buffer = new char[this->key_buffer_len];
+    }
+
+    char *k = this->key_buffer;
+    for (i = 0; i < this->group_column_count; i++) {
+        uint32_t f = this->group_columns[i].field;
+        uint32_t length = row[f] ? static_cast<uint32_t>(lengths[f]) : AGGREGATE_NULL_LENGTH;
+
+        memcpy(k, &length, sizeof(length));
+        k += sizeof(length);
+        if (row[f]) {
+            memcpy(k, row[f], lengths[f]);
+            k += lengths[f];
+        }
+    }
+
+    uint32_t hash = 2166136261u;
+    for (i = 0; i < key_len; i++) {
+        hash = (hash ^ static_cast<unsigned char>(this->key_buffer[i])) * 16777619u;
+    }
+
+    if (!this->slot_count) {
+        this->GrowSlots();
+    }
+
+    uint32_t s = hash & (this->slot_count - 1);
+    while (this->slots[s]) {
+        group *candidate = &this->groups[this->slots[s] - 1];
+        if (candidate->hash == hash && candidate->key_len == key_len
+            && !memcmp(candidate->key, this->key_buffer, key_len)) {
+            return this->slots[s] - 1;
+        }
+        s = (s + 1) & (this->slot_count - 1);
+    }
+
+    uint32_t g = this->NewGroup(hash, this->key_buffer, key_len);
+    this->slots[s] = g + 1;
+
+    // Load factor is kept under 1/2
+    if (this->group_count * 2 > this->slot_count) {
+        this->GrowSlots();
+    }
+
+    return g;
+}
+
+/*!
+ * Adds row to its group, called in the threadpool
+ */
+void MysqlAggregator::AddRow(MYSQL_ROW row, unsigned long *lengths) {
+    uint32_t g;
+
+    if (this->group_column_count) {
+        g = this->FindGroup(row, lengths);
+    } else {
+        g = this->group_count ? 0 : this->NewGroup(0, "", 0);
+    }
+
+    this->groups[g].count++;
+
+    accumulator *group_acc = this->acc + static_cast<size_t>(g) * this->acc_stride;
+    uint32_t a = 0;
+
+    for (int kind = 0; kind < ACC_KINDS; kind++) {
+        for (uint32_t i = 0; i < this->acc_column_count[kind]; i++, a++) {
+            const column &col = this->acc_columns[kind][i];
+            // Cells of text protocol are NUL-terminated
+            const char *value = row[col.field];
+            if (!value) {
+                continue;
+            }
+
+            if (kind == ACC_SUM) {
+                if (col.numeric == NUMERIC_REAL) {
+                    group_acc[a].real += strtod(value, NULL);
+                } else {
+                    AddExact(&group_acc[a], value, col.decimals);
+                }
+            } else if (!group_acc[a].values
+                    || (kind == ACC_MIN ? CompareValues(col, value, group_acc[a].text) < 0
+                                        : CompareValues(col, value, group_acc[a].text) > 0)) {
+                size_t length = lengths[col.field];
+                if (length + 1 > group_acc[a].text_capacity) {
+                    delete[] group_acc[a].text;
+                    group_acc[a].text_capacity = length + 1 > 32 ? length + 1 : 32;
+                    group_acc[a].text = new char[group_acc[a].text_capacity];
+                }
+                memcpy(group_acc[a].text, value, length + 1);
+            }
+            group_acc[a].values++;
+        }
+    }
+}
+
+/*!
+ * Converts groups to array of objects with groupBy columns, `count`
+ * and `sum_<column>`, `min_<column>`, `max_<column>` properties.
+ * Without groupBy there is one row even for no rows, as in SQL
+ */
+Local<Array> MysqlAggregator::ToArray() {
+    HandleScope scope;
+
+    Local<Array> js_result = Array::New();
+
+    if (!this->group_column_count && !this->group_count) {
+        this->NewGroup(0, "", 0);
+    }
+
+    for (uint32_t g = 0; g < this->group_count; g++) {
+        Local<Object> js_row = Object::New();
+        const char *k = this->groups[g].key;
+        uint32_t i;
+
+        for (i = 0; i < this->group_column_count; i++) {
+            uint32_t length;
+            memcpy(&length, k, sizeof(length));
+            k += sizeof(length);
+
+            MYSQL_FIELD field;
+            memset(&field, 0, sizeof(field));
+            field.type = this->group_columns[i].type;
+            field.flags = this->group_columns[i].flags;
+
+            if (length == AGGREGATE_NULL_LENGTH) {
+                js_row->Set(V8STR(this->group_columns[i].name), MysqlResult::GetFieldValue(field, NULL, 0));
+                continue;
+            }
+
+            // GetFieldValue needs NUL-terminated value and can modify it
+            char *value = new char[length + 1];
+            memcpy(value, k, length);
+            value[length] = '\0';
+            k += length;
+
+            js_row->Set(V8STR(this->group_columns[i].name), MysqlResult::GetFieldValue(field, value, length));
+
+            delete[] value;
+        }
+
+        if (this->count) {
+            js_row->Set(V8STR("count"), Number::New(static_cast<double>(this->groups[g].count)));
+        }
+
+        accumulator *group_acc = this->acc + static_cast<size_t>(g) * this->acc_stride;
+        uint32_t a = 0;
+
+        for (int kind = 0; kind < ACC_KINDS; kind++) {
+            for (i = 0; i < this->acc_column_count[kind]; i++, a++) {
+                const column &col = this->acc_columns[kind][i];
+                size_t property_len = strlen(accumulator_prefixes[kind]) + strlen(col.name) + 1;
+                char *property = new char[property_len];
+                snprintf(property, property_len, "%s%s", accumulator_prefixes[kind], col.name);
+
+                MYSQL_FIELD field;
+                memset(&field, 0, sizeof(field));
+                field.type = col.type;
+                field.flags = col.flags;
+
+                if (!group_acc[a].values) {
+                    js_row->Set(V8STR(property), Null());
+                } else if (kind == ACC_SUM && col.numeric == NUMERIC_REAL) {
+                    js_row->Set(V8STR(property), Number::New(group_acc[a].real));
+                } else if (kind == ACC_SUM) {
+                    // SUM() of exact values is DECIMAL in SQL
+                    char *value = ExactSumText(&group_acc[a], col.decimals);
+                    field.type = MYSQL_TYPE_NEWDECIMAL;
+                    js_row->Set(V8STR(property), MysqlResult::GetFieldValue(field, value, strlen(value)));
+                    delete[] value;
+                } else {
+                    // Min and max are values of the column
+                    size_t length = strlen(group_acc[a].text);
+                    char *value = new char[length + 1];
+                    memcpy(value, group_acc[a].text, length + 1);
+                    js_row->Set(V8STR(property), MysqlResult::GetFieldValue(field, value, length));
+                    delete[] value;
+                }
+
+                delete[] property;
+            }
+        }
+
+        js_result->Set(Integer::NewFromUnsigned(g), js_row);
+    }
+
+    return scope.Close(js_result);
+}
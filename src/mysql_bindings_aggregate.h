@@ -0,0 +1,144 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_AGGREGATE_H_
+#define SRC_MYSQL_BINDINGS_AGGREGATE_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "./mysql_bindings.h"
+
+using namespace v8; // NOLINT
+
+/*!
+ * Grouped aggregation over streamed rows
+ *
+ * Columns are named in spec on the event loop thread and bound
+ * to result fields in the threadpool, rows are added there one by one
+ * as they are read with mysql_use_result, so result is never buffered.
+ * Groups are kept in open addressing hash table keyed by raw values
+ * of groupBy columns. Without groupBy the only group is updated directly.
+ *
+ * Accumulators of a group are one flat array:
+ *   sums of `sum` columns, then mins of `min` columns, then maxs of `max` columns
+ * Only numeric columns can be aggregated. Sums of integer and DECIMAL columns
+ * are exact, as SQL SUM() is, sums of FLOAT and DOUBLE columns are doubles.
+ * Min and max keep text of the value and compare it by column type.
+ * NULL values are skipped, aggregate of only NULLs is NULL, as in SQL
+ */
+class MysqlAggregator {
+  public:
+    enum accumulator_kind {
+        ACC_SUM = 0,
+        ACC_MIN,
+        ACC_MAX,
+        ACC_KINDS
+    };
+
+    MysqlAggregator();
+    ~MysqlAggregator();
+
+    void AddGroupColumn(const char *name);
+    void AddAccumulator(accumulator_kind kind, const char *name);
+    void SetCount(bool count);
+
+    // Returns error message or NULL
+    const char *Bind(MYSQL_FIELD *fields, uint32_t num_fields);
+
+    void AddRow(MYSQL_ROW row, unsigned long *lengths);
+
+    Local<Array> ToArray();
+
+    // Exact order of DECIMAL values, MysqlResult merges by it too
+    static int CompareDecimalText(const char *a, const char *b);
+
+  private:
+    enum numeric_kind {
+        NUMERIC_SIGNED = 0,
+        NUMERIC_UNSIGNED,
+        NUMERIC_REAL,
+        NUMERIC_DECIMAL
+    };
+
+    struct column {
+        char *name;
+        uint32_t field;
+        // Copied from MYSQL_FIELD, fields are freed with result
+        enum_field_types type;
+        unsigned int flags;
+        unsigned int decimals;
+        numeric_kind numeric;
+    };
+
+    // Base 10^9 limbs of exact sum, enough for 65 digits of DECIMAL and 2^64 rows
+    static const uint32_t EXACT_LIMBS = 10;
+
+    struct accumulator {
+        // Number of non-NULL values
+        uint64_t values;
+        // Sum of FLOAT and DOUBLE values
+        double real;
+        // Exact sum of integer and DECIMAL values scaled by 10^decimals,
+        // magnitudes of positive and negative values are summed apart
+        uint32_t positive[EXACT_LIMBS];
+        uint32_t negative[EXACT_LIMBS];
+        // NUL-terminated text of min or max value
+        char *text;
+        size_t text_capacity;
+    };
+
+    struct group {
+        uint32_t hash;
+        // Length-prefixed values of groupBy columns, NULL has length ~0
+        char *key;
+        size_t key_len;
+        uint64_t count;
+    };
+
+    column *group_columns;
+    uint32_t group_column_count;
+
+    column *acc_columns[ACC_KINDS];
+    uint32_t acc_column_count[ACC_KINDS];
+    uint32_t acc_stride;
+
+    bool count;
+
+    group *groups;
+    // acc_stride accumulators for every group
+    accumulator *acc;
+    uint32_t group_count;
+    uint32_t group_capacity;
+
+    // Open addressing, group number + 1, 0 for empty slot
+    uint32_t *slots;
+    uint32_t slot_count;
+
+    // Scratch buffer for key of current row
+    char *key_buffer;
+    size_t key_buffer_len;
+
+    static void AddColumn(column **columns, uint32_t *count, const char *name);
+    static const char *BindColumns(column *columns, uint32_t count, MYSQL_FIELD *fields, uint32_t num_fields,
+                                   bool numeric);
+
+    static int CompareValues(const column &col, const char *a, const char *b);
+    static void AddExact(accumulator *a, const char *value, unsigned int scale);
+    static char *ExactSumText(const accumulator *a, unsigned int scale);
+
+    uint32_t FindGroup(MYSQL_ROW row, unsigned long *lengths);
+    uint32_t NewGroup(uint32_t hash, const char *key, size_t key_len);
+    void GrowSlots();
+};
+
+#endif  // SRC_MYSQL_BINDINGS_AGGREGATE_H_
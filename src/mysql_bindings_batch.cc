@@ -0,0 +1,264 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#include "./mysql_bindings_batch.h"
+
+MysqlBatch::MysqlBatch(uint32_t column_count):
+    column_count(column_count),
+    rows_count(0),
+    cells(NULL),
+    arena(NULL),
+    arena_len(0),
+    arena_capacity(0),
+    buffers_count(0) {
+    this->buffers = Persistent<Array>::New(Array::New());
+}
+
+MysqlBatch::~MysqlBatch() {
+    delete[] this->cells;
+    delete[] this->arena;
+
+    this->buffers.Dispose();
+}
+
+/*!
+ * Converts milliseconds of JS Date to MYSQL_TIME in UTC
+ */
+bool MysqlBatch::DateToMysqlTime(double date_ms, MYSQL_TIME *date_data) {
+    time_t date_timet = static_cast<time_t>(date_ms/1000);
+    struct tm date_timeinfo;
+
+    if (!gmtime_r(&date_timet, &date_timeinfo)) {
+        return false;
+    }
+
+    memset(date_data, 0, sizeof(MYSQL_TIME));
+    date_data->year = date_timeinfo.tm_year + 1900;
+    date_data->month = date_timeinfo.tm_mon + 1;
+    date_data->day = date_timeinfo.tm_mday;
+    date_data->hour = date_timeinfo.tm_hour;
+    date_data->minute = date_timeinfo.tm_min;
+    date_data->second = date_timeinfo.tm_sec;
+    date_data->time_type = MYSQL_TIMESTAMP_DATETIME;
+
+    return true;
+}
+
+/*!
+ * Converts value to cell, returns error message or NULL
+ */
+const char *MysqlBatch::AddCell(cell *value, Local<Value> js_value) {
+    value->is_unsigned = false;
+    value->length = 0;
+
+    if (js_value->IsUndefined()) {
+        return "All values must be defined";
+    }
+
+    if (js_value->IsNull()) {
+        value->type = MYSQL_TYPE_NULL;
+    } else if (js_value->IsInt32()) {
+        value->type = MYSQL_TYPE_LONG;
+        value->data.int_value = js_value->Int32Value();
+    } else if (js_value->IsBoolean()) {
+        value->type = MYSQL_TYPE_TINY;
+        value->data.tiny_value = js_value->BooleanValue() ? 1 : 0;
+    } else if (js_value->IsUint32()) {
+        value->type = MYSQL_TYPE_LONG;
+        value->is_unsigned = true;
+        value->data.uint_value = js_value->Uint32Value();
+    } else if (js_value->IsNumber()) {
+        value->type = MYSQL_TYPE_DOUBLE;
+        value->data.double_value = js_value->NumberValue();
+    } else if (js_value->IsDate()) {
+        value->type = MYSQL_TYPE_DATETIME;
+        value->data.double_value = js_value->NumberValue();
+    } else if (node::Buffer::HasInstance(js_value)) {
+        Local<Object> js_buffer = js_value->ToObject();
+
+        value->type = MYSQL_TYPE_BLOB;
+        value->data.ptr = node::Buffer::Data(js_buffer);
+        value->length = node::Buffer::Length(js_buffer);
+        this->buffers->Set(this->buffers_count++, js_buffer);
+    } else {
+        Local<String> js_string = js_value->ToString();
+        size_t string_len = js_string->Utf8Length();
+
+        if (this->arena_len + string_len + 1 > this->arena_capacity) {
+            size_t capacity = this->arena_capacity ? this->arena_capacity * 2 : 4096;
+            while (this->arena_len + string_len + 1 > capacity) {
+                capacity *= 2;
+            }
+
+            char *grown = new char[capacity];
+            if (this->arena_len) {
+                memcpy(grown, this->arena, this->arena_len);
+            }
+            delete[] this->arena;
+            this->arena = grown;
+            this->arena_capacity = capacity;
+        }
+
+        js_string->WriteUtf8(this->arena + this->arena_len, string_len + 1);
+
+        value->type = MYSQL_TYPE_STRING;
+        value->data.offset = this->arena_len;
+        value->length = string_len;
+        this->arena_len += string_len + 1;
+    }
+
+    return NULL;
+}
+
+/*!
+ * Returns length of Array or typed array column, -1 for other values
+ */
+int64_t MysqlBatch::ColumnLength(Local<Value> js_column) {
+    if (js_column->IsArray()) {
+        return Local<Array>::Cast(js_column)->Length();
+    }
+
+    if (js_column->IsObject() && js_column->ToObject()->HasIndexedPropertiesInExternalArrayData()) {
+        return js_column->ToObject()->GetIndexedPropertiesExternalArrayDataLength();
+    }
+
+    return -1;
+}
+
+/*!
+ * Converts column to cells, typed arrays are read directly from their memory
+ */
+const char *MysqlBatch::AddColumn(uint32_t column, Local<Value> js_column) {
+    cell *value = this->cells + column;
+    uint32_t r;
+
+    if (js_column->IsArray()) {
+        Local<Array> js_column_array = Local<Array>::Cast(js_column);
+
+        for (r = 0; r < this->rows_count; r++, value += this->column_count) {
+            const char *error = this->AddCell(value, js_column_array->Get(r));
+            if (error) {
+                return error;
+            }
+        }
+
+        return NULL;
+    }
+
+    Local<Object> js_typed_array = js_column->ToObject();
+    void *data = js_typed_array->GetIndexedPropertiesExternalArrayData();
+    ExternalArrayType type = js_typed_array->GetIndexedPropertiesExternalArrayDataType();
+
+    for (r = 0; r < this->rows_count; r++, value += this->column_count) {
+        value->is_unsigned = false;
+        value->length = 0;
+
+        switch (type) {
+            case kExternalByteArray:
+                value->type = MYSQL_TYPE_LONG;
+                value->data.int_value = static_cast<int8_t *>(data)[r];
+                break;
+            case kExternalShortArray:
+                value->type = MYSQL_TYPE_LONG;
+                value->data.int_value = static_cast<int16_t *>(data)[r];
+                break;
+            case kExternalIntArray:
+                value->type = MYSQL_TYPE_LONG;
+                value->data.int_value = static_cast<int32_t *>(data)[r];
+                break;
+            case kExternalUnsignedByteArray:
+            case kExternalPixelArray:
+                value->type = MYSQL_TYPE_LONG;
+                value->is_unsigned = true;
+                value->data.uint_value = static_cast<uint8_t *>(data)[r];
+                break;
+            case kExternalUnsignedShortArray:
+                value->type = MYSQL_TYPE_LONG;
+                value->is_unsigned = true;
+                value->data.uint_value = static_cast<uint16_t *>(data)[r];
+                break;
+            case kExternalUnsignedIntArray:
+                value->type = MYSQL_TYPE_LONG;
+                value->is_unsigned = true;
+                value->data.uint_value = static_cast<uint32_t *>(data)[r];
+                break;
+            case kExternalFloatArray:
+                value->type = MYSQL_TYPE_DOUBLE;
+                value->data.double_value = static_cast<float *>(data)[r];
+                break;
+            case kExternalDoubleArray:
+                value->type = MYSQL_TYPE_DOUBLE;
+                value->data.double_value = static_cast<double *>(data)[r];
+                break;
+            default:
+                return "Unsupported typed array in columns";
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+ * Converts array of rows or {columns: [...]} to cells,
+ * called once on the event loop thread
+ */
+const char *MysqlBatch::Load(Local<Value> js_rows_value) {
+    uint32_t column_count = this->column_count;
+    const char *error = NULL;
+
+    if (js_rows_value->IsArray()) {
+        Local<Array> js_rows = Local<Array>::Cast(js_rows_value);
+
+        this->rows_count = js_rows->Length();
+        this->cells = new cell[static_cast<size_t>(this->rows_count) * column_count + 1];
+
+        for (uint32_t r = 0; r < this->rows_count && !error; r++) {
+            Local<Value> js_row = js_rows->Get(r);
+
+            if (!js_row->IsArray() || Local<Array>::Cast(js_row)->Length() != column_count) {
+                return "Every row must be an array with value for each column";
+            }
+
+            Local<Array> js_values = Local<Array>::Cast(js_row);
+            cell *row = this->Row(r);
+            for (uint32_t j = 0; j < column_count && !error; j++) {
+                error = this->AddCell(&row[j], js_values->Get(j));
+            }
+        }
+
+        return error;
+    }
+
+    Local<Value> js_columns_value = js_rows_value->ToObject()->Get(V8STR("columns"));
+
+    if (!js_columns_value->IsArray() || Local<Array>::Cast(js_columns_value)->Length() != column_count
+        || !column_count) {
+        return "Option columns must be an array with values for each column";
+    }
+
+    Local<Array> js_columns = Local<Array>::Cast(js_columns_value);
+    int64_t rows_count = ColumnLength(js_columns->Get(0));
+
+    for (uint32_t j = 1; j < column_count && rows_count >= 0; j++) {
+        if (ColumnLength(js_columns->Get(j)) != rows_count) {
+            rows_count = -1;
+        }
+    }
+
+    if (rows_count < 0) {
+        return "Columns must be arrays or typed arrays of the same length";
+    }
+
+    this->rows_count = static_cast<uint32_t>(rows_count);
+    this->cells = new cell[static_cast<size_t>(this->rows_count) * column_count + 1];
+
+    for (uint32_t j = 0; j < column_count && !error; j++) {
+        error = this->AddColumn(j, js_columns->Get(j));
+    }
+
+    return error;
+}
@@ -0,0 +1,93 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_BATCH_H_
+#define SRC_MYSQL_BINDINGS_BATCH_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "./mysql_bindings.h"
+
+using namespace v8; // NOLINT
+
+/*!
+ * Rows of values for bulk writes
+ *
+ * Rows are converted on the event loop thread, so they can be used
+ * in the threadpool without V8. They are given as array of rows
+ * or as {columns: [...]} with Array or typed array per column,
+ * typed arrays are read directly from their memory.
+ *
+ * Every value is a cell: dates are kept as milliseconds,
+ * strings are copied into one arena, Buffers are referenced without copy
+ * until batch is deleted, which is done on the event loop thread
+ */
+class MysqlBatch {
+  public:
+    struct cell {
+        enum_field_types type;
+        bool is_unsigned;
+        unsigned long length; // NOLINT
+        union {
+            signed char tiny_value;
+            int int_value;
+            unsigned int uint_value;
+            double double_value;
+            size_t offset;
+            const char *ptr;
+        } data;
+    };
+
+    explicit MysqlBatch(uint32_t column_count);
+    ~MysqlBatch();
+
+    // Returns error message or NULL
+    const char *Load(Local<Value> js_rows);
+
+    uint32_t ColumnCount() const {
+        return this->column_count;
+    }
+
+    uint32_t RowsCount() const {
+        return this->rows_count;
+    }
+
+    cell *Row(uint32_t r) const {
+        return this->cells + static_cast<size_t>(r) * this->column_count;
+    }
+
+    // Bytes of string or Buffer cell
+    const char *Bytes(const cell *value) const {
+        return value->type == MYSQL_TYPE_BLOB ? value->data.ptr : this->arena + value->data.offset;
+    }
+
+    static bool DateToMysqlTime(double date_ms, MYSQL_TIME *date_data);
+
+  private:
+    uint32_t column_count;
+    uint32_t rows_count;
+    cell *cells;
+
+    char *arena;
+    size_t arena_len;
+    size_t arena_capacity;
+
+    Persistent<Array> buffers;
+    uint32_t buffers_count;
+
+    const char *AddCell(cell *value, Local<Value> js_value);
+    const char *AddColumn(uint32_t column, Local<Value> js_column);
+    static int64_t ColumnLength(Local<Value> js_column);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_BATCH_H_
@@ -0,0 +1,1033 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#include "./mysql_bindings_cache.h"
+#include "./mysql_bindings_result.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+
+// Length of NULL value in encoded result
+#define CACHE_NULL_LENGTH 0xFFFFFFFFU
+
+// Shared memory segment is initialized when magic is set
+#define CACHE_SHARED_MAGIC 0x4D524332U
+
+// Writers lock of shared segment needs robust mutexes, OS X has none
+#if defined(__APPLE__)
+#define CACHE_SHARED_UNSUPPORTED
+#endif
+
+MysqlResultCache::entry *MysqlResultCache::buckets[MysqlResultCache::HASH_BUCKETS];
+MysqlResultCache::entry *MysqlResultCache::lru_head = NULL;
+MysqlResultCache::entry *MysqlResultCache::lru_tail = NULL;
+
+size_t MysqlResultCache::total_bytes = 0;
+size_t MysqlResultCache::max_bytes = 16 * 1024 * 1024;
+MysqlResultCache::stats MysqlResultCache::counters;
+
+pthread_mutex_t MysqlResultCache::lock = PTHREAD_MUTEX_INITIALIZER;
+
+MysqlResultCache::shared_header *MysqlResultCache::shared = NULL;
+
+static void WriteUint32(char **p, uint32_t value) {
+    memcpy(*p, &value, sizeof(value));
+    *p += sizeof(value);
+}
+
+static uint32_t ReadUint32(const char **p) {
+    uint32_t value;
+    memcpy(&value, *p, sizeof(value));
+    *p += sizeof(value);
+    return value;
+}
+
+/*!
+ * Builds cache key from query text and connection scope,
+ * see MysqlConnection::UpdateCacheScope.
+ * Whitespace outside of quoted strings and identifiers is collapsed
+ */
+char *MysqlResultCache::BuildKey(const char *query, size_t query_len,
+                                 const char *scope, size_t scope_len,
+                                 size_t *key_len) {
+    char *key = new char[query_len + 1 + scope_len + 1];
+    char *k = key;
+    char quote = 0;
+    bool space = false;
+
+    for (size_t i = 0; i < query_len; i++) {
+        char c = query[i];
+
+        if (quote) {
+            *k++ = c;
+            if (c == '\\' && quote != '`' && i + 1 < query_len) {
+                *k++ = query[++i];
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            space = true;
+            continue;
+        }
+
+        if (space && k != key) {
+            *k++ = ' ';
+        }
+        space = false;
+
+        if (c == '\'' || c == '"' || c == '`') {
+            quote = c;
+        }
+        *k++ = c;
+    }
+
+    // Trailing semicolon does not change query
+    while (k != key && !quote && (k[-1] == ';' || k[-1] == ' ')) {
+        k--;
+    }
+
+    *k++ = '\0';
+    memcpy(k, scope, scope_len);
+    k += scope_len;
+
+    *key_len = k - key;
+    *k = '\0';
+
+    return key;
+}
+
+/*!
+ * Encodes buffered result, runs in the threadpool
+ */
+char *MysqlResultCache::Encode(MYSQL_RES *my_result, size_t *data_len) {
+    uint32_t num_fields = mysql_num_fields(my_result);
+    uint32_t num_rows = static_cast<uint32_t>(mysql_num_rows(my_result));
+    MYSQL_FIELD *fields = mysql_fetch_fields(my_result);
+    MYSQL_ROW row;
+    unsigned long *lengths;
+    uint32_t i, j;
+
+    size_t len = 2 * sizeof(uint32_t);
+    for (i = 0; i < num_fields; i++) {
+        len += 5 * sizeof(uint32_t) + strlen(fields[i].name) + 1;
+    }
+
+    mysql_data_seek(my_result, 0);
+    while ((row = mysql_fetch_row(my_result))) {
+        lengths = mysql_fetch_lengths(my_result);
+        for (j = 0; j < num_fields; j++) {
+            len += sizeof(uint32_t) + (row[j] ? lengths[j] + 1 : 0);
+        }
+    }
+
+    char *data = new char[len];
+    char *p = data;
+
+    WriteUint32(&p, num_fields);
+    WriteUint32(&p, num_rows);
+    for (i = 0; i < num_fields; i++) {
+        uint32_t name_len = strlen(fields[i].name);
+
+        WriteUint32(&p, fields[i].type);
+        WriteUint32(&p, fields[i].flags);
+        WriteUint32(&p, fields[i].decimals);
+        WriteUint32(&p, fields[i].charsetnr);
+        WriteUint32(&p, name_len);
+        memcpy(p, fields[i].name, name_len + 1);
+        p += name_len + 1;
+    }
+
+    mysql_data_seek(my_result, 0);
+    while ((row = mysql_fetch_row(my_result))) {
+        lengths = mysql_fetch_lengths(my_result);
+        for (j = 0; j < num_fields; j++) {
+            if (!row[j]) {
+                WriteUint32(&p, CACHE_NULL_LENGTH);
+                continue;
+            }
+            WriteUint32(&p, lengths[j]);
+            memcpy(p, row[j], lengths[j]);
+            p += lengths[j];
+            *p++ = '\0';
+        }
+    }
+
+    *data_len = len;
+
+    return data;
+}
+
+/*!
+ * Encodes next rows of result of mysql_use_result() while encoding
+ * is shorter than max_len, so chunk exceeds it by one row at most.
+ * Buffer starts at size_hint and grows twice when it is full.
+ * Sets more if rows are left, otherwise caller checks mysql_errno()
+ */
+char *MysqlResultCache::EncodeStream(MYSQL_RES *my_result, size_t size_hint, size_t max_len,
+                                     size_t *data_len, bool *more) {
+    uint32_t num_fields = mysql_num_fields(my_result);
+    uint32_t num_rows = 0;
+    MYSQL_FIELD *fields = mysql_fetch_fields(my_result);
+    MYSQL_ROW row;
+    unsigned long *lengths;
+    uint32_t i, j;
+
+    size_t len = 2 * sizeof(uint32_t);
+    for (i = 0; i < num_fields; i++) {
+        len += 5 * sizeof(uint32_t) + strlen(fields[i].name) + 1;
+    }
+
+    size_t capacity = size_hint > len ? size_hint : len * 2;
+    char *data = new char[capacity];
+    char *p = data;
+
+    WriteUint32(&p, num_fields);
+    // Rows count is written when it is known
+    WriteUint32(&p, 0);
+    for (i = 0; i < num_fields; i++) {
+        uint32_t name_len = strlen(fields[i].name);
+
+        WriteUint32(&p, fields[i].type);
+        WriteUint32(&p, fields[i].flags);
+        WriteUint32(&p, fields[i].decimals);
+        WriteUint32(&p, fields[i].charsetnr);
+        WriteUint32(&p, name_len);
+        memcpy(p, fields[i].name, name_len + 1);
+        p += name_len + 1;
+    }
+
+    *more = true;
+    while (len < max_len) {
+        if (!(row = mysql_fetch_row(my_result))) {
+            *more = false;
+            break;
+        }
+        lengths = mysql_fetch_lengths(my_result);
+
+        size_t row_len = 0;
+        for (j = 0; j < num_fields; j++) {
+            row_len += sizeof(uint32_t) + (row[j] ? lengths[j] + 1 : 0);
+        }
+
+        if (len + row_len > capacity) {
+            while (len + row_len > capacity) {
+                capacity *= 2;
+            }
+
+            char *grown = new char[capacity];
+            memcpy(grown, data, len);
+            delete[] data;
+            data = grown;
+            p = data + len;
+        }
+
+        for (j = 0; j < num_fields; j++) {
+            if (!row[j]) {
+                WriteUint32(&p, CACHE_NULL_LENGTH);
+                continue;
+            }
+            WriteUint32(&p, lengths[j]);
+            memcpy(p, row[j], lengths[j]);
+            p += lengths[j];
+            *p++ = '\0';
+        }
+
+        len += row_len;
+        num_rows++;
+    }
+
+    p = data + sizeof(uint32_t);
+    WriteUint32(&p, num_rows);
+
+    *data_len = len;
+
+    return data;
+}
+
+/*!
+ * Returns referenced entry or NULL, expired entry is dropped here
+ */
+MysqlResultCache::entry *MysqlResultCache::Lookup(const char *key, size_t key_len) {
+    uint32_t hash = Hash(key, key_len);
+
+    if (shared) {
+        entry *cached = SharedLookup(key, key_len, hash);
+
+        pthread_mutex_lock(&lock);
+        if (cached) {
+            counters.hits++;
+        } else {
+            counters.misses++;
+        }
+        pthread_mutex_unlock(&lock);
+
+        return cached;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    entry *cached = buckets[hash % HASH_BUCKETS];
+    while (cached && (cached->hash != hash
+                   || cached->key_len != key_len
+                   || memcmp(cached->key, key, key_len))) {
+        cached = cached->hash_next;
+    }
+
+    if (cached && cached->expires_at <= Now()) {
+        Unlink(cached);
+        counters.expirations++;
+        cached = NULL;
+    }
+
+    if (!cached) {
+        counters.misses++;
+        pthread_mutex_unlock(&lock);
+        return NULL;
+    }
+
+    // Move to the head of LRU list
+    if (cached != lru_head) {
+        cached->lru_prev->lru_next = cached->lru_next;
+        if (cached->lru_next) {
+            cached->lru_next->lru_prev = cached->lru_prev;
+        } else {
+            lru_tail = cached->lru_prev;
+        }
+
+        cached->lru_prev = NULL;
+        cached->lru_next = lru_head;
+        lru_head->lru_prev = cached;
+        lru_head = cached;
+    }
+
+    cached->refs++;
+    counters.hits++;
+
+    pthread_mutex_unlock(&lock);
+
+    return cached;
+}
+
+/*!
+ * Takes ownership of key, tags and data, returns referenced entry.
+ * Entry larger than cache size is returned, but not stored
+ */
+MysqlResultCache::entry *MysqlResultCache::Store(char *key, size_t key_len,
+                                                 char *tags, size_t tags_len,
+                                                 char *data, size_t data_len,
+                                                 uint32_t ttl_ms) {
+    entry *cached = new entry;
+
+    cached->key = key;
+    cached->key_len = key_len;
+    cached->hash = Hash(key, key_len);
+    cached->tags = tags;
+    cached->tags_len = tags_len;
+    cached->data = data;
+    cached->data_len = data_len;
+    cached->expires_at = Now() + ttl_ms;
+    cached->refs = 1;
+    cached->linked = false;
+    cached->hash_next = NULL;
+    cached->lru_prev = NULL;
+    cached->lru_next = NULL;
+
+    // Entry is returned to caller only for materialization then
+    if (shared) {
+        unsigned int evictions = SharedStore(cached);
+
+        pthread_mutex_lock(&lock);
+        counters.stores++;
+        counters.evictions += evictions;
+        pthread_mutex_unlock(&lock);
+
+        return cached;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    if (EntrySize(cached) > max_bytes) {
+        pthread_mutex_unlock(&lock);
+        return cached;
+    }
+
+    // Replace entry stored by concurrent query
+    entry **bucket = &buckets[cached->hash % HASH_BUCKETS];
+    for (entry *old = *bucket; old; old = old->hash_next) {
+        if (old->hash == cached->hash
+         && old->key_len == key_len
+         && !memcmp(old->key, key, key_len)) {
+            Unlink(old);
+            break;
+        }
+    }
+
+    cached->hash_next = *bucket;
+    *bucket = cached;
+
+    cached->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = cached;
+    } else {
+        lru_tail = cached;
+    }
+    lru_head = cached;
+
+    cached->linked = true;
+    total_bytes += EntrySize(cached);
+    counters.entries++;
+    counters.stores++;
+
+    while (total_bytes > max_bytes) {
+        Unlink(lru_tail);
+        counters.evictions++;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return cached;
+}
+
+void MysqlResultCache::Release(entry *cached) {
+    pthread_mutex_lock(&lock);
+
+    cached->refs--;
+    if (!cached->refs && !cached->linked) {
+        Free(cached);
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+/*!
+ * Drops all entries stored with tag, returns their count
+ */
+unsigned int MysqlResultCache::Invalidate(const char *tag) {
+    unsigned int invalidated = 0;
+    size_t tag_len = strlen(tag);
+
+    if (shared) {
+        invalidated = SharedInvalidate(tag, tag_len);
+    }
+
+    pthread_mutex_lock(&lock);
+
+    entry *cached = lru_head;
+    while (cached) {
+        entry *next = cached->lru_next;
+
+        for (const char *t = cached->tags; t < cached->tags + cached->tags_len; t += strlen(t) + 1) {
+            if (strlen(t) == tag_len && !memcmp(t, tag, tag_len)) {
+                Unlink(cached);
+                invalidated++;
+                break;
+            }
+        }
+
+        cached = next;
+    }
+
+    counters.invalidations += invalidated;
+
+    pthread_mutex_unlock(&lock);
+
+    return invalidated;
+}
+
+void MysqlResultCache::SetMaxBytes(size_t bytes) {
+    pthread_mutex_lock(&lock);
+
+    max_bytes = bytes;
+    while (total_bytes > max_bytes) {
+        Unlink(lru_tail);
+        counters.evictions++;
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+MysqlResultCache::stats MysqlResultCache::GetStats() {
+    pthread_mutex_lock(&lock);
+
+    stats result = counters;
+    result.bytes = total_bytes;
+    result.max_bytes = max_bytes;
+
+    if (shared) {
+        result.entries = shared->entries;
+        result.bytes = shared->bytes;
+        result.max_bytes = shared->data_size;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return result;
+}
+
+/*!
+ * Moves cache into POSIX shared memory segment with given name,
+ * segment of given size is created by the first attached process,
+ * other processes use existing one
+ */
+bool MysqlResultCache::AttachShared(const char *name, size_t size, const char **error) {
+    const size_t min_size = sizeof(shared_header) + 64 * (sizeof(shared_slot) + 1024);
+
+#ifdef CACHE_SHARED_UNSUPPORTED
+    *error = "Shared result cache is not supported on this platform";
+    return false;
+#endif
+
+    if (size < min_size) {
+        *error = "Shared memory segment is too small";
+        return false;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    if (shared) {
+        pthread_mutex_unlock(&lock);
+        *error = "Shared result cache is already attached";
+        return false;
+    }
+
+    bool creator = true;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1) {
+        creator = false;
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+    if (fd == -1) {
+        pthread_mutex_unlock(&lock);
+        *error = "Can't open shared memory segment";
+        return false;
+    }
+
+    if (creator) {
+        if (ftruncate(fd, size) == -1) {
+            close(fd);
+            shm_unlink(name);
+            pthread_mutex_unlock(&lock);
+            *error = "Can't resize shared memory segment";
+            return false;
+        }
+    } else {
+        // Segment may be not resized yet by its creator
+        struct stat st;
+        unsigned int tries = 0;
+        while (fstat(fd, &st) == 0 && st.st_size == 0 && tries++ < 1000) {
+            usleep(1000);
+        }
+        size = st.st_size;
+    }
+
+    if (size < min_size) {
+        close(fd);
+        pthread_mutex_unlock(&lock);
+        *error = "Shared memory segment is too small";
+        return false;
+    }
+
+    void *segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        pthread_mutex_unlock(&lock);
+        *error = "Can't map shared memory segment";
+        return false;
+    }
+
+    shared_header *header = static_cast<shared_header *>(segment);
+
+    if (creator) {
+        // Lock is recovered by the next writer if its owner dies
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        int r = -1;
+#ifndef CACHE_SHARED_UNSUPPORTED
+        r = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+        if (r == 0) {
+            r = pthread_mutex_init(&header->writer_lock, &attr);
+        }
+        pthread_mutexattr_destroy(&attr);
+        if (r != 0) {
+            munmap(segment, size);
+            shm_unlink(name);
+            pthread_mutex_unlock(&lock);
+            *error = "Can't initialize lock of shared memory segment";
+            return false;
+        }
+
+        // One index slot per 4Kb of segment
+        header->slot_count = size / 4096 > 64 ? size / 4096 : 64;
+        header->size = size;
+        header->data_offset = sizeof(shared_header) + header->slot_count * sizeof(shared_slot);
+        header->data_size = size - header->data_offset;
+        header->write_pos = 0;
+        header->read_pos = 0;
+        header->used = 0;
+        header->entries = 0;
+        header->bytes = 0;
+
+        __sync_synchronize();
+        header->magic = CACHE_SHARED_MAGIC;
+    } else {
+        unsigned int tries = 0;
+        while (header->magic != CACHE_SHARED_MAGIC && tries++ < 1000) {
+            usleep(1000);
+        }
+        if (header->magic != CACHE_SHARED_MAGIC || header->size != size) {
+            munmap(segment, size);
+            pthread_mutex_unlock(&lock);
+            *error = "Shared memory segment is not a result cache";
+            return false;
+        }
+    }
+
+    shared = header;
+
+    pthread_mutex_unlock(&lock);
+
+    return true;
+}
+
+MysqlResultCache::shared_slot *MysqlResultCache::SharedSlot(uint32_t i) {
+    shared_slot *slots = reinterpret_cast<shared_slot *>(shared + 1);
+    return &slots[i % shared->slot_count];
+}
+
+/*!
+ * Writers lock. Owner death is reported by the kernel, not guessed from pid,
+ * then segment may be left in the middle of store, so it is emptied
+ */
+void MysqlResultCache::SharedLock() {
+    if (pthread_mutex_lock(&shared->writer_lock) == EOWNERDEAD) {
+        SharedReset();
+#ifndef CACHE_SHARED_UNSUPPORTED
+        pthread_mutex_consistent(&shared->writer_lock);
+#endif
+    }
+}
+
+void MysqlResultCache::SharedUnlock() {
+    pthread_mutex_unlock(&shared->writer_lock);
+}
+
+/*!
+ * Empties slot, writers lock must be held
+ */
+void MysqlResultCache::SharedDrop(shared_slot *slot) {
+    if (!slot->expires_at) {
+        return;
+    }
+
+    // Slot can be left odd by crashed writer
+    uint32_t seq = slot->seq | 1;
+    slot->seq = seq;
+    __sync_synchronize();
+
+    shared->entries--;
+    shared->bytes -= slot->key_len + slot->tags_len + slot->data_len;
+    slot->expires_at = 0;
+
+    __sync_synchronize();
+    slot->seq = seq + 1;
+}
+
+/*!
+ * Empties all slots and the ring, writers lock must be held
+ */
+void MysqlResultCache::SharedReset() {
+    for (uint32_t i = 0; i < shared->slot_count; i++) {
+        SharedDrop(SharedSlot(i));
+    }
+
+    shared->write_pos = 0;
+    shared->read_pos = 0;
+    shared->used = 0;
+    shared->entries = 0;
+    shared->bytes = 0;
+}
+
+/*!
+ * Frees the oldest record of the ring and empties its slot
+ * if it still points to this record, writers lock must be held.
+ * Returns number of evicted entries
+ */
+unsigned int MysqlResultCache::SharedEvictOldest() {
+    char *data_area = reinterpret_cast<char *>(shared) + shared->data_offset;
+    unsigned int evicted = 0;
+
+    // End of the ring too short for record header is skipped without it
+    uint64_t len = shared->data_size - shared->read_pos;
+    if (len >= sizeof(shared_record)) {
+        const shared_record *record = reinterpret_cast<const shared_record *>(data_area + shared->read_pos);
+        len = record->len;
+
+        if (record->slot != NO_SLOT) {
+            shared_slot *slot = SharedSlot(record->slot);
+            if (slot->expires_at && slot->offset == shared->read_pos + sizeof(shared_record)) {
+                SharedDrop(slot);
+                evicted++;
+            }
+        }
+    }
+
+    shared->read_pos += len;
+    shared->used -= len;
+    if (shared->read_pos >= shared->data_size) {
+        shared->read_pos = 0;
+    }
+    if (!shared->used) {
+        shared->read_pos = shared->write_pos;
+    }
+
+    return evicted;
+}
+
+/*!
+ * Lock-free lookup, result is copied into private unlinked entry
+ */
+MysqlResultCache::entry *MysqlResultCache::SharedLookup(const char *key, size_t key_len, uint32_t hash) {
+    const char *data_area = reinterpret_cast<const char *>(shared) + shared->data_offset;
+    uint64_t now = Now();
+
+    for (uint32_t i = 0; i < SHARED_PROBES; i++) {
+        shared_slot *slot = SharedSlot(hash + i);
+
+        for (unsigned int tries = 0; tries < 3; tries++) {
+            uint32_t seq = slot->seq;
+            if (seq & 1) {
+                sched_yield();
+                continue;
+            }
+            __sync_synchronize();
+
+            uint64_t offset = slot->offset;
+            uint64_t slot_key_len = slot->key_len;
+            uint64_t tags_len = slot->tags_len;
+            uint64_t data_len = slot->data_len;
+            uint64_t expires_at = slot->expires_at;
+
+            // Values can be torn by concurrent writer, so they are checked
+            // before use and the whole read is validated by seq below
+            if (!expires_at
+             || slot->hash != hash
+             || slot_key_len != key_len
+             || offset > shared->data_size
+             || tags_len > shared->data_size
+             || data_len > shared->data_size
+             || offset + key_len + tags_len + data_len > shared->data_size
+             || memcmp(data_area + offset, key, key_len)) {
+                break;
+            }
+
+            char *data = new char[data_len];
+            memcpy(data, data_area + offset + key_len + tags_len, data_len);
+
+            __sync_synchronize();
+            if (slot->seq != seq) {
+                delete[] data;
+                continue;
+            }
+
+            if (expires_at <= now) {
+                delete[] data;
+                return NULL;
+            }
+
+            entry *cached = new entry;
+            memset(cached, 0, sizeof(entry));
+            cached->hash = hash;
+            cached->data = data;
+            cached->data_len = data_len;
+            cached->expires_at = expires_at;
+            cached->refs = 1;
+
+            return cached;
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+ * Copies entry into shared segment, evicting oldest records of the ring
+ * until there is room for it. Returns number of evicted entries
+ */
+unsigned int MysqlResultCache::SharedStore(const entry *cached) {
+    uint64_t record_len = sizeof(shared_record) + cached->key_len + cached->tags_len + cached->data_len;
+    unsigned int evictions = 0;
+    uint32_t i;
+
+    // Record headers are kept aligned
+    record_len = (record_len + 7) & ~static_cast<uint64_t>(7);
+    if (record_len > shared->data_size) {
+        return 0;
+    }
+
+    SharedLock();
+
+    // Same key, then empty or expired slot, then slot expiring first
+    uint64_t now = Now();
+    char *data_area = reinterpret_cast<char *>(shared) + shared->data_offset;
+    uint32_t slot_index = 0;
+    shared_slot *slot = NULL;
+    for (i = 0; i < SHARED_PROBES; i++) {
+        shared_slot *probe = SharedSlot(cached->hash + i);
+
+        if (probe->expires_at
+         && probe->hash == cached->hash
+         && probe->key_len == cached->key_len
+         && !memcmp(data_area + probe->offset, cached->key, cached->key_len)) {
+            slot = probe;
+            slot_index = (cached->hash + i) % shared->slot_count;
+            break;
+        }
+        if (!slot || (slot->expires_at > now && probe->expires_at < slot->expires_at)) {
+            slot = probe;
+            slot_index = (cached->hash + i) % shared->slot_count;
+        }
+    }
+    if (slot->expires_at && slot->expires_at > now) {
+        evictions++;
+    }
+    // Its old record stays in the ring until it is overwritten
+    SharedDrop(slot);
+
+    // Record does not fit before the end of the ring, so the rest is skipped
+    if (shared->write_pos + record_len > shared->data_size) {
+        while (shared->used && shared->read_pos >= shared->write_pos) {
+            evictions += SharedEvictOldest();
+        }
+
+        if (shared->used) {
+            uint64_t gap = shared->data_size - shared->write_pos;
+            if (gap >= sizeof(shared_record)) {
+                shared_record *skip = reinterpret_cast<shared_record *>(data_area + shared->write_pos);
+                skip->slot = NO_SLOT;
+                skip->len = gap;
+            }
+            shared->used += gap;
+            shared->write_pos = 0;
+        } else {
+            shared->write_pos = 0;
+            shared->read_pos = 0;
+        }
+    }
+
+    // Oldest records in the way are evicted
+    while (shared->used
+        && shared->read_pos >= shared->write_pos
+        && shared->read_pos - shared->write_pos < record_len) {
+        evictions += SharedEvictOldest();
+    }
+
+    uint64_t offset = shared->write_pos + sizeof(shared_record);
+
+    shared_record *header = reinterpret_cast<shared_record *>(data_area + shared->write_pos);
+    header->slot = slot_index;
+    header->reserved = 0;
+    header->len = record_len;
+
+    char *record = data_area + offset;
+    memcpy(record, cached->key, cached->key_len);
+    memcpy(record + cached->key_len, cached->tags, cached->tags_len);
+    memcpy(record + cached->key_len + cached->tags_len, cached->data, cached->data_len);
+
+    shared->write_pos += record_len;
+    shared->used += record_len;
+
+    uint32_t seq = slot->seq | 1;
+    slot->seq = seq;
+    __sync_synchronize();
+
+    slot->hash = cached->hash;
+    slot->offset = offset;
+    slot->key_len = cached->key_len;
+    slot->tags_len = cached->tags_len;
+    slot->data_len = cached->data_len;
+    slot->expires_at = cached->expires_at;
+    shared->entries++;
+    shared->bytes += cached->key_len + cached->tags_len + cached->data_len;
+
+    __sync_synchronize();
+    slot->seq = seq + 1;
+
+    SharedUnlock();
+
+    return evictions;
+}
+
+unsigned int MysqlResultCache::SharedInvalidate(const char *tag, size_t tag_len) {
+    unsigned int invalidated = 0;
+
+    SharedLock();
+
+    char *data_area = reinterpret_cast<char *>(shared) + shared->data_offset;
+    for (uint32_t i = 0; i < shared->slot_count; i++) {
+        shared_slot *slot = SharedSlot(i);
+        if (!slot->expires_at) {
+            continue;
+        }
+
+        const char *tags = data_area + slot->offset + slot->key_len;
+        for (const char *t = tags; t < tags + slot->tags_len; t += strlen(t) + 1) {
+            if (strlen(t) == tag_len && !memcmp(t, tag, tag_len)) {
+                SharedDrop(slot);
+                invalidated++;
+                break;
+            }
+        }
+    }
+
+    SharedUnlock();
+
+    return invalidated;
+}
+
+/*!
+ * Decodes cached result into array of row objects
+ */
+Local<Value> MysqlResultCache::Materialize(const entry *cached) {
+    return Materialize(cached->data);
+}
+
+/*!
+ * Decodes result of Encode() or EncodeStream() into array of row objects,
+ * field values are converted same way as in MysqlResult#fetchAllSync()
+ */
+Local<Value> MysqlResultCache::Materialize(const char *data) {
+    HandleScope scope;
+
+    const char *p = data;
+    uint32_t num_fields = ReadUint32(&p);
+    uint32_t num_rows = ReadUint32(&p);
+    uint32_t i, j;
+
+    MYSQL_FIELD *fields = new MYSQL_FIELD[num_fields];
+    Local<String> *names = new Local<String>[num_fields];
+    memset(fields, 0, num_fields * sizeof(MYSQL_FIELD));
+
+    for (i = 0; i < num_fields; i++) {
+        fields[i].type = static_cast<enum_field_types>(ReadUint32(&p));
+        fields[i].flags = ReadUint32(&p);
+        fields[i].decimals = ReadUint32(&p);
+        fields[i].charsetnr = ReadUint32(&p);
+
+        uint32_t name_len = ReadUint32(&p);
+        fields[i].name = const_cast<char *>(p);
+        names[i] = V8STR2(p, name_len);
+        p += name_len + 1;
+    }
+
+    // SET values are split in place, so they are copied first
+    char *scratch = NULL;
+    size_t scratch_len = 0;
+
+    Local<Array> js_result = Array::New(num_rows);
+    for (i = 0; i < num_rows; i++) {
+        Local<Object> js_result_row = Object::New();
+
+        for (j = 0; j < num_fields; j++) {
+            uint32_t length = ReadUint32(&p);
+            char *value = NULL;
+
+            if (length != CACHE_NULL_LENGTH) {
+                value = const_cast<char *>(p);
+                p += length + 1;
+
+                if (fields[j].type == MYSQL_TYPE_SET || (fields[j].flags & SET_FLAG)) {
+                    if (scratch_len < length + 1) {
+                        delete[] scratch;
+                        scratch_len = length + 1;
+                        scratch = new char[scratch_len];
+                    }
+                    memcpy(scratch, value, length + 1);
+                    value = scratch;
+                }
+            } else {
+                length = 0;
+            }
+
+            js_result_row->Set(names[j], MysqlResult::GetFieldValue(fields[j], value, length));
+        }
+
+        js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+    }
+
+    delete[] scratch;
+    delete[] names;
+    delete[] fields;
+
+    return scope.Close(js_result);
+}
+
+/*!
+ * FNV-1a hash of key
+ */
+uint32_t MysqlResultCache::Hash(const char *key, size_t key_len) {
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < key_len; i++) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+uint64_t MysqlResultCache::Now() {
+    return uv_hrtime() / 1000000;
+}
+
+size_t MysqlResultCache::EntrySize(const entry *cached) {
+    return sizeof(entry) + cached->key_len + cached->tags_len + cached->data_len;
+}
+
+/*!
+ * Removes entry from hash table and LRU list, lock must be held
+ */
+void MysqlResultCache::Unlink(entry *cached) {
+    entry **bucket = &buckets[cached->hash % HASH_BUCKETS];
+    while (*bucket != cached) {
+        bucket = &(*bucket)->hash_next;
+    }
+    *bucket = cached->hash_next;
+
+    if (cached->lru_prev) {
+        cached->lru_prev->lru_next = cached->lru_next;
+    } else {
+        lru_head = cached->lru_next;
+    }
+    if (cached->lru_next) {
+        cached->lru_next->lru_prev = cached->lru_prev;
+    } else {
+        lru_tail = cached->lru_prev;
+    }
+
+    cached->linked = false;
+    total_bytes -= EntrySize(cached);
+    counters.entries--;
+
+    if (!cached->refs) {
+        Free(cached);
+    }
+}
+
+void MysqlResultCache::Free(entry *cached) {
+    delete[] cached->key;
+    delete[] cached->tags;
+    delete[] cached->data;
+    delete cached;
+}
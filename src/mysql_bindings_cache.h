@@ -0,0 +1,189 @@
+/*!
+ * Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+ * See contributors list in README
+ *
+ * See license text in LICENSE file
+ */
+
+#ifndef SRC_MYSQL_BINDINGS_CACHE_H_
+#define SRC_MYSQL_BINDINGS_CACHE_H_
+
+#include <mysql.h>
+
+#include <v8.h>
+#include <node.h>
+#include <node_version.h>
+
+#include <pthread.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "./mysql_bindings.h"
+
+using namespace v8; // NOLINT
+
+/*!
+ * Process-wide client-side cache of query results
+ *
+ * Results are stored in compact position-independent encoding,
+ * not as V8 objects, so they can be shared between processes.
+ * Cache is bounded by total size of entries, least recently used
+ * entries are evicted first. Entries expire after their TTL
+ * and can be invalidated by tags set on store.
+ *
+ * Encoding of result:
+ *   uint32 field_count, uint32 row_count,
+ *   for each field: uint32 type, flags, decimals, charsetnr, name_length, name, '\0'
+ *   for each value: uint32 length (NULL_LENGTH for NULL), bytes, '\0'
+ *
+ * Cache can be moved into POSIX shared memory segment, so it is shared
+ * by all processes of the host attached to it, e.g. cluster workers.
+ * Segment holds header, hash index slots and data area used as a ring.
+ * Every record in the ring starts with index of its slot, so store evicts
+ * only the oldest records it overwrites and never scans the whole index.
+ * Writers are serialized with robust process-shared mutex in the segment,
+ * it is recovered when its owner dies. Readers are lock-free:
+ * every slot is protected by seqlock, readers copy result out of the segment
+ * and retry if slot was changed meanwhile
+ */
+class MysqlResultCache {
+  public:
+    struct entry {
+        char *key;
+        size_t key_len;
+        uint32_t hash;
+
+        // Tags are stored one after another with '\0' after each
+        char *tags;
+        size_t tags_len;
+
+        char *data;
+        size_t data_len;
+
+        // Milliseconds of uv_hrtime()
+        uint64_t expires_at;
+
+        // Entry is freed when it is not referenced and not linked into the cache
+        unsigned int refs;
+        bool linked;
+
+        entry *hash_next;
+        entry *lru_prev;
+        entry *lru_next;
+    };
+
+    struct stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t stores;
+        uint64_t evictions;
+        uint64_t expirations;
+        uint64_t invalidations;
+        uint64_t entries;
+        uint64_t bytes;
+        uint64_t max_bytes;
+    };
+
+    static char *BuildKey(const char *query, size_t query_len,
+                          const char *scope, size_t scope_len,
+                          size_t *key_len);
+
+    static char *Encode(MYSQL_RES *my_result, size_t *data_len);
+    static char *EncodeStream(MYSQL_RES *my_result, size_t size_hint, size_t max_len,
+                              size_t *data_len, bool *more);
+
+    static entry *Lookup(const char *key, size_t key_len);
+
+    static entry *Store(char *key, size_t key_len,
+                        char *tags, size_t tags_len,
+                        char *data, size_t data_len,
+                        uint32_t ttl_ms);
+
+    static void Release(entry *cached);
+
+    static unsigned int Invalidate(const char *tag);
+
+    static void SetMaxBytes(size_t max_bytes);
+
+    static bool AttachShared(const char *name, size_t size, const char **error);
+
+    static stats GetStats();
+
+    static Local<Value> Materialize(const entry *cached);
+    static Local<Value> Materialize(const char *data);
+
+  private:
+    static const unsigned int HASH_BUCKETS = 4096;
+
+    static entry *buckets[HASH_BUCKETS];
+    static entry *lru_head;
+    static entry *lru_tail;
+
+    static size_t total_bytes;
+    static size_t max_bytes;
+    static stats counters;
+
+    static pthread_mutex_t lock;
+
+    struct shared_slot {
+        // Odd while slot is written
+        volatile uint32_t seq;
+        uint32_t hash;
+        // Offset of key in data area, then tags and data follow it
+        uint64_t offset;
+        uint64_t key_len;
+        uint64_t tags_len;
+        uint64_t data_len;
+        // 0 for empty slot
+        uint64_t expires_at;
+    };
+
+    struct shared_header {
+        volatile uint32_t magic;
+        uint32_t slot_count;
+        uint64_t size;
+        uint64_t data_offset;
+        uint64_t data_size;
+        // Records from read_pos up to write_pos are in use, oldest first
+        uint64_t write_pos;
+        uint64_t read_pos;
+        uint64_t used;
+        uint64_t entries;
+        uint64_t bytes;
+        // Writers lock
+        pthread_mutex_t writer_lock;
+    };
+
+    // Header of record in data area, record of NO_SLOT skips the end of the ring
+    struct shared_record {
+        uint32_t slot;
+        uint32_t reserved;
+        uint64_t len;
+    };
+
+    static const uint32_t NO_SLOT = 0xFFFFFFFFU;
+
+    static const unsigned int SHARED_PROBES = 16;
+
+    static shared_header *shared;
+
+    static shared_slot *SharedSlot(uint32_t i);
+    static void SharedLock();
+    static void SharedUnlock();
+    static void SharedDrop(shared_slot *slot);
+    static void SharedReset();
+    static unsigned int SharedEvictOldest();
+    static entry *SharedLookup(const char *key, size_t key_len, uint32_t hash);
+    static unsigned int SharedStore(const entry *cached);
+    static unsigned int SharedInvalidate(const char *tag, size_t tag_len);
+
+    static uint32_t Hash(const char *key, size_t key_len);
+    static uint64_t Now();
+    static size_t EntrySize(const entry *cached);
+
+    static void Unlink(entry *cached);
+    static void Free(entry *cached);
+};
+
+#endif  // SRC_MYSQL_BINDINGS_CACHE_H_
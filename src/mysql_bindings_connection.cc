@@ -16,6 +16,7 @@
  * Init V8 structures for MysqlConnection class
  */
 Persistent<FunctionTemplate> MysqlConnection::constructor_template;
+Persistent<FunctionTemplate> MysqlConnection::query_handle_template;
 
 void MysqlConnection::Init(Handle<Object> target) {
     HandleScope scope;
@@ -36,15 +37,23 @@ void MysqlConnection::Init(Handle<Object> target) {
 
     // Methods
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "affectedRowsSync",     MysqlConnection::AffectedRowsSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "aggregate",            MysqlConnection::Aggregate);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "attachSharedResultCacheSync", MysqlConnection::AttachSharedResultCacheSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "autoCommit",           MysqlConnection::AutoCommit);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "autoCommitSync",       MysqlConnection::AutoCommitSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "bulkInsert",           MysqlConnection::BulkInsert);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "changeUser",           MysqlConnection::ChangeUser);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "changeUserSync",       MysqlConnection::ChangeUserSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "commit",               MysqlConnection::Commit);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "commitSync",           MysqlConnection::CommitSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "connect",              MysqlConnection::Connect);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "connectSync",          MysqlConnection::ConnectSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "connectedSync",        MysqlConnection::ConnectedSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "close",                MysqlConnection::Close);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "closeSync",            MysqlConnection::CloseSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "debugSync",            MysqlConnection::DebugSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "dumpDebugInfoSync",    MysqlConnection::DumpDebugInfoSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "enableGtidTrackingSync", MysqlConnection::EnableGtidTrackingSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "errnoSync",            MysqlConnection::ErrnoSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "errorSync",            MysqlConnection::ErrorSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "escapeSync",           MysqlConnection::EscapeSync);
@@ -54,25 +63,38 @@ void MysqlConnection::Init(Handle<Object> target) {
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "getClientInfoSync",    MysqlConnection::GetClientInfoSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "getInfoSync",          MysqlConnection::GetInfoSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "getInfoStringSync",    MysqlConnection::GetInfoStringSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "getWarnings",          MysqlConnection::GetWarnings);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "getWarningsSync",      MysqlConnection::GetWarningsSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "initSync",             MysqlConnection::InitSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "initStatementSync",    MysqlConnection::InitStatementSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "invalidateResultCacheSync", MysqlConnection::InvalidateResultCacheSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "lastGtidSync",         MysqlConnection::LastGtidSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "lastInsertIdSync",     MysqlConnection::LastInsertIdSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "multiMoreResultsSync", MysqlConnection::MultiMoreResultsSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "multiNextResultSync",  MysqlConnection::MultiNextResultSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "multiRealQuerySync",   MysqlConnection::MultiRealQuerySync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "ping",                 MysqlConnection::Ping);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "pingSync",             MysqlConnection::PingSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "query",                MysqlConnection::Query);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "querySend",            MysqlConnection::QuerySend);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "querySync",            MysqlConnection::QuerySync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "queueStatsSync",       MysqlConnection::QueueStatsSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "realConnectSync",      MysqlConnection::RealConnectSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "realQuerySync",        MysqlConnection::RealQuerySync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "resultCacheStatsSync", MysqlConnection::ResultCacheStatsSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "rollback",             MysqlConnection::Rollback);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "rollbackSync",         MysqlConnection::RollbackSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "selectDb",             MysqlConnection::SelectDb);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "selectDbSync",         MysqlConnection::SelectDbSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "setAdmissionLimitsSync", MysqlConnection::SetAdmissionLimitsSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "setCharset",           MysqlConnection::SetCharset);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "setCharsetSync",       MysqlConnection::SetCharsetSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "setOptionSync",        MysqlConnection::SetOptionSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "setResultCacheLimitsSync", MysqlConnection::SetResultCacheLimitsSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "setResultModeSync",    MysqlConnection::SetResultModeSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "setSslSync",           MysqlConnection::SetSslSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "sqlStateSync",         MysqlConnection::SqlStateSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "stat",                 MysqlConnection::Stat);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "statSync",             MysqlConnection::StatSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "storeResultSync",      MysqlConnection::StoreResultSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "threadIdSync",         MysqlConnection::ThreadIdSync);
@@ -82,6 +104,27 @@ void MysqlConnection::Init(Handle<Object> target) {
 
     // Make it visible in JavaScript
     target->Set(String::NewSymbol("MysqlConnection"), constructor_template->GetFunction());
+
+    // Process-wide settings are not bound to connection object
+    NODE_SET_METHOD(target, "setProcessAdmissionLimitsSync", MysqlConnection::SetProcessAdmissionLimitsSync);
+
+    // Handle returned by query() and querySend(),
+    // holds connection object and query id
+    Local<FunctionTemplate> query_handle_t = FunctionTemplate::New();
+    query_handle_t->SetClassName(String::NewSymbol("MysqlQueryHandle"));
+    query_handle_t->InstanceTemplate()->SetInternalFieldCount(2);
+
+    NODE_SET_PROTOTYPE_METHOD(query_handle_t, "cancel", MysqlConnection::QueryCancel);
+
+    query_handle_template = Persistent<FunctionTemplate>::New(query_handle_t);
+
+    // Same setting is used by libuv for threadpool size,
+    // one thread is left out of commands scheduling for KILL QUERY jobs
+    // of expired deadlines, they must not wait behind the slow queries
+    const char *threadpool_size = getenv("UV_THREADPOOL_SIZE");
+    if (threadpool_size && atoi(threadpool_size) > 0) {
+        threadpool_jobs_max = atoi(threadpool_size) > 1 ? atoi(threadpool_size) - 1 : 1;
+    }
 }
 
 bool MysqlConnection::Connect(const char* hostname,
@@ -111,6 +154,8 @@ bool MysqlConnection::Connect(const char* hostname,
                             socket,
                             flags);
 
+    this->connect_flags = flags;
+
     if (unsuccessful) {
         this->connect_errno = mysql_errno(this->_conn);
         this->connect_error = mysql_error(this->_conn);
@@ -122,6 +167,7 @@ bool MysqlConnection::Connect(const char* hostname,
     }
 
     this->connected = true;
+    this->SessionChanged();
     return true;
 }
 
@@ -149,6 +195,8 @@ bool MysqlConnection::RealConnect(const char* hostname,
                                             socket,
                                             flags);
 
+    this->connect_flags = flags;
+
     if (unsuccessful) {
         this->connect_errno = mysql_errno(this->_conn);
         this->connect_error = mysql_error(this->_conn);
@@ -178,14 +226,26 @@ bool MysqlConnection::RealConnect(const char* hostname,
 #endif
 
     this->connected = true;
+    this->SessionChanged();
     return true;
 }
 
 void MysqlConnection::Close() {
+    // LOAD DATA waiting for stream data holds query_lock, and the data
+    // can come only from this thread, so the load is failed first
+    for (query_request *query_req = this->active_queries; query_req; query_req = query_req->next_active) {
+        AbortLocalInfile(query_req->infile_data, "Connection is closed by closeSync() during query");
+    }
+
     DEBUG_PRINTF("Close: pthread_mutex_lock\n");
     pthread_mutex_lock(&this->query_lock);
     DEBUG_PRINTF("Close: pthread_mutex_lock'ed\n");
     if (this->_conn) {
+        // Streamed result can't outlive connection, its rows left are dropped
+        if (this->streaming_query && this->streaming_query->use_result) {
+            mysql_free_result(this->streaming_query->use_result);
+            this->streaming_query->use_result = NULL;
+        }
 
         mysql_close(this->_conn);
         this->_conn = NULL;
@@ -197,21 +257,557 @@ void MysqlConnection::Close() {
     }
     DEBUG_PRINTF("Close: pthread_mutex_unlock\n");
     pthread_mutex_unlock(&this->query_lock);
+
+    pthread_mutex_lock(&this->kill_lock);
+    if (this->kill_conn) {
+        mysql_close(this->kill_conn);
+        this->kill_conn = NULL;
+    }
+    pthread_mutex_unlock(&this->kill_lock);
+}
+
+MysqlConnection *MysqlConnection::waiting_head = NULL;
+unsigned int MysqlConnection::threadpool_jobs = 0;
+unsigned int MysqlConnection::threadpool_jobs_max = 3;
+uint64_t MysqlConnection::last_command_seq = 0;
+MysqlConnection::lane_stats MysqlConnection::queue_stats[LANE_COUNT];
+unsigned int MysqlConnection::process_max_queued = 0;
+MysqlConnection::result_shape MysqlConnection::result_shapes[RESULT_SHAPES];
+pthread_mutex_t MysqlConnection::result_shapes_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void MysqlConnection::EnqueueCommand(uv_work_t *req,
+                                     uv_work_cb work_cb,
+                                     uv_after_work_cb after_work_cb,
+                                     command_lane lane,
+                                     uint32_t timeout_ms,
+                                     bool *overloaded,
+                                     bool *dequeued) {
+    queued_command *command = new queued_command;
+
+    command->req = req;
+    command->work_cb = work_cb;
+    command->after_work_cb = after_work_cb;
+    command->lane = lane;
+    command->enqueued_at = uv_now(uv_default_loop());
+    command->deadline = timeout_ms ? command->enqueued_at + timeout_ms : 0;
+    command->seq = ++last_command_seq;
+    command->overloaded = overloaded;
+    command->dequeued = dequeued;
+    command->next = NULL;
+
+    // Queue is used only from the event loop thread, so there is no locking here
+    if (this->queue_tail) {
+        this->queue_tail->next = command;
+    } else {
+        this->queue_head = command;
+    }
+    this->queue_tail = command;
+
+    this->queued_count++;
+    queue_stats[lane].queued++;
+
+    // Waiting connection gets new command from ScheduleWaitingConnections
+    if (!this->command_in_flight && !this->kill_pending && !this->waiting) {
+        this->DispatchNextCommand();
+    }
+
+    if (this->max_queue_wait && this->queue_head) {
+        this->ArmQueueWaitTimer();
+    }
+}
+
+/*!
+ * Starts timer for the oldest queued command that can be rejected,
+ * stops it if there is no such command
+ */
+void MysqlConnection::ArmQueueWaitTimer() {
+    queued_command *command = this->queue_head;
+
+    while (command && (!command->overloaded || !command->dequeued)) {
+        command = command->next;
+    }
+
+    if (!command || !this->max_queue_wait) {
+        if (this->queue_wait_timer) {
+            uv_timer_stop(this->queue_wait_timer);
+        }
+        return;
+    }
+
+    if (!this->queue_wait_timer) {
+        this->queue_wait_timer = new uv_timer_t;
+        this->queue_wait_timer->data = this;
+        uv_timer_init(uv_default_loop(), this->queue_wait_timer);
+    }
+
+    // Command is stale when it waited longer than max_queue_wait, see StartCommand
+    uint64_t expires = command->enqueued_at + this->max_queue_wait + 1;
+    uint64_t now = uv_now(uv_default_loop());
+
+    uv_timer_start(this->queue_wait_timer, EV_QueueWaitTimeout, expires > now ? expires - now : 0, 0);
+}
+
+/*!
+ * Removes commands waited longer than max_queue_wait from the queue
+ * and calls their callbacks with EOVERLOAD error
+ */
+void MysqlConnection::RejectStaleCommands() {
+    uint64_t now = uv_now(uv_default_loop());
+    queued_command *rejected = NULL;
+    queued_command **rejected_tail = &rejected;
+
+    // Queue is FIFO, so stale commands are at its head
+    queued_command *command = this->queue_head;
+    while (command && now - command->enqueued_at > this->max_queue_wait) {
+        queued_command *next = command->next;
+
+        if (command->overloaded && command->dequeued) {
+            this->UnlinkCommand(command);
+
+            command->next = NULL;
+            *rejected_tail = command;
+            rejected_tail = &command->next;
+        }
+
+        command = next;
+    }
+
+    // Callbacks can change the queue, so they are called after the loop above
+    while (rejected) {
+        command = rejected;
+        rejected = command->next;
+
+        *command->overloaded = true;
+        *command->dequeued = true;
+
+        uv_work_t *req = command->req;
+        uv_work_cb work_cb = command->work_cb;
+        uv_after_work_cb after_work_cb = command->after_work_cb;
+
+        delete command;
+
+        if (after_work_cb) {
+            // All after-work functions of commands are declared with one argument
+            // and casted to uv_after_work_cb, so they are called with original type
+            ((void (*)(uv_work_t *)) after_work_cb)(req);
+        } else {
+            // Event loop command reports overloaded state itself, see EV_QuerySend
+            work_cb(req);
+        }
+    }
+}
+
+void MysqlConnection::EV_QueueWaitTimeout(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
+
+    MysqlConnection *conn = (MysqlConnection *)(handle->data);
+
+    // Rejected commands' callbacks can release last references to connection
+    conn->Ref();
+
+    if (conn->max_queue_wait) {
+        conn->RejectStaleCommands();
+    }
+    conn->ArmQueueWaitTimer();
+
+    conn->Unref();
+}
+
+/*!
+ * Returns true if command a should be dispatched before command b,
+ * used to compare head commands of different connections
+ */
+bool MysqlConnection::CommandIsMoreUrgent(const queued_command *a,
+                                          const queued_command *b) {
+    if (a->lane != b->lane) {
+        return a->lane < b->lane;
+    }
+
+    // Command without deadline goes after all commands with it
+    if (a->deadline != b->deadline) {
+        if (!a->deadline || !b->deadline) {
+            return a->deadline != 0;
+        }
+        return a->deadline < b->deadline;
+    }
+
+    return a->seq < b->seq;
+}
+
+/*!
+ * Removes not yet dispatched command from the queue
+ */
+bool MysqlConnection::RemoveCommand(uv_work_t *req) {
+    queued_command *command = this->queue_head;
+
+    while (command && command->req != req) {
+        command = command->next;
+    }
+
+    if (!command) {
+        return false;
+    }
+
+    this->UnlinkCommand(command);
+
+    delete command;
+
+    return true;
+}
+
+void MysqlConnection::UnlinkCommand(queued_command *command) {
+    queued_command *prev = NULL;
+    queued_command *current = this->queue_head;
+
+    while (current && current != command) {
+        prev = current;
+        current = current->next;
+    }
+
+    if (!current) {
+        return;
+    }
+
+    if (prev) {
+        prev->next = command->next;
+    } else {
+        this->queue_head = command->next;
+    }
+    if (this->queue_tail == command) {
+        this->queue_tail = prev;
+    }
+
+    this->queued_count--;
+    queue_stats[command->lane].queued--;
+}
+
+/*!
+ * Returns first queued command, it is not removed from queue.
+ * Connection queue is strictly FIFO, so statements of one session or transaction
+ * run in the order they were issued; lane and deadline only decide
+ * which connection gets a free threadpool slot
+ */
+MysqlConnection::queued_command *MysqlConnection::NextCommand() {
+    return this->queue_head;
+}
+
+void MysqlConnection::StartCommand(queued_command *command) {
+    this->UnlinkCommand(command);
+
+    this->command_in_flight = true;
+
+    uint64_t wait = uv_now(uv_default_loop()) - command->enqueued_at;
+    lane_stats *stats = &queue_stats[command->lane];
+    stats->dispatched++;
+    stats->wait_total += wait;
+    if (wait > stats->wait_max) {
+        stats->wait_max = wait;
+    }
+
+    // Command is still dispatched to keep queue order,
+    // but it fails without touching the server
+    if (command->overloaded && this->max_queue_wait && wait > this->max_queue_wait) {
+        *command->overloaded = true;
+    }
+
+    uv_work_t *req = command->req;
+    uv_work_cb work_cb = command->work_cb;
+    uv_after_work_cb after_work_cb = command->after_work_cb;
+
+    delete command;
+
+    if (after_work_cb) {
+        DEBUG_PRINTF("StartCommand: uv_queue_work\n");
+        threadpool_jobs++;
+        this->command_in_threadpool = true;
+        uv_queue_work(uv_default_loop(), req, work_cb, after_work_cb);
+    } else {
+        DEBUG_PRINTF("StartCommand: in event loop thread\n");
+        work_cb(req);
+    }
+}
+
+void MysqlConnection::DispatchNextCommand() {
+    queued_command *command = this->NextCommand();
+
+    if (!command) {
+        return;
+    }
+
+    if (!command->after_work_cb) {
+        this->StartCommand(command);
+        return;
+    }
+
+    // Threadpool command competes with other connections for a slot
+    if (!this->waiting) {
+        this->waiting = true;
+        this->waiting_next = waiting_head;
+        waiting_head = this;
+    }
+
+    ScheduleWaitingConnections();
+}
+
+/*!
+ * Starts head commands of waiting connections while threadpool slots are free,
+ * most urgent head goes first
+ */
+void MysqlConnection::ScheduleWaitingConnections() {
+    while (waiting_head && threadpool_jobs < threadpool_jobs_max) {
+        MysqlConnection **best = NULL;
+        queued_command *best_command = NULL;
+
+        MysqlConnection **conn = &waiting_head;
+        while (*conn) {
+            queued_command *command = (*conn)->NextCommand();
+
+            if (!command) {
+                // All commands are canceled
+                (*conn)->waiting = false;
+                *conn = (*conn)->waiting_next;
+                continue;
+            }
+
+            if (!best_command || CommandIsMoreUrgent(command, best_command)) {
+                best = conn;
+                best_command = command;
+            }
+
+            conn = &(*conn)->waiting_next;
+        }
+
+        if (!best) {
+            return;
+        }
+
+        MysqlConnection *best_conn = *best;
+        *best = best_conn->waiting_next;
+        best_conn->waiting = false;
+
+        best_conn->StartCommand(best_command);
+    }
+}
+
+/*!
+ * Checks admission limits for new command
+ */
+bool MysqlConnection::Overloaded() {
+    if (this->max_queued && this->queued_count >= this->max_queued) {
+        return true;
+    }
+
+    if (process_max_queued) {
+        uint64_t process_queued = 0;
+        for (int lane = 0; lane < LANE_COUNT; lane++) {
+            process_queued += queue_stats[lane].queued;
+        }
+
+        if (process_queued >= process_max_queued) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Local<Value> MysqlConnection::OverloadException(const char *message) {
+    HandleScope scope;
+
+    Local<Value> exception = V8EXC(message);
+    exception->ToObject()->Set(V8STR("code"), V8STR("EOVERLOAD"));
+
+    return scope.Close(exception);
+}
+
+/*!
+ * Returns copy of GTID reported by server session state tracking
+ * for the last query, or NULL if query committed nothing
+ */
+char *MysqlConnection::SessionGtid(MYSQL *my_conn) {
+#if MYSQL_VERSION_ID >= 50704
+    const char *data;
+    size_t length;
+
+    if (mysql_session_track_get_first(my_conn, SESSION_TRACK_GTIDS, &data, &length) == 0 && length > 0) {
+        char *gtid = new char[length + 1];
+        memcpy(gtid, data, length);
+        gtid[length] = '\0';
+        return gtid;
+    }
+#endif
+
+    return NULL;
+}
+
+/*!
+ * Takes ownership of gtid, NULL keeps the previous one
+ */
+void MysqlConnection::SetLastGtid(char *gtid) {
+    if (!gtid) {
+        return;
+    }
+
+    delete[] this->last_gtid;
+    this->last_gtid = gtid;
+}
+
+/*!
+ * Saves option set with setOptionSync(), so it is also set on side connection
+ */
+void MysqlConnection::SaveConnectOption(mysql_option option, int int_value, const char *string_value) {
+    connect_option *saved = new connect_option;
+
+    saved->option = option;
+    saved->int_value = int_value;
+    saved->string_value = NULL;
+    if (string_value) {
+        saved->string_value = new char[strlen(string_value) + 1];
+        memcpy(saved->string_value, string_value, strlen(string_value) + 1);
+    }
+
+    pthread_mutex_lock(&this->kill_lock);
+    saved->next = this->connect_options;
+    this->connect_options = saved;
+    pthread_mutex_unlock(&this->kill_lock);
+}
+
+/*!
+ * Sets saved options and SSL settings on side connection, called under kill_lock.
+ * Options are applied in the order they were set
+ */
+void MysqlConnection::ApplyConnectOptions(MYSQL *my_conn) {
+    connect_option *reversed = NULL;
+    connect_option *option;
+
+    // List is reversed in place and back, it is not changed meanwhile
+    while (this->connect_options) {
+        option = this->connect_options;
+        this->connect_options = option->next;
+        option->next = reversed;
+        reversed = option;
+    }
+
+    while (reversed) {
+        option = reversed;
+        reversed = option->next;
+
+        if (option->string_value) {
+            mysql_options(my_conn, option->option, option->string_value);
+        } else {
+            mysql_options(my_conn, option->option, &option->int_value);
+        }
+
+        option->next = this->connect_options;
+        this->connect_options = option;
+    }
+
+    if (this->ssl_settings[0] || this->ssl_settings[1] || this->ssl_settings[2]
+        || this->ssl_settings[3] || this->ssl_settings[4]) {
+        mysql_ssl_set(my_conn, this->ssl_settings[0], this->ssl_settings[1],
+                      this->ssl_settings[2], this->ssl_settings[3], this->ssl_settings[4]);
+    }
+}
+
+/*!
+ * Must be called by every queued command after its callback,
+ * so next command from the queue can be started
+ */
+void MysqlConnection::CommandDone() {
+    this->command_in_flight = false;
+
+    if (this->command_in_threadpool) {
+        this->command_in_threadpool = false;
+        threadpool_jobs--;
+    }
+
+    // EIO_After_KillQuery dispatches next command otherwise
+    if (!this->kill_pending) {
+        this->DispatchNextCommand();
+    }
+
+    ScheduleWaitingConnections();
 }
 
 MysqlConnection::MysqlConnection(): ObjectWrap() {
     this->_conn = NULL;
     this->connected = false;
+    this->queue_head = NULL;
+    this->queue_tail = NULL;
+    this->queued_count = 0;
+    this->command_in_flight = false;
+    this->command_in_threadpool = false;
+    this->waiting_next = NULL;
+    this->waiting = false;
+    this->closing = false;
+    this->active_queries = NULL;
+    this->streaming_query = NULL;
+    this->last_query_id = 0;
+    this->kill_conn = NULL;
+    this->kill_pending = false;
+    this->connect_options = NULL;
+    for (int i = 0; i < 5; i++) {
+        this->ssl_settings[i] = NULL;
+    }
+    this->connect_flags = 0;
+    this->max_queued = 0;
+    this->max_queue_wait = 0;
+    this->queue_wait_timer = NULL;
+    this->cache_scope = NULL;
+    this->cache_scope_len = 0;
+    this->schema_untracked = false;
     this->multi_query = false;
     this->opt_reconnect = false;
+    this->track_gtids = false;
+    this->last_gtid = NULL;
+    this->default_result_mode = RESULT_MODE_STORE;
+    this->use_result_above_bytes = 1024 * 1024;
+    this->max_allowed_packet = 0;
+    this->max_allowed_packet_thread_id = 0;
     this->connect_errno = 0;
     this->connect_error = NULL;
     pthread_mutex_init(&this->query_lock, NULL);
+    pthread_mutex_init(&this->kill_lock, NULL);
 }
 
 MysqlConnection::~MysqlConnection() {
-    this->Close();
+    // Queued commands hold a reference to connection object,
+    // so nobody can use connection handle here.
+    // Do not block event loop with COM_QUIT, close handle in the threadpool
+    if (this->_conn || this->kill_conn) {
+        close_request *close_req = new close_request;
+
+        close_req->conn = NULL;
+        close_req->my_conn = this->_conn;
+        close_req->my_kill_conn = this->kill_conn;
+        this->_conn = NULL;
+        this->kill_conn = NULL;
+        this->connected = false;
+
+        uv_work_t *_req = new uv_work_t;
+        _req->data = close_req;
+        uv_queue_work(uv_default_loop(), _req, EIO_Close, (uv_after_work_cb)EIO_After_Close);
+    }
+
+    if (this->queue_wait_timer) {
+        uv_close((uv_handle_t *) this->queue_wait_timer, EV_QueryTimeout_OnTimerClose);
+    }
+
+    delete[] this->last_gtid;
+    delete[] this->cache_scope;
+
+    while (this->connect_options) {
+        connect_option *option = this->connect_options;
+        this->connect_options = option->next;
+        delete[] option->string_value;
+        delete option;
+    }
+    for (int i = 0; i < 5; i++) {
+        delete[] this->ssl_settings[i];
+    }
+
     pthread_mutex_destroy(&this->query_lock);
+    pthread_mutex_destroy(&this->kill_lock);
 }
 
 /**
@@ -275,902 +871,3699 @@ Handle<Value> MysqlConnection::AffectedRowsSync(const Arguments& args) {
     return scope.Close(Integer::New(affected_rows));
 }
 
-/**
- * MysqlConnection#autoCommitSync(mode) -> Boolean
- * - mode (Boolean): Mode flag
- *
- * Sets autocommit mode
- **/
-Handle<Value> MysqlConnection::AutoCommitSync(const Arguments& args) {
+/*!
+ * EIO wrapper functions for MysqlConnection::Aggregate
+ */
+void MysqlConnection::EIO_After_Aggregate(uv_work_t *req) {
     HandleScope scope;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    struct aggregate_request *aggregate_req = (struct aggregate_request *)(req->data);
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    int argc = 1; // node.js convention, there is always at least one argument for callback
+    Local<Value> argv[2];
 
-    REQ_BOOL_ARG(0, autocomit)
+    if (aggregate_req->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (aggregate_req->overloaded) {
+        argv[0] = OverloadException("Query waited in queue longer than maxQueueWaitMs");
+    } else if (!aggregate_req->ok) {
+        unsigned int error_string_length = strlen(aggregate_req->error) + 25;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "Aggregate error #%d: %s",
+                 aggregate_req->errno, aggregate_req->error);
 
-    if (mysql_autocommit(conn->_conn, autocomit)) {
-        return scope.Close(False());
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        argv[0] = Local<Value>::New(Null());
+        argv[1] = aggregate_req->aggregator->ToArray();
+        argc = 2;
     }
 
-    return scope.Close(True());
+    if (aggregate_req->callback->IsFunction()) {
+        node::MakeCallback(
+            Context::GetCurrent()->Global(),
+            Persistent<Function>::Cast(aggregate_req->callback),
+            argc, argv
+        );
+    }
+    aggregate_req->callback.Dispose();
+
+    if (!aggregate_req->dequeued) {
+        aggregate_req->conn->CommandDone();
+    }
+
+    aggregate_req->conn->Unref();
+
+    delete aggregate_req->aggregator;
+    delete[] aggregate_req->query;
+    delete aggregate_req;
+
+    delete req;
 }
 
-/**
- * MysqlConnection#changeUserSync(user[, password[, database]]) -> Boolean
- * - user (String): Username
- * - password (String): Password
- * - database (String): Database to use
- *
- * Changes the user and causes the database to become the default
- **/
-Handle<Value> MysqlConnection::ChangeUserSync(const Arguments& args) {
-    HandleScope scope;
+void MysqlConnection::EIO_Aggregate(uv_work_t *req) {
+    struct aggregate_request *aggregate_req = (struct aggregate_request *)(req->data);
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    MysqlConnection *conn = aggregate_req->conn;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    pthread_mutex_lock(&conn->query_lock);
 
-    REQ_STR_ARG(0, user)
+    // Check connection, see EIO_Query
+    if (!conn->_conn || !conn->connected) {
+        aggregate_req->connection_closed = true;
 
-    // TODO(Sannis): Check logic
-    if ( (args.Length() < 2) || (!args[0]->IsString()) ||
-         (!args[1]->IsString()) ) {
-        return THRTYPEEXC("Must give at least user and password as arguments");
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
     }
-    String::Utf8Value password(args[1]->ToString());
 
-    if ( (args.Length() == 3) && (!args[2]->IsString()) ) {
-        return THRTYPEEXC("Must give string value as third argument, dbname");
+    if (aggregate_req->overloaded) {
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
     }
-    String::Utf8Value dbname(args[2]->ToString());
 
-    bool r = mysql_change_user(conn->_conn,
-                               *user,
-                               args[1]->IsString() ? *password : NULL,
-                               args[2]->IsString() ? *dbname : NULL);
+    MYSQLCONN_DISABLE_MQ;
 
-    if (r) {
-        return scope.Close(False());
+    if (mysql_real_query(conn->_conn, aggregate_req->query, aggregate_req->query_len) != 0) {
+        aggregate_req->errno = mysql_errno(conn->_conn);
+        aggregate_req->error = mysql_error(conn->_conn);
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
     }
 
-    return scope.Close(True());
-}
+    // Rows are aggregated as they come from the server, result is never buffered
+    MYSQL_RES *my_result = mysql_use_result(conn->_conn);
+    if (!my_result) {
+        aggregate_req->errno = mysql_errno(conn->_conn);
+        aggregate_req->error = mysql_errno(conn->_conn) ? mysql_error(conn->_conn)
+                                                        : "Query returned no result set";
 
-/**
- * MysqlConnection#commitSync() -> Boolean
- *
- * Commits the current transaction
- **/
-Handle<Value> MysqlConnection::CommitSync(const Arguments& args) {
-    HandleScope scope;
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    aggregate_req->error = aggregate_req->aggregator->Bind(mysql_fetch_fields(my_result),
+                                                           mysql_num_fields(my_result));
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(my_result))) {
+        // Unbound aggregator only drains the result
+        if (!aggregate_req->error) {
+            aggregate_req->aggregator->AddRow(row, mysql_fetch_lengths(my_result));
+        }
+    }
 
-    if (mysql_commit(conn->_conn)) {
-        return scope.Close(False());
+    if (!aggregate_req->error && mysql_errno(conn->_conn)) {
+        aggregate_req->errno = mysql_errno(conn->_conn);
+        aggregate_req->error = mysql_error(conn->_conn);
     }
 
-    return scope.Close(True());
+    mysql_free_result(my_result);
+
+    aggregate_req->ok = !aggregate_req->error;
+
+    pthread_mutex_unlock(&conn->query_lock);
 }
 
 /*!
- * EIO wrapper functions for MysqlConnection::Connect
+ * Adds column names from aggregation option to aggregator
  */
-void MysqlConnection::EIO_After_Connect(uv_work_t *req) {
-    HandleScope scope;
-
-    struct connect_request *conn_req = (struct connect_request *)(req->data);
-
-    const int argc = 1;
-    Local<Value> argv[argc];
-
-    if (!conn_req->ok) {
-        unsigned int error_string_length = strlen(conn_req->conn->connect_error) + 25;
-        char* error_string = new char[error_string_length];
-        snprintf(
-            error_string, error_string_length,
-            "Connection error #%d: %s",
-            conn_req->conn->connect_errno, conn_req->conn->connect_error);
+static bool AddAggregateColumns(Local<Object> js_options, const char *option,
+                                MysqlAggregator *aggregator, int kind) {
+    Local<Value> js_columns = js_options->Get(V8STR(option));
 
-        argv[0] = V8EXC(error_string);
-        delete[] error_string;
-    } else {
-        argv[0] = Local<Value>::New(Null());
+    if (js_columns->IsUndefined()) {
+        return true;
+    }
+    if (!js_columns->IsArray()) {
+        return false;
     }
 
-    node::MakeCallback(Context::GetCurrent()->Global(), conn_req->callback, argc, argv);
-
-    conn_req->callback.Dispose();
-
-    conn_req->conn->Unref();
-
-    delete conn_req;
-
-    delete req;
-}
-
-void MysqlConnection::EIO_Connect(uv_work_t *req) {
-    struct connect_request *conn_req = (struct connect_request *)(req->data);
+    Local<Array> js_columns_array = Local<Array>::Cast(js_columns);
+    for (uint32_t i = 0; i < js_columns_array->Length(); i++) {
+        String::Utf8Value column(js_columns_array->Get(i)->ToString());
 
-    conn_req->ok = conn_req->conn->Connect(
-        conn_req->hostname ? **(conn_req->hostname) : NULL,
-        conn_req->user ? **(conn_req->user) : NULL,
-        conn_req->password ? **(conn_req->password) : NULL,
-        conn_req->dbname ? **(conn_req->dbname) : NULL,
-        conn_req->port,
-        conn_req->socket ? **(conn_req->socket) : NULL,
-        conn_req->flags
-    ) ? true : false;
+        if (kind < 0) {
+            aggregator->AddGroupColumn(*column);
+        } else {
+            aggregator->AddAccumulator(static_cast<MysqlAggregator::accumulator_kind>(kind), *column);
+        }
+    }
 
-    delete conn_req->hostname;
-    delete conn_req->user;
-    delete conn_req->password;
-    delete conn_req->socket;
+    return true;
 }
 
 /**
- * MysqlConnection#connect([hostname[, user[, password[, database[, port[, socket]]]]]], callback)
- * - hostname (String): Hostname
- * - user (String): Username
- * - password (String): Password
- * - database (String): Database to use
- * - port (Integer): Connection port
- * - socket (String): Connection socket
- * - callback (Function): Callback function, gets (error)
+ * MysqlConnection#aggregate(query, options, callback)
+ * - query (String): Query
+ * - options (Object): `groupBy`, `sum`, `min`, `max` arrays of column names,
+ *   `count` adds number of rows in group, `priority` sets queue lane as for query(),
+ *   `timeoutMs` only gives it a scheduling deadline, so it gets threadpool slot
+ *   before commands of other connections with later ones. Unlike query(),
+ *   aggregate isn't killed when deadline expires and can't be canceled,
+ *   long queue wait is limited by maxQueueWaitMs of setAdmissionLimitsSync()
+ * - callback (Function): Callback function, gets (error, rows)
  *
- * Connects to the MySQL server
+ * Performs query and aggregates its rows natively while they are read
+ * from the server with mysql_use_result, only aggregated rows are returned.
+ * Every row has groupBy columns, `count` and `sum_<column>`, `min_<column>`,
+ * `max_<column>` values, NULLs are skipped as in SQL. Only numeric columns
+ * can be aggregated. Sums of integer and DECIMAL columns are exact DECIMAL
+ * strings, sums of FLOAT and DOUBLE are numbers, min and max are converted
+ * as values of the column. Without `groupBy` there is one row even for no rows
  **/
-Handle<Value> MysqlConnection::Connect(const Arguments& args) {
+Handle<Value> MysqlConnection::Aggregate(const Arguments& args) {
     HandleScope scope;
 
-    REQ_FUN_ARG(args.Length() - 1, callback);
+    REQ_STR_ARG(0, query);
+    REQ_OBJ_ARG(1, js_options);
+    REQ_FUN_ARG(2, callback);
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
-    if (conn->_conn) {
-        const int argc = 1;
-        Local<Value> argv[argc];
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
 
-        argv[0] = V8EXC("Already initialized. "
-                        "Use conn.realConnectSync() after conn.initSync()");
+    query_options options;
+    if (ParseQueryOptions(args, 1, &options) < 0) {
+        return Undefined();
+    }
 
-        TryCatch try_catch;
+    MysqlAggregator *aggregator = new MysqlAggregator();
 
-        callback->Call(Context::GetCurrent()->Global(), argc, argv);
+    if (!AddAggregateColumns(js_options, "groupBy", aggregator, -1)
+        || !AddAggregateColumns(js_options, "sum", aggregator, MysqlAggregator::ACC_SUM)
+        || !AddAggregateColumns(js_options, "min", aggregator, MysqlAggregator::ACC_MIN)
+        || !AddAggregateColumns(js_options, "max", aggregator, MysqlAggregator::ACC_MAX)) {
+        delete aggregator;
+        return THRTYPEEXC("Options groupBy, sum, min and max must be arrays of column names");
+    }
+    aggregator->SetCount(js_options->Get(V8STR("count"))->BooleanValue());
 
-        if (try_catch.HasCaught()) {
-            node::FatalException(try_catch);
-        }
+    aggregate_request *aggregate_req = new aggregate_request;
 
-        return Undefined();
-    }
+    aggregate_req->ok = false;
+    aggregate_req->connection_closed = false;
+    aggregate_req->overloaded = false;
+    aggregate_req->dequeued = false;
 
-    connect_request *conn_req = new connect_request;
+    aggregate_req->callback = Persistent<Value>::New(callback);
+    aggregate_req->conn = conn;
 
-    conn_req->callback = Persistent<Function>::New(callback);
-    conn_req->conn = conn;
-    conn->Ref();
+    aggregate_req->query_len = static_cast<unsigned int>(query.length());
+    aggregate_req->query = new char[aggregate_req->query_len + 1];
+    memcpy(aggregate_req->query, *query, aggregate_req->query_len + 1);
 
-    String::Utf8Value *hostname = new String::Utf8Value(args[0]->ToString());
-    String::Utf8Value *user     = new String::Utf8Value(args[1]->ToString());
-    String::Utf8Value *password = new String::Utf8Value(args[2]->ToString());
-    String::Utf8Value *dbname   = new String::Utf8Value(args[3]->ToString());
-    uint32_t port               =                       args[4]->Uint32Value();
-    String::Utf8Value *socket   = new String::Utf8Value(args[5]->ToString());
-    uint64_t flags              =                       args[6]->Uint32Value();
+    aggregate_req->aggregator = aggregator;
 
-    conn_req->hostname = args[0]->IsString() ? hostname : NULL;
-    conn_req->user     = args[1]->IsString() ? user     : NULL;
-    conn_req->password = args[2]->IsString() ? password : NULL;
-    conn_req->dbname   = args[3]->IsString() ? dbname   : NULL;
-    conn_req->port     = args[4]->IsUint32() ? port     : 0;
-    conn_req->socket   = args[5]->IsString() ? socket   : NULL;
-    conn_req->flags    = args[6]->IsUint32() ? flags    : 0;
+    aggregate_req->errno = 0;
+    aggregate_req->error = NULL;
 
-    uv_work_t *_req = new uv_work_t; \
-    _req->data = conn_req; \
-    uv_queue_work(uv_default_loop(), _req, EIO_Connect, (uv_after_work_cb)EIO_After_Connect);
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = aggregate_req;
+    conn->EnqueueCommand(_req, EIO_Aggregate, (uv_after_work_cb)EIO_After_Aggregate,
+                         options.lane, options.timeout_ms,
+                         &aggregate_req->overloaded, &aggregate_req->dequeued);
 
     return Undefined();
 }
 
 /**
- * MysqlConnection#connectSync([hostname[, user[, password[, database[, port[, socket]]]]]]) -> Boolean
- * - hostname (String): Hostname
- * - user (String): Username
- * - password (String): Password
- * - database (String): Database to use
- * - port (Integer): Connection port
- * - socket (String): Connection socket
+ * MysqlConnection#attachSharedResultCacheSync(name[, size])
+ * - name (String): POSIX shared memory object name, e.g. "/myapp-mysql-cache"
+ * - size (Integer): Segment size in bytes, 64Mb by default
  *
- * Connects to the MySQL server
+ * Moves process-wide result cache into shared memory segment,
+ * so results cached by one process are used by all processes attached to it.
+ * Segment is created by the first process, others use existing one
+ * and ignore size argument
  **/
-Handle<Value> MysqlConnection::ConnectSync(const Arguments& args) {
+Handle<Value> MysqlConnection::AttachSharedResultCacheSync(const Arguments& args) {
     HandleScope scope;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
-    if (conn->_conn) {
-        return THREXC("Already initialized. "
-                      "Use conn.realConnectSync() after conn.initSync()");
+    REQ_STR_ARG(0, name);
+
+    size_t size = 64 * 1024 * 1024;
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        if (!args[1]->IsNumber() || args[1]->NumberValue() <= 0) {
+            return THRTYPEEXC("Argument 1 must be a positive integer");
+        }
+        size = static_cast<size_t>(args[1]->NumberValue());
     }
 
-    String::Utf8Value hostname(args[0]->ToString());
-    String::Utf8Value user(args[1]->ToString());
-    String::Utf8Value password(args[2]->ToString());
-    String::Utf8Value dbname(args[3]->ToString());
-    uint32_t port = args[4]->Uint32Value();
-    String::Utf8Value socket(args[5]->ToString());
-    uint64_t flags = args[6]->Uint32Value();
+    const char *error;
+    if (!MysqlResultCache::AttachShared(*name, size, &error)) {
+        return THREXC(error);
+    }
 
-    bool r = conn->Connect(
-        args[0]->IsString() ? *hostname : NULL,
-        args[1]->IsString() ? *user     : NULL,
-        args[2]->IsString() ? *password : NULL,
-        args[3]->IsString() ? *dbname   : NULL,
-        args[4]->IsUint32() ? port      : 0,
-        args[5]->IsString() ? *socket   : NULL,
-        args[6]->IsUint32() ? flags     : 0
-    );
+    return Undefined();
+}
 
-    if (!r) {
-        return scope.Close(False());
+const char *MysqlConnection::CommandName(command_type type) {
+    switch (type) {
+        case COMMAND_AUTOCOMMIT:
+            return "Autocommit";
+        case COMMAND_CHANGE_USER:
+            return "Change user";
+        case COMMAND_COMMIT:
+            return "Commit";
+        case COMMAND_GET_WARNINGS:
+            return "Get warnings";
+        case COMMAND_PING:
+            return "Ping";
+        case COMMAND_ROLLBACK:
+            return "Rollback";
+        case COMMAND_SELECT_DB:
+            return "Select db";
+        case COMMAND_SET_CHARSET:
+            return "Set charset";
+        case COMMAND_STAT:
+            return "Stat";
     }
 
-    return scope.Close(True());
+    return "Command";
 }
 
-/**
- * MysqlConnection#connectedSync() -> Boolean
- *
- * Returns current connected status
- **/
-Handle<Value> MysqlConnection::ConnectedSync(const Arguments& args) {
-    HandleScope scope;
+MysqlConnection::command_request *MysqlConnection::NewCommandRequest(MysqlConnection *conn,
+                                                                     command_type type,
+                                                                     Handle<Value> callback) {
+    command_request *command_req = new command_request;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    command_req->type = type;
+    command_req->ok = false;
+    command_req->connection_closed = false;
 
-    return scope.Close(conn->connected ? True() : False());
+    command_req->callback = Persistent<Value>::New(callback);
+    command_req->conn = conn;
+
+    command_req->user = NULL;
+    command_req->password = NULL;
+    command_req->dbname = NULL;
+    command_req->charset = NULL;
+    command_req->autocommit = false;
+
+    command_req->stat = NULL;
+    command_req->my_result = NULL;
+
+    command_req->errno = 0;
+    command_req->error = NULL;
+
+    return command_req;
 }
 
-/**
- * MysqlConnection#closeSync()
+/*!
+ * EIO wrapper functions for async control commands
  *
- * Closes database connection
- **/
-Handle<Value> MysqlConnection::CloseSync(const Arguments& args) {
+ * All commands are queued as a tagged command_request
+ * and share one worker and one after function
+ */
+void MysqlConnection::EIO_After_Command(uv_work_t *req) {
     HandleScope scope;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    struct command_request *command_req = (struct command_request *)(req->data);
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    int argc = 1; // node.js convention, there is always at least one argument for callback
+    Local<Value> argv[2];
 
-    conn->Close();
+    if (command_req->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during command");
+    } else if (!command_req->ok) {
+        const char *command_name = CommandName(command_req->type);
+        unsigned int error_string_length = strlen(command_name) + strlen(command_req->error) + 20;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "%s error #%d: %s",
+                 command_name, command_req->errno, command_req->error);
 
-    return Undefined();
-}
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        argv[0] = Local<Value>::New(Null());
 
-/**
- * MysqlConnection#debugSync(message)
- * - message (String): Debug message
- *
- * Performs debug logging
- **/
-Handle<Value> MysqlConnection::DebugSync(const Arguments& args) {
-    HandleScope scope;
+        if (command_req->type == COMMAND_STAT) {
+            argv[1] = V8STR(command_req->stat ? command_req->stat : "");
+            argc = 2;
+        } else if (command_req->type == COMMAND_GET_WARNINGS) {
+            Local<Array> js_result = Array::New();
+            Local<Object> js_warning;
+            MYSQL_ROW row;
+            uint32_t i = 0;
+
+            if (command_req->my_result) {
+                while ((row = mysql_fetch_row(command_req->my_result))) {
+                    js_warning = Object::New();
+                    js_warning->Set(V8STR("errno"), V8STR(row[1])->ToInteger());
+                    js_warning->Set(V8STR("reason"), V8STR(row[2]));
+
+                    js_result->Set(Integer::NewFromUnsigned(i), js_warning);
+
+                    i++;
+                }
+            }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+            argv[1] = js_result;
+            argc = 2;
+        }
+    }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    if (command_req->callback->IsFunction()) {
+        node::MakeCallback(
+            Context::GetCurrent()->Global(),
+            Persistent<Function>::Cast(command_req->callback),
+            argc, argv
+        );
+    }
+    command_req->callback.Dispose();
 
-    REQ_STR_ARG(0, debug)
+    if (command_req->my_result) {
+        mysql_free_result(command_req->my_result);
+    }
 
-    mysql_debug(*debug);
+    delete command_req->user;
+    delete command_req->password;
+    delete command_req->dbname;
+    delete command_req->charset;
 
-    return Undefined();
-}
+    command_req->conn->CommandDone();
 
-/**
- * MysqlConnection#dumpDebugInfoSync() -> Boolean
- *
- * Dump debugging information into the log
- **/
-Handle<Value> MysqlConnection::DumpDebugInfoSync(const Arguments& args) {
-    HandleScope scope;
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    command_req->conn->Unref();
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    delete command_req;
 
-    return scope.Close(mysql_dump_debug_info(conn->_conn) ? False() : True());
+    delete req;
 }
 
-/**
- * MysqlConnection#errnoSync() -> Integer
- *
- * Returns the last error code
- **/
-Handle<Value> MysqlConnection::ErrnoSync(const Arguments& args) {
-    HandleScope scope;
+void MysqlConnection::EIO_Command(uv_work_t *req) {
+    struct command_request *command_req = (struct command_request *)(req->data);
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    MysqlConnection *conn = command_req->conn;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    pthread_mutex_lock(&conn->query_lock);
 
-    return scope.Close(Integer::NewFromUnsigned(mysql_errno(conn->_conn)));
+    // Check connection, see EIO_Query
+    if (!conn->_conn || !conn->connected) {
+        command_req->ok = false;
+        command_req->connection_closed = true;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    mysql_thread_init();
+
+    int r = 0;
+
+    switch (command_req->type) {
+        case COMMAND_AUTOCOMMIT:
+            r = mysql_autocommit(conn->_conn, command_req->autocommit);
+            break;
+        case COMMAND_CHANGE_USER:
+            r = mysql_change_user(conn->_conn,
+                                  **(command_req->user),
+                                  command_req->password ? **(command_req->password) : NULL,
+                                  command_req->dbname ? **(command_req->dbname) : NULL);
+            break;
+        case COMMAND_COMMIT:
+            r = mysql_commit(conn->_conn);
+            break;
+        case COMMAND_GET_WARNINGS:
+            if (mysql_warning_count(conn->_conn)) {
+                r = mysql_real_query(conn->_conn, "SHOW WARNINGS", 13);
+                if (r == 0) {
+                    command_req->my_result = mysql_store_result(conn->_conn);
+                    r = command_req->my_result ? 0 : 1;
+                }
+            }
+            break;
+        case COMMAND_PING:
+            r = mysql_ping(conn->_conn);
+            break;
+        case COMMAND_ROLLBACK:
+            r = mysql_rollback(conn->_conn);
+            break;
+        case COMMAND_SELECT_DB:
+            r = mysql_select_db(conn->_conn, **(command_req->dbname));
+            break;
+        case COMMAND_SET_CHARSET:
+            r = mysql_set_character_set(conn->_conn, **(command_req->charset));
+            break;
+        case COMMAND_STAT:
+            // Points to connection buffer, valid until next command
+            command_req->stat = mysql_stat(conn->_conn);
+            r = command_req->stat ? 0 : 1;
+            break;
+    }
+
+    if (r != 0) {
+        command_req->ok = false;
+        command_req->errno = mysql_errno(conn->_conn);
+        command_req->error = mysql_error(conn->_conn);
+    } else {
+        command_req->ok = true;
+
+        if (command_req->type == COMMAND_CHANGE_USER
+         || command_req->type == COMMAND_SELECT_DB
+         || command_req->type == COMMAND_SET_CHARSET) {
+            conn->SessionChanged();
+        }
+    }
+
+    mysql_thread_end();
+
+    pthread_mutex_unlock(&conn->query_lock);
 }
 
+/*!
+ * Queues command_request, used by all async control commands
+ */
+#define MYSQLCONN_ENQUEUE_COMMAND(command_req) \
+    conn->Ref(); \
+    uv_work_t *_req = new uv_work_t; \
+    _req->data = command_req; \
+    conn->EnqueueCommand(_req, EIO_Command, (uv_after_work_cb)EIO_After_Command);
+
 /**
- * MysqlConnection#errorSync() -> String
+ * MysqlConnection#autoCommit(mode[, callback])
+ * - mode (Boolean): Mode flag
+ * - callback (Function): Callback function, gets (error)
  *
- * Returns the last error message
+ * Sets autocommit mode
  **/
-Handle<Value> MysqlConnection::ErrorSync(const Arguments& args) {
+Handle<Value> MysqlConnection::AutoCommit(const Arguments& args) {
     HandleScope scope;
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
 
-    const char *error = mysql_error(conn->_conn);
+    REQ_BOOL_ARG(0, autocommit)
+    OPTIONAL_FUN_ARG(1, callback);
 
-    return scope.Close(V8STR(error));
+    command_request *command_req = NewCommandRequest(conn, COMMAND_AUTOCOMMIT, callback);
+    command_req->autocommit = autocommit;
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
 }
 
 /**
- * MysqlConnection#escapeSync(string) -> String
- * - string (String): String to escape
+ * MysqlConnection#autoCommitSync(mode) -> Boolean
+ * - mode (Boolean): Mode flag
  *
- * Escapes special characters in a string for use in an SQL statement,
- * taking into account the current charset of the connection
+ * Sets autocommit mode
  **/
-Handle<Value> MysqlConnection::EscapeSync(const Arguments& args) {
+Handle<Value> MysqlConnection::AutoCommitSync(const Arguments& args) {
     HandleScope scope;
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    REQ_STR_ARG(0, str)
+    REQ_BOOL_ARG(0, autocomit)
 
-    unsigned long len = static_cast<unsigned long>(str.length());
-    char *result = new char[2*len + 1];
-    if (!result) {
-        V8::LowMemoryNotification();
-        return THREXC("Not enough memory");
+    if (mysql_autocommit(conn->_conn, autocomit)) {
+        return scope.Close(False());
     }
 
-    len = mysql_real_escape_string(conn->_conn, result, *str, len);
-    Local<Value> js_result = V8STR2(result, len);
-
-    delete[] result;
-
-    return scope.Close(js_result);
+    return scope.Close(True());
 }
 
-/**
- * MysqlConnection#fieldCountSync() -> Integer
- *
- * Returns the number of columns for the most recent query
- **/
-Handle<Value> MysqlConnection::FieldCountSync(const Arguments& args) {
-    HandleScope scope;
+/*!
+ * Returns size of multi-row INSERT chunk, based on server max_allowed_packet.
+ * Session value can't change, so it is read once per session:
+ * reconnect gets new thread ID, changeUser() resets it in SessionChanged()
+ */
+size_t MysqlConnection::BulkInsertChunkBytes(MysqlConnection *conn) {
+    unsigned long thread_id = mysql_thread_id(conn->_conn); // NOLINT
+
+    if (!conn->max_allowed_packet || conn->max_allowed_packet_thread_id != thread_id) {
+        conn->max_allowed_packet = 0;
+
+        if (!mysql_real_query(conn->_conn, "SELECT @@max_allowed_packet", 27)) {
+            MYSQL_RES *my_result = mysql_store_result(conn->_conn);
+
+            if (my_result) {
+                MYSQL_ROW row = mysql_fetch_row(my_result);
+                if (row && row[0]) {
+                    conn->max_allowed_packet = static_cast<size_t>(strtoull(row[0], NULL, 10));
+                    conn->max_allowed_packet_thread_id = mysql_thread_id(conn->_conn);
+                }
+                mysql_free_result(my_result);
+            }
+        }
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    // Not cached if it can't be read
+    size_t max_packet = conn->max_allowed_packet ? conn->max_allowed_packet : 1024 * 1024;
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    if (max_packet > BULK_INSERT_MAX_CHUNK) {
+        max_packet = BULK_INSERT_MAX_CHUNK;
+    }
+    if (max_packet < 2 * BULK_INSERT_PACKET_SLACK) {
+        max_packet = 2 * BULK_INSERT_PACKET_SLACK;
+    }
 
-    return scope.Close(
-                Integer::NewFromUnsigned(
-                    mysql_field_count(conn->_conn)));
+    return max_packet - BULK_INSERT_PACKET_SLACK;
 }
 
-/**
- * MysqlConnection#getCharsetSync() -> Object
- *
- * Returns a character set object
- **/
-Handle<Value> MysqlConnection::GetCharsetSync(const Arguments& args) {
-    HandleScope scope;
+/*!
+ * Serializes row as "(v1,v2,...)" into statement buffer at pos,
+ * returns new position. Buffer is grown for the worst case of row
+ */
+size_t MysqlConnection::BulkInsertRow(bulkInsert_request *bulk_req, uint32_t r, size_t pos) {
+    MysqlBatch::cell *row = bulk_req->batch->Row(r);
+    uint32_t column_count = bulk_req->batch->ColumnCount();
+    uint32_t j;
+
+    // Escaped value is at most twice longer, plus quotes and comma
+    size_t row_bound = 3;
+    for (j = 0; j < column_count; j++) {
+        row_bound += 2 * row[j].length + 32;
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    size_t needed = pos + row_bound + bulk_req->suffix_len + 1;
+    if (needed > bulk_req->buffer_capacity) {
+        size_t capacity = bulk_req->buffer_capacity ? bulk_req->buffer_capacity * 2 : 64 * 1024;
+        while (needed > capacity) {
+            capacity *= 2;
+        }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+        char *grown = new char[capacity];
+        memcpy(grown, bulk_req->buffer, pos);
+        delete[] bulk_req->buffer;
+        bulk_req->buffer = grown;
+        bulk_req->buffer_capacity = capacity;
+    }
 
-    MY_CHARSET_INFO cs;
+    char *p = bulk_req->buffer + pos;
+    MYSQL_TIME date_data;
 
-    mysql_get_character_set_info(conn->_conn, &cs);
+    *p++ = '(';
+    for (j = 0; j < column_count; j++) {
+        MysqlBatch::cell *value = &row[j];
 
-    Local<Object> js_result = Object::New();
+        if (j) {
+            *p++ = ',';
+        }
 
-    js_result->Set(V8STR("charset"), V8STR(cs.csname ? cs.csname : ""));
-    js_result->Set(V8STR("collation"), V8STR(cs.name ? cs.name : ""));
-    js_result->Set(V8STR("dir"), V8STR(cs.dir ? cs.dir : ""));
-    js_result->Set(V8STR("min_length"), Integer::NewFromUnsigned(cs.mbminlen));
-    js_result->Set(V8STR("max_length"), Integer::NewFromUnsigned(cs.mbmaxlen));
-    js_result->Set(V8STR("number"), Integer::NewFromUnsigned(cs.number));
-    js_result->Set(V8STR("state"), Integer::NewFromUnsigned(cs.state));
-    js_result->Set(V8STR("comment"), V8STR(cs.comment ? cs.comment : ""));
+        switch (value->type) {
+            case MYSQL_TYPE_TINY:
+                *p++ = value->data.tiny_value ? '1' : '0';
+                break;
+            case MYSQL_TYPE_LONG:
+                if (value->is_unsigned) {
+                    p += snprintf(p, 32, "%u", value->data.uint_value);
+                } else {
+                    p += snprintf(p, 32, "%d", value->data.int_value);
+                }
+                break;
+            case MYSQL_TYPE_DOUBLE:
+                // NaN and Infinity have no SQL literals
+                if (value->data.double_value != value->data.double_value
+                    || value->data.double_value - value->data.double_value != 0) {
+                    memcpy(p, "NULL", 4);
+                    p += 4;
+                } else {
+                    p += snprintf(p, 32, "%.17g", value->data.double_value);
+                }
+                break;
+            case MYSQL_TYPE_DATETIME:
+                if (!MysqlBatch::DateToMysqlTime(value->data.double_value, &date_data)) {
+                    memcpy(p, "NULL", 4);
+                    p += 4;
+                } else {
+                    p += snprintf(p, 32, "'%04u-%02u-%02u %02u:%02u:%02u'",
+                                  date_data.year, date_data.month, date_data.day,
+                                  date_data.hour, date_data.minute, date_data.second);
+                }
+                break;
+            case MYSQL_TYPE_STRING:
+            case MYSQL_TYPE_BLOB:
+                *p++ = '\'';
+                p += mysql_real_escape_string(bulk_req->conn->_conn, p,
+                                              bulk_req->batch->Bytes(value), value->length);
+                *p++ = '\'';
+                break;
+            default:
+                memcpy(p, "NULL", 4);
+                p += 4;
+        }
+    }
+    *p++ = ')';
 
-    return scope.Close(js_result);
+    return p - bulk_req->buffer;
 }
 
-/**
- * MysqlConnection#getCharsetNameSync() -> String
- *
- * Returns a character set name
- **/
-Handle<Value> MysqlConnection::GetCharsetNameSync(const Arguments& args) {
+/*!
+ * EIO wrapper functions for MysqlConnection::BulkInsert
+ */
+void MysqlConnection::EIO_After_BulkInsert(uv_work_t *req) {
     HandleScope scope;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    struct bulkInsert_request *bulk_req = (struct bulkInsert_request *)(req->data);
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    int argc = 1; // node.js convention, there is always at least one argument for callback
+    Local<Value> argv[2];
+    bool done = true;
 
-    return scope.Close(V8STR(mysql_character_set_name(conn->_conn)));
-}
+    if (bulk_req->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (bulk_req->overloaded) {
+        argv[0] = OverloadException("Query waited in queue longer than maxQueueWaitMs");
+    } else if (!bulk_req->ok) {
+        unsigned int error_string_length = strlen(bulk_req->error) + 50;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "Bulk insert error at row %u #%d: %s",
+                 bulk_req->chunk_first_row, bulk_req->errno, bulk_req->error);
 
-/**
- * MysqlConnection#getClientInfoSync() -> Object
- *
- * Returns the MySQL client version and information
- **/
-Handle<Value> MysqlConnection::GetClientInfoSync(const Arguments& args) {
-    HandleScope scope;
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        uint32_t rows_count = bulk_req->batch->RowsCount();
+
+        if (bulk_req->chunks && bulk_req->progress->IsFunction()) {
+            Local<Value> progress_argv[2];
+            progress_argv[0] = Integer::NewFromUnsigned(bulk_req->next_row);
+            progress_argv[1] = Integer::NewFromUnsigned(rows_count);
+
+            node::MakeCallback(
+                Context::GetCurrent()->Global(),
+                Persistent<Function>::Cast(bulk_req->progress),
+                2, progress_argv
+            );
+        }
 
-    Local<Object> js_result = Object::New();
+        if (bulk_req->next_row < rows_count) {
+            done = false;
+        } else {
+            Local<Object> js_result = Object::New();
 
-    js_result->Set(V8STR("client_info"),
-                   V8STR(mysql_get_client_info()));
-    js_result->Set(V8STR("client_version"),
-                   Integer::NewFromUnsigned(mysql_get_client_version()));
+            js_result->Set(V8STR("affectedRows"), Number::New(static_cast<double>(bulk_req->affected_rows)));
+            js_result->Set(V8STR("firstInsertId"), Number::New(static_cast<double>(bulk_req->first_insert_id)));
+            js_result->Set(V8STR("rows"), Integer::NewFromUnsigned(rows_count));
+            js_result->Set(V8STR("chunks"), Integer::NewFromUnsigned(bulk_req->chunks));
 
-    return scope.Close(js_result);
-}
+            argv[0] = Local<Value>::New(Null());
+            argv[1] = js_result;
+            argc = 2;
+        }
+    }
 
-/**
- * MysqlConnection#getInfoSync() -> Object
- *
- * Returns the MySQL client, server, host and protocol version and information
- **/
-Handle<Value> MysqlConnection::GetInfoSync(const Arguments& args) {
-    HandleScope scope;
+    if (!done) {
+        // Next chunk keeps connection and threadpool slot of the command
+        uv_queue_work(uv_default_loop(), req, EIO_BulkInsert, (uv_after_work_cb)EIO_After_BulkInsert);
+        return;
+    }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    if (bulk_req->callback->IsFunction()) {
+        node::MakeCallback(
+            Context::GetCurrent()->Global(),
+            Persistent<Function>::Cast(bulk_req->callback),
+            argc, argv
+        );
+    }
+    bulk_req->callback.Dispose();
+    bulk_req->progress.Dispose();
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    if (!bulk_req->dequeued) {
+        bulk_req->conn->CommandDone();
+    }
 
-    Local<Object> js_result = Object::New();
+    bulk_req->conn->Unref();
 
-    js_result->Set(V8STR("client_info"),
-                   V8STR(mysql_get_client_info()));
-    js_result->Set(V8STR("client_version"),
-                   Integer::NewFromUnsigned(mysql_get_client_version()));
-    js_result->Set(V8STR("server_info"),
-                   V8STR(mysql_get_server_info(conn->_conn)));
-    js_result->Set(V8STR("server_version"),
-                   Integer::NewFromUnsigned(
-                       mysql_get_server_version(conn->_conn)));
-    js_result->Set(V8STR("host_info"),
-                   V8STR(mysql_get_host_info(conn->_conn)));
-    js_result->Set(V8STR("proto_info"),
-                   Integer::NewFromUnsigned(mysql_get_proto_info(conn->_conn)));
+    delete bulk_req->batch;
+    delete[] bulk_req->prefix;
+    delete[] bulk_req->suffix;
+    delete[] bulk_req->buffer;
+    delete bulk_req;
 
-    return scope.Close(js_result);
+    delete req;
 }
 
-/**
- * MysqlConnection#getInfoStringSync() -> String
- *
- * Retrieves information about the most recently executed query
- **/
-Handle<Value> MysqlConnection::GetInfoStringSync(const Arguments& args) {
-    HandleScope scope;
+/*!
+ * Sends one chunk of rows as multi-row INSERT
+ */
+void MysqlConnection::EIO_BulkInsert(uv_work_t *req) {
+    struct bulkInsert_request *bulk_req = (struct bulkInsert_request *)(req->data);
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    MysqlConnection *conn = bulk_req->conn;
+    uint32_t rows_count = bulk_req->batch->RowsCount();
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    pthread_mutex_lock(&conn->query_lock);
 
-    const char *info = mysql_info(conn->_conn);
+    // Check connection, see EIO_Query
+    if (!conn->_conn || !conn->connected) {
+        bulk_req->connection_closed = true;
 
-    return scope.Close(V8STR(info ? info : ""));
-}
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
 
-/**
- * MysqlConnection#getWarningsSync() -> Array
- *
- * Gets result of SHOW WARNINGS
- **/
-Handle<Value> MysqlConnection::GetWarningsSync(const Arguments& args) {
-    HandleScope scope;
+    if (bulk_req->overloaded || bulk_req->next_row >= rows_count) {
+        bulk_req->ok = !bulk_req->overloaded;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_DISABLE_MQ;
 
-    MYSQL_RES *result;
-    MYSQL_ROW row;
-    int i = 0;
+    if (!bulk_req->chunk_bytes) {
+        bulk_req->chunk_bytes = BulkInsertChunkBytes(conn);
+    }
 
-    Local<Object> js_warning = Object::New();
-    Local<Array> js_result = Array::New();
+    size_t pos = bulk_req->prefix_len;
+    if (pos + 1 > bulk_req->buffer_capacity) {
+        delete[] bulk_req->buffer;
+        bulk_req->buffer_capacity = pos + 64 * 1024;
+        bulk_req->buffer = new char[bulk_req->buffer_capacity];
+    }
+    memcpy(bulk_req->buffer, bulk_req->prefix, pos);
 
-    if (mysql_warning_count(conn->_conn)) {
-        if (mysql_real_query(conn->_conn, "SHOW WARNINGS", 13) == 0) {
-            result = mysql_store_result(conn->_conn);
+    // Chunk always has at least one row, even if it is longer than chunk size
+    bulk_req->chunk_first_row = bulk_req->next_row;
+    while (bulk_req->next_row < rows_count) {
+        size_t row_pos = pos;
 
-            while ((row = mysql_fetch_row(result))) {
-                js_warning->Set(V8STR("errno"), V8STR(row[1])->ToInteger());
+        if (bulk_req->next_row > bulk_req->chunk_first_row) {
+            bulk_req->buffer[pos++] = ',';
+        }
+        pos = BulkInsertRow(bulk_req, bulk_req->next_row, pos);
 
-                js_warning->Set(V8STR("reason"), V8STR(row[2]));
+        if (bulk_req->next_row > bulk_req->chunk_first_row
+            && pos + bulk_req->suffix_len > bulk_req->chunk_bytes) {
+            pos = row_pos;
+            break;
+        }
+        bulk_req->next_row++;
+    }
 
-                js_result->Set(Integer::New(i), js_warning);
+    memcpy(bulk_req->buffer + pos, bulk_req->suffix, bulk_req->suffix_len);
+    pos += bulk_req->suffix_len;
 
-                i++;
-            }
+    if (mysql_real_query(conn->_conn, bulk_req->buffer, pos) != 0) {
+        bulk_req->ok = false;
+        bulk_req->errno = mysql_errno(conn->_conn);
+        bulk_req->error = mysql_error(conn->_conn);
 
-            mysql_free_result(result);
-        }
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
     }
 
-    return scope.Close(js_result);
-}
+    bulk_req->chunks++;
 
-/**
- * MysqlConnection#initSync() -> Boolean
+    my_ulonglong affected_rows = mysql_affected_rows(conn->_conn);
+    if (affected_rows != ((my_ulonglong)-1)) {
+        bulk_req->affected_rows += affected_rows;
+    }
+
+    // Insert id of multi-row INSERT is the id of its first row
+    if (!bulk_req->first_insert_id) {
+        bulk_req->first_insert_id = mysql_insert_id(conn->_conn);
+    }
+
+    bulk_req->ok = true;
+
+    pthread_mutex_unlock(&conn->query_lock);
+}
+
+/*!
+ * Appends `name` quoted as identifier, `db`.`table` names are quoted by parts.
+ * Destination must have space for 3 * name_len + 2 bytes
+ */
+static size_t QuoteIdentifier(char *to, const char *name, size_t name_len, bool qualified) {
+    char *p = to;
+
+    *p++ = '`';
+    for (size_t i = 0; i < name_len; i++) {
+        if (name[i] == '`') {
+            *p++ = '`';
+            *p++ = '`';
+        } else if (qualified && name[i] == '.') {
+            memcpy(p, "`.`", 3);
+            p += 3;
+        } else {
+            *p++ = name[i];
+        }
+    }
+    *p++ = '`';
+
+    return p - to;
+}
+
+/**
+ * MysqlConnection#bulkInsert(table, columns, rows[, options], callback)
+ * - table (String): Table name, may be qualified with database name
+ * - columns (Array): Column names
+ * - rows (Array|Object): Array of rows, row is array of values for columns,
+ *   or object with `columns` array of value columns,
+ *   column is Array or typed array, e.g. Int32Array or Float64Array
+ * - options (Object): `chunkBytes` limits size of one INSERT statement,
+ *   server max_allowed_packet by default; `onDuplicate` is 'ignore', 'replace',
+ *   'update' to update all columns or array of columns to update;
+ *   `onProgress` function gets (rowsInserted, rowsTotal) after every chunk;
+ *   `priority` sets queue lane as for query()
+ * - callback (Function): Callback function, gets (error, result)
  *
- * Initializes MysqlConnection
+ * Inserts rows with multi-row INSERT statements, rows are escaped and
+ * serialized natively in the threadpool into reused statement buffer,
+ * chunks are sent one after another without returning connection to the queue.
+ * Result has `affectedRows`, `firstInsertId`, `rows` and `chunks`.
+ * Chunks are not transactional, on error rows of previous chunks are inserted
  **/
-Handle<Value> MysqlConnection::InitSync(const Arguments& args) {
+Handle<Value> MysqlConnection::BulkInsert(const Arguments& args) {
     HandleScope scope;
 
+    REQ_STR_ARG(0, table);
+    REQ_ARRAY_ARG(1, js_columns);
+
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
-    if (conn->_conn) {
-        return THREXC("Already initialized");
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    uint32_t column_count = js_columns->Length();
+    if (!column_count) {
+        return THRTYPEEXC("Argument 1 must be a non-empty array of column names");
     }
 
-    conn->_conn = mysql_init(NULL);
+    if (args.Length() < 3 || !args[2]->IsObject()) {
+        return THRTYPEEXC("Argument 2 must be an array of rows or an object with columns");
+    }
 
-    if (!conn->_conn) {
-        return scope.Close(False());
+    query_options options;
+    int callback_arg = ParseQueryOptions(args, 3, &options);
+    if (callback_arg < 0) {
+        return Undefined();
     }
+    OPTIONAL_FUN_ARG(callback_arg, callback);
 
-    return scope.Close(True());
+    size_t chunk_bytes = 0;
+    bool replace = false, ignore = false, update_all = false;
+    Local<Value> js_progress = Local<Value>::New(Undefined());
+    Local<Array> js_update_columns;
+
+    if (callback_arg > 3) {
+        Local<Object> js_options = args[3]->ToObject();
+
+        Local<Value> js_chunk_bytes = js_options->Get(V8STR("chunkBytes"));
+        if (js_chunk_bytes->IsUint32() && js_chunk_bytes->Uint32Value() > 0) {
+            chunk_bytes = js_chunk_bytes->Uint32Value();
+        } else if (!js_chunk_bytes->IsUndefined()) {
+            return THRTYPEEXC("Option chunkBytes must be a positive integer");
+        }
+
+        Local<Value> js_on_duplicate = js_options->Get(V8STR("onDuplicate"));
+        if (js_on_duplicate->IsArray()) {
+            js_update_columns = Local<Array>::Cast(js_on_duplicate);
+        } else if (!js_on_duplicate->IsUndefined()) {
+            String::Utf8Value on_duplicate(js_on_duplicate->ToString());
+
+            if (!strcmp(*on_duplicate, "ignore")) {
+                ignore = true;
+            } else if (!strcmp(*on_duplicate, "replace")) {
+                replace = true;
+            } else if (!strcmp(*on_duplicate, "update")) {
+                update_all = true;
+            } else {
+                return THRTYPEEXC("Option onDuplicate must be 'ignore', 'replace', 'update' or an array of columns");
+            }
+        }
+
+        js_progress = js_options->Get(V8STR("onProgress"));
+        if (!js_progress->IsFunction() && !js_progress->IsUndefined()) {
+            return THRTYPEEXC("Option onProgress must be a function");
+        }
+    }
+
+    MysqlBatch *batch = new MysqlBatch(column_count);
+
+    const char *error = batch->Load(args[2]);
+    if (error) {
+        delete batch;
+        return THRTYPEEXC(error);
+    }
+
+    // Column names are quoted once, prefix and suffix are copied into every chunk
+    String::Utf8Value **names = new String::Utf8Value *[column_count];
+    size_t names_len = 0;
+    uint32_t j;
+
+    for (j = 0; j < column_count; j++) {
+        names[j] = new String::Utf8Value(js_columns->Get(j)->ToString());
+        names_len += 3 * names[j]->length() + 3;
+    }
+
+    char *prefix = new char[3 * table.length() + names_len + 32];
+    char *p = prefix;
+
+    const char *verb = replace ? "REPLACE INTO " : ignore ? "INSERT IGNORE INTO " : "INSERT INTO ";
+    memcpy(p, verb, strlen(verb));
+    p += strlen(verb);
+    p += QuoteIdentifier(p, *table, table.length(), true);
+    *p++ = ' ';
+    *p++ = '(';
+    for (j = 0; j < column_count; j++) {
+        if (j) {
+            *p++ = ',';
+        }
+        p += QuoteIdentifier(p, **names[j], names[j]->length(), false);
+    }
+    memcpy(p, ") VALUES ", 9);
+    p += 9;
+
+    size_t prefix_len = p - prefix;
+
+    char *suffix = NULL;
+    size_t suffix_len = 0;
+    uint32_t update_count = update_all ? column_count
+                          : js_update_columns.IsEmpty() ? 0 : js_update_columns->Length();
+
+    if (update_count) {
+        String::Utf8Value **update_names = update_all ? names : new String::Utf8Value *[update_count];
+        size_t update_names_len = 0;
+
+        for (j = 0; j < update_count; j++) {
+            if (!update_all) {
+                update_names[j] = new String::Utf8Value(js_update_columns->Get(j)->ToString());
+            }
+            update_names_len += 6 * update_names[j]->length() + 16;
+        }
+
+        suffix = new char[update_names_len + 32];
+        p = suffix;
+
+        memcpy(p, " ON DUPLICATE KEY UPDATE ", 25);
+        p += 25;
+        for (j = 0; j < update_count; j++) {
+            if (j) {
+                *p++ = ',';
+            }
+            p += QuoteIdentifier(p, **update_names[j], update_names[j]->length(), false);
+            memcpy(p, "=VALUES(", 8);
+            p += 8;
+            p += QuoteIdentifier(p, **update_names[j], update_names[j]->length(), false);
+            *p++ = ')';
+        }
+
+        suffix_len = p - suffix;
+
+        if (!update_all) {
+            for (j = 0; j < update_count; j++) {
+                delete update_names[j];
+            }
+            delete[] update_names;
+        }
+    }
+
+    for (j = 0; j < column_count; j++) {
+        delete names[j];
+    }
+    delete[] names;
+
+    bulkInsert_request *bulk_req = new bulkInsert_request;
+
+    bulk_req->ok = false;
+    bulk_req->connection_closed = false;
+    bulk_req->overloaded = false;
+    bulk_req->dequeued = false;
+
+    bulk_req->callback = Persistent<Value>::New(callback);
+    bulk_req->progress = Persistent<Value>::New(js_progress);
+    bulk_req->conn = conn;
+
+    bulk_req->batch = batch;
+
+    bulk_req->prefix = prefix;
+    bulk_req->prefix_len = prefix_len;
+    bulk_req->suffix = suffix;
+    bulk_req->suffix_len = suffix_len;
+
+    bulk_req->chunk_bytes = chunk_bytes;
+
+    bulk_req->buffer = NULL;
+    bulk_req->buffer_capacity = 0;
+
+    bulk_req->next_row = 0;
+    bulk_req->chunk_first_row = 0;
+    bulk_req->chunks = 0;
+
+    bulk_req->affected_rows = 0;
+    bulk_req->first_insert_id = 0;
+
+    bulk_req->errno = 0;
+    bulk_req->error = NULL;
+
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = bulk_req;
+    conn->EnqueueCommand(_req, EIO_BulkInsert, (uv_after_work_cb)EIO_After_BulkInsert,
+                         options.lane, options.timeout_ms,
+                         &bulk_req->overloaded, &bulk_req->dequeued);
+
+    return Undefined();
 }
 
 /**
- * MysqlConnection#initStatementSync() -> MysqlStatement|Boolean
+ * MysqlConnection#changeUser(user, password[, database][, callback])
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ * - callback (Function): Callback function, gets (error)
  *
- * Initializes a statement and returns it
+ * Changes the user and causes the database to become the default
  **/
-Handle<Value> MysqlConnection::InitStatementSync(const Arguments& args) {
+Handle<Value> MysqlConnection::ChangeUser(const Arguments& args) {
     HandleScope scope;
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
 
-    MYSQL_STMT *my_statement = mysql_stmt_init(conn->_conn);
+    if (args.Length() < 1 || !args[0]->IsString()) {
+        return THRTYPEEXC("Argument 0 must be a string");
+    }
+    OPTIONAL_FUN_ARG(args.Length() - 1, callback);
 
-    if (!my_statement) {
-        return scope.Close(False());
+    int argc = args.Length() - (callback->IsFunction() ? 1 : 0);
+
+    if ( (argc < 2) || (!args[1]->IsString()) ) {
+        return THRTYPEEXC("Must give at least user and password as arguments");
     }
 
-    Local<Value> arg = External::New(my_statement);
-    Persistent<Object> js_result(MysqlStatement::constructor_template->
-                             GetFunction()->NewInstance(1, &arg));
+    if ( (argc == 3) && (!args[2]->IsString()) ) {
+        return THRTYPEEXC("Must give string value as third argument, dbname");
+    }
 
-    return scope.Close(js_result);
+    command_request *command_req = NewCommandRequest(conn, COMMAND_CHANGE_USER, callback);
+    command_req->user = new String::Utf8Value(args[0]->ToString());
+    command_req->password = new String::Utf8Value(args[1]->ToString());
+    if (argc == 3) {
+        command_req->dbname = new String::Utf8Value(args[2]->ToString());
+    }
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
 }
 
 /**
- * MysqlConnection#lastInsertIdSync() -> Integer
+ * MysqlConnection#changeUserSync(user[, password[, database]]) -> Boolean
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
  *
- * Returns the auto generated id used in the last query
+ * Changes the user and causes the database to become the default
  **/
-Handle<Value> MysqlConnection::LastInsertIdSync(const Arguments& args) {
+Handle<Value> MysqlConnection::ChangeUserSync(const Arguments& args) {
     HandleScope scope;
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    MYSQL_RES *result;
-    my_ulonglong insert_id = 0;
+    REQ_STR_ARG(0, user)
 
-    if ( (result = mysql_store_result(conn->_conn)) == 0 &&
-         mysql_field_count(conn->_conn) == 0 &&
-         mysql_insert_id(conn->_conn) != 0) {
-        insert_id = mysql_insert_id(conn->_conn);
+    // TODO(Sannis): Check logic
+    if ( (args.Length() < 2) || (!args[0]->IsString()) ||
+         (!args[1]->IsString()) ) {
+        return THRTYPEEXC("Must give at least user and password as arguments");
+    }
+    String::Utf8Value password(args[1]->ToString());
+
+    if ( (args.Length() == 3) && (!args[2]->IsString()) ) {
+        return THRTYPEEXC("Must give string value as third argument, dbname");
     }
+    String::Utf8Value dbname(args[2]->ToString());
 
-    return scope.Close(Integer::New(insert_id));
+    bool r = mysql_change_user(conn->_conn,
+                               *user,
+                               args[1]->IsString() ? *password : NULL,
+                               args[2]->IsString() ? *dbname : NULL);
+
+    if (r) {
+        return scope.Close(False());
+    }
+
+    conn->SessionChanged();
+
+    return scope.Close(True());
 }
 
 /**
- * MysqlConnection#multiMoreResultsSync() -> Boolean
+ * MysqlConnection#commit([callback])
+ * - callback (Function): Callback function, gets (error)
  *
- * Checks if there are any more query results from a multi query
+ * Commits the current transaction.
+ * Not rejected by admission limits, so transaction can be ended under load
  **/
-Handle<Value> MysqlConnection::MultiMoreResultsSync(const Arguments& args) {
+Handle<Value> MysqlConnection::Commit(const Arguments& args) {
     HandleScope scope;
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
 
-    if (mysql_more_results(conn->_conn)) {
-        return scope.Close(True());
-    }
+    OPTIONAL_FUN_ARG(0, callback);
 
-    return scope.Close(False());
+    command_request *command_req = NewCommandRequest(conn, COMMAND_COMMIT, callback);
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
 }
 
 /**
- * MysqlConnection#multiNextResultSync() -> Boolean
+ * MysqlConnection#commitSync() -> Boolean
  *
- * Prepare next result from multi query
+ * Commits the current transaction
  **/
-Handle<Value> MysqlConnection::MultiNextResultSync(const Arguments& args) {
+Handle<Value> MysqlConnection::CommitSync(const Arguments& args) {
     HandleScope scope;
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
 
-    if (!mysql_more_results(conn->_conn)) {
-        return THREXC("There is no next result set."
-                        "Please, call MultiMoreResultsSync() to check "
-                        "whether to call this function/method");
+    if (mysql_commit(conn->_conn)) {
+        return scope.Close(False());
     }
 
-    if (!mysql_next_result(conn->_conn)) {
-        return scope.Close(True());
+    return scope.Close(True());
+}
+
+/*!
+ * EIO wrapper functions for MysqlConnection::Connect
+ */
+void MysqlConnection::EIO_After_Connect(uv_work_t *req) {
+    HandleScope scope;
+
+    struct connect_request *conn_req = (struct connect_request *)(req->data);
+
+    const int argc = 1;
+    Local<Value> argv[argc];
+
+    if (!conn_req->ok) {
+        unsigned int error_string_length = strlen(conn_req->conn->connect_error) + 25;
+        char* error_string = new char[error_string_length];
+        snprintf(
+            error_string, error_string_length,
+            "Connection error #%d: %s",
+            conn_req->conn->connect_errno, conn_req->conn->connect_error);
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        argv[0] = Local<Value>::New(Null());
     }
 
-    return scope.Close(False());
+    node::MakeCallback(Context::GetCurrent()->Global(), conn_req->callback, argc, argv);
+
+    conn_req->callback.Dispose();
+
+    conn_req->conn->Unref();
+
+    delete conn_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_Connect(uv_work_t *req) {
+    struct connect_request *conn_req = (struct connect_request *)(req->data);
+
+    conn_req->ok = conn_req->conn->Connect(
+        conn_req->hostname ? **(conn_req->hostname) : NULL,
+        conn_req->user ? **(conn_req->user) : NULL,
+        conn_req->password ? **(conn_req->password) : NULL,
+        conn_req->dbname ? **(conn_req->dbname) : NULL,
+        conn_req->port,
+        conn_req->socket ? **(conn_req->socket) : NULL,
+        conn_req->flags
+    ) ? true : false;
+
+    delete conn_req->hostname;
+    delete conn_req->user;
+    delete conn_req->password;
+    delete conn_req->socket;
 }
 
 /**
- * MysqlConnection#multiRealQuerySync(query) -> Boolean
- * - query (String): Query
+ * MysqlConnection#connect([hostname[, user[, password[, database[, port[, socket]]]]]], callback)
+ * - hostname (String): Hostname
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ * - port (Integer): Connection port
+ * - socket (String): Connection socket
+ * - callback (Function): Callback function, gets (error)
  *
- * Performs a multi query on the database
+ * Connects to the MySQL server
  **/
-Handle<Value> MysqlConnection::MultiRealQuerySync(const Arguments& args) {
+Handle<Value> MysqlConnection::Connect(const Arguments& args) {
     HandleScope scope;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    REQ_FUN_ARG(args.Length() - 1, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    if (conn->_conn) {
+        const int argc = 1;
+        Local<Value> argv[argc];
+
+        argv[0] = V8EXC("Already initialized. "
+                        "Use conn.realConnectSync() after conn.initSync()");
+
+        TryCatch try_catch;
+
+        callback->Call(Context::GetCurrent()->Global(), argc, argv);
+
+        if (try_catch.HasCaught()) {
+            node::FatalException(try_catch);
+        }
+
+        return Undefined();
+    }
+
+    connect_request *conn_req = new connect_request;
+
+    conn_req->callback = Persistent<Function>::New(callback);
+    conn_req->conn = conn;
+    conn->Ref();
+
+    String::Utf8Value *hostname = new String::Utf8Value(args[0]->ToString());
+    String::Utf8Value *user     = new String::Utf8Value(args[1]->ToString());
+    String::Utf8Value *password = new String::Utf8Value(args[2]->ToString());
+    String::Utf8Value *dbname   = new String::Utf8Value(args[3]->ToString());
+    uint32_t port               =                       args[4]->Uint32Value();
+    String::Utf8Value *socket   = new String::Utf8Value(args[5]->ToString());
+    uint64_t flags              =                       args[6]->Uint32Value();
+
+    conn_req->hostname = args[0]->IsString() ? hostname : NULL;
+    conn_req->user     = args[1]->IsString() ? user     : NULL;
+    conn_req->password = args[2]->IsString() ? password : NULL;
+    conn_req->dbname   = args[3]->IsString() ? dbname   : NULL;
+    conn_req->port     = args[4]->IsUint32() ? port     : 0;
+    conn_req->socket   = args[5]->IsString() ? socket   : NULL;
+    conn_req->flags    = args[6]->IsUint32() ? flags    : 0;
+
+    uv_work_t *_req = new uv_work_t; \
+    _req->data = conn_req; \
+    uv_queue_work(uv_default_loop(), _req, EIO_Connect, (uv_after_work_cb)EIO_After_Connect);
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#connectSync([hostname[, user[, password[, database[, port[, socket]]]]]]) -> Boolean
+ * - hostname (String): Hostname
+ * - user (String): Username
+ * - password (String): Password
+ * - database (String): Database to use
+ * - port (Integer): Connection port
+ * - socket (String): Connection socket
+ *
+ * Connects to the MySQL server
+ **/
+Handle<Value> MysqlConnection::ConnectSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    if (conn->_conn) {
+        return THREXC("Already initialized. "
+                      "Use conn.realConnectSync() after conn.initSync()");
+    }
+
+    String::Utf8Value hostname(args[0]->ToString());
+    String::Utf8Value user(args[1]->ToString());
+    String::Utf8Value password(args[2]->ToString());
+    String::Utf8Value dbname(args[3]->ToString());
+    uint32_t port = args[4]->Uint32Value();
+    String::Utf8Value socket(args[5]->ToString());
+    uint64_t flags = args[6]->Uint32Value();
+
+    bool r = conn->Connect(
+        args[0]->IsString() ? *hostname : NULL,
+        args[1]->IsString() ? *user     : NULL,
+        args[2]->IsString() ? *password : NULL,
+        args[3]->IsString() ? *dbname   : NULL,
+        args[4]->IsUint32() ? port      : 0,
+        args[5]->IsString() ? *socket   : NULL,
+        args[6]->IsUint32() ? flags     : 0
+    );
+
+    if (!r) {
+        return scope.Close(False());
+    }
+
+    return scope.Close(True());
+}
+
+/**
+ * MysqlConnection#connectedSync() -> Boolean
+ *
+ * Returns current connected status
+ **/
+Handle<Value> MysqlConnection::ConnectedSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    return scope.Close(conn->connected ? True() : False());
+}
+
+/*!
+ * EIO wrapper functions for MysqlConnection::Close
+ */
+void MysqlConnection::EIO_After_Close(uv_work_t *req) {
+    HandleScope scope;
+
+    struct close_request *close_req = (struct close_request *)(req->data);
+
+    // No connection object if handle was closed from destructor
+    if (close_req->conn) {
+        close_req->conn->closing = false;
+
+        if (close_req->callback->IsFunction()) {
+            const int argc = 1;
+            Local<Value> argv[argc];
+            argv[0] = Local<Value>::New(Null());
+
+            node::MakeCallback(
+                Context::GetCurrent()->Global(),
+                Persistent<Function>::Cast(close_req->callback),
+                argc, argv
+            );
+        }
+        close_req->callback.Dispose();
+
+        close_req->conn->CommandDone();
+
+        close_req->conn->Unref();
+    }
+
+    delete close_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_Close(uv_work_t *req) {
+    struct close_request *close_req = (struct close_request *)(req->data);
+
+    if (close_req->my_conn) {
+        mysql_close(close_req->my_conn);
+    }
+
+    if (close_req->my_kill_conn) {
+        mysql_close(close_req->my_kill_conn);
+    }
+
+    // KILL QUERY of canceled query can still use side connection,
+    // so it is detached under kill_lock as in MysqlConnection::Close
+    if (close_req->conn) {
+        MysqlConnection *conn = close_req->conn;
+
+        pthread_mutex_lock(&conn->kill_lock);
+        if (conn->kill_conn) {
+            mysql_close(conn->kill_conn);
+            conn->kill_conn = NULL;
+        }
+        pthread_mutex_unlock(&conn->kill_lock);
+    }
+}
+
+/*!
+ * Starts queued MysqlConnection::Close in the event loop thread
+ */
+void MysqlConnection::EV_Close(uv_work_t *req) {
+    struct close_request *close_req = (struct close_request *)(req->data);
+
+    MysqlConnection *conn = close_req->conn;
+
+    // All previous commands are done here, so detach handle
+    // and mark connection as closed before mysql_close() in the threadpool.
+    // Handle can be already closed by closeSync(), side connection
+    // for KILL QUERY is closed by EIO_Close
+    close_req->my_conn = conn->_conn;
+
+    conn->_conn = NULL;
+    conn->connected = false;
+    conn->opt_reconnect = false;
+    conn->connect_errno = 0;
+    conn->connect_error = NULL;
+
+    uv_queue_work(uv_default_loop(), req, EIO_Close, (uv_after_work_cb)EIO_After_Close);
+}
+
+/**
+ * MysqlConnection#close([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Closes database connection after all queued queries.
+ * New queries are rejected until connection is closed.
+ **/
+Handle<Value> MysqlConnection::Close(const Arguments& args) {
+    HandleScope scope;
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+
+    conn->closing = true;
+
+    close_request *close_req = new close_request;
+
+    close_req->callback = Persistent<Value>::New(callback);
+    close_req->conn = conn;
+    close_req->my_conn = NULL;
+    close_req->my_kill_conn = NULL;
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = close_req;
+    // Close goes after all queued commands, no new ones are accepted
+    conn->EnqueueCommand(_req, EV_Close, NULL, LANE_BACKGROUND);
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#closeSync()
+ *
+ * Closes database connection
+ **/
+Handle<Value> MysqlConnection::CloseSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    conn->Close();
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#debugSync(message)
+ * - message (String): Debug message
+ *
+ * Performs debug logging
+ **/
+Handle<Value> MysqlConnection::DebugSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_STR_ARG(0, debug)
+
+    mysql_debug(*debug);
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#dumpDebugInfoSync() -> Boolean
+ *
+ * Dump debugging information into the log
+ **/
+Handle<Value> MysqlConnection::DumpDebugInfoSync(const Arguments& args) {
+    HandleScope scope;
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    return scope.Close(mysql_dump_debug_info(conn->_conn) ? False() : True());
+}
+
+/**
+ * MysqlConnection#enableGtidTrackingSync() -> Boolean
+ *
+ * Enables session_track_gtids, so GTID of every transaction committed
+ * on this connection is returned by lastGtidSync().
+ * Requires MySQL 5.7 server and client library
+ **/
+Handle<Value> MysqlConnection::EnableGtidTrackingSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_STREAMING;
+    MYSQLCONN_MUSTNOT_BE_LOADING_INFILE;
+
+#if MYSQL_VERSION_ID >= 50704
+    pthread_mutex_lock(&conn->query_lock);
+    const char *track_query = "SET SESSION session_track_gtids = OWN_GTID";
+    int r = mysql_real_query(conn->_conn, track_query, strlen(track_query));
+    pthread_mutex_unlock(&conn->query_lock);
+
+    if (r != 0) {
+        return scope.Close(False());
+    }
+
+    conn->track_gtids = true;
+
+    return scope.Close(True());
+#else
+    return THREXC("GTID tracking requires libmysqlclient 5.7.4 or newer");
+#endif
+}
+
+/**
+ * MysqlConnection#errnoSync() -> Integer
+ *
+ * Returns the last error code
+ **/
+Handle<Value> MysqlConnection::ErrnoSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    return scope.Close(Integer::NewFromUnsigned(mysql_errno(conn->_conn)));
+}
+
+/**
+ * MysqlConnection#errorSync() -> String
+ *
+ * Returns the last error message
+ **/
+Handle<Value> MysqlConnection::ErrorSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    const char *error = mysql_error(conn->_conn);
+
+    return scope.Close(V8STR(error));
+}
+
+/**
+ * MysqlConnection#escapeSync(string) -> String
+ * - string (String): String to escape
+ *
+ * Escapes special characters in a string for use in an SQL statement,
+ * taking into account the current charset of the connection
+ **/
+Handle<Value> MysqlConnection::EscapeSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    REQ_STR_ARG(0, str)
+
+    unsigned long len = static_cast<unsigned long>(str.length());
+    char *result = new char[2*len + 1];
+    if (!result) {
+        V8::LowMemoryNotification();
+        return THREXC("Not enough memory");
+    }
+
+    len = mysql_real_escape_string(conn->_conn, result, *str, len);
+    Local<Value> js_result = V8STR2(result, len);
+
+    delete[] result;
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#fieldCountSync() -> Integer
+ *
+ * Returns the number of columns for the most recent query
+ **/
+Handle<Value> MysqlConnection::FieldCountSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    return scope.Close(
+                Integer::NewFromUnsigned(
+                    mysql_field_count(conn->_conn)));
+}
+
+/**
+ * MysqlConnection#getCharsetSync() -> Object
+ *
+ * Returns a character set object
+ **/
+Handle<Value> MysqlConnection::GetCharsetSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    MY_CHARSET_INFO cs;
+
+    mysql_get_character_set_info(conn->_conn, &cs);
+
+    Local<Object> js_result = Object::New();
+
+    js_result->Set(V8STR("charset"), V8STR(cs.csname ? cs.csname : ""));
+    js_result->Set(V8STR("collation"), V8STR(cs.name ? cs.name : ""));
+    js_result->Set(V8STR("dir"), V8STR(cs.dir ? cs.dir : ""));
+    js_result->Set(V8STR("min_length"), Integer::NewFromUnsigned(cs.mbminlen));
+    js_result->Set(V8STR("max_length"), Integer::NewFromUnsigned(cs.mbmaxlen));
+    js_result->Set(V8STR("number"), Integer::NewFromUnsigned(cs.number));
+    js_result->Set(V8STR("state"), Integer::NewFromUnsigned(cs.state));
+    js_result->Set(V8STR("comment"), V8STR(cs.comment ? cs.comment : ""));
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#getCharsetNameSync() -> String
+ *
+ * Returns a character set name
+ **/
+Handle<Value> MysqlConnection::GetCharsetNameSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    return scope.Close(V8STR(mysql_character_set_name(conn->_conn)));
+}
+
+/**
+ * MysqlConnection#getClientInfoSync() -> Object
+ *
+ * Returns the MySQL client version and information
+ **/
+Handle<Value> MysqlConnection::GetClientInfoSync(const Arguments& args) {
+    HandleScope scope;
+
+    Local<Object> js_result = Object::New();
+
+    js_result->Set(V8STR("client_info"),
+                   V8STR(mysql_get_client_info()));
+    js_result->Set(V8STR("client_version"),
+                   Integer::NewFromUnsigned(mysql_get_client_version()));
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#getInfoSync() -> Object
+ *
+ * Returns the MySQL client, server, host and protocol version and information
+ **/
+Handle<Value> MysqlConnection::GetInfoSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    Local<Object> js_result = Object::New();
+
+    js_result->Set(V8STR("client_info"),
+                   V8STR(mysql_get_client_info()));
+    js_result->Set(V8STR("client_version"),
+                   Integer::NewFromUnsigned(mysql_get_client_version()));
+    js_result->Set(V8STR("server_info"),
+                   V8STR(mysql_get_server_info(conn->_conn)));
+    js_result->Set(V8STR("server_version"),
+                   Integer::NewFromUnsigned(
+                       mysql_get_server_version(conn->_conn)));
+    js_result->Set(V8STR("host_info"),
+                   V8STR(mysql_get_host_info(conn->_conn)));
+    js_result->Set(V8STR("proto_info"),
+                   Integer::NewFromUnsigned(mysql_get_proto_info(conn->_conn)));
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#getInfoStringSync() -> String
+ *
+ * Retrieves information about the most recently executed query
+ **/
+Handle<Value> MysqlConnection::GetInfoStringSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    const char *info = mysql_info(conn->_conn);
+
+    return scope.Close(V8STR(info ? info : ""));
+}
+
+/**
+ * MysqlConnection#getWarnings([callback])
+ * - callback (Function): Callback function, gets (error, warnings)
+ *
+ * Gets result of SHOW WARNINGS
+ **/
+Handle<Value> MysqlConnection::GetWarnings(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    command_request *command_req = NewCommandRequest(conn, COMMAND_GET_WARNINGS, callback);
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#getWarningsSync() -> Array
+ *
+ * Gets result of SHOW WARNINGS
+ **/
+Handle<Value> MysqlConnection::GetWarningsSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    MYSQL_RES *result;
+    MYSQL_ROW row;
+    int i = 0;
+
+    Local<Object> js_warning = Object::New();
+    Local<Array> js_result = Array::New();
+
+    if (mysql_warning_count(conn->_conn)) {
+        if (mysql_real_query(conn->_conn, "SHOW WARNINGS", 13) == 0) {
+            result = mysql_store_result(conn->_conn);
+
+            while ((row = mysql_fetch_row(result))) {
+                js_warning->Set(V8STR("errno"), V8STR(row[1])->ToInteger());
+
+                js_warning->Set(V8STR("reason"), V8STR(row[2]));
+
+                js_result->Set(Integer::New(i), js_warning);
+
+                i++;
+            }
+
+            mysql_free_result(result);
+        }
+    }
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#initSync() -> Boolean
+ *
+ * Initializes MysqlConnection
+ **/
+Handle<Value> MysqlConnection::InitSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    if (conn->_conn) {
+        return THREXC("Already initialized");
+    }
+
+    conn->_conn = mysql_init(NULL);
+
+    if (!conn->_conn) {
+        return scope.Close(False());
+    }
+
+    return scope.Close(True());
+}
+
+/**
+ * MysqlConnection#initStatementSync() -> MysqlStatement|Boolean
+ *
+ * Initializes a statement and returns it
+ **/
+Handle<Value> MysqlConnection::InitStatementSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    MYSQL_STMT *my_statement = mysql_stmt_init(conn->_conn);
+
+    if (!my_statement) {
+        return scope.Close(False());
+    }
+
+    Local<Value> argv[2];
+    argv[0] = External::New(my_statement);
+    argv[1] = args.Holder();
+    Persistent<Object> js_result(MysqlStatement::constructor_template->
+                             GetFunction()->NewInstance(2, argv));
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#invalidateResultCacheSync(tags) -> Integer
+ * - tags (String|Array): Tag or tags set by `cacheTags` query option
+ *
+ * Drops cached results stored with any of tags, returns number of dropped results
+ **/
+Handle<Value> MysqlConnection::InvalidateResultCacheSync(const Arguments& args) {
+    HandleScope scope;
+
+    if (args.Length() < 1 || (!args[0]->IsString() && !args[0]->IsArray())) {
+        return THRTYPEEXC("Argument 0 must be a string or an array");
+    }
+
+    size_t tags_len;
+    char *tags = CopyCacheTags(args[0], &tags_len);
+    unsigned int invalidated = 0;
+
+    for (const char *tag = tags; tag < tags + tags_len; tag += strlen(tag) + 1) {
+        invalidated += MysqlResultCache::Invalidate(tag);
+    }
+
+    delete[] tags;
+
+    return scope.Close(Integer::NewFromUnsigned(invalidated));
+}
+
+/**
+ * MysqlConnection#lastGtidSync() -> String|null
+ *
+ * Returns GTID of the last transaction committed on this connection,
+ * see enableGtidTrackingSync()
+ **/
+Handle<Value> MysqlConnection::LastGtidSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    if (!conn->last_gtid) {
+        return scope.Close(Null());
+    }
+
+    return scope.Close(V8STR(conn->last_gtid));
+}
+
+/**
+ * MysqlConnection#lastInsertIdSync() -> Integer
+ *
+ * Returns the auto generated id used in the last query
+ **/
+Handle<Value> MysqlConnection::LastInsertIdSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    MYSQL_RES *result;
+    my_ulonglong insert_id = 0;
+
+    if ( (result = mysql_store_result(conn->_conn)) == 0 &&
+         mysql_field_count(conn->_conn) == 0 &&
+         mysql_insert_id(conn->_conn) != 0) {
+        insert_id = mysql_insert_id(conn->_conn);
+    }
+
+    return scope.Close(Integer::New(insert_id));
+}
+
+/**
+ * MysqlConnection#multiMoreResultsSync() -> Boolean
+ *
+ * Checks if there are any more query results from a multi query
+ **/
+Handle<Value> MysqlConnection::MultiMoreResultsSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    if (mysql_more_results(conn->_conn)) {
+        return scope.Close(True());
+    }
+
+    return scope.Close(False());
+}
+
+/**
+ * MysqlConnection#multiNextResultSync() -> Boolean
+ *
+ * Prepare next result from multi query
+ **/
+Handle<Value> MysqlConnection::MultiNextResultSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    if (!mysql_more_results(conn->_conn)) {
+        return THREXC("There is no next result set."
+                        "Please, call MultiMoreResultsSync() to check "
+                        "whether to call this function/method");
+    }
+
+    if (!mysql_next_result(conn->_conn)) {
+        return scope.Close(True());
+    }
+
+    return scope.Close(False());
+}
+
+/**
+ * MysqlConnection#multiRealQuerySync(query) -> Boolean
+ * - query (String): Query
+ *
+ * Performs a multi query on the database
+ **/
+Handle<Value> MysqlConnection::MultiRealQuerySync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    REQ_STR_ARG(0, query)
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_STREAMING;
+    MYSQLCONN_MUSTNOT_BE_LOADING_INFILE;
+
+    MYSQLCONN_ENABLE_MQ;
+    unsigned int query_len = static_cast<unsigned int>(query.length());
+    if (mysql_real_query(conn->_conn, *query, query_len) != 0) {
+        MYSQLCONN_DISABLE_MQ;
+        return scope.Close(False());
+    }
+    MYSQLCONN_DISABLE_MQ;
+
+    // Schema changes of next statements are read later by nextResultSync()
+    if (HasUseStatement(*query)) {
+        conn->schema_untracked = true;
+        conn->UpdateCacheScope();
+    }
+
+    return scope.Close(True());
+}
+
+/**
+ * MysqlConnection#ping([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Pings a server connection,
+ * or tries to reconnect if the connection has gone down
+ **/
+Handle<Value> MysqlConnection::Ping(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    command_request *command_req = NewCommandRequest(conn, COMMAND_PING, callback);
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#pingSync() -> Boolean
+ *
+ * Pings a server connection,
+ * or tries to reconnect if the connection has gone down
+ **/
+Handle<Value> MysqlConnection::PingSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+
+    if (mysql_ping(conn->_conn)) {
+        return scope.Close(False());
+    }
+
+    return scope.Close(True());
+}
+
+/*!
+ * EIO wrapper functions for MysqlConnection::Query
+ */
+void MysqlConnection::EIO_After_Query(uv_work_t *req) {
+    HandleScope scope;
+
+    struct query_request *query_req = (struct query_request *)(req->data);
+
+    // We can't use const int argc here because argv is used
+    // for both MysqlResult creation and callback call
+    int argc = 1; // node.js convention, there is always at least one argument for callback
+    Local<Value> argv[3];
+    MysqlResultCache::entry *cache_entry = NULL;
+    DEBUG_PRINTF("EIO_After_Query: in\n");
+
+    // Chunk of streamed result is converted before the next one is read,
+    // command stays in flight until the last one
+    if (query_req->use_result) {
+        query_req->conn->streaming_query = query_req;
+
+        TakeResultRows(query_req);
+        delete[] query_req->cache_data;
+        query_req->cache_data = NULL;
+
+        uv_queue_work(uv_default_loop(), req, EIO_QueryChunk, (uv_after_work_cb)EIO_After_Query);
+        return;
+    }
+    if (query_req->conn->streaming_query == query_req) {
+        query_req->conn->streaming_query = NULL;
+    }
+
+    // Load is over, so callbacks can use *Sync() methods again
+    FreeLocalInfileData(query_req->infile_data);
+    query_req->infile_data = NULL;
+    if (!query_req->conn->_conn || !query_req->conn->connected || query_req->connection_closed) {
+        DEBUG_PRINTF("EIO_After_Query: !query_req->conn->_conn || !query_req->conn->connected || query_req->connection_closed\n");
+        // Check connection
+        // If closeSync() is called after query(),
+        // than connection is destroyed here
+        // https://github.com/Sannis/node-mysql-libmysqlclient/issues/157
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (query_req->overloaded) {
+        argv[0] = OverloadException("Query waited in queue longer than maxQueueWaitMs");
+    } else if (query_req->gtid_wait_timed_out) {
+        argv[0] = V8EXC("Timeout waiting for GTID set replication");
+        argv[0]->ToObject()->Set(V8STR("code"), V8STR("EGTIDTIMEOUT"));
+    } else if (!query_req->ok && query_req->canceled) {
+        // Query is finished before KILL QUERY if it is ok, so result is returned
+        argv[0] = V8EXC(query_req->timed_out ? "Query timeout exceeded" : "Query is canceled");
+    } else if (!query_req->ok) {
+        unsigned int error_string_length = strlen(query_req->error) + 20;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length, "Query error #%d: %s",
+                 query_req->errno, query_req->error);
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        if (query_req->gtid) {
+            query_req->conn->SetLastGtid(query_req->gtid);
+            query_req->gtid = NULL;
+        }
+
+        if (query_req->have_result_set && query_req->cache_key) {
+            // querySend() result is encoded here, query() one in the threadpool
+            if (!query_req->cache_data) {
+                query_req->cache_data = MysqlResultCache::Encode(query_req->my_result,
+                                                                 &query_req->cache_data_len);
+            }
+            if (query_req->my_result) {
+                mysql_free_result(query_req->my_result);
+                query_req->my_result = NULL;
+            }
+
+            cache_entry = MysqlResultCache::Store(query_req->cache_key, query_req->cache_key_len,
+                                                  query_req->cache_tags, query_req->cache_tags_len,
+                                                  query_req->cache_data, query_req->cache_data_len,
+                                                  query_req->cache_ttl_ms);
+            query_req->cache_key = NULL;
+            query_req->cache_tags = NULL;
+            query_req->cache_data = NULL;
+
+            argv[1] = MysqlResultCache::Materialize(cache_entry);
+        } else if (query_req->have_result_set && query_req->cache_data) {
+            // Result is encoded in the threadpool, see MysqlConnection#setResultModeSync
+            argv[1] = TakeResultRows(query_req);
+        } else if (query_req->have_result_set) {
+            argv[0] = External::New(query_req->conn->_conn);
+            argv[1] = External::New(query_req->my_result);
+            argv[2] = Integer::NewFromUnsigned(query_req->field_count);
+            Persistent<Object> js_result(MysqlResult::constructor_template->
+                                     GetFunction()->NewInstance(3, argv));
+
+            argv[1] = Local<Object>::New(js_result);
+        } else {
+            Local<Object> js_result = Object::New();
+            js_result->Set(V8STR("affectedRows"),
+                           Integer::New(query_req->affected_rows));
+            js_result->Set(V8STR("insertId"),
+                           Integer::New(query_req->insert_id));
+            argv[1] = Local<Object>::New(js_result);
+        }
+        argc = 2;
+        argv[0] = Local<Value>::New(Null());
+    }
+
+    // Coalesced query callbacks get rows instead of MysqlResult,
+    // it is fetched once per caller or once for all of them
+    Local<Object> js_result;
+    Local<Function> fetch_all;
+    if (query_req->coalesce != COALESCE_NONE && argc == 2 && query_req->have_result_set
+        && !cache_entry && !query_req->cache_data) {
+        js_result = argv[1]->ToObject();
+        fetch_all = Local<Function>::Cast(js_result->Get(V8STR("fetchAllSync")));
+
+        TryCatch try_catch;
+        argv[1] = fetch_all->Call(js_result, 0, NULL);
+        if (try_catch.HasCaught()) {
+            argv[0] = try_catch.Exception();
+            argc = 1;
+        }
+    }
+
+    // Waiters list is detached, so callbacks can't cancel them
+    coalesced_waiter *waiters = query_req->waiters;
+    query_req->waiters = NULL;
+
+    if (query_req->callback->IsFunction() && !query_req->caller_detached) {
+        DEBUG_PRINTF("EIO_After_Query: node::MakeCallback\n");
+        node::MakeCallback(
+            Context::GetCurrent()->Global(),
+            Persistent<Function>::Cast(query_req->callback),
+            argc, argv
+        );
+    }
+    query_req->callback.Dispose();
+
+    while (waiters) {
+        coalesced_waiter *waiter = waiters;
+        waiters = waiter->next;
+
+        if (!fetch_all.IsEmpty() && argc == 2 && query_req->coalesce == COALESCE_COPY) {
+            mysql_data_seek(query_req->my_result, 0);
+
+            TryCatch try_catch;
+            argv[1] = fetch_all->Call(js_result, 0, NULL);
+            if (try_catch.HasCaught()) {
+                argv[0] = try_catch.Exception();
+                argc = 1;
+            }
+        } else if (cache_entry && query_req->coalesce == COALESCE_COPY) {
+            argv[1] = MysqlResultCache::Materialize(cache_entry);
+        } else if (query_req->cache_data && query_req->coalesce == COALESCE_COPY) {
+            argv[1] = MysqlResultCache::Materialize(query_req->cache_data);
+        }
+
+        if (waiter->callback->IsFunction()) {
+            node::MakeCallback(
+                Context::GetCurrent()->Global(),
+                Persistent<Function>::Cast(waiter->callback),
+                argc, argv
+            );
+        }
+
+        FreeWaiter(waiter);
+    }
+
+    if (!fetch_all.IsEmpty()) {
+        // Exception from freeSync() must not leave the libuv callback
+        TryCatch try_catch;
+        Local<Function> free_result = Local<Function>::Cast(js_result->Get(V8STR("freeSync")));
+        free_result->Call(js_result, 0, NULL);
+    }
+
+    if (cache_entry) {
+        MysqlResultCache::Release(cache_entry);
+    }
+
+    query_req->conn->UntrackQuery(query_req);
+
+    // Start next command only after callback,
+    // it can use connection state, e.g. conn.errnoSync()
+    if (!query_req->dequeued) {
+        query_req->conn->CommandDone();
+    }
+
+    // See comment above
+    DEBUG_PRINTF("EIO_After_Query: Unref?\n");
+    if (!query_req->conn->_conn || !query_req->conn->connected) {
+        DEBUG_PRINTF("EIO_After_Query: Unref\n");
+        query_req->conn->Unref();
+        DEBUG_PRINTF("EIO_After_Query: Unref'ed\n");
+    }
+
+    query_req->on_chunk.Dispose();
+    query_req->rows.Dispose();
+
+    delete[] query_req->query;
+    delete[] query_req->cache_key;
+    delete[] query_req->cache_tags;
+    delete[] query_req->cache_data;
+    delete[] query_req->wait_gtid;
+    delete[] query_req->gtid;
+    delete query_req;
+
+    delete req;
+}
+
+void MysqlConnection::EIO_Query(uv_work_t *req) {
+    struct query_request *query_req = (struct query_request *)(req->data);
+
+    MysqlConnection *conn = query_req->conn;
+
+    // Commands queue guarantees that there is no other query for this connection
+    // in the threadpool, so we can wait here only for *Sync() calls
+    DEBUG_PRINTF("EIO_Query: pthread_mutex_lock\n");
+    pthread_mutex_lock(&conn->query_lock);
+    DEBUG_PRINTF("EIO_Query: pthread_mutex_lock'ed\n");
+
+    // Check connection
+    // If closeSync() is called after query(),
+    // than connection is destroyed here
+    // https://github.com/Sannis/node-mysql-libmysqlclient/issues/157
+    if (!conn->_conn || !conn->connected) {
+        query_req->ok = false;
+        query_req->connection_closed = true;
+
+        DEBUG_PRINTF("EIO_Query: !conn->_conn || !conn->connected\n");
+        DEBUG_PRINTF("EIO_Query: pthread_mutex_unlock\n");
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+    query_req->connection_closed = false;
+
+    // Canceled while waiting for a threadpool thread,
+    // KILL QUERY has nothing to interrupt in this case
+    __sync_synchronize();
+    if (query_req->canceled || query_req->overloaded) {
+        query_req->ok = false;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    int r;
+    if (query_req->wait_gtid) {
+        r = RealQueryAfterGtidWait(query_req);
+    } else {
+        MYSQLCONN_DISABLE_MQ;
+
+        // we are protected with mutex, so set CURRENT request data
+        // in connection (common object for ALL queries)
+        SetCorrectLocalInfileHandlers(query_req->infile_data, conn->_conn);
+        r = mysql_real_query(conn->_conn, query_req->query, query_req->query_len);
+
+        // clean after ourselves
+        RestoreLocalInfileHandlers(query_req->infile_data, conn->_conn);
+    }
+
+    if (query_req->gtid_wait_timed_out) {
+        query_req->ok = false;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    int errno = mysql_errno(conn->_conn);
+    if (r != 0 || errno != 0) {
+        // Query error
+        query_req->ok = false;
+        query_req->errno = errno;
+        query_req->error = mysql_error(conn->_conn);
+    } else {
+        query_req->ok = true;
+
+        conn->TrackSessionSchema(query_req->query);
+
+        // Learned size of result is also initial size of its buffer
+        uint64_t expected_bytes = 0;
+        if (query_req->mode == RESULT_MODE_AUTO) {
+            expected_bytes = ResultShapeBytes(query_req->shape_hash);
+        }
+        bool use_result = (query_req->mode == RESULT_MODE_USE
+                           || (query_req->mode == RESULT_MODE_AUTO
+                               && expected_bytes >= query_req->use_result_above_bytes))
+                       && !query_req->cache_key && query_req->coalesce == COALESCE_NONE;
+
+        MYSQL_RES *my_result = use_result ? mysql_use_result(conn->_conn)
+                                          : mysql_store_result(conn->_conn);
+
+        query_req->field_count = mysql_field_count(conn->_conn);
+
+        if (my_result && use_result) {
+            query_req->have_result_set = true;
+            query_req->use_result = my_result;
+
+            size_t size_hint = expected_bytes + expected_bytes / 8;
+            ReadResultChunk(query_req, size_hint < RESULT_CHUNK_BYTES ? size_hint : RESULT_CHUNK_BYTES);
+        } else if (my_result) {
+            // Valid result set (may be empty, of cause)
+            query_req->have_result_set = true;
+            query_req->my_result = my_result;
+
+            // Result for the cache is encoded out of the event loop thread
+            if (query_req->cache_key || query_req->mode != RESULT_MODE_STORE) {
+                query_req->cache_data = MysqlResultCache::Encode(my_result, &query_req->cache_data_len);
+            }
+            if (query_req->mode != RESULT_MODE_STORE) {
+                uint32_t num_rows;
+                memcpy(&num_rows, query_req->cache_data + sizeof(uint32_t), sizeof(num_rows));
+                query_req->result_bytes = query_req->cache_data_len;
+                query_req->result_rows = num_rows;
+
+                mysql_free_result(my_result);
+                query_req->my_result = NULL;
+            }
+        } else {
+            if (query_req->field_count == 0) {
+                // No result set - not a SELECT, SHOW, DESCRIBE or EXPLAIN
+                query_req->have_result_set = false;
+                // UPDATE or DELETE?
+                query_req->affected_rows = mysql_affected_rows(conn->_conn);
+                // INSERT?
+                query_req->insert_id = mysql_insert_id(conn->_conn);
+            } else {
+                // Result store error
+                query_req->ok = false;
+                query_req->errno = errno;
+                query_req->error = mysql_error(conn->_conn);
+            }
+        }
+    }
+
+    // Rows left are read by EIO_QueryChunk
+    if (!query_req->use_result) {
+        FinishQueryResult(query_req);
+    }
+    DEBUG_PRINTF("EIO_Query: pthread_mutex_unlock\n");
+    pthread_mutex_unlock(&conn->query_lock);
+}
+
+/*!
+ * Converts rows of cache_data and passes them to onChunk callback,
+ * or appends them to rows of previous chunks of streamed result
+ */
+Local<Value> MysqlConnection::TakeResultRows(query_request *query_req) {
+    HandleScope scope;
+
+    Local<Array> rows = Local<Array>::Cast(MysqlResultCache::Materialize(query_req->cache_data));
+
+    if (!query_req->on_chunk.IsEmpty()) {
+        Local<Value> argv[1];
+        argv[0] = rows;
+        node::MakeCallback(Context::GetCurrent()->Global(), query_req->on_chunk, 1, argv);
+
+        return scope.Close(Null());
+    }
+
+    if (query_req->rows.IsEmpty()) {
+        if (query_req->use_result) {
+            query_req->rows = Persistent<Array>::New(rows);
+        }
+        return scope.Close(rows);
+    }
+
+    uint32_t count = query_req->rows->Length();
+    for (uint32_t i = 0; i < rows->Length(); i++) {
+        query_req->rows->Set(count + i, rows->Get(i));
+    }
+
+    return scope.Close(Local<Array>::New(query_req->rows));
+}
+
+/*!
+ * Reads next chunk of streamed result after the previous one is converted
+ */
+void MysqlConnection::EIO_QueryChunk(uv_work_t *req) {
+    struct query_request *query_req = (struct query_request *)(req->data);
+
+    MysqlConnection *conn = query_req->conn;
+
+    pthread_mutex_lock(&conn->query_lock);
+
+    // Result is freed by closeSync(), see MysqlConnection::Close
+    if (!conn->_conn || !conn->connected) {
+        query_req->ok = false;
+        query_req->connection_closed = true;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    __sync_synchronize();
+    if (query_req->canceled) {
+        query_req->ok = false;
+
+        // Rows left after KILL QUERY are dropped
+        mysql_free_result(query_req->use_result);
+        query_req->use_result = NULL;
+    } else {
+        ReadResultChunk(query_req, RESULT_CHUNK_BYTES);
+    }
+
+    if (!query_req->use_result) {
+        FinishQueryResult(query_req);
+    }
+    pthread_mutex_unlock(&conn->query_lock);
+}
+
+/*!
+ * Encodes next chunk of streamed result into cache_data,
+ * result is freed after its last row or connection error
+ */
+void MysqlConnection::ReadResultChunk(query_request *query_req, size_t size_hint) {
+    MysqlConnection *conn = query_req->conn;
+    bool more;
+
+    query_req->cache_data = MysqlResultCache::EncodeStream(query_req->use_result, size_hint, RESULT_CHUNK_BYTES,
+                                                           &query_req->cache_data_len, &more);
+
+    uint32_t num_rows;
+    memcpy(&num_rows, query_req->cache_data + sizeof(uint32_t), sizeof(num_rows));
+    query_req->result_bytes += query_req->cache_data_len;
+    query_req->result_rows += num_rows;
+
+    if (more) {
+        return;
+    }
+
+    // Connection error while rows are read
+    unsigned int errno = mysql_errno(conn->_conn);
+    if (errno) {
+        query_req->ok = false;
+        query_req->errno = errno;
+        query_req->error = mysql_error(conn->_conn);
+
+        delete[] query_req->cache_data;
+        query_req->cache_data = NULL;
+    }
+    mysql_free_result(query_req->use_result);
+    query_req->use_result = NULL;
+}
+
+/*!
+ * Reads connection state left after the whole result of query
+ */
+void MysqlConnection::FinishQueryResult(query_request *query_req) {
+    MysqlConnection *conn = query_req->conn;
+
+    if (query_req->ok && conn->track_gtids) {
+        query_req->gtid = SessionGtid(conn->_conn);
+    }
+
+    // Results after the first one, e.g. status of CALL,
+    // would put the next command of connection out of sync
+    while (mysql_more_results(conn->_conn) && mysql_next_result(conn->_conn) == 0) {
+        MYSQL_RES *extra_result = mysql_store_result(conn->_conn);
+        if (extra_result) {
+            mysql_free_result(extra_result);
+        }
+    }
+
+    if (query_req->ok && query_req->have_result_set && query_req->mode == RESULT_MODE_AUTO) {
+        RecordResultShape(query_req->shape_hash, query_req->result_bytes, query_req->result_rows);
+    }
+}
+
+/*!
+ * Sends WAIT_FOR_EXECUTED_GTID_SET() as a statement of its own, then query
+ * if the wait has not timed out, so replica read sees replicated write.
+ * Multi-statements stay off, so query text can't run anything after SELECT.
+ * Connection is left at query result, returns non-zero on error
+ */
+int MysqlConnection::RealQueryAfterGtidWait(query_request *query_req) {
+    MysqlConnection *conn = query_req->conn;
+
+    MYSQLCONN_DISABLE_MQ;
+
+    size_t wait_gtid_len = strlen(query_req->wait_gtid);
+    char *escaped_gtid = new char[wait_gtid_len * 2 + 1];
+    mysql_real_escape_string(conn->_conn, escaped_gtid, query_req->wait_gtid, wait_gtid_len);
+
+    size_t wait_query_size = strlen(escaped_gtid) + 64;
+    char *wait_query = new char[wait_query_size];
+    int wait_query_len;
+    if (query_req->wait_gtid_timeout_ms) {
+        wait_query_len = snprintf(wait_query, wait_query_size, "SELECT WAIT_FOR_EXECUTED_GTID_SET('%s', %u)",
+                                  escaped_gtid, (query_req->wait_gtid_timeout_ms + 999) / 1000);
+    } else {
+        wait_query_len = snprintf(wait_query, wait_query_size, "SELECT WAIT_FOR_EXECUTED_GTID_SET('%s')",
+                                  escaped_gtid);
+    }
+
+    int r = mysql_real_query(conn->_conn, wait_query, wait_query_len);
+
+    delete[] wait_query;
+    delete[] escaped_gtid;
+
+    if (r != 0) {
+        return r;
+    }
+
+    // WAIT_FOR_EXECUTED_GTID_SET() returns 0 on success and 1 on timeout
+    MYSQL_RES *wait_result = mysql_store_result(conn->_conn);
+    if (!wait_result) {
+        return 1;
+    }
+    MYSQL_ROW wait_row = mysql_fetch_row(wait_result);
+    if (!wait_row || !wait_row[0] || strcmp(wait_row[0], "0")) {
+        query_req->gtid_wait_timed_out = true;
+    }
+    mysql_free_result(wait_result);
+
+    // Query is not sent at all after timeout, its result would be stale
+    if (query_req->gtid_wait_timed_out) {
+        return 1;
+    }
+
+    return mysql_real_query(conn->_conn, query_req->query, query_req->query_len);
+}
+
+/*!
+ * Returns true for readable stream, it has on() and pause()
+ */
+static bool IsReadableStream(Handle<Value> value) {
+    if (!value->IsObject() || value->IsFunction() || node::Buffer::HasInstance(value)) {
+        return false;
+    }
+
+    Local<Object> js_stream = value->ToObject();
+    return js_stream->Get(V8STR("on"))->IsFunction() && js_stream->Get(V8STR("pause"))->IsFunction();
+}
+
+/**
+ * MysqlConnection#query(query[, local_infile][, options], callback) -> MysqlQueryHandle
+ * - query (String): Query
+ * - local_infile (Buffer|Stream): Data for LOAD DATA LOCAL INFILE, Buffer or readable stream,
+ *   stream is read while query runs and paused when the server falls behind,
+ *   it must emit Buffers. Until callback querySync(), realQuerySync(),
+ *   multiRealQuerySync() and enableGtidTrackingSync() throw, closeSync() fails the load
+ * - options (Object): Query options, `timeoutMs` sets query deadline,
+ *   `priority` sets queue lane: "interactive" (default), "batch" or "background"
+ *   `coalesce` shares execution of identical concurrent SELECTs,
+ *   callback gets rows array then, one per caller or one for all if "shared",
+ *   SELECTs with user variables or nondeterministic functions always run
+ *   `cacheTtlMs` returns SELECT result from process-wide cache if it is there,
+ *   or stores it for that time, callback gets rows array then,
+ *   SELECTs of session variables (`@v`, `@@session.x`) are never cached,
+ *   `cacheTags` (String or Array) marks stored result for invalidateResultCacheSync()
+ *   `waitForGtid` makes SELECT wait until GTID set is applied on this server,
+ *   wait is sent as a separate statement before query and bounded by `waitForGtidTimeoutMs`,
+ *   error of expired wait has EGTIDTIMEOUT code
+ *   `resultMode` overrides result strategy of connection, see MysqlConnection#setResultModeSync
+ *   `onChunk` (Function) gets rows of every chunk of streamed result, callback gets null
+ *   instead of rows then, rows passed before an error are not taken back
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Performs a query on the database.
+ * Uses mysql_real_query.
+ * Returned handle can be used to cancel query.
+ * Queries of one connection run in the order they are issued,
+ * lane and deadline decide which connection gets a threadpool slot first.
+ **/
+Handle<Value> MysqlConnection::Query(const Arguments& args) {
+    HandleScope scope;
+
+    REQ_STR_ARG(0, query);
+    OPTIONAL_BUFFER_ARG(1, local_infile_buffer);
+
+    Handle<Value> local_infile = local_infile_buffer;
+    if (local_infile->IsNull() && args.Length() > 1 && IsReadableStream(args[1])) {
+        local_infile = args[1];
+    }
+
+    query_options options;
+    int callback_arg = ParseQueryOptions(args, local_infile->IsNull() ? 1 : 2, &options);
+    if (callback_arg < 0) {
+        return Undefined();
+    }
+    OPTIONAL_FUN_ARG(callback_arg, callback);
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+
+    unsigned int query_len = static_cast<unsigned int>(query.length());
+
+    // Waiting query can't share result of query which doesn't wait
+    if (!options.wait_gtid.IsEmpty()) {
+        if (!IsReadQuery(*query) || !local_infile->IsNull()) {
+            return THRTYPEEXC("Option waitForGtid can be used only with SELECT queries");
+        }
+        options.cache_ttl_ms = 0;
+        options.coalesce = COALESCE_NONE;
+    }
+
+    result_mode mode = options.mode != RESULT_MODE_DEFAULT ? options.mode : conn->default_result_mode;
+
+    // Chunks are passed on only while rows of streamed result are read
+    if (!options.on_chunk.IsEmpty()) {
+        if (mode == RESULT_MODE_STORE) {
+            return THRTYPEEXC("Option onChunk can be used only with 'use' or 'auto' result mode");
+        }
+        if (options.cache_ttl_ms || options.coalesce != COALESCE_NONE) {
+            return THRTYPEEXC("Option onChunk can't be used with cacheTtlMs or coalesce");
+        }
+    }
+
+    // Cached result is returned without touching the network or the threadpool
+    char *cache_key = NULL;
+    size_t cache_key_len = 0;
+    if (options.cache_ttl_ms && local_infile->IsNull() && IsReadQuery(*query)) {
+        cache_key = conn->CacheKey(*query, query_len, &cache_key_len);
+    }
+    if (cache_key) {
+        Local<Object> query_handle = conn->ReturnCachedResult(cache_key, cache_key_len, callback, args.Holder());
+        if (!query_handle.IsEmpty()) {
+            delete[] cache_key;
+            return scope.Close(query_handle);
+        }
+    }
+
+    if (local_infile->IsNull()) {
+        Local<Object> query_handle = conn->CoalesceQuery(*query, query_len, options, callback, args.Holder());
+        if (!query_handle.IsEmpty()) {
+            delete[] cache_key;
+            return scope.Close(query_handle);
+        }
+    }
+
+    if (conn->Overloaded()) {
+        delete[] cache_key;
+        return ThrowException(OverloadException("Commands queue is full"));
+    }
+
+    query_request *query_req = new query_request;
+
+    query_req->query = new char[query_len + 1];
+    query_req->query_len = query_len;
+    query_req->infile_data = MysqlConnection::PrepareLocalInfileData(local_infile);
+    // Copy query from V8 value to buffer
+    memcpy(query_req->query, *query, query_len);
+    query_req->query[query_len] = '\0';
+
+    query_req->callback = Persistent<Value>::New(callback);
+    query_req->conn = conn;
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = query_req;
+    Local<Object> query_handle = conn->TrackQuery(query_req, _req, options, args.Holder());
+    if (cache_key) {
+        query_req->cache_key = cache_key;
+        query_req->cache_key_len = cache_key_len;
+        query_req->cache_tags = CopyCacheTags(options.cache_tags, &query_req->cache_tags_len);
+        query_req->cache_ttl_ms = options.cache_ttl_ms;
+    }
+    if (!options.wait_gtid.IsEmpty()) {
+        String::Utf8Value wait_gtid(options.wait_gtid);
+
+        query_req->wait_gtid = new char[wait_gtid.length() + 1];
+        memcpy(query_req->wait_gtid, *wait_gtid, wait_gtid.length() + 1);
+        query_req->wait_gtid_timeout_ms = options.wait_gtid_timeout_ms;
+    }
+    query_req->mode = mode;
+    if (query_req->mode == RESULT_MODE_AUTO) {
+        query_req->shape_hash = HashQueryShape(query_req->query, query_len);
+    }
+    if (!options.on_chunk.IsEmpty()) {
+        query_req->on_chunk = Persistent<Function>::New(Local<Function>::Cast(options.on_chunk));
+    }
+    conn->EnqueueCommand(_req, EIO_Query, (uv_after_work_cb)EIO_After_Query,
+                         options.lane, options.timeout_ms,
+                         &query_req->overloaded, &query_req->dequeued);
+
+    return scope.Close(query_handle);
+}
+
+/*!
+ * Parses optional query options object at position i,
+ * returns position of the next argument or -1 on error
+ */
+int MysqlConnection::ParseQueryOptions(const Arguments& args, int i, query_options *options) {
+    options->timeout_ms = 0;
+    options->lane = LANE_INTERACTIVE;
+    options->coalesce = COALESCE_NONE;
+    options->cache_ttl_ms = 0;
+    options->wait_gtid_timeout_ms = 0;
+    options->mode = RESULT_MODE_DEFAULT;
+
+    if (args.Length() <= i || !args[i]->IsObject() || args[i]->IsFunction()) {
+        return i;
+    }
+
+    Local<Object> js_options = args[i]->ToObject();
+
+    Local<Value> timeout = js_options->Get(V8STR("timeoutMs"));
+
+    if (timeout->IsUint32()) {
+        options->timeout_ms = timeout->Uint32Value();
+    } else if (!timeout->IsUndefined()) {
+        THRTYPEEXC("Option timeoutMs must be a positive integer");
+        return -1;
+    }
+
+    Local<Value> priority = js_options->Get(V8STR("priority"));
+
+    if (!priority->IsUndefined()) {
+        String::Utf8Value priority_name(priority->ToString());
+
+        if (!strcmp(*priority_name, "interactive")) {
+            options->lane = LANE_INTERACTIVE;
+        } else if (!strcmp(*priority_name, "batch")) {
+            options->lane = LANE_BATCH;
+        } else if (!strcmp(*priority_name, "background")) {
+            options->lane = LANE_BACKGROUND;
+        } else {
+            THRTYPEEXC("Option priority must be 'interactive', 'batch' or 'background'");
+            return -1;
+        }
+    }
+
+    Local<Value> coalesce = js_options->Get(V8STR("coalesce"));
+
+    if (coalesce->IsString() && !strcmp(*String::Utf8Value(coalesce), "shared")) {
+        options->coalesce = COALESCE_SHARED;
+    } else if (coalesce->IsBoolean()) {
+        options->coalesce = coalesce->BooleanValue() ? COALESCE_COPY : COALESCE_NONE;
+    } else if (!coalesce->IsUndefined()) {
+        THRTYPEEXC("Option coalesce must be boolean or 'shared'");
+        return -1;
+    }
+
+    Local<Value> cache_ttl = js_options->Get(V8STR("cacheTtlMs"));
+
+    if (cache_ttl->IsUint32()) {
+        options->cache_ttl_ms = cache_ttl->Uint32Value();
+    } else if (!cache_ttl->IsUndefined()) {
+        THRTYPEEXC("Option cacheTtlMs must be a positive integer");
+        return -1;
+    }
+
+    Local<Value> cache_tags = js_options->Get(V8STR("cacheTags"));
+
+    if (cache_tags->IsString() || cache_tags->IsArray()) {
+        options->cache_tags = cache_tags;
+    } else if (!cache_tags->IsUndefined()) {
+        THRTYPEEXC("Option cacheTags must be a string or an array of strings");
+        return -1;
+    }
+
+    Local<Value> wait_gtid = js_options->Get(V8STR("waitForGtid"));
+
+    if (wait_gtid->IsString()) {
+        options->wait_gtid = wait_gtid;
+    } else if (!wait_gtid->IsUndefined() && !wait_gtid->IsNull()) {
+        THRTYPEEXC("Option waitForGtid must be a string");
+        return -1;
+    }
+
+    Local<Value> wait_gtid_timeout = js_options->Get(V8STR("waitForGtidTimeoutMs"));
+
+    if (wait_gtid_timeout->IsUint32()) {
+        options->wait_gtid_timeout_ms = wait_gtid_timeout->Uint32Value();
+    } else if (!wait_gtid_timeout->IsUndefined()) {
+        THRTYPEEXC("Option waitForGtidTimeoutMs must be a positive integer");
+        return -1;
+    }
+
+    Local<Value> mode = js_options->Get(V8STR("resultMode"));
+
+    if (!mode->IsUndefined()) {
+        options->mode = ParseResultMode(mode);
+        if (options->mode == RESULT_MODE_DEFAULT) {
+            THRTYPEEXC("Option resultMode must be 'store', 'use' or 'auto'");
+            return -1;
+        }
+    }
+
+    Local<Value> on_chunk = js_options->Get(V8STR("onChunk"));
+
+    if (!on_chunk->IsUndefined()) {
+        if (!on_chunk->IsFunction()) {
+            THRTYPEEXC("Option onChunk must be a function");
+            return -1;
+        }
+        options->on_chunk = on_chunk;
+    }
+
+    return i + 1;
+}
+
+/*!
+ * Returns RESULT_MODE_DEFAULT for unknown mode name
+ */
+MysqlConnection::result_mode MysqlConnection::ParseResultMode(Handle<Value> mode) {
+    if (!mode->IsString()) {
+        return RESULT_MODE_DEFAULT;
+    }
+
+    String::Utf8Value mode_name(mode);
+
+    if (!strcmp(*mode_name, "store")) {
+        return RESULT_MODE_STORE;
+    } else if (!strcmp(*mode_name, "use")) {
+        return RESULT_MODE_USE;
+    } else if (!strcmp(*mode_name, "auto")) {
+        return RESULT_MODE_AUTO;
+    }
+
+    return RESULT_MODE_DEFAULT;
+}
+
+/*!
+ * Registers query as cancelable and starts its deadline timer,
+ * deadline includes time spent in commands queue
+ */
+Local<Object> MysqlConnection::TrackQuery(query_request *query_req,
+                                          uv_work_t *req,
+                                          const query_options &options,
+                                          Handle<Object> js_conn) {
+    HandleScope scope;
+
+    uint32_t timeout_ms = options.timeout_ms;
+
+    // LOAD DATA LOCAL INFILE and writes are never coalesced
+    if (options.coalesce != COALESCE_NONE && !query_req->infile_data && IsReadQuery(query_req->query)) {
+        query_req->coalesce = options.coalesce;
+        query_req->query_hash = HashQuery(query_req->query, query_req->query_len);
+    } else {
+        query_req->coalesce = COALESCE_NONE;
+        query_req->query_hash = 0;
+    }
+    query_req->lane = options.lane;
+    query_req->waiters = NULL;
+    query_req->caller_detached = false;
+
+    query_req->cache_key = NULL;
+    query_req->cache_key_len = 0;
+    query_req->cache_tags = NULL;
+    query_req->cache_tags_len = 0;
+    query_req->cache_ttl_ms = 0;
+    query_req->cache_data = NULL;
+    query_req->cache_data_len = 0;
+
+    query_req->wait_gtid = NULL;
+    query_req->wait_gtid_timeout_ms = 0;
+    query_req->gtid_wait_timed_out = false;
+    query_req->gtid = NULL;
+
+    query_req->mode = RESULT_MODE_STORE;
+    query_req->shape_hash = 0;
+    query_req->use_result_above_bytes = this->use_result_above_bytes;
+    query_req->use_result = NULL;
+    query_req->result_bytes = 0;
+    query_req->result_rows = 0;
+
+    query_req->id = ++this->last_query_id;
+    query_req->req = req;
+    query_req->canceled = false;
+    query_req->overloaded = false;
+    query_req->dequeued = false;
+    query_req->timed_out = false;
+    query_req->timer = NULL;
+
+    query_req->next_active = this->active_queries;
+    this->active_queries = query_req;
+
+    if (timeout_ms > 0) {
+        query_req->timer = new uv_timer_t;
+        query_req->timer->data = query_req;
+        uv_timer_init(uv_default_loop(), query_req->timer);
+        uv_timer_start(query_req->timer, EV_QueryTimeout, timeout_ms, 0);
+    }
+
+    return scope.Close(NewQueryHandle(js_conn, query_req->id));
+}
+
+Local<Object> MysqlConnection::NewQueryHandle(Handle<Object> js_conn, uint32_t id) {
+    HandleScope scope;
+
+    Local<Object> query_handle =
+        query_handle_template->GetFunction()->NewInstance();
+    query_handle->SetInternalField(0, js_conn);
+    query_handle->SetInternalField(1, Integer::NewFromUnsigned(id));
+
+    return scope.Close(query_handle);
+}
+
+/*!
+ * Single-flight coalescing
+ *
+ * Caller of a SELECT identical to the last queued or running command on this connection
+ * is attached to it as a waiter, so query is executed only once.
+ * Waiter keeps its own timeout, it is not attached to a query from less urgent lane
+ */
+Local<Object> MysqlConnection::CoalesceQuery(const char *query,
+                                             unsigned int query_len,
+                                             const query_options &options,
+                                             Handle<Value> callback,
+                                             Handle<Object> js_conn) {
+    HandleScope scope;
+
+    if (options.coalesce == COALESCE_NONE || !IsReadQuery(query)) {
+        return Local<Object>();
+    }
+
+    query_request *leader = this->FindCoalescingLeader(options.coalesce, options.lane, query, query_len,
+                                                       HashQuery(query, query_len));
+    if (!leader) {
+        return Local<Object>();
+    }
+
+    coalesced_waiter *waiter = new coalesced_waiter;
+
+    waiter->id = ++this->last_query_id;
+    waiter->callback = Persistent<Value>::New(callback);
+    waiter->conn = this;
+    waiter->timer = NULL;
+    waiter->next = NULL;
+
+    if (options.timeout_ms > 0) {
+        waiter->timer = new uv_timer_t;
+        waiter->timer->data = waiter;
+        uv_timer_init(uv_default_loop(), waiter->timer);
+        uv_timer_start(waiter->timer, EV_WaiterTimeout, options.timeout_ms, 0);
+    }
+
+    // Callbacks are called in order of calls
+    coalesced_waiter **last = &leader->waiters;
+    while (*last) {
+        last = &(*last)->next;
+    }
+    *last = waiter;
+
+    return scope.Close(NewQueryHandle(js_conn, waiter->id));
+}
+
+MysqlConnection::query_request *MysqlConnection::FindCoalescingLeader(coalesce_mode coalesce,
+                                                                      command_lane lane,
+                                                                      const char *query,
+                                                                      unsigned int query_len,
+                                                                      uint32_t query_hash) {
+    // Query queued before a later command of the caller, e.g. UPDATE,
+    // would return stale result, so only the last command can be a leader
+    uv_work_t *last_req = this->queue_tail ? this->queue_tail->req : NULL;
+
+    for (query_request *query_req = this->active_queries; query_req; query_req = query_req->next_active) {
+        if (query_req->coalesce == coalesce
+         && (!last_req || query_req->req == last_req)
+         && query_req->lane <= lane
+         && query_req->query_hash == query_hash
+         && query_req->query_len == query_len
+         && !query_req->canceled
+         && !query_req->overloaded
+         && !memcmp(query_req->query, query, query_len)) {
+            return query_req;
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+ * Words that make SELECT result depend on the moment or caller of execution,
+ * or give it side effects: locking reads, lock and sleep functions,
+ * nondeterministic functions and SELECT ... INTO
+ */
+static const char *volatile_query_words[] = {
+    "UPDATE", "SHARE", "GET_LOCK", "RELEASE_LOCK", "RELEASE_ALL_LOCKS", "IS_FREE_LOCK", "IS_USED_LOCK",
+    "SLEEP", "BENCHMARK", "RAND", "UUID", "UUID_SHORT",
+    "NOW", "SYSDATE", "CURDATE", "CURTIME", "CURRENT_DATE", "CURRENT_TIME", "CURRENT_TIMESTAMP",
+    "LOCALTIME", "LOCALTIMESTAMP", "UNIX_TIMESTAMP", "UTC_DATE", "UTC_TIME", "UTC_TIMESTAMP",
+    "LAST_INSERT_ID", "FOUND_ROWS", "ROW_COUNT", "CONNECTION_ID", "NEXTVAL", "INTO",
+    NULL
+};
+
+static bool IsIdentifierChar(char c) {
+    return isalnum((unsigned char) c) || c == '_' || c == '$';
+}
+
+/*!
+ * Only SELECT queries are coalesced and cached.
+ * Words are matched anywhere in the query, so e.g. a column named `now`
+ * only disables coalescing and caching of the query.
+ * User and system variables (`@v`, `@v := ...`, `@@session.x`) belong
+ * to the session and can be assigned by the query, so any `@` or `:=`,
+ * even inside a string literal, makes the query volatile too
+ */
+bool MysqlConnection::IsReadQuery(const char *query) {
+    while (*query == ' ' || *query == '\t' || *query == '\n' || *query == '\r' || *query == '(') {
+        query++;
+    }
+
+    if (strncasecmp(query, "SELECT", 6) != 0) {
+        return false;
+    }
+
+    for (const char *word = query + 6; *word; word++) {
+        if (*word == '@' || (*word == ':' && word[1] == '=')) {
+            return false;
+        }
+
+        if (!IsIdentifierChar(*word) || IsIdentifierChar(word[-1])) {
+            continue;
+        }
+
+        size_t word_len = 1;
+        while (IsIdentifierChar(word[word_len])) {
+            word_len++;
+        }
+
+        for (int i = 0; volatile_query_words[i]; i++) {
+            if (strlen(volatile_query_words[i]) == word_len
+             && strncasecmp(word, volatile_query_words[i], word_len) == 0) {
+                return false;
+            }
+        }
+
+        word += word_len - 1;
+    }
+
+    return true;
+}
+
+/*!
+ * Returns true if one of statements of query text is USE
+ */
+bool MysqlConnection::HasUseStatement(const char *query) {
+    bool statement_start = true;
+    char quote = 0;
+
+    for (const char *c = query; *c; c++) {
+        if (quote) {
+            if (*c == '\\' && quote != '`' && c[1]) {
+                c++;
+            } else if (*c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (*c == ';') {
+            statement_start = true;
+            continue;
+        }
+
+        if (statement_start) {
+            if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+                continue;
+            }
+            if (strncasecmp(c, "USE", 3) == 0 && !IsIdentifierChar(c[3])) {
+                return true;
+            }
+            statement_start = false;
+        }
+
+        if (*c == '\'' || *c == '"' || *c == '`') {
+            quote = *c;
+        }
+    }
+
+    return false;
+}
+
+/*!
+ * Called after connect, changeUser(), selectDb() and setCharset(),
+ * current database is known again
+ */
+void MysqlConnection::SessionChanged() {
+    this->max_allowed_packet = 0;
+    this->schema_untracked = false;
+    this->UpdateCacheScope();
+}
+
+/*!
+ * Called after successful query, USE changes current database of the session.
+ * Client library updates it from session state tracking if server reports it
+ */
+void MysqlConnection::TrackSessionSchema(const char *query) {
+    if (!HasUseStatement(query)) {
+        return;
+    }
+
+#if MYSQL_VERSION_ID >= 50704
+    const char *data;
+    size_t length;
+
+    if (mysql_session_track_get_first(this->_conn, SESSION_TRACK_SCHEMA, &data, &length) == 0) {
+        this->SessionChanged();
+        return;
+    }
+#endif
+
+    // Results of this connection are not cached until selectDb() or changeUser()
+    this->schema_untracked = true;
+    this->UpdateCacheScope();
+}
+
+/*!
+ * Copies connection scope for cache keys, called by the thread that uses connection handle
+ */
+void MysqlConnection::UpdateCacheScope() {
+    char *scope = NULL;
+    size_t scope_len = 0;
+
+    if (this->_conn && this->connected && !this->schema_untracked) {
+        char port[12];
+        snprintf(port, sizeof(port), "%u", this->_conn->port);
+
+        const char *parts[6] = {
+            this->_conn->host,
+            port,
+            this->_conn->unix_socket,
+            this->_conn->user,
+            mysql_character_set_name(this->_conn),
+            this->_conn->db
+        };
+
+        for (int i = 0; i < 6; i++) {
+            scope_len += (parts[i] ? strlen(parts[i]) : 0) + 1;
+        }
+
+        scope = new char[scope_len];
+        char *p = scope;
+        for (int i = 0; i < 6; i++) {
+            size_t part_len = parts[i] ? strlen(parts[i]) : 0;
+            if (part_len) {
+                memcpy(p, parts[i], part_len);
+                p += part_len;
+            }
+            *p++ = '\0';
+        }
+    }
+
+    pthread_mutex_lock(&this->kill_lock);
+    char *old_scope = this->cache_scope;
+    this->cache_scope = scope;
+    this->cache_scope_len = scope_len;
+    pthread_mutex_unlock(&this->kill_lock);
+
+    delete[] old_scope;
+}
+
+/*!
+ * Returns result cache key for query, NULL if results of connection can't be cached now
+ */
+char *MysqlConnection::CacheKey(const char *query, size_t query_len, size_t *key_len) {
+    char *key = NULL;
+
+    pthread_mutex_lock(&this->kill_lock);
+    if (this->cache_scope) {
+        key = MysqlResultCache::BuildKey(query, query_len, this->cache_scope, this->cache_scope_len, key_len);
+    }
+    pthread_mutex_unlock(&this->kill_lock);
+
+    return key;
+}
+
+/*!
+ * Result cache hit, rows are materialized on the next event loop iteration
+ * from the cached encoding, so callback is never called synchronously
+ */
+Local<Object> MysqlConnection::ReturnCachedResult(const char *cache_key,
+                                                  size_t cache_key_len,
+                                                  Handle<Value> callback,
+                                                  Handle<Object> js_conn) {
+    HandleScope scope;
+
+    MysqlResultCache::entry *cached = MysqlResultCache::Lookup(cache_key, cache_key_len);
+    if (!cached) {
+        return Local<Object>();
+    }
+
+    cached_query_request *cached_req = new cached_query_request;
+    cached_req->callback = Persistent<Value>::New(callback);
+    cached_req->cached = cached;
+
+    uv_timer_t *timer = new uv_timer_t;
+    timer->data = cached_req;
+    uv_timer_init(uv_default_loop(), timer);
+    uv_timer_start(timer, EV_CachedQuery, 0, 0);
+
+    // Cached result is already complete, handle can't cancel it
+    return scope.Close(NewQueryHandle(js_conn, ++this->last_query_id));
+}
+
+void MysqlConnection::EV_CachedQuery(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
+
+    cached_query_request *cached_req = (cached_query_request *)(handle->data);
+
+    uv_close((uv_handle_t *) handle, EV_QueryTimeout_OnTimerClose);
+
+    if (cached_req->callback->IsFunction()) {
+        Local<Value> argv[2];
+        argv[0] = Local<Value>::New(Null());
+        argv[1] = MysqlResultCache::Materialize(cached_req->cached);
+
+        node::MakeCallback(
+            Context::GetCurrent()->Global(),
+            Persistent<Function>::Cast(cached_req->callback),
+            2, argv
+        );
+    }
+    cached_req->callback.Dispose();
+
+    MysqlResultCache::Release(cached_req->cached);
+
+    delete cached_req;
+}
+
+/*!
+ * Copies cacheTags option into '\0'-separated buffer
+ */
+char *MysqlConnection::CopyCacheTags(Handle<Value> tags, size_t *tags_len) {
+    HandleScope scope;
+
+    *tags_len = 0;
+
+    if (tags.IsEmpty() || (!tags->IsString() && !tags->IsArray())) {
+        return NULL;
+    }
+
+    Local<Array> js_tags;
+    if (tags->IsArray()) {
+        js_tags = Local<Array>::Cast(tags->ToObject());
+    } else {
+        js_tags = Array::New(1);
+        js_tags->Set(0, tags);
+    }
+
+    uint32_t i;
+    for (i = 0; i < js_tags->Length(); i++) {
+        *tags_len += js_tags->Get(i)->ToString()->Utf8Length() + 1;
+    }
+
+    char *buffer = new char[*tags_len];
+    char *p = buffer;
+    for (i = 0; i < js_tags->Length(); i++) {
+        String::Utf8Value tag(js_tags->Get(i)->ToString());
+
+        memcpy(p, *tag, tag.length() + 1);
+        p += tag.length() + 1;
+    }
+
+    return buffer;
+}
+
+/*!
+ * FNV-1a hash of query text
+ */
+uint32_t MysqlConnection::HashQuery(const char *query, unsigned int query_len) {
+    uint32_t hash = 2166136261U;
+
+    for (unsigned int i = 0; i < query_len; i++) {
+        hash ^= static_cast<unsigned char>(query[i]);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/*!
+ * FNV-1a hash of query text with literals replaced by '?',
+ * whitespace runs squeezed and letters lowercased,
+ * so queries differing only in parameters have same shape
+ */
+uint32_t MysqlConnection::HashQueryShape(const char *query, unsigned int query_len) {
+    uint32_t hash = 2166136261U;
+    bool in_word = false;
+    unsigned int i = 0;
+
+    while (i < query_len) {
+        unsigned char c = query[i];
+
+        if (c == '\'' || c == '"') {
+            for (i++; i < query_len && query[i] != c; i++) {
+                if (query[i] == '\\') {
+                    i++;
+                }
+            }
+            i++;
+            c = '?';
+        } else if (c >= '0' && c <= '9' && !in_word) {
+            while (i < query_len && (isalnum(static_cast<unsigned char>(query[i])) || query[i] == '.')) {
+                i++;
+            }
+            c = '?';
+        } else if (isspace(c)) {
+            while (i < query_len && isspace(static_cast<unsigned char>(query[i]))) {
+                i++;
+            }
+            c = ' ';
+        } else {
+            i++;
+            c = tolower(c);
+        }
+
+        in_word = isalnum(c) || c == '_' || c == '$';
+
+        hash ^= c;
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+/*!
+ * Returns learned size of result of query shape, 0 if it is unknown
+ */
+uint64_t MysqlConnection::ResultShapeBytes(uint32_t shape_hash) {
+    result_shape *shape = &result_shapes[shape_hash % RESULT_SHAPES];
+    uint64_t bytes = 0;
+
+    pthread_mutex_lock(&result_shapes_lock);
+    if (shape->samples && shape->hash == shape_hash) {
+        bytes = shape->bytes;
+    }
+    pthread_mutex_unlock(&result_shapes_lock);
+
+    return bytes;
+}
+
+/*!
+ * Updates moving averages of query shape, other shape in its slot is replaced
+ */
+void MysqlConnection::RecordResultShape(uint32_t shape_hash, uint64_t bytes, uint64_t rows) {
+    result_shape *shape = &result_shapes[shape_hash % RESULT_SHAPES];
+
+    pthread_mutex_lock(&result_shapes_lock);
+    if (!shape->samples || shape->hash != shape_hash) {
+        shape->hash = shape_hash;
+        shape->samples = 0;
+        shape->bytes = bytes;
+        shape->rows = rows;
+    } else {
+        shape->bytes = (shape->bytes * 3 + bytes) / 4;
+        shape->rows = (shape->rows * 3 + rows) / 4;
+    }
+    shape->samples++;
+    pthread_mutex_unlock(&result_shapes_lock);
+}
+
+void MysqlConnection::UntrackQuery(query_request *query_req) {
+    query_request **active = &this->active_queries;
+
+    while (*active && *active != query_req) {
+        active = &(*active)->next_active;
+    }
+
+    if (*active) {
+        *active = query_req->next_active;
+    }
+
+    if (query_req->timer) {
+        uv_timer_stop(query_req->timer);
+        uv_close((uv_handle_t *) query_req->timer, EV_QueryTimeout_OnTimerClose);
+        query_req->timer = NULL;
+    }
+}
+
+/*!
+ * Cancels queued or running query by id
+ *
+ * Queued query is failed immediately,
+ * running one is interrupted with KILL QUERY, connection stays usable
+ */
+bool MysqlConnection::CancelQuery(uint32_t id, bool timed_out) {
+    HandleScope scope;
+
+    query_request *query_req = this->active_queries;
+
+    while (query_req && query_req->id != id) {
+        // Coalesced waiter is just detached from query
+        coalesced_waiter **waiter = &query_req->waiters;
+        while (*waiter && (*waiter)->id != id) {
+            waiter = &(*waiter)->next;
+        }
+
+        if (*waiter) {
+            coalesced_waiter *canceled = *waiter;
+            *waiter = canceled->next;
+
+            DeferCanceledCallback(canceled->callback, timed_out);
+            FreeWaiter(canceled);
+
+            return true;
+        }
+
+        query_req = query_req->next_active;
+    }
+
+    if (!query_req || query_req->canceled || query_req->caller_detached) {
+        return false;
+    }
+
+    // Query still runs for coalesced waiters, only caller gets error
+    if (query_req->waiters) {
+        query_req->caller_detached = true;
+
+        DeferCanceledCallback(query_req->callback, timed_out);
+
+        return true;
+    }
+
+    query_req->timed_out = timed_out;
+    query_req->canceled = true;
+    __sync_synchronize();
+
+    // Callback is not called from inside of cancel(), as for the other outcomes
+    if (this->RemoveCommand(query_req->req)) {
+        query_req->ok = false;
+        query_req->connection_closed = false;
+        query_req->dequeued = true;
+
+        uv_timer_t *timer = new uv_timer_t;
+        timer->data = query_req;
+        uv_timer_init(uv_default_loop(), timer);
+        uv_timer_start(timer, EV_CanceledQuery, 0, 0);
 
-    REQ_STR_ARG(0, query)
+        return true;
+    }
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    // Running LOAD DATA can wait for stream data, KILL QUERY can't interrupt it
+    AbortLocalInfile(query_req->infile_data, timed_out ? "Query timeout exceeded" : "Query is canceled");
 
-    MYSQLCONN_ENABLE_MQ;
-    unsigned int query_len = static_cast<unsigned int>(query.length());
-    if (mysql_real_query(conn->_conn, *query, query_len) != 0) {
-        MYSQLCONN_DISABLE_MQ;
-        return scope.Close(False());
+    if (!this->_conn || !this->connected || this->kill_pending) {
+        return true;
     }
-    MYSQLCONN_DISABLE_MQ;
 
-    return scope.Close(True());
-}
+    // Connection parameters are copied,
+    // they are not changed until running query is done
+    kill_request *kill_req = new kill_request;
 
-/**
- * MysqlConnection#pingSync() -> Boolean
- *
- * Pings a server connection,
- * or tries to reconnect if the connection has gone down
- **/
-Handle<Value> MysqlConnection::PingSync(const Arguments& args) {
-    HandleScope scope;
+    kill_req->conn = this;
+    kill_req->thread_id = mysql_thread_id(this->_conn);
+    kill_req->host = this->_conn->host ? strdup(this->_conn->host) : NULL;
+    kill_req->user = this->_conn->user ? strdup(this->_conn->user) : NULL;
+    kill_req->passwd = this->_conn->passwd ? strdup(this->_conn->passwd) : NULL;
+    kill_req->unix_socket = this->_conn->unix_socket ? strdup(this->_conn->unix_socket) : NULL;
+    kill_req->port = this->_conn->port;
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+    this->kill_pending = true;
+    this->Ref();
 
-    MYSQLCONN_MUSTBE_CONNECTED;
+    // Bypasses commands scheduler, threadpool thread reserved
+    // by threadpool_jobs_max is free for it even if queries fill the rest
+    uv_work_t *_req = new uv_work_t;
+    _req->data = kill_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_KillQuery, (uv_after_work_cb)EIO_After_KillQuery);
 
-    if (mysql_ping(conn->_conn)) {
-        return scope.Close(False());
-    }
+    return true;
+}
 
-    return scope.Close(True());
+void MysqlConnection::EV_QueryTimeout(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
+
+    struct query_request *query_req = (struct query_request *)(handle->data);
+
+    query_req->conn->CancelQuery(query_req->id, true);
 }
 
 /*!
- * EIO wrapper functions for MysqlConnection::Query
+ * Calls callback of canceled query or waiter in next loop iteration
  */
-void MysqlConnection::EIO_After_Query(uv_work_t *req) {
-    HandleScope scope;
+void MysqlConnection::DeferCanceledCallback(Handle<Value> callback, bool timed_out) {
+    canceled_callback *canceled = new canceled_callback;
+    canceled->callback = Persistent<Value>::New(callback);
+    canceled->timed_out = timed_out;
+
+    uv_timer_t *timer = new uv_timer_t;
+    timer->data = canceled;
+    uv_timer_init(uv_default_loop(), timer);
+    uv_timer_start(timer, EV_CanceledCallback, 0, 0);
+}
 
-    struct query_request *query_req = (struct query_request *)(req->data);
+void MysqlConnection::EV_CanceledCallback(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
 
-    // We can't use const int argc here because argv is used
-    // for both MysqlResult creation and callback call
-    int argc = 1; // node.js convention, there is always at least one argument for callback
-    Local<Value> argv[3];
-    DEBUG_PRINTF("EIO_After_Query: in\n");
-    if (!query_req->conn->_conn || !query_req->conn->connected || query_req->connection_closed) {
-        DEBUG_PRINTF("EIO_After_Query: !query_req->conn->_conn || !query_req->conn->connected || query_req->connection_closed\n");
-        // Check connection
-        // If closeSync() is called after query(),
-        // than connection is destroyed here
-        // https://github.com/Sannis/node-mysql-libmysqlclient/issues/157
-        argv[0] = V8EXC("Connection is closed by closeSync() during query");
-    } else if (!query_req->ok) {
-        unsigned int error_string_length = strlen(query_req->error) + 20;
-        char* error_string = new char[error_string_length];
-        snprintf(error_string, error_string_length, "Query error #%d: %s",
-                 query_req->errno, query_req->error);
+    canceled_callback *canceled = (canceled_callback *)(handle->data);
 
-        argv[0] = V8EXC(error_string);
-        delete[] error_string;
-    } else {
-        if (query_req->have_result_set) {
-            argv[0] = External::New(query_req->conn->_conn);
-            argv[1] = External::New(query_req->my_result);
-            argv[2] = Integer::NewFromUnsigned(query_req->field_count);
-            Persistent<Object> js_result(MysqlResult::constructor_template->
-                                     GetFunction()->NewInstance(3, argv));
+    uv_close((uv_handle_t *) handle, EV_QueryTimeout_OnTimerClose);
 
-            argv[1] = Local<Object>::New(js_result);
-        } else {
-            Local<Object> js_result = Object::New();
-            js_result->Set(V8STR("affectedRows"),
-                           Integer::New(query_req->affected_rows));
-            js_result->Set(V8STR("insertId"),
-                           Integer::New(query_req->insert_id));
-            argv[1] = Local<Object>::New(js_result);
-        }
-        argc = 2;
-        argv[0] = Local<Value>::New(Null());
-    }
+    if (canceled->callback->IsFunction()) {
+        Local<Value> argv[1];
+        argv[0] = V8EXC(canceled->timed_out ? "Query timeout exceeded" : "Query is canceled");
 
-    if (query_req->callback->IsFunction()) {
-        DEBUG_PRINTF("EIO_After_Query: node::MakeCallback\n");
         node::MakeCallback(
             Context::GetCurrent()->Global(),
-            Persistent<Function>::Cast(query_req->callback),
-            argc, argv
+            Persistent<Function>::Cast(canceled->callback),
+            1, argv
         );
-
-        query_req->callback.Dispose();
     }
+    canceled->callback.Dispose();
 
-    // See comment above
-    DEBUG_PRINTF("EIO_After_Query: Unref?\n");
-    if (!query_req->conn->_conn || !query_req->conn->connected) {
-        DEBUG_PRINTF("EIO_After_Query: Unref\n");
-        query_req->conn->Unref();
-        DEBUG_PRINTF("EIO_After_Query: Unref'ed\n");
-    }
+    delete canceled;
+}
 
-    delete[] query_req->query;
-    delete query_req;
+void MysqlConnection::EV_CanceledQuery(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
 
-    delete req;
+    struct query_request *query_req = (struct query_request *)(handle->data);
+
+    uv_close((uv_handle_t *) handle, EV_QueryTimeout_OnTimerClose);
+
+    EIO_After_Query(query_req->req);
 }
 
-void MysqlConnection::EIO_Query(uv_work_t *req) {
-    struct query_request *query_req = (struct query_request *)(req->data);
+void MysqlConnection::EV_WaiterTimeout(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
 
-    MysqlConnection *conn = query_req->conn;
+    coalesced_waiter *waiter = (coalesced_waiter *)(handle->data);
 
-    DEBUG_PRINTF("EIO_Query: pthread_mutex_lock\n");
-    pthread_mutex_lock(&conn->query_lock);
-    DEBUG_PRINTF("EIO_Query: pthread_mutex_lock'ed\n");
+    waiter->conn->CancelQuery(waiter->id, true);
+}
 
-    // Check connection
-    // If closeSync() is called after query(),
-    // than connection is destroyed here
-    // https://github.com/Sannis/node-mysql-libmysqlclient/issues/157
-    if (!conn->_conn || !conn->connected) {
-        query_req->ok = false;
-        query_req->connection_closed = true;
+void MysqlConnection::FreeWaiter(coalesced_waiter *waiter) {
+    if (waiter->timer) {
+        uv_close((uv_handle_t *) waiter->timer, EV_QueryTimeout_OnTimerClose);
+    }
+    waiter->callback.Dispose();
 
-        DEBUG_PRINTF("EIO_Query: !conn->_conn || !conn->connected\n");
-        DEBUG_PRINTF("EIO_Query: pthread_mutex_unlock\n");
-        pthread_mutex_unlock(&conn->query_lock);
-        return;
+    delete waiter;
+}
+
+void MysqlConnection::EV_QueryTimeout_OnTimerClose(uv_handle_t *handle) {
+    delete (uv_timer_t *) handle;
+}
+
+/*!
+ * EIO wrapper functions for KILL QUERY
+ */
+void MysqlConnection::EIO_After_KillQuery(uv_work_t *req) {
+    struct kill_request *kill_req = (struct kill_request *)(req->data);
+
+    MysqlConnection *conn = kill_req->conn;
+
+    conn->kill_pending = false;
+    if (!conn->command_in_flight) {
+        conn->DispatchNextCommand();
     }
-    query_req->connection_closed = false;
 
-    MYSQLCONN_DISABLE_MQ;
+    conn->Unref();
 
-    // we are protected with mutex, so set CURRENT request data
-    // in connection (common object for ALL queries)
-    SetCorrectLocalInfileHandlers(query_req->infile_data, conn->_conn);
-    int r = mysql_real_query(conn->_conn, query_req->query, query_req->query_len);
+    free(kill_req->host);
+    free(kill_req->user);
+    free(kill_req->passwd);
+    free(kill_req->unix_socket);
+    delete kill_req;
 
-    // clean after ourselves
-    RestoreLocalInfileHandlers(query_req->infile_data, conn->_conn);
+    delete req;
+}
 
-    int errno = mysql_errno(conn->_conn);
-    if (r != 0 || errno != 0) {
-        // Query error
-        query_req->ok = false;
-        query_req->errno = errno;
-        query_req->error = mysql_error(conn->_conn);
-    } else {
-        query_req->ok = true;
+void MysqlConnection::EIO_KillQuery(uv_work_t *req) {
+    struct kill_request *kill_req = (struct kill_request *)(req->data);
 
-        MYSQL_RES *my_result = mysql_store_result(conn->_conn);
+    MysqlConnection *conn = kill_req->conn;
 
-        query_req->field_count = mysql_field_count(conn->_conn);
+    pthread_mutex_lock(&conn->kill_lock);
 
-        if (my_result) {
-            // Valid result set (may be empty, of cause)
-            query_req->have_result_set = true;
-            query_req->my_result = my_result;
-        } else {
-            if (query_req->field_count == 0) {
-                // No result set - not a SELECT, SHOW, DESCRIBE or EXPLAIN
-                query_req->have_result_set = false;
-                // UPDATE or DELETE?
-                query_req->affected_rows = mysql_affected_rows(conn->_conn);
-                // INSERT?
-                query_req->insert_id = mysql_insert_id(conn->_conn);
-            } else {
-                // Result store error
-                query_req->ok = false;
-                query_req->errno = errno;
-                query_req->error = mysql_error(conn->_conn);
-            }
+    mysql_thread_init();
+
+    if (!conn->kill_conn) {
+        conn->kill_conn = mysql_init(NULL);
+
+        if (conn->kill_conn) {
+            conn->ApplyConnectOptions(conn->kill_conn);
+        }
+
+        // Database and multi statements are not needed for KILL QUERY
+        if (conn->kill_conn && !mysql_real_connect(conn->kill_conn,
+                                                   kill_req->host,
+                                                   kill_req->user,
+                                                   kill_req->passwd,
+                                                   NULL,
+                                                   kill_req->port,
+                                                   kill_req->unix_socket,
+                                                   conn->connect_flags
+                                                   & ~(CLIENT_MULTI_STATEMENTS | CLIENT_MULTI_RESULTS))) {
+            DEBUG_PRINTF("EIO_KillQuery: %s\n", mysql_error(conn->kill_conn));
+            mysql_close(conn->kill_conn);
+            conn->kill_conn = NULL;
         }
     }
-    DEBUG_PRINTF("EIO_Query: pthread_mutex_unlock\n");
-    pthread_mutex_unlock(&conn->query_lock);
+
+    if (conn->kill_conn) {
+        char kill_query[32];
+        int kill_query_len = snprintf(kill_query, sizeof(kill_query), "KILL QUERY %lu", kill_req->thread_id);
+
+        if (mysql_real_query(conn->kill_conn, kill_query, kill_query_len)) {
+            // Side connection is broken, open new one next time
+            mysql_close(conn->kill_conn);
+            conn->kill_conn = NULL;
+        }
+    }
+
+    mysql_thread_end();
+
+    pthread_mutex_unlock(&conn->kill_lock);
 }
 
 /**
- * MysqlConnection#query(query, callback)
- * - query (String): Query
- * - callback (Function): Callback function, gets (error, result)
+ * MysqlQueryHandle#cancel() -> Boolean
  *
- * Performs a query on the database.
- * Uses mysql_real_query.
+ * Cancels query started with query() or querySend().
+ * Callback gets "Query is canceled" error.
+ * Returns false if query is already finished.
  **/
-Handle<Value> MysqlConnection::Query(const Arguments& args) {
+Handle<Value> MysqlConnection::QueryCancel(const Arguments& args) {
     HandleScope scope;
 
-    REQ_STR_ARG(0, query);
-    OPTIONAL_BUFFER_ARG(1, local_infile_buffer);
-
-    Handle<Value> callback;
-    if (local_infile_buffer->IsNull()) {
-      OPTIONAL_FUN_ARG(1, possibly_callback);
-      callback = possibly_callback;
-    } else {
-      OPTIONAL_FUN_ARG(2, possibly_callback);
-      callback = possibly_callback;
+    Local<Object> query_handle = args.This();
+    if (query_handle->InternalFieldCount() != 2) {
+        return THREXC("cancel() must be called on query handle");
     }
 
-    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
-
-    MYSQLCONN_MUSTBE_CONNECTED;
-
-    query_request *query_req = new query_request;
-    unsigned int query_len = static_cast<unsigned int>(query.length());
-
-    query_req->query = new char[query_len + 1];
-    query_req->query_len = query_len;
-    query_req->infile_data = MysqlConnection::PrepareLocalInfileData(local_infile_buffer);
-    // Copy query from V8 value to buffer
-    memcpy(query_req->query, *query, query_len);
-    query_req->query[query_len] = '\0';
-
-    query_req->callback = Persistent<Value>::New(callback);
-    query_req->conn = conn;
-    conn->Ref();
-
-    uv_work_t *_req = new uv_work_t;
-    _req->data = query_req;
-    uv_queue_work(uv_default_loop(), _req, EIO_Query, (uv_after_work_cb)EIO_After_Query);
+    MysqlConnection *conn =
+        OBJUNWRAP<MysqlConnection>(query_handle->GetInternalField(0)->ToObject());
+    uint32_t id = query_handle->GetInternalField(1)->Uint32Value();
 
-    return Undefined();
+    return scope.Close(conn->CancelQuery(id, false) ? True() : False());
 }
 
 /*!
@@ -1179,13 +4572,11 @@ Handle<Value> MysqlConnection::Query(const Arguments& args) {
 void MysqlConnection::EV_After_QuerySend(NODE_ADDON_SHIM_IO_WATCH_CALLBACK_ARGUMENTS) {
     HandleScope scope;
 
-    uv_work_t *_req = new uv_work_t;
-
-    // Fake uv_work_t struct for EIO_After_Query call
+    // Queued uv_work_t struct for EIO_After_Query call
 #if NODE_VERSION_AT_LEAST(0, 7, 9)
-    _req->data = handle->data;
+    uv_work_t *_req = static_cast<uv_work_t *>(handle->data);
 #else
-    _req->data = io_watcher->data;
+    uv_work_t *_req = static_cast<uv_work_t *>(io_watcher->data);
 #endif
 
     // Stop IO watcher
@@ -1224,6 +4615,8 @@ void MysqlConnection::EV_After_QuerySend(NODE_ADDON_SHIM_IO_WATCH_CALLBACK_ARGUM
     } else {
         query_req->ok = true;
 
+        conn->TrackSessionSchema(query_req->query);
+
         MYSQL_RES *my_result = mysql_store_result(conn->_conn);
 
         query_req->field_count = mysql_field_count(conn->_conn);
@@ -1249,48 +4642,150 @@ void MysqlConnection::EV_After_QuerySend(NODE_ADDON_SHIM_IO_WATCH_CALLBACK_ARGUM
         }
     }
 
+    if (query_req->ok && conn->track_gtids) {
+        query_req->gtid = SessionGtid(conn->_conn);
+    }
+
     // The callback part, just call the existing code
     EIO_After_Query(_req);
 }
 
 /**
- * MysqlConnection#querySend(query, callback)
+ * MysqlConnection#querySend(query[, options], callback) -> MysqlQueryHandle
  * - query (String): Query
+ * - options (Object): Query options, `timeoutMs` sets query deadline,
+ *   `priority` sets queue lane: "interactive" (default), "batch" or "background"
+ *   `coalesce` shares execution of identical concurrent SELECTs,
+ *   callback gets rows array then, one per caller or one for all if "shared"
+ *   `cacheTtlMs` and `cacheTags` use result cache, see MysqlConnection#query
  * - callback (Function): Callback function, gets (errro, result)
  *
  * Performs a query on the database.
  * Uses mysql_send_query.
+ * Returned handle can be used to cancel query.
+ * Queries of one connection run in the order they are issued,
+ * lane and deadline decide which connection gets a threadpool slot first.
  */
 Handle<Value> MysqlConnection::QuerySend(const Arguments& args) {
     HandleScope scope;
 
     REQ_STR_ARG(0, query);
-    OPTIONAL_FUN_ARG(1, callback);
+
+    query_options options;
+    int callback_arg = ParseQueryOptions(args, 1, &options);
+    if (callback_arg < 0) {
+        return Undefined();
+    }
+    OPTIONAL_FUN_ARG(callback_arg, callback);
 
     MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
 
     MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
 
-    query_request *query_req = new query_request;
+    if (!options.wait_gtid.IsEmpty()) {
+        return THRTYPEEXC("Option waitForGtid is not supported by querySend(), use query()");
+    }
+
+    // Result is read in the event loop thread, so it is always stored
+    if (options.mode != RESULT_MODE_DEFAULT && options.mode != RESULT_MODE_STORE) {
+        return THRTYPEEXC("Option resultMode is not supported by querySend(), use query()");
+    }
+    if (!options.on_chunk.IsEmpty()) {
+        return THRTYPEEXC("Option onChunk is not supported by querySend(), use query()");
+    }
 
     unsigned int query_len = static_cast<unsigned int>(query.length());
+
+    char *cache_key = NULL;
+    size_t cache_key_len = 0;
+    Local<Object> query_handle;
+    if (options.cache_ttl_ms && IsReadQuery(*query)) {
+        cache_key = conn->CacheKey(*query, query_len, &cache_key_len);
+    }
+    if (cache_key) {
+        query_handle = conn->ReturnCachedResult(cache_key, cache_key_len, callback, args.Holder());
+        if (!query_handle.IsEmpty()) {
+            delete[] cache_key;
+            return scope.Close(query_handle);
+        }
+    }
+
+    query_handle = conn->CoalesceQuery(*query, query_len, options, callback, args.Holder());
+    if (!query_handle.IsEmpty()) {
+        delete[] cache_key;
+        return scope.Close(query_handle);
+    }
+
+    if (conn->Overloaded()) {
+        delete[] cache_key;
+        return ThrowException(OverloadException("Commands queue is full"));
+    }
+
+    query_request *query_req = new query_request;
+
     query_req->query = new char[query_len + 1];
 
     // Copy query from V8 var to buffer
     memcpy(query_req->query, *query, query_len);
     query_req->query[query_len] = '\0';
 
+    query_req->query_len = query_len;
+    query_req->infile_data = NULL;
+
     query_req->callback = Persistent<Value>::New(callback);
     query_req->conn = conn;
     conn->Ref();
 
+    uv_work_t *_req = new uv_work_t;
+    _req->data = query_req;
+    query_handle = conn->TrackQuery(query_req, _req, options, args.Holder());
+    if (cache_key) {
+        query_req->cache_key = cache_key;
+        query_req->cache_key_len = cache_key_len;
+        query_req->cache_tags = CopyCacheTags(options.cache_tags, &query_req->cache_tags_len);
+        query_req->cache_ttl_ms = options.cache_ttl_ms;
+    }
+    conn->EnqueueCommand(_req, EV_QuerySend, NULL,
+                         options.lane, options.timeout_ms,
+                         &query_req->overloaded, &query_req->dequeued);
+
+    return scope.Close(query_handle);
+}
+
+/*!
+ * Starts queued MysqlConnection::QuerySend in the event loop thread
+ */
+void MysqlConnection::EV_QuerySend(uv_work_t *req) {
+    struct query_request *query_req = (struct query_request *)(req->data);
+
+    MysqlConnection *conn = query_req->conn;
+
+    // Check connection
+    // If closeSync() is called after querySend(),
+    // than connection is destroyed here
+    if (!conn->_conn || !conn->connected) {
+        query_req->ok = false;
+        query_req->connection_closed = true;
+
+        EIO_After_Query(req);
+
+        return;
+    }
+
+    if (query_req->overloaded) {
+        query_req->ok = false;
+
+        EIO_After_Query(req);
+
+        return;
+    }
+
     // Send query
-    mysql_send_query(conn->_conn, query_req->query, query_len + 1);
+    mysql_send_query(conn->_conn, query_req->query, query_req->query_len + 1);
 
     // Init IO watcher
-    NODE_ADDON_SHIM_START_IO_READABLE_WATCH(query_req, EV_After_QuerySend, conn->_conn->net.fd)
-
-    return Undefined();
+    NODE_ADDON_SHIM_START_IO_READABLE_WATCH(req, EV_After_QuerySend, conn->_conn->net.fd)
 }
 
 
@@ -1309,6 +4804,8 @@ Handle<Value> MysqlConnection::QuerySync(const Arguments& args) {
     OPTIONAL_BUFFER_ARG(1, local_infile_buffer);
 
     MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_STREAMING;
+    MYSQLCONN_MUSTNOT_BE_LOADING_INFILE;
 
     MYSQLCONN_DISABLE_MQ;
 
@@ -1322,9 +4819,16 @@ Handle<Value> MysqlConnection::QuerySync(const Arguments& args) {
     SetCorrectLocalInfileHandlers(infile_data, conn->_conn);
     int r = mysql_real_query(conn->_conn, *query, query_len);
     RestoreLocalInfileHandlers(infile_data, conn->_conn);
+    FreeLocalInfileData(infile_data);
     if (r == 0) {
+        conn->TrackSessionSchema(*query);
+
         my_result = mysql_store_result(conn->_conn);
         field_count = mysql_field_count(conn->_conn);
+
+        if (conn->track_gtids) {
+            conn->SetLastGtid(SessionGtid(conn->_conn));
+        }
     }
 
     pthread_mutex_unlock(&conn->query_lock);
@@ -1354,6 +4858,57 @@ Handle<Value> MysqlConnection::QuerySync(const Arguments& args) {
     return scope.Close(js_result);
 }
 
+/**
+ * MysqlConnection#queueStatsSync() -> Object
+ *
+ * Returns process-wide commands queue statistics per priority lane:
+ * number of queued and dispatched commands, total and maximum queue wait in milliseconds
+ **/
+Handle<Value> MysqlConnection::QueueStatsSync(const Arguments& args) {
+    HandleScope scope;
+
+    const char *lane_names[LANE_COUNT] = {"interactive", "batch", "background"};
+
+    Local<Object> js_result = Object::New();
+
+    for (int lane = 0; lane < LANE_COUNT; lane++) {
+        Local<Object> js_lane = Object::New();
+
+        js_lane->Set(V8STR("queued"), Number::New(queue_stats[lane].queued));
+        js_lane->Set(V8STR("dispatched"), Number::New(queue_stats[lane].dispatched));
+        js_lane->Set(V8STR("waitTotalMs"), Number::New(queue_stats[lane].wait_total));
+        js_lane->Set(V8STR("waitMaxMs"), Number::New(queue_stats[lane].wait_max));
+
+        js_result->Set(V8STR(lane_names[lane]), js_lane);
+    }
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#rollback([callback])
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Rolls back current transaction.
+ * Not rejected by admission limits, so transaction can be ended under load
+ **/
+Handle<Value> MysqlConnection::Rollback(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    command_request *command_req = NewCommandRequest(conn, COMMAND_ROLLBACK, callback);
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
+}
+
 /**
  * MysqlConnection#rollbackSync() -> Boolean
  *
@@ -1427,6 +4982,8 @@ Handle<Value> MysqlConnection::RealQuerySync(const Arguments& args) {
     REQ_STR_ARG(0, query)
 
     MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_STREAMING;
+    MYSQLCONN_MUSTNOT_BE_LOADING_INFILE;
 
     MYSQLCONN_DISABLE_MQ;
 
@@ -1434,6 +4991,9 @@ Handle<Value> MysqlConnection::RealQuerySync(const Arguments& args) {
 
     pthread_mutex_lock(&conn->query_lock);
     int r = mysql_real_query(conn->_conn, *query, query_len);
+    if (r == 0) {
+        conn->TrackSessionSchema(*query);
+    }
     pthread_mutex_unlock(&conn->query_lock);
 
     if (r != 0) {
@@ -1443,6 +5003,62 @@ Handle<Value> MysqlConnection::RealQuerySync(const Arguments& args) {
     return scope.Close(True());
 }
 
+/**
+ * MysqlConnection#resultCacheStatsSync() -> Object
+ *
+ * Returns process-wide result cache statistics: number of hits, misses, stores,
+ * evictions, expirations and invalidations, current entries count, size and size limit in bytes.
+ * Counters are per process, sizes are of shared segment if it is attached
+ **/
+Handle<Value> MysqlConnection::ResultCacheStatsSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlResultCache::stats stats = MysqlResultCache::GetStats();
+
+    Local<Object> js_result = Object::New();
+
+    js_result->Set(V8STR("hits"), Number::New(stats.hits));
+    js_result->Set(V8STR("misses"), Number::New(stats.misses));
+    js_result->Set(V8STR("stores"), Number::New(stats.stores));
+    js_result->Set(V8STR("evictions"), Number::New(stats.evictions));
+    js_result->Set(V8STR("expirations"), Number::New(stats.expirations));
+    js_result->Set(V8STR("invalidations"), Number::New(stats.invalidations));
+    js_result->Set(V8STR("entries"), Number::New(stats.entries));
+    js_result->Set(V8STR("bytes"), Number::New(stats.bytes));
+    js_result->Set(V8STR("maxBytes"), Number::New(stats.max_bytes));
+
+    return scope.Close(js_result);
+}
+
+/**
+ * MysqlConnection#selectDb(database[, callback])
+ * - database (String): Database to use
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Selects the default database for database queries
+ **/
+Handle<Value> MysqlConnection::SelectDb(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    if (args.Length() < 1 || !args[0]->IsString()) {
+        return THRTYPEEXC("Argument 0 must be a string");
+    }
+    OPTIONAL_FUN_ARG(1, callback);
+
+    command_request *command_req = NewCommandRequest(conn, COMMAND_SELECT_DB, callback);
+    command_req->dbname = new String::Utf8Value(args[0]->ToString());
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
+}
+
 /**
  * MysqlConnection#selectDbSync(database) -> Boolean
  * - database (String): Database to use
@@ -1462,9 +5078,107 @@ Handle<Value> MysqlConnection::SelectDbSync(const Arguments& args) {
         return scope.Close(False());
     }
 
+    conn->SessionChanged();
+
     return scope.Close(True());
 }
 
+/**
+ * MysqlConnection#setAdmissionLimitsSync(limits)
+ * - limits (Object): Limits, non-negative integers, 0 disables limit
+ *
+ * Sets admission control limits:
+ * `maxQueued` for commands queued on this connection,
+ * `maxQueueWaitMs` for queue wait of this connection queries,
+ * queries waited longer are rejected without waiting for their turn.
+ * Both are 0 (unlimited) by default, omitted limits are not changed.
+ * Commands over limits are rejected with EOVERLOAD error code,
+ * see also MysqlLibmysqlclient.setProcessAdmissionLimitsSync()
+ **/
+Handle<Value> MysqlConnection::SetAdmissionLimitsSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    REQ_OBJ_ARG(0, limits);
+
+    Local<Value> max_queued = limits->Get(V8STR("maxQueued"));
+    Local<Value> max_queue_wait = limits->Get(V8STR("maxQueueWaitMs"));
+
+    if ((!max_queued->IsUndefined() && !max_queued->IsUint32()) ||
+        (!max_queue_wait->IsUndefined() && !max_queue_wait->IsUint32())) {
+        return THRTYPEEXC("Limits must be non-negative integers");
+    }
+
+    if (!max_queued->IsUndefined()) {
+        conn->max_queued = max_queued->Uint32Value();
+    }
+    if (!max_queue_wait->IsUndefined()) {
+        conn->max_queue_wait = max_queue_wait->Uint32Value();
+
+        // Already queued commands get new limit too
+        conn->ArmQueueWaitTimer();
+    }
+
+    return Undefined();
+}
+
+/**
+ * MysqlLibmysqlclient.setProcessAdmissionLimitsSync(limits)
+ * - limits (Object): Limits, non-negative integers, 0 disables limit
+ *
+ * Sets process-wide admission control limits:
+ * `maxQueued` for commands queued on all connections of the process,
+ * 0 (unlimited) by default.
+ * Commands over limits are rejected with EOVERLOAD error code
+ **/
+Handle<Value> MysqlConnection::SetProcessAdmissionLimitsSync(const Arguments& args) {
+    HandleScope scope;
+
+    REQ_OBJ_ARG(0, limits);
+
+    Local<Value> max_queued = limits->Get(V8STR("maxQueued"));
+
+    if (!max_queued->IsUndefined() && !max_queued->IsUint32()) {
+        return THRTYPEEXC("Limits must be non-negative integers");
+    }
+
+    if (!max_queued->IsUndefined()) {
+        process_max_queued = max_queued->Uint32Value();
+    }
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#setCharset(charset[, callback])
+ * - charset (String): Charset
+ * - callback (Function): Callback function, gets (error)
+ *
+ * Sets the default client character set
+ **/
+Handle<Value> MysqlConnection::SetCharset(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    if (args.Length() < 1 || !args[0]->IsString()) {
+        return THRTYPEEXC("Argument 0 must be a string");
+    }
+    OPTIONAL_FUN_ARG(1, callback);
+
+    command_request *command_req = NewCommandRequest(conn, COMMAND_SET_CHARSET, callback);
+    command_req->charset = new String::Utf8Value(args[0]->ToString());
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
+}
+
 /**
  * MysqlConnection#setCharsetSync() -> Boolean
  * - charset (String): Charset
@@ -1484,6 +5198,8 @@ Handle<Value> MysqlConnection::SetCharsetSync(const Arguments& args) {
         return scope.Close(False());
     }
 
+    conn->SessionChanged();
+
     return scope.Close(True());
 }
 
@@ -1520,6 +5236,9 @@ Handle<Value> MysqlConnection::SetOptionSync(const Arguments& args) {
                               static_cast<const char *>(
                                 static_cast<const void *>(
                                   &option_integer_value)));
+            if (!r) {
+                conn->SaveConnectOption(option_key, option_integer_value, NULL);
+            }
             // MYSQL_OPT_RECONNECT option is modified by mysql_real_connect
             // due to bug in MySQL < 5.1.6
             // Save it state and repeat mysql_options after connect
@@ -1539,6 +5258,10 @@ Handle<Value> MysqlConnection::SetOptionSync(const Arguments& args) {
             {
             REQ_STR_ARG(1, option_string_value);
             r = mysql_options(conn->_conn, option_key, *option_string_value);
+            // Init command is not run on KILL QUERY side connection
+            if (!r && option_key != MYSQL_INIT_COMMAND) {
+                conn->SaveConnectOption(option_key, 0, *option_string_value);
+            }
             }
             break;
         case MYSQL_OPT_LOCAL_INFILE:
@@ -1566,6 +5289,79 @@ Handle<Value> MysqlConnection::SetOptionSync(const Arguments& args) {
     return scope.Close(True());
 }
 
+/**
+ * MysqlConnection#setResultCacheLimitsSync(limits)
+ * - limits (Object): Limits, non-negative integers
+ *
+ * Sets process-wide result cache limits:
+ * `maxBytes` for total size of cached results, 16Mb by default,
+ * least recently used results are evicted over it, 0 disables cache.
+ * Shared cache size is set by attachSharedResultCacheSync()
+ **/
+Handle<Value> MysqlConnection::SetResultCacheLimitsSync(const Arguments& args) {
+    HandleScope scope;
+
+    REQ_OBJ_ARG(0, limits);
+
+    Local<Value> max_bytes = limits->Get(V8STR("maxBytes"));
+
+    if (!max_bytes->IsUndefined() && (!max_bytes->IsNumber() || max_bytes->NumberValue() < 0)) {
+        return THRTYPEEXC("Limits must be non-negative integers");
+    }
+
+    if (!max_bytes->IsUndefined()) {
+        MysqlResultCache::SetMaxBytes(static_cast<size_t>(max_bytes->NumberValue()));
+    }
+
+    return Undefined();
+}
+
+/**
+ * MysqlConnection#setResultModeSync(mode[, useResultAboveBytes])
+ * - mode (String): Result strategy of query(): "store" (default), "use" or "auto"
+ * - useResultAboveBytes (Integer): Size of result "auto" mode streams from, 1 MiB by default
+ *
+ * Sets result strategy of query() for this connection,
+ * it is overridden by `resultMode` query option.
+ * "use" and "auto" modes change callback contract: it gets rows array
+ * instead of MysqlResult, or null if `onChunk` query option is set,
+ * so every query() caller of the connection must be ready for it.
+ * Prefer opting in per query with `resultMode` option, helpers of the module
+ * pass `resultMode: 'store'` where they need MysqlResult.
+ * "use" reads rows with mysql_use_result in chunks of about 1 MiB,
+ * every chunk is converted before the next one is read, so libmysqlclient
+ * never buffers the whole result. Memory peak is bounded only with `onChunk`:
+ * without it all converted rows are collected for callback, and they take
+ * more memory than stored result would. Until callback querySync(),
+ * realQuerySync(), multiRealQuerySync() and enableGtidTrackingSync() throw,
+ * other *Sync() calls fail as out of sync, closeSync() reads and drops rows left.
+ * "auto" learns size of results of every query shape and uses
+ * mysql_store_result for small ones and mysql_use_result for large ones.
+ * Cached and coalesced results are always stored, querySend() always
+ * returns MysqlResult.
+ **/
+Handle<Value> MysqlConnection::SetResultModeSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    result_mode mode = ParseResultMode(args[0]);
+    if (mode == RESULT_MODE_DEFAULT) {
+        return THRTYPEEXC("Result mode must be 'store', 'use' or 'auto'");
+    }
+
+    if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        if (!args[1]->IsUint32()) {
+            return THRTYPEEXC("Result size threshold must be a positive integer");
+        }
+        conn->use_result_above_bytes = args[1]->Uint32Value();
+    }
+
+    conn->default_result_mode = mode;
+
+    return Undefined();
+}
+
 /**
  * MysqlConnection#setSslSync()
  *
@@ -1604,6 +5400,19 @@ Handle<Value> MysqlConnection::SetSslSync(const Arguments& args) {
         cipher
     );
 
+    const char *ssl_settings[5] = {key, cert, ca, capath, cipher};
+
+    pthread_mutex_lock(&conn->kill_lock);
+    for (int i = 0; i < 5; i++) {
+        delete[] conn->ssl_settings[i];
+        conn->ssl_settings[i] = NULL;
+        if (ssl_settings[i]) {
+            conn->ssl_settings[i] = new char[strlen(ssl_settings[i]) + 1];
+            memcpy(conn->ssl_settings[i], ssl_settings[i], strlen(ssl_settings[i]) + 1);
+        }
+    }
+    pthread_mutex_unlock(&conn->kill_lock);
+
     return scope.Close(Undefined());
 }
 
@@ -1622,6 +5431,30 @@ Handle<Value> MysqlConnection::SqlStateSync(const Arguments& args) {
     return scope.Close(V8STR(mysql_sqlstate(conn->_conn)));
 }
 
+/**
+ * MysqlConnection#stat([callback])
+ * - callback (Function): Callback function, gets (error, status)
+ *
+ * Gets the current system status
+ **/
+Handle<Value> MysqlConnection::Stat(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlConnection *conn = OBJUNWRAP<MysqlConnection>(args.Holder());
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    OPTIONAL_FUN_ARG(0, callback);
+
+    command_request *command_req = NewCommandRequest(conn, COMMAND_STAT, callback);
+
+    MYSQLCONN_ENQUEUE_COMMAND(command_req);
+
+    return Undefined();
+}
+
 /**
  * MysqlConnection#statSync() -> String
  *
@@ -1757,6 +5590,45 @@ int MysqlConnection::CustomLocalInfileInit(void ** ptr, const char * filename, v
 }
 int MysqlConnection::CustomLocalInfileRead(void * ptr, char * buf, unsigned int buf_len) {
   local_infile_data * infile_data = static_cast<local_infile_data *>(ptr);
+  if (infile_data->streaming) {
+    pthread_mutex_lock(&infile_data->lock);
+    while (!infile_data->count && !infile_data->ended && !infile_data->error) {
+      pthread_cond_wait(&infile_data->readable, &infile_data->lock);
+    }
+    if (infile_data->error) {
+      pthread_mutex_unlock(&infile_data->lock);
+      return -1;
+    }
+
+    // Read chunks in place, buffer of libmysqlclient is filled from several of them
+    size_t copied = 0;
+    while (copied < buf_len && infile_data->count) {
+      local_infile_chunk * chunk = &infile_data->ring[infile_data->head];
+      size_t copy_len = chunk->length - infile_data->position;
+      copy_len = copy_len < buf_len - copied ? copy_len : buf_len - copied;
+      memcpy(buf + copied, chunk->data + infile_data->position, copy_len);
+      copied += copy_len;
+      infile_data->position += copy_len;
+      infile_data->queued_bytes -= copy_len;
+
+      if (infile_data->position == chunk->length) {
+        infile_data->position = 0;
+        infile_data->head = (infile_data->head + 1) % LOCAL_INFILE_RING;
+        infile_data->count--;
+        infile_data->released++;
+      }
+    }
+    bool wake = infile_data->released >= LOCAL_INFILE_RING / 4
+             || (infile_data->paused
+                 && infile_data->count < LOCAL_INFILE_RING / 4
+                 && infile_data->queued_bytes < LOCAL_INFILE_HIGH_WATER / 4);
+    pthread_mutex_unlock(&infile_data->lock);
+
+    if (wake) {
+      uv_async_send(&infile_data->drained);
+    }
+    return copied;
+  }
   if (!infile_data->buffer || !infile_data->length) {
     return 0;
   }
@@ -1774,21 +5646,279 @@ void MysqlConnection::CustomLocalInfileEnd(void * ptr) {
 int MysqlConnection::CustomLocalInfileError(void * ptr,
                                             char *error_msg,
                                             unsigned int error_msg_len) {
+  local_infile_data * infile_data = static_cast<local_infile_data *>(ptr);
+  if (infile_data->streaming && infile_data->error) {
+    snprintf(error_msg, error_msg_len, "%s", infile_data->error);
+    // CR_UNKNOWN_ERROR
+    return 2000;
+  }
   return 0;
 }
 
+/*!
+ * Calls method of LOAD DATA LOCAL INFILE stream, e.g. pause() or resume()
+ */
+static void CallStreamMethod(Handle<Object> js_stream, const char * method, int argc, Handle<Value> * argv) {
+  Local<Value> js_method = js_stream->Get(V8STR(method));
+  if (js_method->IsFunction()) {
+    Local<Function>::Cast(js_method)->Call(js_stream, argc, argv);
+  }
+}
+
 MysqlConnection::local_infile_data * MysqlConnection::PrepareLocalInfileData(Handle<Value> buffer) {
   local_infile_data * infile_data;
   if (buffer->IsNull()) {
     return NULL;
   }
-  infile_data = static_cast<local_infile_data*>(malloc(sizeof(*infile_data)));
-  infile_data->length = node::Buffer::Length(buffer->ToObject());
+  infile_data = new local_infile_data;
   infile_data->position = 0;
-  infile_data->buffer = static_cast<char *>(malloc(infile_data->length));
-  memcpy(infile_data->buffer, node::Buffer::Data(buffer->ToObject()), infile_data->length);
+  infile_data->buffer = NULL;
+  infile_data->length = 0;
+  infile_data->streaming = false;
+  infile_data->error = NULL;
+
+  // Buffer is read in place, it is referenced instead of copied
+  if (node::Buffer::HasInstance(buffer)) {
+    infile_data->js_buffer = Persistent<Object>::New(buffer->ToObject());
+    infile_data->buffer = node::Buffer::Data(infile_data->js_buffer);
+    infile_data->length = node::Buffer::Length(infile_data->js_buffer);
+    return infile_data;
+  }
+
+  infile_data->streaming = true;
+  infile_data->head = 0;
+  infile_data->count = 0;
+  infile_data->released = 0;
+  infile_data->queued_bytes = 0;
+  infile_data->paused = false;
+  infile_data->ended = false;
+  infile_data->done = false;
+  pthread_mutex_init(&infile_data->lock, NULL);
+  pthread_cond_init(&infile_data->readable, NULL);
+  uv_async_init(uv_default_loop(), &infile_data->drained, EV_LocalInfileDrained);
+  infile_data->drained.data = infile_data;
+
+  Local<Value> js_data = External::New(infile_data);
+  infile_data->stream = Persistent<Object>::New(buffer->ToObject());
+  infile_data->on_data = Persistent<Function>::New(FunctionTemplate::New(OnLocalInfileData, js_data)->GetFunction());
+  infile_data->on_end = Persistent<Function>::New(FunctionTemplate::New(OnLocalInfileEnd, js_data)->GetFunction());
+  infile_data->on_error = Persistent<Function>::New(FunctionTemplate::New(OnLocalInfileError, js_data)->GetFunction());
+
+  Handle<Value> argv[2];
+  argv[0] = V8STR("data");
+  argv[1] = infile_data->on_data;
+  CallStreamMethod(infile_data->stream, "on", 2, argv);
+  argv[0] = V8STR("end");
+  argv[1] = infile_data->on_end;
+  CallStreamMethod(infile_data->stream, "on", 2, argv);
+  argv[0] = V8STR("error");
+  argv[1] = infile_data->on_error;
+  CallStreamMethod(infile_data->stream, "on", 2, argv);
+
   return infile_data;
 }
+
+/*!
+ * Frees LOAD DATA LOCAL INFILE data on the event loop thread after query is done,
+ * stream listeners are removed, stream is left as is
+ */
+void MysqlConnection::FreeLocalInfileData(local_infile_data * infile_data) {
+  if (!infile_data) {
+    return;
+  }
+  if (!infile_data->streaming) {
+    infile_data->js_buffer.Dispose();
+    delete infile_data;
+    return;
+  }
+
+  infile_data->done = true;
+
+  Handle<Value> argv[2];
+  argv[0] = V8STR("data");
+  argv[1] = infile_data->on_data;
+  CallStreamMethod(infile_data->stream, "removeListener", 2, argv);
+  argv[0] = V8STR("end");
+  argv[1] = infile_data->on_end;
+  CallStreamMethod(infile_data->stream, "removeListener", 2, argv);
+  argv[0] = V8STR("error");
+  argv[1] = infile_data->on_error;
+  CallStreamMethod(infile_data->stream, "removeListener", 2, argv);
+
+  pthread_mutex_lock(&infile_data->lock);
+  ReleaseLocalInfileChunks(infile_data, true);
+  pthread_mutex_unlock(&infile_data->lock);
+
+  infile_data->stream.Dispose();
+  infile_data->on_data.Dispose();
+  infile_data->on_end.Dispose();
+  infile_data->on_error.Dispose();
+
+  // Data is freed when async handle is closed
+  uv_close(reinterpret_cast<uv_handle_t *>(&infile_data->drained), EV_LocalInfileDrained_OnClose);
+}
+
+void MysqlConnection::EV_LocalInfileDrained_OnClose(uv_handle_t *handle) {
+  local_infile_data * infile_data = static_cast<local_infile_data *>(handle->data);
+  pthread_mutex_destroy(&infile_data->lock);
+  pthread_cond_destroy(&infile_data->readable);
+  delete[] infile_data->error;
+  delete infile_data;
+}
+
+/*!
+ * Fails waiting or next read of LOAD DATA LOCAL INFILE stream
+ */
+void MysqlConnection::AbortLocalInfile(local_infile_data * infile_data, const char * error) {
+  if (!infile_data || !infile_data->streaming) {
+    return;
+  }
+  pthread_mutex_lock(&infile_data->lock);
+  if (!infile_data->error) {
+    size_t error_len = strlen(error);
+    infile_data->error = new char[error_len + 1];
+    memcpy(infile_data->error, error, error_len + 1);
+  }
+  pthread_cond_signal(&infile_data->readable);
+  pthread_mutex_unlock(&infile_data->lock);
+}
+
+/*!
+ * Returns true if a query with LOAD DATA LOCAL INFILE stream is queued or running,
+ * it holds query_lock while waiting for stream data from the event loop thread
+ */
+bool MysqlConnection::LoadingLocalInfile() {
+  for (query_request *query_req = this->active_queries; query_req; query_req = query_req->next_active) {
+    if (query_req->infile_data && query_req->infile_data->streaming) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+ * Drops references to read chunks, or to all chunks, called under lock
+ * on the event loop thread
+ */
+void MysqlConnection::ReleaseLocalInfileChunks(local_infile_data * infile_data, bool all) {
+  unsigned int release_count = infile_data->released + (all ? infile_data->count : 0);
+  unsigned int first = (infile_data->head + LOCAL_INFILE_RING - infile_data->released) % LOCAL_INFILE_RING;
+
+  for (unsigned int i = 0; i < release_count; i++) {
+    infile_data->ring[(first + i) % LOCAL_INFILE_RING].buffer.Dispose();
+  }
+  infile_data->released = 0;
+  if (all) {
+    infile_data->count = 0;
+    infile_data->queued_bytes = 0;
+  }
+}
+
+Handle<Value> MysqlConnection::OnLocalInfileData(const Arguments& args) {
+  HandleScope scope;
+
+  local_infile_data * infile_data = static_cast<local_infile_data *>(Local<External>::Cast(args.Data())->Value());
+  if (infile_data->done) {
+    return Undefined();
+  }
+  if (args.Length() < 1 || !node::Buffer::HasInstance(args[0])) {
+    AbortLocalInfile(infile_data, "LOAD DATA LOCAL INFILE stream must emit Buffers");
+    return Undefined();
+  }
+
+  // Empty read would mean end of file for libmysqlclient
+  Local<Object> js_chunk = args[0]->ToObject();
+  if (!node::Buffer::Length(js_chunk)) {
+    return Undefined();
+  }
+  bool pause = false;
+
+  pthread_mutex_lock(&infile_data->lock);
+  ReleaseLocalInfileChunks(infile_data, false);
+  if (infile_data->count == LOCAL_INFILE_RING) {
+    pthread_mutex_unlock(&infile_data->lock);
+    AbortLocalInfile(infile_data, "LOAD DATA LOCAL INFILE stream emits data after pause()");
+    return Undefined();
+  }
+
+  local_infile_chunk * chunk = &infile_data->ring[(infile_data->head + infile_data->count) % LOCAL_INFILE_RING];
+  chunk->buffer = Persistent<Object>::New(js_chunk);
+  chunk->data = node::Buffer::Data(js_chunk);
+  chunk->length = node::Buffer::Length(js_chunk);
+  infile_data->count++;
+  infile_data->queued_bytes += chunk->length;
+
+  // Other half of the ring is left for chunks emitted after pause()
+  if (!infile_data->paused
+      && (infile_data->count >= LOCAL_INFILE_RING / 2
+          || infile_data->queued_bytes >= LOCAL_INFILE_HIGH_WATER)) {
+    infile_data->paused = pause = true;
+  }
+
+  pthread_cond_signal(&infile_data->readable);
+  pthread_mutex_unlock(&infile_data->lock);
+
+  if (pause) {
+    CallStreamMethod(infile_data->stream, "pause", 0, NULL);
+  }
+
+  return Undefined();
+}
+
+Handle<Value> MysqlConnection::OnLocalInfileEnd(const Arguments& args) {
+  HandleScope scope;
+
+  local_infile_data * infile_data = static_cast<local_infile_data *>(Local<External>::Cast(args.Data())->Value());
+
+  pthread_mutex_lock(&infile_data->lock);
+  infile_data->ended = true;
+  pthread_cond_signal(&infile_data->readable);
+  pthread_mutex_unlock(&infile_data->lock);
+
+  return Undefined();
+}
+
+Handle<Value> MysqlConnection::OnLocalInfileError(const Arguments& args) {
+  HandleScope scope;
+
+  local_infile_data * infile_data = static_cast<local_infile_data *>(Local<External>::Cast(args.Data())->Value());
+
+  if (args.Length() > 0 && args[0]->IsObject()) {
+    String::Utf8Value error(args[0]->ToObject()->Get(V8STR("message"))->ToString());
+    AbortLocalInfile(infile_data, *error);
+  } else {
+    AbortLocalInfile(infile_data, "LOAD DATA LOCAL INFILE stream error");
+  }
+
+  return Undefined();
+}
+
+/*!
+ * Releases read chunks and resumes stream, when reader has caught up
+ */
+void MysqlConnection::EV_LocalInfileDrained(NODE_ADDON_SHIM_ASYNC_CALLBACK_ARGUMENTS) {
+  HandleScope scope;
+
+  local_infile_data * infile_data = static_cast<local_infile_data *>(handle->data);
+  bool resume = false;
+
+  pthread_mutex_lock(&infile_data->lock);
+  ReleaseLocalInfileChunks(infile_data, false);
+  if (infile_data->paused && !infile_data->done && !infile_data->ended
+      && infile_data->count < LOCAL_INFILE_RING / 4
+      && infile_data->queued_bytes < LOCAL_INFILE_HIGH_WATER / 4) {
+    infile_data->paused = false;
+    resume = true;
+  }
+  pthread_mutex_unlock(&infile_data->lock);
+
+  // Stream can emit data synchronously, so it is resumed without lock
+  if (resume) {
+    CallStreamMethod(infile_data->stream, "resume", 0, NULL);
+  }
+}
+
 void MysqlConnection::SetCorrectLocalInfileHandlers(local_infile_data * infile_data,
                                                     MYSQL * conn) {
   if (infile_data) {
@@ -1810,11 +5940,8 @@ void MysqlConnection::SetCorrectLocalInfileHandlers(local_infile_data * infile_d
 void MysqlConnection::RestoreLocalInfileHandlers(local_infile_data * infile_data,
                                                  MYSQL * conn) {
   if (infile_data) {
+    // Data is freed on the event loop thread, see FreeLocalInfileData
     mysql_set_local_infile_default(conn);
-    if (infile_data->buffer) {
-      free(infile_data->buffer);
-    }
-    free(infile_data);
   } else {
     mysql_thread_end();
   }
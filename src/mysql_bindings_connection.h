@@ -17,10 +17,14 @@
 #include <unistd.h>
 #include <pthread.h>
 
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 
 #include "./mysql_bindings.h"
+#include "./mysql_bindings_aggregate.h"
+#include "./mysql_bindings_batch.h"
+#include "./mysql_bindings_cache.h"
 
 #define MYSQLCONN_DISABLE_MQ \
     if (conn->multi_query) { \
@@ -39,6 +43,26 @@
         return THREXC("Not connected"); \
     }
 
+#define MYSQLCONN_MUSTNOT_BE_CLOSING \
+    if (conn->closing) { \
+        return THREXC("Connection is closing"); \
+    }
+
+#define MYSQLCONN_MUSTNOT_BE_OVERLOADED \
+    if (conn->Overloaded()) { \
+        return ThrowException(MysqlConnection::OverloadException("Commands queue is full")); \
+    }
+
+#define MYSQLCONN_MUSTNOT_BE_STREAMING \
+    if (conn->streaming_query) { \
+        return THREXC("Connection is reading rows of streamed result"); \
+    }
+
+#define MYSQLCONN_MUSTNOT_BE_LOADING_INFILE \
+    if (conn->LoadingLocalInfile()) { \
+        return THREXC("Connection is loading LOAD DATA LOCAL INFILE stream"); \
+    }
+
 #define MYSQLCONN_MUSTBE_INITIALIZED \
     if (!conn->_conn) { \
         return THREXC("Not initialized"); \
@@ -52,8 +76,13 @@ using namespace v8; // NOLINT
  * MySQL connection class, base version
  **/
 class MysqlConnection : public node::ObjectWrap {
+    // Statement sends executeBatch() through commands queue of connection
+    friend class MysqlStatement;
+
   public:
     static Persistent<FunctionTemplate> constructor_template;
+    // Handle returned by query() and querySend()
+    static Persistent<FunctionTemplate> query_handle_template;
 
     static void Init(Handle<Object> target);
 
@@ -81,9 +110,167 @@ class MysqlConnection : public node::ObjectWrap {
 
     pthread_mutex_t query_lock;
 
+    /*!
+     * Native commands queue
+     *
+     * Only one command per connection is passed to the threadpool at a time,
+     * next one is dispatched from the completion path of the previous.
+     * Commands of one connection are dispatched in FIFO order,
+     * priority lane, then earliest deadline, then sequence number
+     * only decide which connection's head command gets a threadpool slot
+     */
+    enum command_lane {
+        LANE_INTERACTIVE = 0,
+        LANE_BATCH,
+        LANE_BACKGROUND,
+        LANE_COUNT
+    };
+
+    struct queued_command {
+        uv_work_t *req;
+        // Runs in the threadpool, or in the event loop thread if after_work_cb is NULL
+        uv_work_cb work_cb;
+        uv_after_work_cb after_work_cb;
+
+        command_lane lane;
+        // Absolute time in event loop milliseconds, 0 if there is no deadline
+        uint64_t deadline;
+        uint64_t enqueued_at;
+        uint64_t seq;
+        // Set if command waited longer than max_queue_wait, see MysqlConnection::StartCommand
+        bool *overloaded;
+        // Set if command is rejected while queued, its callback must not call CommandDone()
+        bool *dequeued;
+
+        queued_command *next;
+    };
+    static bool CommandIsMoreUrgent(const queued_command *a, const queued_command *b);
+    queued_command *queue_head;
+    queued_command *queue_tail;
+    unsigned int queued_count;
+    bool command_in_flight;
+    bool command_in_threadpool;
+
+    void EnqueueCommand(uv_work_t *req,
+                        uv_work_cb work_cb,
+                        uv_after_work_cb after_work_cb,
+                        command_lane lane = LANE_INTERACTIVE,
+                        uint32_t timeout_ms = 0,
+                        bool *overloaded = NULL,
+                        bool *dequeued = NULL);
+    bool RemoveCommand(uv_work_t *req);
+    queued_command *NextCommand();
+    void UnlinkCommand(queued_command *command);
+    void StartCommand(queued_command *command);
+    void DispatchNextCommand();
+    void CommandDone();
+
+    /*!
+     * Process-wide scheduling of threadpool commands
+     *
+     * No more commands than threadpool threads are passed to libuv,
+     * so its FIFO queue can't delay urgent commands of other connections.
+     * One thread is kept free for KILL QUERY of expired deadlines
+     * (unless UV_THREADPOOL_SIZE is 1).
+     * Connections with ready command wait for a free slot in waiting list
+     */
+    static MysqlConnection *waiting_head;
+    MysqlConnection *waiting_next;
+    bool waiting;
+
+    static unsigned int threadpool_jobs;
+    static unsigned int threadpool_jobs_max;
+    static uint64_t last_command_seq;
+
+    static void ScheduleWaitingConnections();
+
+    struct lane_stats {
+        uint64_t queued;
+        uint64_t dispatched;
+        uint64_t wait_total;
+        uint64_t wait_max;
+    };
+    static lane_stats queue_stats[LANE_COUNT];
+
+    /*!
+     * Admission control, new commands are rejected with EOVERLOAD error
+     * when queue is full, 0 means no limit
+     */
+    unsigned int max_queued;
+    unsigned int max_queue_wait;
+    static unsigned int process_max_queued;
+
+    bool Overloaded();
+    static Local<Value> OverloadException(const char *message);
+
+    /*!
+     * Commands waited longer than max_queue_wait are rejected by timer,
+     * so they don't hold queue slots until their turn
+     */
+    uv_timer_t *queue_wait_timer;
+    void ArmQueueWaitTimer();
+    void RejectStaleCommands();
+    static void EV_QueueWaitTimeout(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS);
+
+    // Set by close(), no new commands are accepted
+    bool closing;
+
     bool multi_query;
     my_bool opt_reconnect;
 
+    /*!
+     * Read-your-writes consistency, GTID of the last transaction
+     * is captured with session state tracking
+     */
+    bool track_gtids;
+    char *last_gtid;
+
+    static char *SessionGtid(MYSQL *my_conn);
+    void SetLastGtid(char *gtid);
+
+    /*!
+     * Result strategy of query(), see MysqlConnection#setResultModeSync
+     *
+     * In "use" and "auto" modes result is converted to compact encoding
+     * of MysqlResultCache in the threadpool and callback gets rows array
+     * instead of MysqlResult. "use" streams rows with mysql_use_result
+     * in chunks of RESULT_CHUNK_BYTES: every chunk is read in the threadpool
+     * and converted on the event loop thread before the next one is read,
+     * the command stays in flight until the last one. So libmysqlclient
+     * never buffers the whole result, and with `onChunk` query option
+     * converted rows are not collected either.
+     * "auto" learns typical size of result for every query shape
+     * (query text with literals stripped) and streams only large ones,
+     * small results are stored and encoded into exactly sized buffer.
+     * Cached and coalesced results are always stored
+     */
+    enum result_mode {
+        // Mode of connection, only for query options
+        RESULT_MODE_DEFAULT = 0,
+        RESULT_MODE_STORE,
+        RESULT_MODE_USE,
+        RESULT_MODE_AUTO
+    };
+    result_mode default_result_mode;
+    uint32_t use_result_above_bytes;
+    static const size_t RESULT_CHUNK_BYTES = 1024 * 1024;
+
+    struct result_shape {
+        uint32_t hash;
+        uint32_t samples;
+        // Moving averages of encoded result size and rows count
+        uint64_t bytes;
+        uint64_t rows;
+    };
+    // Process-wide, direct-mapped by shape hash, updated in the threadpool
+    static const unsigned int RESULT_SHAPES = 1024;
+    static result_shape result_shapes[RESULT_SHAPES];
+    static pthread_mutex_t result_shapes_lock;
+
+    static uint32_t HashQueryShape(const char *query, unsigned int query_len);
+    static uint64_t ResultShapeBytes(uint32_t shape_hash);
+    static void RecordResultShape(uint32_t shape_hash, uint64_t bytes, uint64_t rows);
+
     unsigned int connect_errno;
     const char *connect_error;
 
@@ -105,10 +292,130 @@ class MysqlConnection : public node::ObjectWrap {
 
     static Handle<Value> AffectedRowsSync(const Arguments& args);
 
+    struct aggregate_request {
+        bool ok;
+        bool connection_closed;
+        bool overloaded;
+        bool dequeued;
+
+        Persistent<Value> callback;
+        MysqlConnection *conn;
+
+        char *query;
+        unsigned int query_len;
+
+        MysqlAggregator *aggregator;
+
+        unsigned int errno;
+        const char *error;
+    };
+    static void EIO_After_Aggregate(uv_work_t *req);
+    static void EIO_Aggregate(uv_work_t *req);
+    static Handle<Value> Aggregate(const Arguments& args);
+
+    static Handle<Value> AttachSharedResultCacheSync(const Arguments& args);
+
+    /*!
+     * Generic request for async control commands,
+     * see MysqlConnection::EIO_Command
+     */
+    enum command_type {
+        COMMAND_AUTOCOMMIT,
+        COMMAND_CHANGE_USER,
+        COMMAND_COMMIT,
+        COMMAND_GET_WARNINGS,
+        COMMAND_PING,
+        COMMAND_ROLLBACK,
+        COMMAND_SELECT_DB,
+        COMMAND_SET_CHARSET,
+        COMMAND_STAT
+    };
+    struct command_request {
+        command_type type;
+
+        bool ok;
+        bool connection_closed;
+
+        Persistent<Value> callback;
+        MysqlConnection *conn;
+
+        // Arguments
+        String::Utf8Value *user;
+        String::Utf8Value *password;
+        String::Utf8Value *dbname;
+        String::Utf8Value *charset;
+        bool autocommit;
+
+        // Results
+        const char *stat;
+        MYSQL_RES *my_result;
+
+        unsigned int errno;
+        const char *error;
+    };
+    static const char *CommandName(command_type type);
+    static command_request *NewCommandRequest(MysqlConnection *conn,
+                                              command_type type,
+                                              Handle<Value> callback);
+    static void EIO_After_Command(uv_work_t *req);
+    static void EIO_Command(uv_work_t *req);
+
+    static Handle<Value> AutoCommit(const Arguments& args);
+
     static Handle<Value> AutoCommitSync(const Arguments& args);
 
+    struct bulkInsert_request {
+        bool ok;
+        bool connection_closed;
+        bool overloaded;
+        bool dequeued;
+
+        Persistent<Value> callback;
+        Persistent<Value> progress;
+        MysqlConnection *conn;
+
+        MysqlBatch *batch;
+
+        // INSERT ... VALUES and ON DUPLICATE KEY UPDATE ... parts of every chunk
+        char *prefix;
+        size_t prefix_len;
+        char *suffix;
+        size_t suffix_len;
+
+        // 0 until it is read from @@max_allowed_packet
+        size_t chunk_bytes;
+
+        // Statement buffer, reused by every chunk
+        char *buffer;
+        size_t buffer_capacity;
+
+        uint32_t next_row;
+        uint32_t chunk_first_row;
+        uint32_t chunks;
+
+        my_ulonglong affected_rows;
+        my_ulonglong first_insert_id;
+
+        unsigned int errno;
+        const char *error;
+    };
+    static const size_t BULK_INSERT_MAX_CHUNK = 16 * 1024 * 1024;
+    static const size_t BULK_INSERT_PACKET_SLACK = 1024;
+    // Session max_allowed_packet, 0 until it is read, and thread ID of session it is read for
+    size_t max_allowed_packet;
+    unsigned long max_allowed_packet_thread_id; // NOLINT
+    static size_t BulkInsertChunkBytes(MysqlConnection *conn);
+    static size_t BulkInsertRow(bulkInsert_request *bulk_req, uint32_t r, size_t pos);
+    static void EIO_After_BulkInsert(uv_work_t *req);
+    static void EIO_BulkInsert(uv_work_t *req);
+    static Handle<Value> BulkInsert(const Arguments& args);
+
+    static Handle<Value> ChangeUser(const Arguments& args);
+
     static Handle<Value> ChangeUserSync(const Arguments& args);
 
+    static Handle<Value> Commit(const Arguments& args);
+
     static Handle<Value> CommitSync(const Arguments& args);
 
     struct connect_request {
@@ -133,12 +440,26 @@ class MysqlConnection : public node::ObjectWrap {
 
     static Handle<Value> ConnectedSync(const Arguments& args);
 
+    struct close_request {
+        Persistent<Value> callback;
+        MysqlConnection *conn;
+
+        MYSQL *my_conn;
+        MYSQL *my_kill_conn;
+    };
+    static void EIO_After_Close(uv_work_t *req);
+    static void EIO_Close(uv_work_t *req);
+    static void EV_Close(uv_work_t *req);
+    static Handle<Value> Close(const Arguments& args);
+
     static Handle<Value> CloseSync(const Arguments& args);
 
     static Handle<Value> DebugSync(const Arguments& args);
 
     static Handle<Value> DumpDebugInfoSync(const Arguments& args);
 
+    static Handle<Value> EnableGtidTrackingSync(const Arguments& args);
+
     static Handle<Value> ErrnoSync(const Arguments& args);
 
     static Handle<Value> ErrorSync(const Arguments& args);
@@ -157,12 +478,18 @@ class MysqlConnection : public node::ObjectWrap {
 
     static Handle<Value> GetInfoStringSync(const Arguments& args);
 
+    static Handle<Value> GetWarnings(const Arguments& args);
+
     static Handle<Value> GetWarningsSync(const Arguments& args);
 
     static Handle<Value> InitSync(const Arguments& args);
 
     static Handle<Value> InitStatementSync(const Arguments& args);
 
+    static Handle<Value> InvalidateResultCacheSync(const Arguments& args);
+
+    static Handle<Value> LastGtidSync(const Arguments& args);
+
     static Handle<Value> LastInsertIdSync(const Arguments& args);
 
     static Handle<Value> MultiMoreResultsSync(const Arguments& args);
@@ -171,11 +498,87 @@ class MysqlConnection : public node::ObjectWrap {
 
     static Handle<Value> MultiRealQuerySync(const Arguments& args);
 
+    static Handle<Value> Ping(const Arguments& args);
+
     static Handle<Value> PingSync(const Arguments& args);
+
+    /*!
+     * Data for LOAD DATA LOCAL INFILE, read by libmysqlclient in the threadpool
+     *
+     * Buffer is read in place, it is referenced until query is done.
+     * Readable stream is not buffered as a whole: its chunks are queued
+     * into bounded ring on the event loop thread and read in place by
+     * CustomLocalInfileRead, which waits for them. Stream is paused
+     * when ring is half full, read chunks are released and stream is resumed
+     * by `drained` async handle, when reader catches up
+     */
+    struct local_infile_chunk {
+      Persistent<Object> buffer;
+      const char * data;
+      size_t length;
+    };
+    static const unsigned int LOCAL_INFILE_RING = 64;
+    static const size_t LOCAL_INFILE_HIGH_WATER = 4 * 1024 * 1024;
     struct local_infile_data {
-      char * buffer;
+      const char * buffer;
       size_t length;
       size_t position;
+      Persistent<Object> js_buffer;
+
+      bool streaming;
+      Persistent<Object> stream;
+      Persistent<Function> on_data;
+      Persistent<Function> on_end;
+      Persistent<Function> on_error;
+      pthread_mutex_t lock;
+      pthread_cond_t readable;
+      uv_async_t drained;
+      // Chunks from head are queued, `released` chunks before head are read
+      local_infile_chunk ring[LOCAL_INFILE_RING];
+      unsigned int head;
+      unsigned int count;
+      unsigned int released;
+      size_t queued_bytes;
+      bool paused;
+      bool ended;
+      bool done;
+      char * error;
+    };
+
+    /*!
+     * Identical concurrent SELECTs can share one execution,
+     * all callers get rows arrays instead of MysqlResult
+     */
+    enum coalesce_mode {
+        COALESCE_NONE = 0,
+        // Every caller gets its own rows array
+        COALESCE_COPY,
+        // All callers get one rows array, it must not be modified
+        COALESCE_SHARED
+    };
+
+    struct coalesced_waiter {
+        uint32_t id;
+        Persistent<Value> callback;
+        MysqlConnection *conn;
+        // Waiter keeps its own deadline, NULL if there is no one
+        uv_timer_t *timer;
+
+        coalesced_waiter *next;
+    };
+
+    struct query_options {
+        uint32_t timeout_ms;
+        command_lane lane;
+        coalesce_mode coalesce;
+        // Result cache, see MysqlResultCache
+        uint32_t cache_ttl_ms;
+        Local<Value> cache_tags;
+        // GTID set replica waits for before query
+        Local<Value> wait_gtid;
+        uint32_t wait_gtid_timeout_ms;
+        result_mode mode;
+        Local<Value> on_chunk;
     };
 
     struct query_request {
@@ -198,7 +601,163 @@ class MysqlConnection : public node::ObjectWrap {
         const char *error;
 
         local_infile_data * infile_data;
+
+        // Single-flight coalescing, see MysqlConnection::FindCoalescingLeader
+        coalesce_mode coalesce;
+        command_lane lane;
+        uint32_t query_hash;
+        coalesced_waiter *waiters;
+        // Caller canceled query, but it still runs for coalesced waiters
+        bool caller_detached;
+
+        // Result is stored into MysqlResultCache if cache_key is set
+        char *cache_key;
+        size_t cache_key_len;
+        char *cache_tags;
+        size_t cache_tags_len;
+        uint32_t cache_ttl_ms;
+        char *cache_data;
+        size_t cache_data_len;
+
+        // WAIT_FOR_EXECUTED_GTID_SET() is sent before query as its own statement
+        char *wait_gtid;
+        uint32_t wait_gtid_timeout_ms;
+        bool gtid_wait_timed_out;
+        // GTID of transaction committed by query
+        char *gtid;
+
+        // Resolved result strategy, rows are returned in cache_data
+        // unless it is RESULT_MODE_STORE
+        result_mode mode;
+        uint32_t shape_hash;
+        uint32_t use_result_above_bytes;
+        // Streamed result while its rows are left, see EIO_QueryChunk
+        MYSQL_RES *use_result;
+        Persistent<Function> on_chunk;
+        // Rows of previous chunks if there is no onChunk callback
+        Persistent<Array> rows;
+        // Encoded size and rows count of the whole result
+        uint64_t result_bytes;
+        uint64_t result_rows;
+
+        // Cancellation state, see MysqlConnection::CancelQuery
+        uint32_t id;
+        uv_work_t *req;
+        // Set on the event loop thread, read by EIO_Query
+        volatile bool canceled;
+        bool overloaded;
+        // Removed from commands queue before dispatch
+        bool dequeued;
+        bool timed_out;
+        uv_timer_t *timer;
+        query_request *next_active;
+    };
+
+    /*!
+     * Query cancellation and deadlines
+     *
+     * Running query is interrupted with KILL QUERY
+     * sent over a lazily opened side connection
+     */
+    query_request *active_queries;
+    uint32_t last_query_id;
+    // Query reading rows of streamed result between its chunks
+    query_request *streaming_query;
+
+    MYSQL *kill_conn;
+    pthread_mutex_t kill_lock;
+
+    // Side connection is opened with the same flags, options and SSL settings,
+    // options are saved by setOptionSync() and setSslSync() under kill_lock
+    struct connect_option {
+        mysql_option option;
+        int int_value;
+        char *string_value;
+        connect_option *next;
+    };
+    connect_option *connect_options;
+    char *ssl_settings[5];
+    uint64_t connect_flags;
+    void SaveConnectOption(mysql_option option, int int_value, const char *string_value);
+    void ApplyConnectOptions(MYSQL *my_conn);
+    // Next command is not dispatched until KILL QUERY is done,
+    // so it can't interrupt wrong query
+    bool kill_pending;
+
+    struct kill_request {
+        MysqlConnection *conn;
+
+        unsigned long thread_id;
+
+        char *host;
+        char *user;
+        char *passwd;
+        char *unix_socket;
+        unsigned int port;
     };
+    static void EIO_After_KillQuery(uv_work_t *req);
+    static void EIO_KillQuery(uv_work_t *req);
+
+    static int ParseQueryOptions(const Arguments& args, int i, query_options *options);
+    static result_mode ParseResultMode(Handle<Value> mode);
+    static Local<Object> NewQueryHandle(Handle<Object> js_conn, uint32_t id);
+    Local<Object> TrackQuery(query_request *query_req,
+                             uv_work_t *req,
+                             const query_options &options,
+                             Handle<Object> js_conn);
+    void UntrackQuery(query_request *query_req);
+    bool CancelQuery(uint32_t id, bool timed_out);
+
+    query_request *FindCoalescingLeader(coalesce_mode coalesce,
+                                        command_lane lane,
+                                        const char *query,
+                                        unsigned int query_len,
+                                        uint32_t query_hash);
+    Local<Object> CoalesceQuery(const char *query,
+                                unsigned int query_len,
+                                const query_options &options,
+                                Handle<Value> callback,
+                                Handle<Object> js_conn);
+    static void FreeWaiter(coalesced_waiter *waiter);
+    static void EV_WaiterTimeout(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS);
+    static bool IsReadQuery(const char *query);
+    static bool HasUseStatement(const char *query);
+
+    /*!
+     * Result cache scope: server, user, character set and current database
+     * of the session, identical queries share cached results only within one scope.
+     * Copy is read under kill_lock, NULL if current database is not known,
+     * e.g. after USE without session state tracking
+     */
+    char *cache_scope;
+    size_t cache_scope_len;
+    bool schema_untracked;
+    void SessionChanged();
+    void TrackSessionSchema(const char *query);
+    void UpdateCacheScope();
+    char *CacheKey(const char *query, size_t query_len, size_t *key_len);
+
+    struct cached_query_request {
+        Persistent<Value> callback;
+        MysqlResultCache::entry *cached;
+    };
+    Local<Object> ReturnCachedResult(const char *cache_key,
+                                     size_t cache_key_len,
+                                     Handle<Value> callback,
+                                     Handle<Object> js_conn);
+    static char *CopyCacheTags(Handle<Value> tags, size_t *tags_len);
+    static void EV_CachedQuery(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS);
+    static uint32_t HashQuery(const char *query, unsigned int query_len);
+
+    static void EV_QueryTimeout(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS);
+    struct canceled_callback {
+        Persistent<Value> callback;
+        bool timed_out;
+    };
+    static void DeferCanceledCallback(Handle<Value> callback, bool timed_out);
+    static void EV_CanceledCallback(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS);
+    static void EV_CanceledQuery(NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS);
+    static void EV_QueryTimeout_OnTimerClose(uv_handle_t *handle);
     static int CustomLocalInfileInit(void ** ptr,
                                      const char * filename,
                                      void * userdata);
@@ -214,35 +773,72 @@ class MysqlConnection : public node::ObjectWrap {
     static void RestoreLocalInfileHandlers(local_infile_data * infile_data,
                                            MYSQL * conn);
     static local_infile_data * PrepareLocalInfileData(Handle<Value> buffer);
+    static void FreeLocalInfileData(local_infile_data * infile_data);
+    static void AbortLocalInfile(local_infile_data * infile_data, const char * error);
+    bool LoadingLocalInfile();
+    static void ReleaseLocalInfileChunks(local_infile_data * infile_data, bool all);
+    static Handle<Value> OnLocalInfileData(const Arguments& args);
+    static Handle<Value> OnLocalInfileEnd(const Arguments& args);
+    static Handle<Value> OnLocalInfileError(const Arguments& args);
+    static void EV_LocalInfileDrained(NODE_ADDON_SHIM_ASYNC_CALLBACK_ARGUMENTS);
+    static void EV_LocalInfileDrained_OnClose(uv_handle_t *handle);
+    static int RealQueryAfterGtidWait(query_request *query_req);
     static void EIO_After_Query(uv_work_t *req);
     static void EIO_Query(uv_work_t *req);
+    static void EIO_QueryChunk(uv_work_t *req);
+    static void ReadResultChunk(query_request *query_req, size_t size_hint);
+    static void FinishQueryResult(query_request *query_req);
+    static Local<Value> TakeResultRows(query_request *query_req);
     static Handle<Value> Query(const Arguments& args);
 
+    static Handle<Value> QueryCancel(const Arguments& args);
+
     /*!
      * Callback function for uv_close(uv_handle_t* handle), if needed
      */
     NODE_ADDON_SHIM_STOP_IO_WATCH_ONCLOSE(EV_After_QuerySend_OnWatchHandleClose)
     static void EV_After_QuerySend(NODE_ADDON_SHIM_IO_WATCH_CALLBACK_ARGUMENTS);
+    static void EV_QuerySend(uv_work_t *req);
     static Handle<Value> QuerySend(const Arguments& args);
 
     static Handle<Value> QuerySync(const Arguments& args);
 
+    static Handle<Value> QueueStatsSync(const Arguments& args);
+
     static Handle<Value> RealConnectSync(const Arguments& args);
 
     static Handle<Value> RealQuerySync(const Arguments& args);
 
+    static Handle<Value> ResultCacheStatsSync(const Arguments& args);
+
+    static Handle<Value> Rollback(const Arguments& args);
+
     static Handle<Value> RollbackSync(const Arguments& args);
 
+    static Handle<Value> SelectDb(const Arguments& args);
+
     static Handle<Value> SelectDbSync(const Arguments& args);
 
+    static Handle<Value> SetCharset(const Arguments& args);
+
     static Handle<Value> SetCharsetSync(const Arguments& args);
 
+    static Handle<Value> SetAdmissionLimitsSync(const Arguments& args);
+
+    static Handle<Value> SetProcessAdmissionLimitsSync(const Arguments& args);
+
     static Handle<Value> SetOptionSync(const Arguments& args);
 
+    static Handle<Value> SetResultCacheLimitsSync(const Arguments& args);
+
+    static Handle<Value> SetResultModeSync(const Arguments& args);
+
     static Handle<Value> SetSslSync(const Arguments& args);
 
     static Handle<Value> SqlStateSync(const Arguments& args);
 
+    static Handle<Value> Stat(const Arguments& args);
+
     static Handle<Value> StatSync(const Arguments& args);
 
     static Handle<Value> StoreResultSync(const Arguments& args);
@@ -11,6 +11,8 @@
 #include "./mysql_bindings_connection.h"
 #include "./mysql_bindings_result.h"
 
+#include <cmath>
+
 /*!
  * Init V8 structures for MysqlResult class
  */
@@ -44,13 +46,15 @@ void MysqlResult::Init(Handle<Object> target) {
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "fieldSeekSync",        MysqlResult::FieldSeekSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "fieldTellSync",        MysqlResult::FieldTellSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "freeSync",             MysqlResult::FreeSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "hashJoin",             MysqlResult::HashJoin);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "mergeSortedSync",      MysqlResult::MergeSortedSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "numRowsSync",          MysqlResult::NumRowsSync);
 
     // Make it visible in JavaScript
     target->Set(String::NewSymbol("MysqlResult"), constructor_template->GetFunction());
 }
 
-MysqlResult::MysqlResult(): ObjectWrap() {}
+MysqlResult::MysqlResult(): ObjectWrap(), busy(0) {}
 
 MysqlResult::~MysqlResult() {
     this->Free();
@@ -251,6 +255,264 @@ MysqlResult::fetch_options MysqlResult::GetFetchOptions(Local<Object> options) {
     return fo;
 }
 
+/*!
+ * Resolves `columns` and `where` fetch options against result fields,
+ * returns error message or NULL
+ */
+const char *MysqlResult::BuildFetchFilter(Local<Object> options, MYSQL_RES *my_result, fetch_filter *filter) {
+    MYSQL_FIELD *fields = mysql_fetch_fields(my_result);
+    uint32_t num_fields = mysql_num_fields(my_result);
+    uint32_t i, j;
+
+    filter->columns = NULL;
+    filter->column_count = 0;
+    filter->predicates = NULL;
+    filter->predicate_count = 0;
+
+    Local<Value> js_columns = options->Get(V8STR("columns"));
+    if (js_columns->IsArray()) {
+        Local<Array> js_columns_array = Local<Array>::Cast(js_columns);
+        filter->columns = new uint32_t[js_columns_array->Length() + 1];
+
+        for (i = 0; i < js_columns_array->Length(); i++) {
+            String::Utf8Value column(js_columns_array->Get(i)->ToString());
+            for (j = 0; j < num_fields && strcmp(fields[j].name, *column); j++) {}
+            if (j == num_fields) {
+                FreeFetchFilter(filter);
+                return "Column from 'columns' option is not found in result";
+            }
+            filter->columns[filter->column_count++] = j;
+        }
+    } else if (!js_columns->IsUndefined()) {
+        return "Option 'columns' must be an array";
+    }
+
+    Local<Value> js_where = options->Get(V8STR("where"));
+    if (js_where->IsUndefined()) {
+        return NULL;
+    }
+    if (!js_where->IsObject() || js_where->IsArray()) {
+        FreeFetchFilter(filter);
+        return "Option 'where' must be an object";
+    }
+
+    Local<Array> js_where_columns = js_where->ToObject()->GetPropertyNames();
+    // Every column has at most four range predicates
+    filter->predicates = new fetch_predicate[js_where_columns->Length() * 4 + 1];
+
+    for (i = 0; i < js_where_columns->Length(); i++) {
+        Local<Value> js_column = js_where_columns->Get(i);
+        Local<Value> js_value = js_where->ToObject()->Get(js_column);
+        String::Utf8Value column(js_column->ToString());
+
+        for (j = 0; j < num_fields && strcmp(fields[j].name, *column); j++) {}
+        if (j == num_fields) {
+            FreeFetchFilter(filter);
+            return "Column from 'where' option is not found in result";
+        }
+
+        // Numbers are compared only with numeric columns, as strings can't be
+        predicate_number number_type = PREDICATE_NUMBER_REAL;
+        bool numeric_column = true;
+        switch (fields[j].type) {
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONGLONG:
+            case MYSQL_TYPE_YEAR:
+                number_type = (fields[j].flags & UNSIGNED_FLAG) ? PREDICATE_NUMBER_UNSIGNED
+                                                                : PREDICATE_NUMBER_SIGNED;
+                break;
+            case MYSQL_TYPE_FLOAT:
+            case MYSQL_TYPE_DOUBLE:
+            case MYSQL_TYPE_DECIMAL:
+            case MYSQL_TYPE_NEWDECIMAL:
+                break;
+            default:
+                numeric_column = false;
+                break;
+        }
+        if (!numeric_column && (js_value->IsNumber() || js_value->IsBoolean()
+                                || (js_value->IsObject() && !js_value->IsArray()))) {
+            FreeFetchFilter(filter);
+            return "Numbers and ranges in 'where' option can be used only with numeric columns";
+        }
+
+        fetch_predicate *predicate = &filter->predicates[filter->predicate_count];
+        predicate->field = j;
+        predicate->value = NULL;
+        predicate->value_length = 0;
+        predicate->number = 0;
+        predicate->number_type = number_type;
+
+        if (js_value->IsNull()) {
+            predicate->op = PREDICATE_IS_NULL;
+            filter->predicate_count++;
+        } else if (js_value->IsNumber() || js_value->IsBoolean()) {
+            predicate->op = PREDICATE_EQ;
+            predicate->number = js_value->NumberValue();
+            filter->predicate_count++;
+        } else if (js_value->IsString()) {
+            String::Utf8Value value(js_value);
+            predicate->op = PREDICATE_EQ;
+            predicate->value_length = value.length();
+            predicate->value = new char[value.length() + 1];
+            memcpy(predicate->value, *value, value.length() + 1);
+            filter->predicate_count++;
+        } else if (js_value->IsObject() && !js_value->IsArray()) {
+            static const char *range_names[] = {"lt", "lte", "gt", "gte"};
+            static const predicate_op range_ops[] = {PREDICATE_LT, PREDICATE_LTE, PREDICATE_GT, PREDICATE_GTE};
+            Local<Object> js_range = js_value->ToObject();
+
+            if (js_range->GetPropertyNames()->Length() == 0) {
+                FreeFetchFilter(filter);
+                return "Range in 'where' option must have lt, lte, gt or gte";
+            }
+
+            for (uint32_t r = 0; r < 4; r++) {
+                Local<Value> js_bound = js_range->Get(V8STR(range_names[r]));
+                if (js_bound->IsUndefined()) {
+                    continue;
+                }
+                if (!js_bound->IsNumber()) {
+                    FreeFetchFilter(filter);
+                    return "Range bounds in 'where' option must be numbers";
+                }
+
+                predicate = &filter->predicates[filter->predicate_count++];
+                predicate->field = j;
+                predicate->op = range_ops[r];
+                predicate->value = NULL;
+                predicate->value_length = 0;
+                predicate->number = js_bound->NumberValue();
+                predicate->number_type = number_type;
+            }
+        } else {
+            FreeFetchFilter(filter);
+            return "Values in 'where' option must be strings, numbers, null or ranges";
+        }
+    }
+
+    return NULL;
+}
+
+/*!
+ * Compares numeric cell with number of predicate. Integer columns are parsed
+ * as 64-bit integers, so BIGINT values above 2^53 are not rounded
+ */
+int MysqlResult::CompareNumberCell(const fetch_predicate *predicate, const char *cell) {
+    double bound = predicate->number;
+
+    if (predicate->number_type == PREDICATE_NUMBER_REAL) {
+        double number = strtod(cell, NULL);
+        return number < bound ? -1 : (number > bound ? 1 : 0);
+    }
+
+    // Integer is compared with floor of bound, then fraction of bound decides
+    double floor_bound = floor(bound);
+    int r;
+
+    if (predicate->number_type == PREDICATE_NUMBER_UNSIGNED) {
+        if (floor_bound < 0) {
+            return 1;
+        }
+        if (floor_bound >= 18446744073709551616.0) {
+            return -1;
+        }
+        unsigned long long number = strtoull(cell, NULL, 10); // NOLINT
+        unsigned long long integer_bound = static_cast<unsigned long long>(floor_bound); // NOLINT
+        r = number < integer_bound ? -1 : (number > integer_bound ? 1 : 0);
+    } else {
+        if (floor_bound < -9223372036854775808.0) {
+            return 1;
+        }
+        if (floor_bound >= 9223372036854775808.0) {
+            return -1;
+        }
+        long long number = strtoll(cell, NULL, 10); // NOLINT
+        long long integer_bound = static_cast<long long>(floor_bound); // NOLINT
+        r = number < integer_bound ? -1 : (number > integer_bound ? 1 : 0);
+    }
+
+    return r == 0 && bound > floor_bound ? -1 : r;
+}
+
+/*!
+ * Checks row against predicates of fetch filter, NULL matches only null
+ */
+bool MysqlResult::RowMatches(const fetch_filter *filter, MYSQL_ROW row, unsigned long *lengths) {
+    for (uint32_t i = 0; i < filter->predicate_count; i++) {
+        const fetch_predicate *predicate = &filter->predicates[i];
+        const char *cell = row[predicate->field];
+
+        if (predicate->op == PREDICATE_IS_NULL) {
+            if (cell) {
+                return false;
+            }
+            continue;
+        }
+        if (!cell) {
+            return false;
+        }
+
+        if (predicate->value) {
+            if (lengths[predicate->field] != predicate->value_length
+                || memcmp(cell, predicate->value, predicate->value_length)) {
+                return false;
+            }
+            continue;
+        }
+
+        // NaN matches nothing
+        if (predicate->number != predicate->number) {
+            return false;
+        }
+
+        // Cells of text protocol are NUL-terminated
+        int r = CompareNumberCell(predicate, cell);
+        bool matches = false;
+
+        switch (predicate->op) {
+            case PREDICATE_EQ:
+                matches = r == 0;
+                break;
+            case PREDICATE_LT:
+                matches = r < 0;
+                break;
+            case PREDICATE_LTE:
+                matches = r <= 0;
+                break;
+            case PREDICATE_GT:
+                matches = r > 0;
+                break;
+            case PREDICATE_GTE:
+                matches = r >= 0;
+                break;
+            default:
+                break;
+        }
+        if (!matches) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MysqlResult::FreeFetchFilter(fetch_filter *filter) {
+    for (uint32_t i = 0; i < filter->predicate_count; i++) {
+        delete[] filter->predicates[i].value;
+    }
+    delete[] filter->predicates;
+    delete[] filter->columns;
+
+    filter->columns = NULL;
+    filter->column_count = 0;
+    filter->predicates = NULL;
+    filter->predicate_count = 0;
+}
+
 void MysqlResult::Free() {
     if (_res) {
         mysql_free_result(_res);
@@ -310,6 +572,7 @@ Handle<Value> MysqlResult::DataSeekSync(const Arguments& args) {
     MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
 
     MYSQLRES_MUSTBE_VALID;
+    MYSQLRES_MUSTNOT_BE_BUSY;
 
     REQ_UINT_ARG(0, offset)
 
@@ -327,47 +590,49 @@ Handle<Value> MysqlResult::DataSeekSync(const Arguments& args) {
 }
 
 /*!
- * EIO wrapper functions for MysqlResult::FetchAll
+ * Converts rows of fetchAll() until result is exhausted or slice time is over,
+ * returns true when all rows are converted.
+ * With `onChunk` option rows of the slice are passed to it and not collected
  */
-void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
+bool MysqlResult::FetchAllSlice(fetchAll_request *fetchAll_req) {
     HandleScope scope;
 
-    struct fetchAll_request *fetchAll_req = (struct fetchAll_request *)(req->data);
-
-    // We can't use const int argc here because argv is used
-    // for both MysqlResult creation and callback call
-    int argc = 1; // node.js convention, there is always at least one argument for callback
-    Local<Value> argv[3];
+    MYSQL_FIELD *fields = fetchAll_req->fields;
+    uint32_t num_fields = fetchAll_req->num_fields;
+    MYSQL_ROW result_row;
+    unsigned long *field_lengths;
+    uint32_t j = 0;
+    fetch_filter *filter = &fetchAll_req->filter;
+    uint32_t column_count = filter->columns ? filter->column_count : num_fields;
+    bool chunked = !fetchAll_req->on_chunk.IsEmpty();
+    uint32_t chunk_count = 0;
+    bool done = true;
 
-    if (!fetchAll_req->ok) {
-        argv[0] = V8EXC("Error on fetching fields");
-    } else {
-        MYSQL_FIELD *fields = fetchAll_req->fields;
-        uint32_t num_fields = fetchAll_req->num_fields;
-        MYSQL_ROW result_row;
-        unsigned long *field_lengths;
-        uint32_t i = 0, j = 0;
+    uint64_t deadline = fetchAll_req->slice_ms
+                      ? uv_hrtime() + static_cast<uint64_t>(fetchAll_req->slice_ms) * 1000000
+                      : 0;
 
-        // Get rows
-        Local<Array> js_result = Array::New();
-        Local<Object> js_result_row;
-        Local<Value> js_field;
+    Local<Array> js_result = chunked ? Array::New() : Local<Array>::New(fetchAll_req->rows);
+    Local<Object> js_result_row;
+    Local<Value> js_field;
 
-        i = 0;
-        while ((result_row = mysql_fetch_row(fetchAll_req->res->_res))) {
-            field_lengths = mysql_fetch_lengths(fetchAll_req->res->_res);
+    while ((result_row = mysql_fetch_row(fetchAll_req->res->_res))) {
+        field_lengths = mysql_fetch_lengths(fetchAll_req->res->_res);
+        fetchAll_req->fetched++;
 
+        if (!filter->predicate_count || RowMatches(filter, result_row, field_lengths)) {
             if (fetchAll_req->fo.results_as_array) {
               js_result_row = Array::New();
             } else {
               js_result_row = Object::New();
             }
 
-            for (j = 0; j < num_fields; j++) {
+            for (uint32_t c = 0; c < column_count; c++) {
+                j = filter->columns ? filter->columns[c] : c;
                 js_field = GetFieldValue(fields[j], result_row[j], field_lengths[j]);
 
                 if (fetchAll_req->fo.results_as_array) {
-                    js_result_row->Set(Integer::NewFromUnsigned(j), js_field);
+                    js_result_row->Set(Integer::NewFromUnsigned(c), js_field);
                 } else if (fetchAll_req->fo.results_nest_tables) {
                     if (!js_result_row->Has(V8STR(fields[j].table))) {
                         js_result_row->Set(V8STR(fields[j].table), Object::New());
@@ -379,48 +644,96 @@ void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
                 }
             }
 
-            js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+            if (chunked) {
+                js_result->Set(Integer::NewFromUnsigned(chunk_count++), js_result_row);
+            } else {
+                js_result->Set(Integer::NewFromUnsigned(fetchAll_req->rows_count++), js_result_row);
+            }
+        }
 
-            i++;
+        // Clock is read once per 64 rows
+        if (deadline && (fetchAll_req->fetched & 63) == 0 && uv_hrtime() >= deadline) {
+            done = false;
+            break;
         }
+    }
+
+    if (chunked && chunk_count > 0) {
+        Local<Value> argv[1];
+        argv[0] = js_result;
+        node::MakeCallback(Context::GetCurrent()->Global(), fetchAll_req->on_chunk, 1, argv);
+    }
 
-        if (i != mysql_num_rows(fetchAll_req->res->_res)) {
-            unsigned int errno = mysql_errno(fetchAll_req->res->_conn);
-            const char *error = mysql_error(fetchAll_req->res->_conn);
-            unsigned long error_string_length = strlen(error) + 20;
-            char* error_string = new char[error_string_length];
-            snprintf(
-                error_string, error_string_length,
-                "Fetch error #%d: %s",
-                errno, error
-            );
+    return done;
+}
 
-            argv[0] = V8EXC(error_string);
-            delete[] error_string;
-        } else {
-            // Get fields info
-            Local<Array> js_fields = Array::New();
+/*!
+ * Calls fetchAll() callback and frees request
+ */
+void MysqlResult::FetchAllDone(fetchAll_request *fetchAll_req) {
+    HandleScope scope;
 
-            for (i = 0; i < num_fields; i++) {
-                js_result_row = Object::New();
-                AddFieldProperties(js_result_row, &fields[i]);
+    // We can't use const int argc here because argv is used
+    // for both MysqlResult creation and callback call
+    int argc = 1; // node.js convention, there is always at least one argument for callback
+    Local<Value> argv[3];
 
-                js_fields->Set(Integer::NewFromUnsigned(i), js_result_row);
-            }
+    fetchAll_req->res->busy--;
 
-            argv[1] = js_result;
-            argv[2] = js_fields;
-            argv[0] = Local<Value>::New(Null());
-            argc = 3;
+    if (!fetchAll_req->ok) {
+        argv[0] = V8EXC("Error on fetching fields");
+    } else if (!fetchAll_req->res->_res) {
+        argv[0] = V8EXC("Result has been freed.");
+    } else if (fetchAll_req->fetched != mysql_num_rows(fetchAll_req->res->_res)) {
+        unsigned int errno = mysql_errno(fetchAll_req->res->_conn);
+        const char *error = mysql_error(fetchAll_req->res->_conn);
+        unsigned long error_string_length = strlen(error) + 20;
+        char* error_string = new char[error_string_length];
+        snprintf(
+            error_string, error_string_length,
+            "Fetch error #%d: %s",
+            errno, error
+        );
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        // Get fields info
+        Local<Array> js_fields = Array::New();
+        Local<Object> js_field_obj;
+
+        for (uint32_t i = 0; i < fetchAll_req->num_fields; i++) {
+            js_field_obj = Object::New();
+            AddFieldProperties(js_field_obj, &fetchAll_req->fields[i]);
+
+            js_fields->Set(Integer::NewFromUnsigned(i), js_field_obj);
+        }
+
+        if (fetchAll_req->on_chunk.IsEmpty()) {
+            argv[1] = Local<Array>::New(fetchAll_req->rows);
+        } else {
+            argv[1] = Local<Value>::New(Null());
         }
+        argv[2] = js_fields;
+        argv[0] = Local<Value>::New(Null());
+        argc = 3;
     }
 
     node::MakeCallback(Context::GetCurrent()->Global(), fetchAll_req->callback, argc, argv);
 
     fetchAll_req->callback.Dispose();
-    
+    fetchAll_req->on_chunk.Dispose();
+    fetchAll_req->rows.Dispose();
+
     fetchAll_req->res->Unref();
 
+    FreeFetchFilter(&fetchAll_req->filter);
+
+    if (fetchAll_req->check) {
+        uv_close((uv_handle_t *) fetchAll_req->check, EV_FetchAllSlice_OnClose);
+        uv_close((uv_handle_t *) fetchAll_req->idle, EV_FetchAllSlice_OnClose);
+    }
+
     // Free the result object after callback
     // All of the rows have been gotten at this point
     // Removed, see comment below
@@ -428,10 +741,69 @@ void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
 
     // DO NOT do this. User must can manipulate result after fetchAll().
     // delete fetchAll_req->res;
-    
+
     delete fetchAll_req;
+}
+
+/*!
+ * Next slice runs in check phase, after pending I/O is processed,
+ * like setImmediate() callbacks
+ */
+void MysqlResult::EV_FetchAllSlice(NODE_ADDON_SHIM_CHECK_CALLBACK_ARGUMENTS) {
+    HandleScope scope;
+
+    fetchAll_request *fetchAll_req = (fetchAll_request *)(handle->data);
+
+    if (!FetchAllSlice(fetchAll_req)) {
+        return;
+    }
+
+    uv_check_stop(fetchAll_req->check);
+    uv_idle_stop(fetchAll_req->idle);
+
+    FetchAllDone(fetchAll_req);
+}
+
+/*!
+ * Active idle handle makes event loop poll for I/O without blocking
+ */
+void MysqlResult::EV_FetchAllIdle(NODE_ADDON_SHIM_IDLE_CALLBACK_ARGUMENTS) {
+}
+
+void MysqlResult::EV_FetchAllSlice_OnClose(uv_handle_t *handle) {
+    if (handle->type == UV_CHECK) {
+        delete (uv_check_t *) handle;
+    } else {
+        delete (uv_idle_t *) handle;
+    }
+}
+
+/*!
+ * EIO wrapper functions for MysqlResult::FetchAll
+ */
+void MysqlResult::EIO_After_FetchAll(uv_work_t *req) {
+    HandleScope scope;
+
+    struct fetchAll_request *fetchAll_req = (struct fetchAll_request *)(req->data);
 
     delete req;
+
+    if (fetchAll_req->ok) {
+        fetchAll_req->rows = Persistent<Array>::New(Array::New());
+
+        if (!FetchAllSlice(fetchAll_req)) {
+            fetchAll_req->check = new uv_check_t;
+            fetchAll_req->idle = new uv_idle_t;
+            uv_check_init(uv_default_loop(), fetchAll_req->check);
+            uv_idle_init(uv_default_loop(), fetchAll_req->idle);
+            fetchAll_req->check->data = fetchAll_req;
+            uv_check_start(fetchAll_req->check, EV_FetchAllSlice);
+            uv_idle_start(fetchAll_req->idle, EV_FetchAllIdle);
+            return;
+        }
+    }
+
+    FetchAllDone(fetchAll_req);
 }
 
 void MysqlResult::EIO_FetchAll(uv_work_t *req) {
@@ -452,7 +824,12 @@ void MysqlResult::EIO_FetchAll(uv_work_t *req) {
  * - options (Boolean|Object): Fetch style options (optional)
  * - callback (Function): Callback function, gets (error, rows)
  *
- * Fetches all result rows as an array
+ * Fetches all result rows as an array,
+ * `columns` and `where` options work as in fetchAllSync().
+ * With `sliceMs` option rows are converted in slices of that duration,
+ * event loop handles I/O between them. With `onChunk` function option
+ * rows of every slice are passed to it, and callback gets null instead of rows.
+ * Until callback is called, methods moving row cursor and freeSync() throw
  **/
 Handle<Value> MysqlResult::FetchAll(const Arguments& args) {
     HandleScope scope;
@@ -498,14 +875,52 @@ Handle<Value> MysqlResult::FetchAll(const Arguments& args) {
     MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder()); // NOLINT
 
     MYSQLRES_MUSTBE_VALID;
+    MYSQLRES_MUSTNOT_BE_BUSY;
+
+    uint32_t slice_ms = 0;
+    Local<Value> on_chunk;
+    if (arg_pos > 0 && !throw_wrong_arguments_exception) {
+        Local<Value> js_slice_ms = args[0]->ToObject()->Get(V8STR("sliceMs"));
+        if (js_slice_ms->IsUint32()) {
+            slice_ms = js_slice_ms->Uint32Value();
+        } else if (!js_slice_ms->IsUndefined()) {
+            return THRTYPEEXC("Option sliceMs must be a positive integer");
+        }
+
+        on_chunk = args[0]->ToObject()->Get(V8STR("onChunk"));
+        if (!on_chunk->IsFunction() && !on_chunk->IsUndefined()) {
+            return THRTYPEEXC("Option onChunk must be a function");
+        }
+    }
+
+    fetch_filter filter = {NULL, 0, NULL, 0};
+    if (arg_pos > 0 && !throw_wrong_arguments_exception) {
+        const char *filter_error = BuildFetchFilter(args[0]->ToObject(), res->_res, &filter);
+        if (filter_error) {
+            return THREXC(filter_error);
+        }
+    }
 
     fetchAll_request *fetchAll_req = new fetchAll_request;
 
     fetchAll_req->callback = Persistent<Function>::New(callback);
     fetchAll_req->res = res;
     res->Ref();
+
+    // Cursor of the result is moved only by this fetch until callback
+    res->busy++;
     
     fetchAll_req->fo = fo;
+    fetchAll_req->filter = filter;
+
+    fetchAll_req->slice_ms = slice_ms;
+    if (!on_chunk.IsEmpty() && on_chunk->IsFunction()) {
+        fetchAll_req->on_chunk = Persistent<Function>::New(Local<Function>::Cast(on_chunk));
+    }
+    fetchAll_req->rows_count = 0;
+    fetchAll_req->fetched = 0;
+    fetchAll_req->check = NULL;
+    fetchAll_req->idle = NULL;
 
     uv_work_t *_req = new uv_work_t;
     _req->data = fetchAll_req;
@@ -515,10 +930,17 @@ Handle<Value> MysqlResult::FetchAll(const Arguments& args) {
 }
 
 /**
- * MysqlResult#fetchAllSync([options]) -> Array
+ * MysqlResult#fetchAllSync([options]) -> Array|Object
  * - options (Object): Fetch style options (optional)
  *
- * Fetches all result rows as an array
+ * Fetches all result rows as an array.
+ * With `indexBy` option fetches rows into an object without prototype
+ * keyed by value of that column, rows with NULL key are skipped.
+ * `columns` option is array of column names to fetch, `where` option is object
+ * of column conditions: string or number to be equal, null for NULL,
+ * or range {lt, lte, gt, gte}. Numbers and ranges can be used only with numeric
+ * columns, strings are compared bytewise, so BIGINT above 2^53 is matched exactly
+ * by string. Skipped rows and cells are not converted to JS values
  **/
 Handle<Value> MysqlResult::FetchAllSync(const Arguments& args) {
     HandleScope scope;
@@ -526,6 +948,7 @@ Handle<Value> MysqlResult::FetchAllSync(const Arguments& args) {
     MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
 
     MYSQLRES_MUSTBE_VALID;
+    MYSQLRES_MUSTNOT_BE_BUSY;
 
     fetch_options fo = {false, false};
 
@@ -546,7 +969,39 @@ Handle<Value> MysqlResult::FetchAllSync(const Arguments& args) {
     unsigned long *field_lengths;
     uint32_t i = 0, j = 0;
 
-    Local<Array> js_result = Array::New();
+    // Key column for indexBy option
+    bool indexed = false;
+    uint32_t index_field = 0;
+    if (args.Length() > 0 && args[0]->ToObject()->Has(V8STR("indexBy"))) {
+        String::Utf8Value index_by(args[0]->ToObject()->Get(V8STR("indexBy"))->ToString());
+
+        for (j = 0; j < num_fields; j++) {
+            if (!strcmp(fields[j].name, *index_by)) {
+                break;
+            }
+        }
+        if (j == num_fields) {
+            return THREXC("Column from 'indexBy' option is not found in result");
+        }
+
+        indexed = true;
+        index_field = j;
+    }
+
+    fetch_filter filter = {NULL, 0, NULL, 0};
+    if (args.Length() > 0) {
+        const char *filter_error = BuildFetchFilter(args[0]->ToObject(), res->_res, &filter);
+        if (filter_error) {
+            return THREXC(filter_error);
+        }
+    }
+    uint32_t column_count = filter.columns ? filter.column_count : num_fields;
+
+    Local<Object> js_result = indexed ? Object::New() : Local<Object>(Array::New());
+    if (indexed) {
+        // Key values like "__proto__" must not change the object
+        js_result->SetPrototype(Null());
+    }
     Local<Object> js_result_row;
     Local<Value> js_field;
 
@@ -554,17 +1009,22 @@ Handle<Value> MysqlResult::FetchAllSync(const Arguments& args) {
     while ( (result_row = mysql_fetch_row(res->_res)) ) {
         field_lengths = mysql_fetch_lengths(res->_res);
 
+        if (filter.predicate_count && !RowMatches(&filter, result_row, field_lengths)) {
+            continue;
+        }
+
         if (fo.results_as_array) {
             js_result_row = Array::New();
         } else {
             js_result_row = Object::New();
         }
 
-        for (j = 0; j < num_fields; j++) {
+        for (uint32_t c = 0; c < column_count; c++) {
+            j = filter.columns ? filter.columns[c] : c;
             js_field = GetFieldValue(fields[j], result_row[j], field_lengths[j]);
 
             if (fo.results_as_array) {
-                js_result_row->Set(Integer::NewFromUnsigned(j), js_field);
+                js_result_row->Set(Integer::NewFromUnsigned(c), js_field);
             } else if (fo.results_nest_tables) {
                 if (!js_result_row->Has(V8STR(fields[j].table))) {
                     js_result_row->Set(V8STR(fields[j].table), Object::New());
@@ -576,11 +1036,19 @@ Handle<Value> MysqlResult::FetchAllSync(const Arguments& args) {
             }
         }
 
-        js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+        if (indexed) {
+            if (result_row[index_field]) {
+                js_result->Set(V8STR2(result_row[index_field], field_lengths[index_field]), js_result_row);
+            }
+        } else {
+            js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+        }
 
         i++;
     }
 
+    FreeFetchFilter(&filter);
+
     return scope.Close(js_result);
 }
 
@@ -716,6 +1184,7 @@ Handle<Value> MysqlResult::FetchRowSync(const Arguments& args) {
     MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
 
     MYSQLRES_MUSTBE_VALID;
+    MYSQLRES_MUSTNOT_BE_BUSY;
 
     fetch_options fo = {false, false};
 
@@ -820,12 +1289,696 @@ Handle<Value> MysqlResult::FreeSync(const Arguments& args) {
     MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
 
     MYSQLRES_MUSTBE_VALID;
+    MYSQLRES_MUSTNOT_BE_BUSY;
 
     res->Free();
 
     return Undefined();
 }
 
+/*!
+ * Collects row pointers and lengths of stored result on the event loop thread,
+ * so the threadpool job does not move row cursor of the result.
+ * Rows stay valid until result is freed, cursor is restored
+ */
+void MysqlResult::CollectJoinRows(MYSQL_RES *my_result, join_rows *rows) {
+    uint32_t num_fields = mysql_num_fields(my_result);
+    uint32_t count = static_cast<uint32_t>(mysql_num_rows(my_result));
+    MYSQL_ROW_OFFSET cursor = mysql_row_tell(my_result);
+    MYSQL_ROW row;
+
+    rows->rows = new MYSQL_ROW[count + 1];
+    rows->lengths = new unsigned long[static_cast<size_t>(count) * num_fields + 1];
+    rows->count = 0;
+
+    mysql_data_seek(my_result, 0);
+    while (rows->count < count && (row = mysql_fetch_row(my_result))) {
+        rows->rows[rows->count] = row;
+        memcpy(rows->lengths + static_cast<size_t>(rows->count) * num_fields,
+               mysql_fetch_lengths(my_result), num_fields * sizeof(unsigned long));
+        rows->count++;
+    }
+    mysql_row_seek(my_result, cursor);
+}
+
+/*!
+ * FNV-1a hash of join key
+ */
+uint32_t MysqlResult::JoinKeyHash(const char *key, unsigned long key_length) {
+    uint32_t hash = 2166136261u;
+
+    for (unsigned long i = 0; i < key_length; i++) {
+        hash = (hash ^ static_cast<unsigned char>(key[i])) * 16777619u;
+    }
+
+    return hash;
+}
+
+/*!
+ * EIO wrapper functions for MysqlResult::HashJoin
+ */
+void MysqlResult::EIO_After_HashJoin(uv_work_t *req) {
+    HandleScope scope;
+
+    struct hashJoin_request *hashJoin_req = (struct hashJoin_request *)(req->data);
+
+    const int argc = 2;
+    Local<Value> argv[2];
+
+    hashJoin_req->left->busy--;
+    hashJoin_req->right->busy--;
+
+    {
+        MYSQL_FIELD *left_fields = mysql_fetch_fields(hashJoin_req->left->_res);
+        MYSQL_FIELD *right_fields = mysql_fetch_fields(hashJoin_req->right->_res);
+        uint32_t left_num_fields = mysql_num_fields(hashJoin_req->left->_res);
+        uint32_t right_num_fields = mysql_num_fields(hashJoin_req->right->_res);
+
+        Local<Array> js_result = Array::New();
+        Local<Object> js_result_row;
+        Local<Value> js_field;
+
+        for (uint32_t i = 0; i < hashJoin_req->pair_count; i++) {
+            uint32_t left_row = hashJoin_req->pairs[2 * i];
+            uint32_t right_row = hashJoin_req->pairs[2 * i + 1];
+
+            if (hashJoin_req->results_as_array) {
+                js_result_row = Array::New();
+            } else {
+                js_result_row = Object::New();
+            }
+
+            for (uint32_t c = 0; c < hashJoin_req->column_count; c++) {
+                bool from_right = hashJoin_req->columns[c] & JOIN_RIGHT_COLUMN;
+                uint32_t f = hashJoin_req->columns[c] & ~JOIN_RIGHT_COLUMN;
+                MYSQL_FIELD &field = from_right ? right_fields[f] : left_fields[f];
+
+                if (from_right && right_row == JOIN_NO_ROW) {
+                    js_field = Local<Value>::New(Null());
+                } else {
+                    char *value = from_right ? hashJoin_req->right_rows.rows[right_row][f]
+                                             : hashJoin_req->left_rows.rows[left_row][f];
+                    unsigned long length = from_right
+                        ? hashJoin_req->right_rows.lengths[static_cast<size_t>(right_row) * right_num_fields + f]
+                        : hashJoin_req->left_rows.lengths[static_cast<size_t>(left_row) * left_num_fields + f];
+
+                    if ((field.type == MYSQL_TYPE_SET || (field.flags & SET_FLAG)) && value) {
+                        // GetFieldValue splits SET in place, row can be joined more than once,
+                        // libmysqlclient reports SET columns as MYSQL_TYPE_STRING with SET_FLAG
+                        char *scratch = new char[length + 1];
+                        memcpy(scratch, value, length);
+                        scratch[length] = '\0';
+                        js_field = GetFieldValue(field, scratch, length);
+                        delete[] scratch;
+                    } else {
+                        js_field = GetFieldValue(field, value, length);
+                    }
+                }
+
+                if (hashJoin_req->results_as_array) {
+                    js_result_row->Set(Integer::NewFromUnsigned(c), js_field);
+                } else {
+                    js_result_row->Set(V8STR(field.name), js_field);
+                }
+            }
+
+            js_result->Set(Integer::NewFromUnsigned(i), js_result_row);
+        }
+
+        argv[1] = js_result;
+        argv[0] = Local<Value>::New(Null());
+    }
+
+    node::MakeCallback(Context::GetCurrent()->Global(), hashJoin_req->callback, argc, argv);
+
+    hashJoin_req->callback.Dispose();
+
+    hashJoin_req->left->Unref();
+    hashJoin_req->right->Unref();
+
+    delete[] hashJoin_req->columns;
+    delete[] hashJoin_req->left_rows.rows;
+    delete[] hashJoin_req->left_rows.lengths;
+    delete[] hashJoin_req->right_rows.rows;
+    delete[] hashJoin_req->right_rows.lengths;
+    delete[] hashJoin_req->pairs;
+    delete hashJoin_req;
+
+    delete req;
+}
+
+void MysqlResult::EIO_HashJoin(uv_work_t *req) {
+    struct hashJoin_request *hashJoin_req = (struct hashJoin_request *)(req->data);
+
+    // Only rows collected by HashJoin() are read here, results can't be freed meanwhile
+    uint32_t left_num_fields = mysql_num_fields(hashJoin_req->left->_res);
+    uint32_t right_num_fields = mysql_num_fields(hashJoin_req->right->_res);
+
+    // Hash table is built on the smaller result and probed with the other one
+    bool build_left = hashJoin_req->left_rows.count < hashJoin_req->right_rows.count;
+    join_rows *build = build_left ? &hashJoin_req->left_rows : &hashJoin_req->right_rows;
+    join_rows *probe = build_left ? &hashJoin_req->right_rows : &hashJoin_req->left_rows;
+    uint32_t build_key = build_left ? hashJoin_req->left_key : hashJoin_req->right_key;
+    uint32_t probe_key = build_left ? hashJoin_req->right_key : hashJoin_req->left_key;
+    uint32_t build_num_fields = build_left ? left_num_fields : right_num_fields;
+    uint32_t probe_num_fields = build_left ? right_num_fields : left_num_fields;
+
+    uint32_t bucket_count = 16;
+    while (bucket_count < build->count * 2) {
+        bucket_count <<= 1;
+    }
+
+    uint32_t *buckets = new uint32_t[bucket_count];
+    uint32_t *chain = new uint32_t[build->count + 1];
+    uint32_t *hashes = new uint32_t[build->count + 1];
+    uint32_t i;
+
+    for (i = 0; i < bucket_count; i++) {
+        buckets[i] = JOIN_NO_ROW;
+    }
+
+    // Rows are inserted in reverse, so chains keep original order
+    for (i = build->count; i-- > 0; ) {
+        const char *key = build->rows[i][build_key];
+        unsigned long key_length = build->lengths[static_cast<size_t>(i) * build_num_fields + build_key];
+
+        // NULL never equals anything
+        if (!key) {
+            continue;
+        }
+
+        uint32_t hash = JoinKeyHash(key, key_length);
+
+        hashes[i] = hash;
+        chain[i] = buckets[hash & (bucket_count - 1)];
+        buckets[hash & (bucket_count - 1)] = i;
+    }
+
+    // Left rows without match are emitted after probe if left is the build side
+    bool *matched = NULL;
+    if (hashJoin_req->left_join && build_left) {
+        matched = new bool[build->count + 1];
+        memset(matched, 0, (build->count + 1) * sizeof(bool));
+    }
+
+    uint32_t pairs_capacity = 64;
+    hashJoin_req->pairs = new uint32_t[2 * pairs_capacity];
+    hashJoin_req->pair_count = 0;
+
+#define HASHJOIN_ADD_PAIR(left_row, right_row) \
+    if (hashJoin_req->pair_count == pairs_capacity) { \
+        uint32_t *grown = new uint32_t[4 * pairs_capacity]; \
+        memcpy(grown, hashJoin_req->pairs, 2 * pairs_capacity * sizeof(uint32_t)); \
+        delete[] hashJoin_req->pairs; \
+        hashJoin_req->pairs = grown; \
+        pairs_capacity *= 2; \
+    } \
+    hashJoin_req->pairs[2 * hashJoin_req->pair_count] = (left_row); \
+    hashJoin_req->pairs[2 * hashJoin_req->pair_count + 1] = (right_row); \
+    hashJoin_req->pair_count++;
+
+    for (i = 0; i < probe->count; i++) {
+        const char *key = probe->rows[i][probe_key];
+        unsigned long key_length = probe->lengths[static_cast<size_t>(i) * probe_num_fields + probe_key];
+        bool found = false;
+
+        if (key) {
+            uint32_t hash = JoinKeyHash(key, key_length);
+
+            for (uint32_t j = buckets[hash & (bucket_count - 1)]; j != JOIN_NO_ROW; j = chain[j]) {
+                unsigned long build_length = build->lengths[static_cast<size_t>(j) * build_num_fields + build_key];
+                if (hashes[j] != hash || build_length != key_length
+                    || memcmp(build->rows[j][build_key], key, key_length)) {
+                    continue;
+                }
+
+                found = true;
+                if (build_left) {
+                    if (matched) {
+                        matched[j] = true;
+                    }
+                    HASHJOIN_ADD_PAIR(j, i);
+                } else {
+                    HASHJOIN_ADD_PAIR(i, j);
+                }
+            }
+        }
+
+        if (!found && hashJoin_req->left_join && !build_left) {
+            HASHJOIN_ADD_PAIR(i, JOIN_NO_ROW);
+        }
+    }
+
+    if (matched) {
+        for (i = 0; i < build->count; i++) {
+            if (!matched[i]) {
+                HASHJOIN_ADD_PAIR(i, JOIN_NO_ROW);
+            }
+        }
+        delete[] matched;
+    }
+
+#undef HASHJOIN_ADD_PAIR
+
+    delete[] buckets;
+    delete[] chain;
+    delete[] hashes;
+}
+
+/**
+ * MysqlResult#hashJoin(right, options, callback)
+ * - right (MysqlResult): Stored result to join with
+ * - options (Object): `leftKey` and `rightKey` columns, join `type` "inner" (default) or "left",
+ *   `columns` array of output column names, "left." or "right." prefix picks the result,
+ *   by default all left columns and right columns with other names, `asArray`
+ * - callback (Function): Callback function, gets (error, rows)
+ *
+ * Joins this result with other one by equality of key columns,
+ * e.g. results from different servers. Hash table is built on the smaller result
+ * and probed with the other one in the threadpool, only joined rows
+ * are converted to JS values. Keys are compared as text, NULL keys never match.
+ * Until callback is called, methods of both results moving row cursor
+ * and freeSync() throw
+ **/
+Handle<Value> MysqlResult::HashJoin(const Arguments& args) {
+    HandleScope scope;
+
+    REQ_OBJ_ARG(0, js_right);
+    REQ_OBJ_ARG(1, js_options);
+    REQ_FUN_ARG(2, callback);
+
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
+
+    MYSQLRES_MUSTBE_VALID;
+
+    if (!MysqlResult::constructor_template->HasInstance(js_right)) {
+        return THRTYPEEXC("Argument 0 must be a MysqlResult");
+    }
+    MysqlResult *right = OBJUNWRAP<MysqlResult>(js_right);
+    if (!right->_res) {
+        return THREXC("Result has been freed.");
+    }
+    if (mysql_result_is_unbuffered(res->_res) || mysql_result_is_unbuffered(right->_res)) {
+        return THREXC("Function cannot be used with MYSQL_USE_RESULT");
+    }
+    if (mysql_num_rows(res->_res) >= JOIN_NO_ROW || mysql_num_rows(right->_res) >= JOIN_NO_ROW) {
+        return THREXC("Result is too large to join");
+    }
+
+    MYSQL_FIELD *left_fields = mysql_fetch_fields(res->_res);
+    MYSQL_FIELD *right_fields = mysql_fetch_fields(right->_res);
+    uint32_t left_num_fields = mysql_num_fields(res->_res);
+    uint32_t right_num_fields = mysql_num_fields(right->_res);
+    uint32_t j;
+
+    String::Utf8Value left_key(js_options->Get(V8STR("leftKey"))->ToString());
+    for (j = 0; j < left_num_fields && strcmp(left_fields[j].name, *left_key); j++) {}
+    if (j == left_num_fields) {
+        return THREXC("Column from 'leftKey' option is not found in result");
+    }
+    uint32_t left_key_field = j;
+
+    String::Utf8Value right_key(js_options->Get(V8STR("rightKey"))->ToString());
+    for (j = 0; j < right_num_fields && strcmp(right_fields[j].name, *right_key); j++) {}
+    if (j == right_num_fields) {
+        return THREXC("Column from 'rightKey' option is not found in result");
+    }
+    uint32_t right_key_field = j;
+
+    bool left_join = false;
+    Local<Value> js_type = js_options->Get(V8STR("type"));
+    if (!js_type->IsUndefined()) {
+        String::Utf8Value type(js_type->ToString());
+        if (!strcmp(*type, "left")) {
+            left_join = true;
+        } else if (strcmp(*type, "inner")) {
+            return THRTYPEEXC("Option type must be 'inner' or 'left'");
+        }
+    }
+
+    uint32_t *columns;
+    uint32_t column_count = 0;
+    Local<Value> js_columns = js_options->Get(V8STR("columns"));
+
+    if (js_columns->IsArray()) {
+        Local<Array> js_columns_array = Local<Array>::Cast(js_columns);
+        columns = new uint32_t[js_columns_array->Length() + 1];
+
+        for (column_count = 0; column_count < js_columns_array->Length(); column_count++) {
+            String::Utf8Value column(js_columns_array->Get(column_count)->ToString());
+            const char *name = *column;
+            bool search_left = true, search_right = true;
+
+            if (!strncmp(name, "left.", 5)) {
+                name += 5;
+                search_right = false;
+            } else if (!strncmp(name, "right.", 6)) {
+                name += 6;
+                search_left = false;
+            }
+
+            for (j = 0; search_left && j < left_num_fields && strcmp(left_fields[j].name, name); j++) {}
+            if (search_left && j < left_num_fields) {
+                columns[column_count] = j;
+                continue;
+            }
+            for (j = 0; search_right && j < right_num_fields && strcmp(right_fields[j].name, name); j++) {}
+            if (search_right && j < right_num_fields) {
+                columns[column_count] = j | JOIN_RIGHT_COLUMN;
+                continue;
+            }
+
+            delete[] columns;
+            return THREXC("Column from 'columns' option is not found in results");
+        }
+    } else if (js_columns->IsUndefined()) {
+        columns = new uint32_t[left_num_fields + right_num_fields + 1];
+
+        for (j = 0; j < left_num_fields; j++) {
+            columns[column_count++] = j;
+        }
+        for (j = 0; j < right_num_fields; j++) {
+            uint32_t k;
+            for (k = 0; k < left_num_fields && strcmp(left_fields[k].name, right_fields[j].name); k++) {}
+            if (k == left_num_fields) {
+                columns[column_count++] = j | JOIN_RIGHT_COLUMN;
+            }
+        }
+    } else {
+        return THRTYPEEXC("Option columns must be an array");
+    }
+
+    hashJoin_request *hashJoin_req = new hashJoin_request;
+
+    hashJoin_req->callback = Persistent<Function>::New(callback);
+    hashJoin_req->left = res;
+    hashJoin_req->right = right;
+    hashJoin_req->left_key = left_key_field;
+    hashJoin_req->right_key = right_key_field;
+    hashJoin_req->left_join = left_join;
+    hashJoin_req->results_as_array = js_options->Get(V8STR("asArray"))->BooleanValue();
+    hashJoin_req->columns = columns;
+    hashJoin_req->column_count = column_count;
+    hashJoin_req->pairs = NULL;
+    hashJoin_req->pair_count = 0;
+
+    CollectJoinRows(res->_res, &hashJoin_req->left_rows);
+    CollectJoinRows(right->_res, &hashJoin_req->right_rows);
+
+    // Rows are read in the threadpool, so results can't be freed until callback
+    res->Ref();
+    right->Ref();
+    res->busy++;
+    right->busy++;
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = hashJoin_req;
+    uv_queue_work(uv_default_loop(), _req, EIO_HashJoin, (uv_after_work_cb)EIO_After_HashJoin);
+
+    return Undefined();
+}
+
+/*!
+ * Checks that CompareFieldValues() orders values of field as the server does:
+ * numbers, dates and strings of binary collations. Non-binary collations,
+ * ENUM and SET (sorted by index) and TIME (may be negative or over 99 hours)
+ * are sorted by the server in order it can't reproduce
+ */
+bool MysqlResult::IsMergeableField(const MYSQL_FIELD &field) {
+    switch (field.type) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_YEAR:
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_NEWDATE:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP:
+            return true;
+        case MYSQL_TYPE_VARCHAR:
+        case MYSQL_TYPE_VAR_STRING:
+        case MYSQL_TYPE_STRING:
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB:
+            return !(field.flags & (ENUM_FLAG | SET_FLAG)) && (field.flags & BINARY_FLAG);
+        default:
+            return false;
+    }
+}
+
+/*!
+ * Compares text protocol values the way ORDER BY does for numbers and dates,
+ * strings are compared bytewise, trailing spaces are ignored for
+ * PAD SPACE *_bin collations. NULL is less than any value.
+ * Field must be accepted by IsMergeableField()
+ */
+int MysqlResult::CompareFieldValues(const MYSQL_FIELD &field,
+                                    const char *a, unsigned long a_length,
+                                    const char *b, unsigned long b_length) {
+    if (!a || !b) {
+        return (a ? 1 : 0) - (b ? 1 : 0);
+    }
+
+    switch (field.type) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_YEAR:
+        case MYSQL_TYPE_LONGLONG:
+            if (field.flags & UNSIGNED_FLAG) {
+                unsigned long long a_value = strtoull(a, NULL, 10), b_value = strtoull(b, NULL, 10); // NOLINT
+                return a_value < b_value ? -1 : (a_value > b_value ? 1 : 0);
+            } else {
+                long long a_value = strtoll(a, NULL, 10), b_value = strtoll(b, NULL, 10); // NOLINT
+                return a_value < b_value ? -1 : (a_value > b_value ? 1 : 0);
+            }
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE: {
+            double a_value = strtod(a, NULL), b_value = strtod(b, NULL);
+            return a_value < b_value ? -1 : (a_value > b_value ? 1 : 0);
+        }
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            // Exceeds double precision, text protocol values are NUL-terminated
+            return MysqlAggregator::CompareDecimalText(a, b);
+        default: {
+            // Dates are zero-padded, so bytewise order is right for them
+            if (field.charsetnr != 63) {
+                while (a_length > 0 && a[a_length - 1] == ' ') {
+                    a_length--;
+                }
+                while (b_length > 0 && b[b_length - 1] == ' ') {
+                    b_length--;
+                }
+            }
+
+            int r = memcmp(a, b, a_length < b_length ? a_length : b_length);
+            if (r != 0) {
+                return r;
+            }
+            return a_length < b_length ? -1 : (a_length > b_length ? 1 : 0);
+        }
+    }
+}
+
+/*!
+ * Order of merge sources by their current rows, ties are broken by source index
+ */
+bool MysqlResult::MergeSourceLess(const merge_source &a, const merge_source &b,
+                                  MYSQL_FIELD *fields, const merge_key *keys, uint32_t key_count) {
+    for (uint32_t k = 0; k < key_count; k++) {
+        uint32_t f = keys[k].field;
+        int r = CompareFieldValues(fields[f], a.row[f], a.lengths[f], b.row[f], b.lengths[f]);
+        if (r != 0) {
+            return keys[k].desc ? r > 0 : r < 0;
+        }
+    }
+
+    return a.index < b.index;
+}
+
+/**
+ * MysqlResult#mergeSortedSync(results[, options]) -> Array
+ * - results (Array): Other results with the same columns
+ * - options (Object): `orderBy` is array of {column, desc} the results are sorted by,
+ *   `limit` is number of rows to return, `asArray` returns rows as arrays
+ *
+ * Merges this and other sorted results, e.g. of one query on many shards,
+ * with k-way merge over stored rows. Only rows within limit are converted
+ * to JS values. Without `orderBy` results are concatenated.
+ * Columns of `orderBy` must be numbers, dates or strings of binary collation,
+ * other values are sorted by server collation rules not known here
+ **/
+Handle<Value> MysqlResult::MergeSortedSync(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlResult *res = OBJUNWRAP<MysqlResult>(args.Holder());
+
+    MYSQLRES_MUSTBE_VALID;
+    MYSQLRES_MUSTNOT_BE_BUSY;
+
+    if (args.Length() < 1 || !args[0]->IsArray()) {
+        return THRTYPEEXC("Argument 0 must be an array of results");
+    }
+    Local<Array> js_results = Local<Array>::Cast(args[0]);
+
+    Local<Object> js_options = Object::New();
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        js_options = args[1]->ToObject();
+    } else if (args.Length() > 1 && !args[1]->IsUndefined()) {
+        return THRTYPEEXC("Argument 1 must be an object");
+    }
+
+    MYSQL_FIELD *fields = mysql_fetch_fields(res->_res);
+    uint32_t num_fields = mysql_num_fields(res->_res);
+    uint32_t source_count = js_results->Length() + 1;
+    uint32_t i, j;
+
+    for (i = 0; i < source_count - 1; i++) {
+        Local<Value> js_other = js_results->Get(i);
+        if (!MysqlResult::constructor_template->HasInstance(js_other)) {
+            return THRTYPEEXC("Results array must contain only MysqlResult objects");
+        }
+        MysqlResult *other = OBJUNWRAP<MysqlResult>(js_other->ToObject());
+        if (!other->_res) {
+            return THREXC("Result has been freed.");
+        }
+        if (other->busy) {
+            return THREXC("Result is used by pending asynchronous operation");
+        }
+        if (mysql_result_is_unbuffered(other->_res) || mysql_num_fields(other->_res) != num_fields) {
+            return THREXC("Results must be stored and have the same columns");
+        }
+    }
+
+    uint64_t limit = ~static_cast<uint64_t>(0);
+    Local<Value> js_limit = js_options->Get(V8STR("limit"));
+    if (js_limit->IsUint32()) {
+        limit = js_limit->Uint32Value();
+    } else if (!js_limit->IsUndefined()) {
+        return THRTYPEEXC("Option limit must be a positive integer");
+    }
+
+    bool results_as_array = js_options->Get(V8STR("asArray"))->BooleanValue();
+
+    uint32_t key_count = 0;
+    merge_key *keys = NULL;
+    Local<Value> js_order_by = js_options->Get(V8STR("orderBy"));
+    if (js_order_by->IsArray()) {
+        Local<Array> js_keys = Local<Array>::Cast(js_order_by);
+        keys = new merge_key[js_keys->Length() + 1];
+
+        for (key_count = 0; key_count < js_keys->Length(); key_count++) {
+            Local<Object> js_key = js_keys->Get(key_count)->ToObject();
+            String::Utf8Value column(js_key->Get(V8STR("column"))->ToString());
+
+            for (j = 0; j < num_fields; j++) {
+                if (!strcmp(fields[j].name, *column)) {
+                    break;
+                }
+            }
+            if (j == num_fields) {
+                delete[] keys;
+                return THREXC("Column from 'orderBy' option is not found in result");
+            }
+            if (!IsMergeableField(fields[j])) {
+                delete[] keys;
+                return THREXC("Column from 'orderBy' option must be numeric, date or binary string");
+            }
+
+            keys[key_count].field = j;
+            keys[key_count].desc = js_key->Get(V8STR("desc"))->BooleanValue();
+        }
+    } else if (!js_order_by->IsUndefined()) {
+        return THRTYPEEXC("Option orderBy must be an array");
+    }
+
+    // Binary min-heap of sources having current row
+    merge_source *heap = new merge_source[source_count];
+    uint32_t heap_size = 0;
+
+    for (i = 0; i < source_count; i++) {
+        MYSQL_RES *my_result = i == 0 ? res->_res : OBJUNWRAP<MysqlResult>(js_results->Get(i - 1)->ToObject())->_res;
+        merge_source source = {my_result, mysql_fetch_row(my_result), NULL, i};
+        if (!source.row) {
+            continue;
+        }
+        source.lengths = mysql_fetch_lengths(my_result);
+
+        // Sift up
+        j = heap_size++;
+        while (j > 0 && MergeSourceLess(source, heap[(j - 1) / 2], fields, keys, key_count)) {
+            heap[j] = heap[(j - 1) / 2];
+            j = (j - 1) / 2;
+        }
+        heap[j] = source;
+    }
+
+    Local<Array> js_result = Array::New();
+    Local<Object> js_result_row;
+    uint32_t rows = 0;
+
+    while (heap_size > 0 && rows < limit) {
+        merge_source top = heap[0];
+
+        if (results_as_array) {
+            js_result_row = Array::New();
+        } else {
+            js_result_row = Object::New();
+        }
+        for (j = 0; j < num_fields; j++) {
+            Local<Value> js_field = GetFieldValue(fields[j], top.row[j], top.lengths[j]);
+            if (results_as_array) {
+                js_result_row->Set(Integer::NewFromUnsigned(j), js_field);
+            } else {
+                js_result_row->Set(V8STR(fields[j].name), js_field);
+            }
+        }
+        js_result->Set(Integer::NewFromUnsigned(rows++), js_result_row);
+
+        top.row = mysql_fetch_row(top.my_result);
+        if (top.row) {
+            top.lengths = mysql_fetch_lengths(top.my_result);
+        } else {
+            top = heap[--heap_size];
+        }
+
+        // Sift down
+        j = 0;
+        while (heap_size > 0) {
+            uint32_t child = 2 * j + 1;
+            if (child >= heap_size) {
+                break;
+            }
+            if (child + 1 < heap_size && MergeSourceLess(heap[child + 1], heap[child], fields, keys, key_count)) {
+                child++;
+            }
+            if (!MergeSourceLess(heap[child], top, fields, keys, key_count)) {
+                break;
+            }
+            heap[j] = heap[child];
+            j = child;
+        }
+        if (heap_size > 0) {
+            heap[j] = top;
+        }
+    }
+
+    delete[] heap;
+    delete[] keys;
+
+    return scope.Close(js_result);
+}
+
 /**
  * MysqlResult#numRowsSync() -> Integer
  *
@@ -15,6 +15,7 @@
 #include <node_version.h>
 #include <node_buffer.h>
 
+#include <cstdlib>
 #include <cstring>
 
 #include "./mysql_bindings.h"
@@ -27,6 +28,11 @@
         return THREXC("Result has been freed."); \
     }
 
+#define MYSQLRES_MUSTNOT_BE_BUSY \
+    if (res->busy) { \
+        return THREXC("Result is used by pending asynchronous operation"); \
+    }
+
 /** section: Classes
  * class MysqlResult
  *
@@ -48,6 +54,45 @@ class MysqlResult : public node::ObjectWrap {
     };
     static fetch_options GetFetchOptions(Local<Object> options);
 
+    /*!
+     * Column projection and row predicates of fetch options,
+     * applied before any V8 value of a row is created
+     */
+    enum predicate_op {
+        PREDICATE_EQ,
+        PREDICATE_IS_NULL,
+        PREDICATE_LT,
+        PREDICATE_LTE,
+        PREDICATE_GT,
+        PREDICATE_GTE
+    };
+    enum predicate_number {
+        PREDICATE_NUMBER_SIGNED,
+        PREDICATE_NUMBER_UNSIGNED,
+        PREDICATE_NUMBER_REAL
+    };
+    struct fetch_predicate {
+        uint32_t field;
+        predicate_op op;
+        // Compared bytewise if set, otherwise cell is compared as number
+        char *value;
+        unsigned long value_length;
+        double number;
+        // How numeric column is parsed, integers are compared exactly
+        predicate_number number_type;
+    };
+    struct fetch_filter {
+        // Output fields, all fields if NULL
+        uint32_t *columns;
+        uint32_t column_count;
+        fetch_predicate *predicates;
+        uint32_t predicate_count;
+    };
+    static const char *BuildFetchFilter(Local<Object> options, MYSQL_RES *my_result, fetch_filter *filter);
+    static bool RowMatches(const fetch_filter *filter, MYSQL_ROW row, unsigned long *lengths);
+    static int CompareNumberCell(const fetch_predicate *predicate, const char *cell);
+    static void FreeFetchFilter(fetch_filter *filter);
+
     void Free();
 
   protected:
@@ -56,13 +101,17 @@ class MysqlResult : public node::ObjectWrap {
 
     uint32_t field_count;
 
+    // Number of pending asynchronous operations reading rows of the result
+    uint32_t busy;
+
     MysqlResult();
 
     explicit MysqlResult(MYSQL *my_connection, MYSQL_RES *my_result, uint32_t my_field_count):
         ObjectWrap(),
         _conn(my_connection),
         _res(my_result),
-        field_count(my_field_count) {}
+        field_count(my_field_count),
+        busy(0) {}
 
     ~MysqlResult();
 
@@ -88,7 +137,22 @@ class MysqlResult : public node::ObjectWrap {
         uint32_t num_fields;
 
         fetch_options fo;
+        fetch_filter filter;
+
+        // Time-sliced conversion, see MysqlResult::FetchAllSlice
+        uint32_t slice_ms;
+        Persistent<Function> on_chunk;
+        Persistent<Array> rows;
+        uint32_t rows_count;
+        my_ulonglong fetched;
+        uv_check_t *check;
+        uv_idle_t *idle;
     };
+    static bool FetchAllSlice(fetchAll_request *fetchAll_req);
+    static void FetchAllDone(fetchAll_request *fetchAll_req);
+    static void EV_FetchAllSlice(NODE_ADDON_SHIM_CHECK_CALLBACK_ARGUMENTS);
+    static void EV_FetchAllIdle(NODE_ADDON_SHIM_IDLE_CALLBACK_ARGUMENTS);
+    static void EV_FetchAllSlice_OnClose(uv_handle_t *handle);
     static void EIO_After_FetchAll(uv_work_t *req);
     static void EIO_FetchAll(uv_work_t *req);
     static Handle<Value> FetchAll(const Arguments& args);
@@ -111,6 +175,59 @@ class MysqlResult : public node::ObjectWrap {
 
     static Handle<Value> FreeSync(const Arguments& args);
 
+    struct join_rows {
+        MYSQL_ROW *rows;
+        // num_fields lengths for every row
+        unsigned long *lengths;
+        uint32_t count;
+    };
+    struct hashJoin_request {
+        Persistent<Function> callback;
+        MysqlResult *left;
+        MysqlResult *right;
+
+        uint32_t left_key;
+        uint32_t right_key;
+        bool left_join;
+        bool results_as_array;
+
+        // Output columns, JOIN_RIGHT_COLUMN bit marks column of right result
+        uint32_t *columns;
+        uint32_t column_count;
+
+        join_rows left_rows;
+        join_rows right_rows;
+
+        // Pairs of left and right row numbers, JOIN_NO_ROW for missing right row
+        uint32_t *pairs;
+        uint32_t pair_count;
+    };
+    static const uint32_t JOIN_RIGHT_COLUMN = 0x80000000;
+    static const uint32_t JOIN_NO_ROW = 0xFFFFFFFF;
+    static void CollectJoinRows(MYSQL_RES *my_result, join_rows *rows);
+    static uint32_t JoinKeyHash(const char *key, unsigned long key_length);
+    static void EIO_After_HashJoin(uv_work_t *req);
+    static void EIO_HashJoin(uv_work_t *req);
+    static Handle<Value> HashJoin(const Arguments& args);
+
+    struct merge_key {
+        uint32_t field;
+        bool desc;
+    };
+    struct merge_source {
+        MYSQL_RES *my_result;
+        MYSQL_ROW row;
+        unsigned long *lengths;
+        uint32_t index;
+    };
+    static bool IsMergeableField(const MYSQL_FIELD &field);
+    static int CompareFieldValues(const MYSQL_FIELD &field,
+                                  const char *a, unsigned long a_length,
+                                  const char *b, unsigned long b_length);
+    static bool MergeSourceLess(const merge_source &a, const merge_source &b,
+                                MYSQL_FIELD *fields, const merge_key *keys, uint32_t key_count);
+    static Handle<Value> MergeSortedSync(const Arguments& args);
+
     static Handle<Value> NumRowsSync(const Arguments& args);
 };
 
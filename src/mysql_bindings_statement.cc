@@ -46,6 +46,7 @@ void MysqlStatement::Init(Handle<Object> target) {
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "dataSeekSync",       MysqlStatement::DataSeekSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "errnoSync",          MysqlStatement::ErrnoSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "errorSync",          MysqlStatement::ErrorSync);
+    NODE_SET_PROTOTYPE_METHOD(constructor_template, "executeBatch",       MysqlStatement::ExecuteBatch);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "executeSync",        MysqlStatement::ExecuteSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "fetchAllSync",       MysqlStatement::FetchAllSync);
     NODE_SET_PROTOTYPE_METHOD(constructor_template, "fieldCountSync",     MysqlStatement::FieldCountSync);
@@ -67,38 +68,95 @@ void MysqlStatement::Init(Handle<Object> target) {
 MysqlStatement::MysqlStatement(MYSQL_STMT *my_stmt): ObjectWrap() {
     this->_stmt = my_stmt;
     this->binds = NULL;
+    this->params = NULL;
     this->param_count = 0;
+    this->params_bound = false;
+    this->conn = NULL;
+    this->executing_batch = false;
     this->prepared = false;
     this->stored = false;
 }
 
 MysqlStatement::~MysqlStatement() {
     if (this->_stmt) {
-        if (this->prepared) {
-            for (uint64_t i = 0; i < this->param_count; i++) {
-                if (this->binds[i].buffer_type == MYSQL_TYPE_LONG) {
-                    if (this->binds[i].is_unsigned) {
-                        delete static_cast<unsigned int *>(this->binds[i].buffer); // NOLINT
-                    } else {
-                        delete static_cast<int *>(this->binds[i].buffer);
-                    }
-                } else if (this->binds[i].buffer_type == MYSQL_TYPE_DOUBLE) {
-                    delete static_cast<double *>(this->binds[i].buffer);
-                } else if (this->binds[i].buffer_type == MYSQL_TYPE_STRING) {
-                    // TODO(Sannis): Or delete?
-                    delete[] static_cast<char *>(this->binds[i].buffer);
-                    delete static_cast<unsigned long *>(this->binds[i].length); // NOLINT
-                } else if (this->binds[i].buffer_type == MYSQL_TYPE_DATETIME) {
-                    delete static_cast<MYSQL_TIME *>(this->binds[i].buffer);
-                } else {
-                    printf("MysqlStatement::~MysqlStatement: o_0\n");
-                }
-            }
-            delete[] this->binds;
-        }
         mysql_stmt_free_result(this->_stmt);
         mysql_stmt_close(this->_stmt);
     }
+
+    this->FreeParams();
+
+    this->js_conn.Dispose();
+}
+
+/*!
+ * Frees bind arena
+ */
+void MysqlStatement::FreeParams() {
+    for (uint64_t i = 0; i < this->param_count && this->params; i++) {
+        delete[] this->params[i].string_buffer;
+        this->params[i].buffer.Dispose();
+    }
+
+    delete[] this->params;
+    delete[] this->binds;
+    this->params = NULL;
+    this->binds = NULL;
+    this->param_count = 0;
+    this->params_bound = false;
+}
+
+/*!
+ * Binds null, number, boolean or Date parameter to value in data,
+ * returns error message or NULL. Strings and Buffers are left to caller,
+ * buffer_type of bind is MYSQL_TYPE_STRING for them
+ */
+const char *MysqlStatement::BindScalarParam(Handle<Value> js_param, MYSQL_BIND *bind, param_scalar *data) {
+    bind->is_null = 0;
+    bind->is_unsigned = false;
+    bind->length = NULL;
+
+    if (js_param->IsUndefined()) {
+        return "All arguments must be defined";
+    }
+
+    if (js_param->IsNull()) {
+        bind->buffer_type = MYSQL_TYPE_NULL;
+        bind->buffer = NULL;
+    } else if (js_param->IsInt32()) {
+        data->int_value = js_param->Int32Value();
+
+        bind->buffer_type = MYSQL_TYPE_LONG;
+        bind->buffer = &data->int_value;
+    } else if (js_param->IsBoolean()) {
+        // I assume, booleans are usually stored as TINYINT(1)
+        data->tiny_value = js_param->BooleanValue() ? 1 : 0;
+
+        bind->buffer_type = MYSQL_TYPE_TINY;
+        bind->buffer = &data->tiny_value;
+    } else if (js_param->IsUint32()) {
+        data->uint_value = js_param->Uint32Value();
+
+        bind->buffer_type = MYSQL_TYPE_LONG;
+        bind->buffer = &data->uint_value;
+        bind->is_unsigned = true;
+    } else if (js_param->IsNumber()) {
+        data->double_value = js_param->NumberValue();
+
+        bind->buffer_type = MYSQL_TYPE_DOUBLE;
+        bind->buffer = &data->double_value;
+    } else if (js_param->IsDate()) {
+        if (!MysqlBatch::DateToMysqlTime(js_param->NumberValue(), &data->time_value)) {
+            return "Error occured in gmtime_r()";
+        }
+
+        bind->buffer_type = MYSQL_TYPE_DATETIME;
+        bind->buffer = &data->time_value;
+    } else {
+        bind->buffer_type = MYSQL_TYPE_STRING;
+        bind->buffer = NULL;
+    }
+
+    return NULL;
 }
 
 /**
@@ -114,6 +172,11 @@ Handle<Value> MysqlStatement::New(const Arguments& args) {
     MysqlStatement *binding_stmt = new MysqlStatement(my_stmt);
     binding_stmt->Wrap(args.Holder());
 
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        binding_stmt->conn = OBJUNWRAP<MysqlConnection>(args[1]->ToObject());
+        binding_stmt->js_conn = Persistent<Object>::New(args[1]->ToObject());
+    }
+
     return args.Holder();
 }
 
@@ -252,6 +315,7 @@ Handle<Value> MysqlStatement::BindParamsSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
 
     REQ_ARRAY_ARG(0, js_params);
@@ -259,105 +323,75 @@ Handle<Value> MysqlStatement::BindParamsSync(const Arguments& args) {
     uint32_t i = 0;
     Local<Value> js_param;
 
-    // For debug
-    /*String::Utf8Value *str;
-    for (i = 0; i < js_params->Length(); i++) {
-        str = new String::Utf8Value(js_params->Get(Integer::New(i))->ToString());
-        printf("%d: %s\n", i, **str);
-    }*/
-
     if (js_params->Length() != stmt->param_count) {
         return THREXC("Array length doesn't match number of parameters in prepared statement"); // NOLINT
     }
 
-    int *int_data;
-    unsigned int *uint_data;
-    double *double_data;
-    unsigned long *str_length; // NOLINT
-    char *str_data;
-    time_t date_timet;
-    struct tm date_timeinfo;
-    MYSQL_TIME *date_data;
+    // All params are checked before any of them is changed,
+    // libmysqlclient keeps pointers into previously bound ones
+    for (i = 0; i < js_params->Length(); i++) {
+        MYSQL_BIND scratch_bind;
+        param_scalar scratch_data;
+
+        const char *error = BindScalarParam(js_params->Get(i), &scratch_bind, &scratch_data);
+        if (error) {
+            return THREXC(error);
+        }
+    }
 
     for (i = 0; i < js_params->Length(); i++) {
         js_param = js_params->Get(i);
 
-        if (js_param->IsUndefined()) {
-            return THREXC("All arguments must be defined");
+        MYSQL_BIND *bind = &stmt->binds[i];
+        param_value *param = &stmt->params[i];
+
+        // Previously bound Buffer is not needed anymore
+        if (!param->buffer.IsEmpty()) {
+            param->buffer.Dispose();
+            param->buffer.Clear();
+        }
+
+        const char *error = BindScalarParam(js_param, bind, &param->data);
+        if (error) {
+            // Getter of params array returned other value, binds are half-updated
+            stmt->params_bound = false;
+            return THREXC(error);
         }
 
-        if (js_param->IsNull()) {
-            int_data = new int;
-            *int_data = 0;
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_NULL;
-            stmt->binds[i].buffer = int_data;
-            // TODO(Sannis): Fix this error
-            stmt->binds[i].is_null = 0;
-        } else if (js_param->IsInt32()) {
-            int_data = new int;
-            *int_data = js_param->Int32Value();
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_LONG;
-            stmt->binds[i].buffer = int_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].is_unsigned = false;
-        } else if (js_param->IsBoolean()) {
-            // I assume, booleans are usually stored as TINYINT(1)
-            int_data = new int;
-            *int_data = js_param->Int32Value();
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_TINY;
-            stmt->binds[i].buffer = int_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].is_unsigned = false;
-        } else if (js_param->IsUint32()) {
-            uint_data = new unsigned int;
-            *uint_data = js_param->Uint32Value();
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_LONG;
-            stmt->binds[i].buffer = uint_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].is_unsigned = true;
-        } else if (js_param->IsNumber()) {
-            double_data = new double;
-            *double_data = js_param->NumberValue();
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_DOUBLE;
-            stmt->binds[i].buffer = double_data;
-            stmt->binds[i].is_null = 0;
-        } else if (js_param->IsDate()) {
-            date_data = new MYSQL_TIME;
-            date_timet = static_cast<time_t>(js_param->NumberValue()/1000);
-            if (!gmtime_r(&date_timet, &date_timeinfo)) {
-                return THREXC("Error occured in gmtime_r()");
+        if (bind->buffer_type == MYSQL_TYPE_STRING && node::Buffer::HasInstance(js_param)) {
+            // Bound without copy, Buffer is referenced while it is bound
+            Local<Object> js_buffer = js_param->ToObject();
+            param->buffer = Persistent<Object>::New(js_buffer);
+            param->length = node::Buffer::Length(js_buffer);
+
+            bind->buffer_type = MYSQL_TYPE_BLOB;
+            bind->buffer = node::Buffer::Data(js_buffer);
+            bind->buffer_length = param->length;
+            bind->length = &param->length;
+        } else if (bind->buffer_type == MYSQL_TYPE_STRING) {  // js_param->IsString() and other
+            Local<String> js_string = js_param->ToString();
+            size_t string_len = js_string->Utf8Length();
+
+            if (string_len + 1 > param->string_capacity) {
+                delete[] param->string_buffer;
+                param->string_capacity = string_len + 1 > 64 ? (string_len + 1) * 2 : 64;
+                param->string_buffer = new char[param->string_capacity];
             }
-            date_data->year = date_timeinfo.tm_year + 1900;
-            date_data->month = date_timeinfo.tm_mon + 1;
-            date_data->day = date_timeinfo.tm_mday;
-            date_data->hour = date_timeinfo.tm_hour;
-            date_data->minute = date_timeinfo.tm_min;
-            date_data->second = date_timeinfo.tm_sec;
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_DATETIME;
-            stmt->binds[i].buffer = date_data;
-            stmt->binds[i].is_null = 0;
-        } else {  // js_param->IsString() and other
-            // TODO(Sannis): Simplify this if possible
-            str_data = strdup(**(new String::Utf8Value(js_param->ToString())));
-            str_length = new unsigned long; // NOLINT
-            *str_length = js_param->ToString()->Length();
-
-            stmt->binds[i].buffer_type = MYSQL_TYPE_STRING;
-            stmt->binds[i].buffer =  str_data;
-            stmt->binds[i].is_null = 0;
-            stmt->binds[i].length = str_length;
+            js_string->WriteUtf8(param->string_buffer, param->string_capacity);
+            param->length = string_len;
+
+            bind->buffer_type = MYSQL_TYPE_STRING;
+            bind->buffer = param->string_buffer;
+            bind->buffer_length = param->string_capacity;
+            bind->length = &param->length;
         }
     }
 
     if (mysql_stmt_bind_param(stmt->_stmt, stmt->binds)) {
+      stmt->params_bound = false;
       return scope.Close(False());
     }
+    stmt->params_bound = true;
 
     return scope.Close(True());
 }
@@ -373,6 +407,7 @@ Handle<Value> MysqlStatement::CloseSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
 
     if (mysql_stmt_close(stmt->_stmt)) {
         return scope.Close(False());
@@ -394,6 +429,7 @@ Handle<Value> MysqlStatement::DataSeekSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
     MYSQLSTMT_MUSTBE_STORED;
 
@@ -443,6 +479,355 @@ Handle<Value> MysqlStatement::ErrorSync(const Arguments& args) {
     return scope.Close(V8STR(error));
 }
 
+/*!
+ * Records failed execution, error message is copied
+ */
+void MysqlStatement::AddBatchError(executeBatch_request *batch_req, uint32_t index,
+                                   unsigned int errno, const char *error) {
+    if (batch_req->errors_count == batch_req->errors_capacity) {
+        batch_req->errors_capacity = batch_req->errors_capacity ? batch_req->errors_capacity * 2 : 16;
+        batch_error *grown = new batch_error[batch_req->errors_capacity];
+
+        if (batch_req->errors_count) {
+            memcpy(grown, batch_req->errors, batch_req->errors_count * sizeof(batch_error));
+        }
+        delete[] batch_req->errors;
+        batch_req->errors = grown;
+    }
+
+    batch_error *added = &batch_req->errors[batch_req->errors_count++];
+    size_t error_len = strlen(error);
+    added->index = index;
+    added->errno = errno;
+    added->error = new char[error_len + 1];
+    memcpy(added->error, error, error_len + 1);
+}
+
+void MysqlStatement::FreeBatch(executeBatch_request *batch_req) {
+    for (uint32_t i = 0; i < batch_req->errors_count; i++) {
+        delete[] batch_req->errors[i].error;
+    }
+    delete[] batch_req->errors;
+    delete batch_req->batch;
+
+    batch_req->callback.Dispose();
+
+    delete batch_req;
+}
+
+/*!
+ * EIO wrapper functions for MysqlStatement::ExecuteBatch
+ */
+void MysqlStatement::EIO_After_ExecuteBatch(uv_work_t *req) {
+    HandleScope scope;
+
+    struct executeBatch_request *batch_req = (struct executeBatch_request *)(req->data);
+
+    int argc = 1; // node.js convention, there is always at least one argument for callback
+    Local<Value> argv[2];
+
+    if (batch_req->connection_closed) {
+        argv[0] = V8EXC("Connection is closed by closeSync() during query");
+    } else if (batch_req->overloaded) {
+        argv[0] = MysqlConnection::OverloadException("Query waited in queue longer than maxQueueWaitMs");
+    } else if (batch_req->transaction_open) {
+        argv[0] = V8EXC("Connection has open transaction, batch with transaction option would commit it");
+    } else if (batch_req->rollback_failed) {
+        unsigned int error_string_length = strlen(batch_req->error) + 80;
+        char* error_string = new char[error_string_length];
+        snprintf(error_string, error_string_length,
+                 "Execute batch error at row %u, rollback error #%d: %s",
+                 batch_req->errors[0].index, batch_req->errno, batch_req->error);
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else if (!batch_req->ok || (batch_req->transaction && batch_req->errors_count)) {
+        // Failed execution stops transactional batch, it is rolled back
+        batch_error *failed = batch_req->errors_count ? &batch_req->errors[0] : NULL;
+        const char *error = failed ? failed->error : batch_req->error;
+        unsigned int error_string_length = strlen(error) + 80;
+        char* error_string = new char[error_string_length];
+
+        if (failed) {
+            snprintf(error_string, error_string_length,
+                     "Execute batch error at row %u, transaction is rolled back #%d: %s",
+                     failed->index, failed->errno, error);
+        } else {
+            snprintf(error_string, error_string_length, "Execute batch error #%d: %s",
+                     batch_req->errno, error);
+        }
+
+        argv[0] = V8EXC(error_string);
+        delete[] error_string;
+    } else {
+        Local<Object> js_result = Object::New();
+        Local<Array> js_errors = Array::New(batch_req->errors_count);
+
+        for (uint32_t i = 0; i < batch_req->errors_count; i++) {
+            Local<Object> js_error = Object::New();
+            js_error->Set(V8STR("index"), Integer::NewFromUnsigned(batch_req->errors[i].index));
+            js_error->Set(V8STR("errno"), Integer::NewFromUnsigned(batch_req->errors[i].errno));
+            js_error->Set(V8STR("error"), V8STR(batch_req->errors[i].error));
+            js_errors->Set(i, js_error);
+        }
+
+        js_result->Set(V8STR("executed"), Integer::NewFromUnsigned(batch_req->executed));
+        js_result->Set(V8STR("affectedRows"), Number::New(static_cast<double>(batch_req->affected_rows)));
+        js_result->Set(V8STR("firstInsertId"), Number::New(static_cast<double>(batch_req->first_insert_id)));
+        js_result->Set(V8STR("lastInsertId"), Number::New(static_cast<double>(batch_req->last_insert_id)));
+        js_result->Set(V8STR("errors"), js_errors);
+
+        argv[0] = Local<Value>::New(Null());
+        argv[1] = js_result;
+        argc = 2;
+    }
+
+    batch_req->stmt->executing_batch = false;
+
+    if (batch_req->callback->IsFunction()) {
+        node::MakeCallback(
+            Context::GetCurrent()->Global(),
+            Persistent<Function>::Cast(batch_req->callback),
+            argc, argv
+        );
+    }
+
+    if (!batch_req->dequeued) {
+        batch_req->conn->CommandDone();
+    }
+
+    batch_req->conn->Unref();
+    batch_req->stmt->Unref();
+
+    FreeBatch(batch_req);
+
+    delete req;
+}
+
+void MysqlStatement::EIO_ExecuteBatch(uv_work_t *req) {
+    struct executeBatch_request *batch_req = (struct executeBatch_request *)(req->data);
+
+    MysqlStatement *stmt = batch_req->stmt;
+    MysqlConnection *conn = batch_req->conn;
+    uint32_t param_count = stmt->param_count;
+
+    pthread_mutex_lock(&conn->query_lock);
+
+    // Check connection, see MysqlConnection::EIO_Query
+    if (!conn->_conn || !conn->connected) {
+        batch_req->connection_closed = true;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    if (batch_req->overloaded) {
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    if (batch_req->transaction && (conn->_conn->server_status & SERVER_STATUS_IN_TRANS)) {
+        batch_req->transaction_open = true;
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    if (batch_req->transaction && mysql_real_query(conn->_conn, "START TRANSACTION", 17)) {
+        batch_req->errno = mysql_errno(conn->_conn);
+        batch_req->error = mysql_error(conn->_conn);
+
+        pthread_mutex_unlock(&conn->query_lock);
+        return;
+    }
+
+    // Binds of one row, rebound in place before every execution
+    MYSQL_BIND *binds = new MYSQL_BIND[param_count + 1];
+    MYSQL_TIME *times = new MYSQL_TIME[param_count + 1];
+    memset(binds, 0, (param_count + 1) * sizeof(MYSQL_BIND));
+
+    for (uint32_t r = 0; r < batch_req->batch->RowsCount(); r++) {
+        MysqlBatch::cell *row = batch_req->batch->Row(r);
+
+        for (uint32_t j = 0; j < param_count; j++) {
+            MysqlBatch::cell *cell = &row[j];
+            MYSQL_BIND *bind = &binds[j];
+
+            bind->buffer_type = cell->type;
+            bind->is_unsigned = cell->is_unsigned;
+            bind->buffer_length = 0;
+            bind->length = NULL;
+
+            switch (cell->type) {
+                case MYSQL_TYPE_NULL:
+                    bind->buffer = NULL;
+                    break;
+                case MYSQL_TYPE_TINY:
+                    bind->buffer = &cell->data.tiny_value;
+                    break;
+                case MYSQL_TYPE_LONG:
+                    bind->buffer = &cell->data.int_value;
+                    break;
+                case MYSQL_TYPE_DOUBLE:
+                    bind->buffer = &cell->data.double_value;
+                    break;
+                case MYSQL_TYPE_DATETIME:
+                    MysqlBatch::DateToMysqlTime(cell->data.double_value, &times[j]);
+                    bind->buffer = &times[j];
+                    break;
+                case MYSQL_TYPE_BLOB:
+                    bind->buffer = const_cast<char *>(batch_req->batch->Bytes(cell));
+                    bind->buffer_length = cell->length;
+                    bind->length = &cell->length;
+                    break;
+                default:
+                    bind->buffer = const_cast<char *>(batch_req->batch->Bytes(cell));
+                    bind->buffer_length = cell->length + 1;
+                    bind->length = &cell->length;
+            }
+        }
+
+        if (mysql_stmt_bind_param(stmt->_stmt, binds) || mysql_stmt_execute(stmt->_stmt)) {
+            AddBatchError(batch_req, r, mysql_stmt_errno(stmt->_stmt), mysql_stmt_error(stmt->_stmt));
+
+            if (batch_req->transaction) {
+                break;
+            }
+            continue;
+        }
+
+        batch_req->executed++;
+
+        my_ulonglong affected_rows = mysql_stmt_affected_rows(stmt->_stmt);
+        if (affected_rows != ((my_ulonglong)-1)) {
+            batch_req->affected_rows += affected_rows;
+        }
+
+        my_ulonglong insert_id = mysql_stmt_insert_id(stmt->_stmt);
+        if (insert_id) {
+            if (!batch_req->first_insert_id) {
+                batch_req->first_insert_id = insert_id;
+            }
+            batch_req->last_insert_id = insert_id;
+        }
+    }
+
+    if (batch_req->transaction && batch_req->errors_count) {
+        if (mysql_rollback(conn->_conn)) {
+            batch_req->rollback_failed = true;
+            batch_req->errno = mysql_errno(conn->_conn);
+            batch_req->error = mysql_error(conn->_conn);
+        }
+    } else if (batch_req->transaction && mysql_commit(conn->_conn)) {
+        batch_req->errno = mysql_errno(conn->_conn);
+        batch_req->error = mysql_error(conn->_conn);
+    }
+
+    // Parameters of bindParamsSync() are bound back for executeSync()
+    if (stmt->params_bound) {
+        mysql_stmt_bind_param(stmt->_stmt, stmt->binds);
+    }
+
+    delete[] binds;
+    delete[] times;
+
+    batch_req->ok = !batch_req->error;
+
+    pthread_mutex_unlock(&conn->query_lock);
+}
+
+/**
+ * MysqlStatement#executeBatch(rows[, options], callback)
+ * - rows (Array|Object): Array of parameters arrays, one per execution,
+ *   or object with `columns` array of parameter columns,
+ *   column is Array or typed array, e.g. Int32Array or Float64Array
+ * - options (Object): `transaction` runs batch in one transaction,
+ *   it is rolled back and stopped on first failed execution,
+ *   it fails without executions if connection is already in transaction,
+ *   `priority` sets queue lane as for MysqlConnection#query()
+ * - callback (Function): Callback function, gets (error, result)
+ *
+ * Executes prepared statement once per row in one threadpool job,
+ * parameters are rebound natively between executions.
+ * Result has `executed`, `affectedRows`, `firstInsertId`, `lastInsertId`
+ * and `errors` array of {index, errno, error} for failed executions
+ **/
+Handle<Value> MysqlStatement::ExecuteBatch(const Arguments& args) {
+    HandleScope scope;
+
+    MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
+
+    MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTBE_PREPARED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
+
+    MysqlConnection *conn = stmt->conn;
+    if (!conn) {
+        return THREXC("Statement is not created by MysqlConnection#initStatementSync()");
+    }
+
+    MYSQLCONN_MUSTBE_CONNECTED;
+    MYSQLCONN_MUSTNOT_BE_CLOSING;
+    MYSQLCONN_MUSTNOT_BE_OVERLOADED;
+
+    if (args.Length() < 1 || !args[0]->IsObject()) {
+        return THRTYPEEXC("Argument 0 must be an array of rows or an object with columns");
+    }
+
+    MysqlConnection::query_options options;
+    int callback_arg = MysqlConnection::ParseQueryOptions(args, 1, &options);
+    if (callback_arg < 0) {
+        return Undefined();
+    }
+    OPTIONAL_FUN_ARG(callback_arg, callback);
+
+    uint32_t param_count = stmt->param_count;
+
+    executeBatch_request *batch_req = new executeBatch_request;
+
+    batch_req->ok = false;
+    batch_req->connection_closed = false;
+    batch_req->overloaded = false;
+    batch_req->dequeued = false;
+    batch_req->stmt = stmt;
+    batch_req->conn = conn;
+    batch_req->batch = new MysqlBatch(param_count);
+    batch_req->transaction = callback_arg > 1
+                          && args[1]->ToObject()->Get(V8STR("transaction"))->BooleanValue();
+    batch_req->executed = 0;
+    batch_req->affected_rows = 0;
+    batch_req->first_insert_id = 0;
+    batch_req->last_insert_id = 0;
+    batch_req->transaction_open = false;
+    batch_req->rollback_failed = false;
+    batch_req->errors = NULL;
+    batch_req->errors_count = 0;
+    batch_req->errors_capacity = 0;
+    batch_req->errno = 0;
+    batch_req->error = NULL;
+
+    const char *error = batch_req->batch->Load(args[0]);
+
+    if (error) {
+        FreeBatch(batch_req);
+        return THRTYPEEXC(error);
+    }
+
+    batch_req->callback = Persistent<Value>::New(callback);
+
+    stmt->executing_batch = true;
+    stmt->Ref();
+    conn->Ref();
+
+    uv_work_t *_req = new uv_work_t;
+    _req->data = batch_req;
+    conn->EnqueueCommand(_req, EIO_ExecuteBatch, (uv_after_work_cb)EIO_After_ExecuteBatch,
+                         options.lane, options.timeout_ms,
+                         &batch_req->overloaded, &batch_req->dequeued);
+
+    return Undefined();
+}
+
 /**
  * Executes a prepared query
  *
@@ -454,6 +839,7 @@ Handle<Value> MysqlStatement::ExecuteSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
 
     if (mysql_stmt_execute(stmt->_stmt)) {
@@ -474,6 +860,7 @@ Handle<Value> MysqlStatement::FetchAllSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.This());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
 
     // Get fields count for binding buffers
@@ -752,6 +1139,7 @@ Handle<Value> MysqlStatement::FreeResultSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
 
     return scope.Close(!mysql_stmt_free_result(stmt->_stmt) ? True() : False());
 }
@@ -801,6 +1189,7 @@ Handle<Value> MysqlStatement::PrepareSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
 
     REQ_STR_ARG(0, query)
 
@@ -813,9 +1202,7 @@ Handle<Value> MysqlStatement::PrepareSync(const Arguments& args) {
         return scope.Close(False());
     }
 
-    if (stmt->binds) {
-        delete[] stmt->binds;
-    }
+    stmt->FreeParams();
 
     stmt->param_count = mysql_stmt_param_count(stmt->_stmt);
 
@@ -823,7 +1210,13 @@ Handle<Value> MysqlStatement::PrepareSync(const Arguments& args) {
         stmt->binds = new MYSQL_BIND[stmt->param_count];
         memset(stmt->binds, 0, stmt->param_count*sizeof(MYSQL_BIND));
 
-        // TODO(Sannis): Smth else?
+        // Persistent handles are empty after construction
+        stmt->params = new param_value[stmt->param_count];
+        for (uint64_t i = 0; i < stmt->param_count; i++) {
+            stmt->params[i].length = 0;
+            stmt->params[i].string_buffer = NULL;
+            stmt->params[i].string_capacity = 0;
+        }
     }
 
     stmt->prepared = true;
@@ -842,6 +1235,7 @@ Handle<Value> MysqlStatement::ResetSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
 
 
@@ -895,6 +1289,7 @@ Handle<Value> MysqlStatement::SendLongDataSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
 
     REQ_INT_ARG(0, parameter_number);
@@ -934,6 +1329,7 @@ Handle<Value> MysqlStatement::StoreResultSync(const Arguments& args) {
     MysqlStatement *stmt = OBJUNWRAP<MysqlStatement>(args.Holder());
 
     MYSQLSTMT_MUSTBE_INITIALIZED;
+    MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH;
     MYSQLSTMT_MUSTBE_PREPARED;
 
     if (mysql_stmt_store_result(stmt->_stmt) != 0) {
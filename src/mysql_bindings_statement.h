@@ -15,6 +15,7 @@
 #include <node_object_wrap.h>
 
 #include "./mysql_bindings.h"
+#include "./mysql_bindings_batch.h"
 
 #define MYSQLSTMT_MUSTBE_INITIALIZED \
     if (!stmt->_stmt) { \
@@ -31,6 +32,13 @@
         return THREXC("Statement result not stored"); \
     }
 
+#define MYSQLSTMT_MUSTNOT_BE_EXECUTING_BATCH \
+    if (stmt->executing_batch) { \
+        return THREXC("Statement is busy with executeBatch()"); \
+    }
+
+class MysqlConnection;
+
 /** section: Classes
  * class MysqlStatement
  *
@@ -45,8 +53,44 @@ class MysqlStatement : public node::ObjectWrap {
   protected:
     MYSQL_STMT *_stmt;
 
+    /*!
+     * Bind arena, allocated once per prepare and rebound in place,
+     * binds point into values of their parameters.
+     * String buffers only grow, Buffer parameters are bound without copy
+     * and are referenced until they are rebound
+     */
+    union param_scalar {
+        signed char tiny_value;
+        int int_value;
+        unsigned int uint_value;
+        double double_value;
+        MYSQL_TIME time_value;
+    };
+
+    struct param_value {
+        param_scalar data;
+        unsigned long length; // NOLINT
+
+        char *string_buffer;
+        size_t string_capacity;
+
+        Persistent<Object> buffer;
+    };
+
     MYSQL_BIND *binds;
+    param_value *params;
     unsigned long param_count;
+    // Binds are passed to mysql_stmt_bind_param()
+    bool params_bound;
+
+    void FreeParams();
+    static const char *BindScalarParam(Handle<Value> js_param, MYSQL_BIND *bind, param_scalar *data);
+
+    // Connection is referenced by statement, its commands queue is used by executeBatch()
+    MysqlConnection *conn;
+    Persistent<Object> js_conn;
+
+    bool executing_batch;
 
     bool prepared;
     bool stored;
@@ -76,6 +120,50 @@ class MysqlStatement : public node::ObjectWrap {
 
     static Handle<Value> CloseSync(const Arguments& args);
 
+    struct batch_error {
+        uint32_t index;
+        unsigned int errno;
+        char *error;
+    };
+
+    struct executeBatch_request {
+        bool ok;
+        bool connection_closed;
+        bool overloaded;
+        bool dequeued;
+
+        Persistent<Value> callback;
+        MysqlStatement *stmt;
+        MysqlConnection *conn;
+
+        // Rows of parameters, Buffers are referenced until batch is done
+        MysqlBatch *batch;
+
+        bool transaction;
+        // START TRANSACTION would implicitly commit transaction of caller
+        bool transaction_open;
+        bool rollback_failed;
+
+        uint32_t executed;
+        my_ulonglong affected_rows;
+        my_ulonglong first_insert_id;
+        my_ulonglong last_insert_id;
+
+        // Grows twice when it is full
+        batch_error *errors;
+        uint32_t errors_count;
+        uint32_t errors_capacity;
+
+        unsigned int errno;
+        const char *error;
+    };
+    static void AddBatchError(executeBatch_request *batch_req, uint32_t index,
+                              unsigned int errno, const char *error);
+    static void FreeBatch(executeBatch_request *batch_req);
+    static void EIO_After_ExecuteBatch(uv_work_t *req);
+    static void EIO_ExecuteBatch(uv_work_t *req);
+    static Handle<Value> ExecuteBatch(const Arguments& args);
+
     static Handle<Value> DataSeekSync(const Arguments& args);
 
     static Handle<Value> ErrnoSync(const Arguments& args);
@@ -56,3 +56,23 @@
     #define NODE_ADDON_SHIM_IO_WATCH_CALLBACK_ARGUMENTS \
       EV_P_ ev_io *io_watcher, int events
 #endif
+
+#if NODE_VERSION_AT_LEAST(0, 11, 13)
+    #define NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS \
+      uv_timer_t* handle
+    #define NODE_ADDON_SHIM_CHECK_CALLBACK_ARGUMENTS \
+      uv_check_t* handle
+    #define NODE_ADDON_SHIM_IDLE_CALLBACK_ARGUMENTS \
+      uv_idle_t* handle
+    #define NODE_ADDON_SHIM_ASYNC_CALLBACK_ARGUMENTS \
+      uv_async_t* handle
+#else
+    #define NODE_ADDON_SHIM_TIMER_CALLBACK_ARGUMENTS \
+      uv_timer_t* handle, int status
+    #define NODE_ADDON_SHIM_CHECK_CALLBACK_ARGUMENTS \
+      uv_check_t* handle, int status
+    #define NODE_ADDON_SHIM_IDLE_CALLBACK_ARGUMENTS \
+      uv_idle_t* handle, int status
+    #define NODE_ADDON_SHIM_ASYNC_CALLBACK_ARGUMENTS \
+      uv_async_t* handle, int status
+#endif
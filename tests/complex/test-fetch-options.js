@@ -280,6 +280,147 @@ exports.FetchAllSyncWithObjectOptionsConflicted = function (test) {
   test.done();
 };
 
+exports.FetchAllSync_indexBy = function (test) {
+  test.expect(4);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res,
+    rows;
+
+  res = conn.querySync("SELECT size, colors FROM " + cfg.test_table2 + " WHERE size='small';");
+  test.ok(res instanceof cfg.mysql_bindings.MysqlResult);
+  
+  rows = res.fetchAllSync({'indexBy': 'colors'});
+  test.same(rows,
+            {red: {size: 'small', colors: 'red'}, orange: {size: 'small', colors: 'orange'}},
+            "conn.querySync('SELECT ...').fetchAllSync({'indexBy': 'colors'})");
+  res.freeSync();
+  
+  res = conn.querySync("SELECT size, colors FROM " + cfg.test_table2 + ";");
+  test.ok(res instanceof cfg.mysql_bindings.MysqlResult);
+  
+  test.throws(function () {
+    rows = res.fetchAllSync({'indexBy': 'not_a_column'});
+  }, Error, "Column from 'indexBy' option is not found in result");
+  res.freeSync();
+  
+  conn.closeSync();
+  test.done();
+};
+
+exports.FetchAllSync_columnsAndWhere = function (test) {
+  test.expect(7);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res,
+    rows;
+
+  res = conn.querySync("SELECT 1 AS id, 'a' AS name, 10 AS score UNION ALL SELECT 2, 'b', 20 UNION ALL SELECT 3, NULL, 30;");
+  
+  rows = res.fetchAllSync({columns: ['name'], where: {score: {gte: 20}}});
+  test.same(rows, [{name: 'b'}, {name: null}], "fetchAllSync({columns: [...], where: {col: range}})");
+  
+  res.dataSeekSync(0);
+  rows = res.fetchAllSync({asArray: true, columns: ['score', 'id'], where: {name: 'a'}});
+  test.same(rows, [[10, 1]], "fetchAllSync({asArray: true, columns: [...], where: {col: value}})");
+  
+  res.dataSeekSync(0);
+  rows = res.fetchAllSync({where: {name: null, id: 3}});
+  test.same(rows, [{id: 3, name: null, score: 30}], "fetchAllSync({where: {col: null}})");
+  
+  test.throws(function () {
+    res.fetchAllSync({columns: ['not_a_column']});
+  }, Error, "Column from 'columns' option is not found in result");
+  test.throws(function () {
+    res.fetchAllSync({where: {name: 0}});
+  }, Error, "Number in 'where' option for not numeric column");
+  res.freeSync();
+  
+  res = conn.querySync("SELECT CAST(9007199254740993 AS SIGNED) AS id UNION ALL SELECT CAST(9007199254740992 AS SIGNED);");
+  rows = res.fetchAllSync({where: {id: {gt: 9007199254740992}}});
+  test.same(rows, [{id: '9007199254740993'}], "fetchAllSync({where: {col: range}}) with BIGINT above 2^53");
+  
+  res.dataSeekSync(0);
+  rows = res.fetchAllSync({where: {id: {lte: 9007199254740992}}});
+  test.same(rows, [{id: '9007199254740992'}], "fetchAllSync({where: {col: range}}) compares integers exactly");
+  res.freeSync();
+  
+  conn.closeSync();
+  test.done();
+};
+
+exports.FetchAll_columnsAndWhere = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res = conn.querySync("SELECT 1 AS id, 'a' AS name UNION ALL SELECT 2, 'b';");
+
+  res.fetchAll({columns: ['id'], where: {id: {lt: 2}}}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, [{id: 1}], "fetchAll({columns: [...], where: {...}})");
+    
+    res.freeSync();
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.LookupBatcher = function (test) {
+  test.expect(7);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionQueuedSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    batcher = conn.lookupBatcher(cfg.test_table2, 'colors', ['size']),
+    queries = 0,
+    loaded = 0,
+    query = conn.query;
+
+  // Batcher gets MysqlResult whatever result mode of connection is
+  conn.setResultModeSync('use');
+
+  conn.query = function () {
+    queries++;
+    return query.apply(this, arguments);
+  };
+
+  function done() {
+    loaded++;
+    if (loaded === 6) {
+      test.ok(queries === 1, "All lookups of one tick are sent with one query");
+      conn.closeSync();
+      test.done();
+    }
+  }
+
+  batcher.load('red', function (err, row) {
+    test.same(row, {size: 'small', colors: 'red'}, "batcher.load('red')");
+    done();
+  });
+  batcher.load('deep purple', function (err, row) {
+    test.same(row, {size: 'large', colors: 'deep purple'}, "batcher.load('deep purple')");
+    done();
+  });
+  batcher.load('red', function (err, row) {
+    test.same(row, {size: 'small', colors: 'red'}, "Duplicate keys get the same row");
+    done();
+  });
+  batcher.load("white' OR '1'='1", function (err, row) {
+    test.ok(err === null && row === null, "Missing key gets null");
+    done();
+  });
+  batcher.load('RED ', function (err, row) {
+    test.same(row, {size: 'small', colors: 'red'}, "Key is matched by column collation");
+    done();
+  });
+  batcher.load('__proto__', function (err, row) {
+    test.ok(err === null && row === null, "batcher.load('__proto__') gets null");
+    done();
+  });
+};
+
 exports.setOptionSyncQueryFetchAll = function (test) {
   test.expect(4);
   
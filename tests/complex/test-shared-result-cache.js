@@ -0,0 +1,126 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var
+  cfg = require('../config'),
+  child_process = require('child_process'),
+  fs = require('fs');
+
+var
+  segment = "/nmlc-test-shared-cache-" + process.pid,
+  small_segment = segment + "-small",
+  query = "SELECT COUNT(*) AS n FROM " + cfg.test_table + " WHERE num = 42;",
+  options = {cacheTtlMs: 60000, cacheTags: ['test_shared_cache']};
+
+/*
+ * Shared cache can't be detached from process,
+ * so every attachment runs in its own child process started from this file
+ */
+var actions = {
+  query: function (conn, callback) {
+    conn.query(query, options, function (err, rows) {
+      callback({rows: rows});
+    });
+  },
+
+  invalidate: function (conn, callback) {
+    var invalidated = conn.invalidateResultCacheSync('test_shared_cache');
+
+    conn.query(query, options, function (err, rows) {
+      callback({invalidated: invalidated, rows: rows});
+    });
+  },
+
+  fill: function (conn, callback) {
+    var i = 0;
+
+    (function next() {
+      if (i === 32) {
+        callback({});
+        return;
+      }
+
+      conn.query("SELECT REPEAT('x', 8192) AS v, " + (i++) + " AS n;", options, next);
+    }());
+  }
+};
+
+if (require.main === module) {
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.attachSharedResultCacheSync(process.argv[2], parseInt(process.argv[3], 10));
+
+  actions[process.argv[4]](conn, function (result) {
+    result.stats = conn.resultCacheStatsSync();
+    conn.closeSync();
+    process.stdout.write(JSON.stringify(result));
+  });
+
+  return;
+}
+
+function runAttached(name, size, action, callback) {
+  child_process.execFile(process.execPath, [__filename, name, String(size), action], function (err, stdout) {
+    callback(err, err ? null : JSON.parse(stdout));
+  });
+}
+
+function unlinkSegment(name) {
+  if (fs.existsSync("/dev/shm" + name)) {
+    fs.unlinkSync("/dev/shm" + name);
+  }
+}
+
+exports.SharedResultCache = function (test) {
+  test.expect(10);
+
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DELETE FROM " + cfg.test_table + " WHERE num = 42;");
+
+  runAttached(segment, 1024 * 1024, 'query', function (err, result) {
+    test.ok(err === null, "First process is attached");
+    test.same(result.rows, [{n: 0}], "Query result is stored into shared cache");
+    test.equals(result.stats.stores, 1, "Result is stored by first process");
+
+    conn.querySync("INSERT INTO " + cfg.test_table + " (num) VALUES (42);");
+
+    runAttached(segment, 1024 * 1024, 'query', function (err, result) {
+      test.ok(err === null, "Second process is attached");
+      test.same(result.rows, [{n: 0}], "Result stored by other process is returned");
+      test.equals(result.stats.hits, 1, "Result is read by second process from shared cache");
+
+      runAttached(segment, 1024 * 1024, 'invalidate', function (err, result) {
+        test.ok(err === null, "Third process is attached");
+        test.equals(result.invalidated, 1, "Result stored by other process is invalidated by tag");
+        test.same(result.rows, [{n: 1}], "Query is executed after invalidation");
+        test.equals(result.stats.hits, 0, "Invalidated result is not returned");
+
+        conn.querySync("DELETE FROM " + cfg.test_table + " WHERE num = 42;");
+        conn.closeSync();
+        unlinkSegment(segment);
+        test.done();
+      });
+    });
+  });
+};
+
+exports.SharedResultCacheEviction = function (test) {
+  test.expect(4);
+
+  runAttached(small_segment, 128 * 1024, 'fill', function (err, result) {
+    test.ok(err === null, "Process is attached to small segment");
+    test.equals(result.stats.stores, 32, "Every result is stored");
+    test.ok(result.stats.evictions > 0, "Oldest results are evicted");
+    test.ok(result.stats.entries < 32 && result.stats.bytes <= result.stats.maxBytes,
+            "Stored results fit into segment");
+
+    unlinkSegment(small_segment);
+    test.done();
+  });
+};
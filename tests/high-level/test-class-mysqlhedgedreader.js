@@ -0,0 +1,77 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+exports.New = function (test) {
+  test.expect(4);
+
+  test.throws(function () {
+    (new cfg.mysql_libmysqlclient.MysqlHedgedReader([]));
+  }, Error, "new MysqlHedgedReader() without replicas");
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    reader = new cfg.mysql_libmysqlclient.MysqlHedgedReader([conn], {delayMs: 10});
+
+  test.equals(reader.hedgeDelaySync(), 10, "reader.hedgeDelaySync() with fixed delay");
+
+  reader = new cfg.mysql_libmysqlclient.MysqlHedgedReader([conn], {initialDelayMs: 50, minSamples: 3});
+  test.equals(reader.hedgeDelaySync(), 50, "reader.hedgeDelaySync() without latency samples");
+
+  reader._sample(5);
+  reader._sample(5);
+  reader._sample(5);
+  test.equals(reader.hedgeDelaySync(), 5, "reader.hedgeDelaySync() after minimum samples");
+
+  conn.closeSync();
+  test.done();
+};
+
+exports.QueryHedgedToSecondReplica = function (test) {
+  test.expect(4);
+
+  var
+    slow = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    fast = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    reader = new cfg.mysql_libmysqlclient.MysqlHedgedReader([slow, fast], {delayMs: 20}),
+    started = Date.now();
+
+  // Stall the first replica
+  slow.query("SELECT SLEEP(1);", function () {
+    slow.closeSync();
+    fast.closeSync();
+    test.done();
+  });
+
+  reader.query("SELECT 1 AS a;", function (err, res) {
+    test.ok(err === null, "Error object is not present");
+    test.same(res.fetchAllSync(), [{a: 1}], "Result of the fastest replica");
+    test.ok(Date.now() - started < 1000, "Hedged query is not blocked by stalled replica");
+    test.same(reader.statsSync().hedgeWins, 1, "reader.statsSync().hedgeWins");
+    res.freeSync();
+  });
+};
+
+exports.QueryNotHedgedForWrites = function (test) {
+  test.expect(2);
+
+  var
+    conn1 = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    conn2 = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    reader = new cfg.mysql_libmysqlclient.MysqlHedgedReader([conn1, conn2], {delayMs: 1});
+
+  reader.query("DO SLEEP(0.05);", function (err) {
+    test.ok(err === null, "Error object is not present");
+    test.equals(reader.statsSync().hedged, 0, "Non-SELECT query is not hedged");
+
+    conn1.closeSync();
+    conn2.closeSync();
+    test.done();
+  });
+};
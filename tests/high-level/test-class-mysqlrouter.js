@@ -0,0 +1,144 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+function createRouter(lags) {
+  var
+    primary = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    replicas = lags.map(function () {
+      return cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+    });
+
+  return new cfg.mysql_libmysqlclient.MysqlRouter({
+    primary: primary,
+    replicas: replicas,
+    maxLagMs: 1000,
+    lagSampler: function (connection, callback) {
+      callback(null, lags[replicas.indexOf(connection)]);
+    }
+  });
+}
+
+function closeRouter(router) {
+  var stats = router.statsSync();
+
+  router.closeSync();
+  router._primaries.concat(router._replicas).forEach(function (target) {
+    target.connection.closeSync();
+  });
+
+  return stats;
+}
+
+exports.New = function (test) {
+  test.expect(1);
+
+  test.throws(function () {
+    (new cfg.mysql_libmysqlclient.MysqlRouter({}));
+  }, Error, "new MysqlRouter() without primary");
+
+  test.done();
+};
+
+exports.IsRead = function (test) {
+  test.expect(5);
+
+  var isRead = cfg.mysql_libmysqlclient.MysqlRouter.isRead;
+
+  test.ok(isRead("SELECT 1"), "SELECT is read");
+  test.ok(isRead(" (SELECT 1) UNION (SELECT 2)"), "SELECT in parentheses is read");
+  test.ok(!isRead("SELECT * FROM t FOR UPDATE"), "SELECT ... FOR UPDATE is not read");
+  test.ok(!isRead("SELECT * FROM t LOCK IN SHARE MODE"), "SELECT ... LOCK IN SHARE MODE is not read");
+  test.ok(!isRead("UPDATE t SET a = 1"), "UPDATE is not read");
+
+  test.done();
+};
+
+exports.RouteReadsToReplicasUnderLag = function (test) {
+  test.expect(3);
+
+  var router = createRouter([5000, 0]);
+
+  test.strictEqual(router.route("SELECT 1"), router._replicas[1].connection, "Read goes to replica with small lag");
+  test.strictEqual(router.route("INSERT INTO t VALUES (1)"), router._primaries[0].connection, "Write goes to primary");
+  test.strictEqual(router.route("SELECT 1 FOR UPDATE"), router._primaries[0].connection, "Locking read goes to primary");
+
+  closeRouter(router);
+  test.done();
+};
+
+exports.RouteToPrimaryInTransaction = function (test) {
+  test.expect(4);
+
+  var router = createRouter([0]), primary = router._primaries[0].connection;
+
+  test.strictEqual(router.route("START TRANSACTION"), primary, "START TRANSACTION goes to primary");
+  test.strictEqual(router.route("SELECT 1"), primary, "Read inside transaction goes to primary");
+  test.strictEqual(router.route("ROLLBACK TO SAVEPOINT a"), primary, "Transaction is not finished by ROLLBACK TO");
+  router.route("COMMIT");
+  test.strictEqual(router.route("SELECT 1"), router._replicas[0].connection, "Read after COMMIT goes to replica");
+
+  closeRouter(router);
+  test.done();
+};
+
+exports.Query = function (test) {
+  test.expect(3);
+
+  var router = createRouter([0, 0]);
+
+  router.query("SELECT 1 AS a;", function (err, res) {
+    test.ok(err === null, "Error object is not present");
+    test.same(res.fetchAllSync(), [{a: 1}], "router.query() result");
+    res.freeSync();
+
+    var stats = closeRouter(router);
+    test.equals(stats.replicas[0].queries + stats.replicas[1].queries, 1, "Query is sent to replica");
+    test.done();
+  });
+};
+
+exports.QueryReadYourWrites = function (test) {
+  test.expect(4);
+
+  var
+    primary = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    replica = {
+      query: function (query, options, callback) {
+        test.equals(options.waitForGtid, "3e11fa47-71ca-11e1-9e33-c80aa9429562:23", "Replica read waits for primary write");
+        var err = new Error("Timeout waiting for GTID set replication");
+        err.code = "EGTIDTIMEOUT";
+        callback(err);
+      }
+    },
+    router = new cfg.mysql_libmysqlclient.MysqlRouter({
+      primary: primary,
+      replicas: [replica],
+      lagSampler: function (connection, callback) {
+        callback(null, 0);
+      }
+    });
+
+  // Emulates GTID of write, readYourWrites is set after construction to work with any server
+  router._readYourWrites = true;
+  router._primaries[0].lastGtid = "3e11fa47-71ca-11e1-9e33-c80aa9429562:23";
+
+  router.query("SELECT 1 AS a;", function (err, res) {
+    test.ok(err === null, "Error object is not present");
+    test.same(res.fetchAllSync(), [{a: 1}], "Read is retried on primary after GTID wait timeout");
+    res.freeSync();
+
+    var stats = router.statsSync();
+    test.equals(stats.primary[0].queries, 1, "Query is sent to primary");
+
+    router.closeSync();
+    primary.closeSync();
+    test.done();
+  });
+};
@@ -0,0 +1,124 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+function createShards(count) {
+  var shards = [], i;
+
+  for (i = 0; i < count; i++) {
+    shards.push({
+      name: "shard" + i,
+      connections: [cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database)]
+    });
+  }
+
+  return shards;
+}
+
+function closeShards(shards) {
+  shards.forEach(function (shard) {
+    shard.connections.forEach(function (connection) {
+      connection.closeSync();
+    });
+  });
+}
+
+exports.New = function (test) {
+  test.expect(2);
+
+  test.throws(function () {
+    (new cfg.mysql_libmysqlclient.MysqlShardMap([]));
+  }, Error, "new MysqlShardMap() without shards");
+  test.throws(function () {
+    (new cfg.mysql_libmysqlclient.MysqlShardMap([{name: "a"}]));
+  }, Error, "new MysqlShardMap() with shard without connections");
+
+  test.done();
+};
+
+exports.ShardIndex = function (test) {
+  test.expect(5);
+
+  var
+    shards = createShards(4),
+    map = new cfg.mysql_libmysqlclient.MysqlShardMap(shards),
+    used = {},
+    i;
+
+  for (i = 0; i < 1000; i++) {
+    used[map.shardIndex(i)] = true;
+  }
+
+  test.equals(Object.keys(used).length, 4, "Keys are spread over all shards");
+  test.equals(map.shardIndex("user:42"), map.shardIndex("user:42"), "String key is mapped to the same shard");
+  test.equals(map.shardName(7), shards[map.shardIndex(7)].name, "map.shardName()");
+  test.equals(map.shardIndex(42), map.shardIndex("42"), "Number and its string from result row are mapped to the same shard");
+
+  used = {};
+  for (i = 0; i < 1000; i++) {
+    used[map.shardIndex(i + 0.5)] = true;
+  }
+  test.equals(Object.keys(used).length, 4, "Fractional keys are not truncated");
+
+  closeShards(shards);
+  test.done();
+};
+
+exports.SetWeightSync = function (test) {
+  test.expect(3);
+
+  var
+    shards = createShards(4),
+    map = new cfg.mysql_libmysqlclient.MysqlShardMap(shards),
+    before = [],
+    movedElsewhere = 0,
+    i;
+
+  for (i = 0; i < 1000; i++) {
+    before.push(map.shardIndex(i));
+  }
+
+  map.setWeightSync("shard1", 2);
+
+  for (i = 0; i < 1000; i++) {
+    if (map.shardIndex(i) !== before[i] && map.shardIndex(i) !== 1) {
+      movedElsewhere++;
+    }
+  }
+
+  test.equals(movedElsewhere, 0, "Keys move only to shard with increased weight");
+  test.ok(map.statsSync()[1].keyShare > map.statsSync()[0].keyShare, "Heavier shard owns more keys");
+  test.throws(function () {
+    map.setWeightSync("unknown", 1);
+  }, Error, "map.setWeightSync() with unknown shard");
+
+  closeShards(shards);
+  test.done();
+};
+
+exports.QueryShard = function (test) {
+  test.expect(4);
+
+  var
+    shards = createShards(2),
+    map = new cfg.mysql_libmysqlclient.MysqlShardMap(shards);
+
+  map.queryShard(42, "SELECT 1 AS a;", function (err, res) {
+    test.ok(err === null, "Error object is not present");
+    test.same(res.fetchAllSync(), [{a: 1}], "map.queryShard() result");
+    res.freeSync();
+
+    var stats = map.statsSync()[map.shardIndex(42)];
+    test.equals(stats.queries, 1, "Query is counted for key shard");
+    test.equals(stats.inFlight, 0, "Query is finished");
+
+    closeShards(shards);
+    test.done();
+  });
+};
@@ -0,0 +1,74 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config');
+
+function createConnections(count) {
+  var connections = [], i;
+
+  for (i = 0; i < count; i++) {
+    connections.push(cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database));
+  }
+
+  return connections;
+}
+
+function closeConnections(connections) {
+  connections.forEach(function (connection) {
+    connection.closeSync();
+  });
+}
+
+exports.Scatter = function (test) {
+  test.expect(2);
+
+  var connections = createConnections(3);
+
+  cfg.mysql_libmysqlclient.scatter(connections,
+    "SELECT CONNECTION_ID() % 7 AS k, 1 AS n UNION ALL SELECT 5, 2 ORDER BY n DESC",
+    {orderBy: "n DESC", limit: 4},
+    function (err, rows) {
+      test.ok(err === null, "Error object is not present");
+      test.same(rows.map(function (row) {
+        return row.n;
+      }), [2, 2, 2, 1], "Shard results are merged in order and limited");
+
+      closeConnections(connections);
+      test.done();
+    });
+};
+
+exports.ScatterWithQueryOptions = function (test) {
+  test.expect(2);
+
+  var connections = createConnections(2);
+
+  cfg.mysql_libmysqlclient.scatter(connections, "SELECT 1 AS n",
+    {orderBy: "n", queryOptions: {cacheTtlMs: 1000, coalesce: true, resultMode: 'use'}},
+    function (err, rows) {
+      test.ok(err === null, "Cache, coalescing and result mode of queryOptions are ignored");
+      test.equals(rows.length, 2, "Rows of all shards are merged");
+
+      closeConnections(connections);
+      test.done();
+    });
+};
+
+exports.ScatterWithError = function (test) {
+  test.expect(2);
+
+  var connections = createConnections(2);
+
+  cfg.mysql_libmysqlclient.scatter(connections, "SELECT * FROM " + cfg.test_table_notexists, function (err, rows) {
+    test.ok(err, "Error object is present");
+    test.strictEqual(rows, undefined, "Rows are not returned on shard error");
+
+    closeConnections(connections);
+    test.done();
+  });
+};
@@ -109,6 +109,69 @@ module.exports = {
       test.done();
     }
   },
+  asyncFromStream: function (test) {
+    test.expect(3);
+    var
+      stream = new (require('stream').Stream)(),
+      lines = prepareData().split('\n'),
+      i = 0,
+      paused = false,
+      pauses = 0,
+      emit = function () {
+        while (!paused && i < lines.length) {
+          stream.emit('data', new Buffer(lines[i] + '\n'));
+          i += 1;
+        }
+        if (!paused && i === lines.length) {
+          i += 1;
+          stream.emit('end');
+        }
+      };
+    stream.readable = true;
+    stream.pause = function () {
+      paused = true;
+      pauses += 1;
+    };
+    stream.resume = function () {
+      paused = false;
+      process.nextTick(emit);
+    };
+    this.conn.query(
+      this.exampleQuery,
+      stream,
+      function (error) {
+        var result;
+        test.ok(error === null, "Asynchronous load data infile from stream fails");
+        result = this.conn.querySync("select count(*) as count from " + cfg.test_table).fetchAllSync();
+        test.equals(result[0].count, lines.length, "All lines of stream are loaded");
+        test.ok(pauses > 0, "Stream is paused while server falls behind");
+        test.done();
+      }.bind(this)
+    );
+    process.nextTick(emit);
+  },
+  asyncFromStreamCloseSync: function (test) {
+    test.expect(2);
+    var stream = new (require('stream').Stream)();
+    stream.readable = true;
+    stream.pause = function () {};
+    stream.resume = function () {};
+    this.conn.query(
+      this.exampleQuery,
+      stream,
+      function (error) {
+        test.ok(error !== null, "Load waiting for stream data is failed by closeSync()");
+        test.done();
+      }
+    );
+    // Stream emits nothing, so load waits for data holding the connection
+    setTimeout(function () {
+      test.throws(function () {
+        this.conn.querySync("SELECT 1");
+      }.bind(this), Error, "querySync() throws while stream is loaded");
+      this.conn.closeSync();
+    }.bind(this), 100);
+  },
   asyncSyncAsync: function (test) {
     test.expect(4);
     try {
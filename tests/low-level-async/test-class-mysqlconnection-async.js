@@ -88,6 +88,124 @@ exports.ConnectAfterConnectSync2 = function (test) {
   });
 };
 
+exports.Close = function (test) {
+  test.expect(6);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query_done = false;
+
+  conn.query("SELECT SLEEP(1);", function (err, res) {
+    test.ok(err === null, "Queued query is finished before close");
+    query_done = true;
+  });
+
+  conn.close(function (err) {
+    test.ok(err === null, "Error object is not present");
+    test.ok(query_done, "close() waits for queued queries");
+    test.ok(!conn.connectedSync(), "conn.connectedSync() after conn.close()");
+
+    test.done();
+  });
+
+  test.ok(conn.connectedSync(), "Connection is still alive while queries are running");
+
+  test.throws(function () {
+    conn.query("SELECT 1;", function () {});
+  }, "Connection is closing");
+};
+
+exports.Aggregate = function (test) {
+  test.expect(8);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.throws(function () {
+    conn.aggregate("SELECT 1 AS a;", {sum: "a"}, function () {});
+  }, TypeError, "conn.aggregate() with not an array option");
+
+  conn.aggregate("SELECT 'a' AS g, CAST(1.5 AS DECIMAL(6,2)) AS v UNION ALL SELECT 'b', 5 " +
+                 "UNION ALL SELECT 'a', NULL UNION ALL SELECT 'a', 3.25;",
+                 {groupBy: ["g"], sum: ["v"], min: ["v"], max: ["v"], count: true}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, [
+      {g: 'a', count: 3, sum_v: '4.75', min_v: '1.50', max_v: '3.25'},
+      {g: 'b', count: 1, sum_v: '5.00', min_v: '5.00', max_v: '5.00'}
+    ], "conn.aggregate() with groupBy");
+
+    conn.aggregate("SELECT 1 AS v UNION ALL SELECT 2;", {sum: ["v"], count: true}, function (err, rows) {
+      test.same(rows, [{count: 2, sum_v: '3'}], "conn.aggregate() without groupBy");
+
+      conn.aggregate("SELECT 0.1 AS v UNION ALL SELECT 0.2;", {sum: ["v"]}, function (err, rows) {
+        test.same(rows, [{sum_v: '0.3'}], "conn.aggregate() sums DECIMAL exactly");
+
+        conn.aggregate("SELECT 1 AS v FROM DUAL WHERE 0;", {sum: ["v"], count: true}, function (err, rows) {
+          test.same(rows, [{count: 0, sum_v: null}], "conn.aggregate() without groupBy over no rows");
+
+          conn.aggregate("SELECT CURDATE() AS d;", {min: ["d"]}, function (err, rows) {
+            test.ok(err, "Error for not numeric column");
+
+            conn.aggregate("SELECT 1 AS v;", {sum: ["unknown"]}, function (err, rows) {
+              test.ok(err, "Error for unknown column");
+
+              conn.closeSync();
+              test.done();
+            });
+          });
+        });
+      });
+    });
+  });
+};
+
+exports.BulkInsert = function (test) {
+  test.expect(9);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    rows = [],
+    progress = [],
+    i;
+
+  test.throws(function () {
+    conn.bulkInsert(cfg.test_table, ["random_number"], [[1]], {onDuplicate: "skip"}, function () {});
+  }, TypeError, "conn.bulkInsert() with unknown onDuplicate");
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  conn.querySync("ALTER TABLE " + cfg.test_table + " AUTO_INCREMENT = 1;");
+
+  for (i = 0; i < 200; i += 1) {
+    rows.push([i, i % 2 === 0]);
+  }
+
+  conn.bulkInsert(cfg.test_table, ["random_number", "random_boolean"], rows, {
+    chunkBytes: 512,
+    onProgress: function (done, total) {
+      progress.push(done + "/" + total);
+    }
+  }, function (err, result) {
+    test.ok(err === null, "Error object is not present");
+    test.equals(result.affectedRows, 200, "Affected rows count");
+    test.equals(result.firstInsertId, 1, "First insert id");
+    test.ok(result.chunks > 1 && result.chunks === progress.length, "Rows are sent in chunks with progress");
+    test.equals(progress[progress.length - 1], "200/200", "All rows are reported by progress");
+
+    conn.bulkInsert(cfg.test_table, ["random_number", "random_boolean"],
+                    {columns: [new Int32Array([-1, -2, -3]), [true, false, "1"]]}, function (err, result) {
+      test.equals(result.affectedRows, 3, "Affected rows count for columns");
+      test.equals(conn.querySync("SELECT SUM(random_number) AS s FROM " + cfg.test_table +
+                                 " WHERE random_number < 0;").fetchAllSync()[0].s, -6, "Typed array values are inserted");
+
+      conn.bulkInsert("unknown_database.unknown_table", ["random_number"], [[1]], function (err) {
+        test.ok(err, "Error for unknown table");
+
+        conn.closeSync();
+        test.done();
+      });
+    });
+  });
+};
+
 exports.Query = function (test) {
   test.expect(2);
   
@@ -198,6 +316,459 @@ exports.QueryWithoutCallback = function (test) {
   });
 };
 
+exports.QueryCoalesced = function (test) {
+  test.expect(6);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT 1 + 1 AS n;",
+    questions = "SHOW SESSION STATUS LIKE 'Questions';",
+    questions_before = parseInt(conn.querySync(questions).fetchAllSync()[0].Value, 10),
+    results = [];
+
+  conn.query("SELECT SLEEP(0.1);", function () {});
+
+  function collect(err, rows) {
+    test.ok(err === null, "Error object is not present");
+    results.push(rows);
+    
+    if (results.length === 3) {
+      test.same(results, [[{n: 2}], [{n: 2}], [{n: 2}]], "Every caller gets rows");
+      test.ok(results[0] !== results[1], "Every caller gets own rows array");
+      
+      // SLEEP(), one coalesced SELECT and this SHOW
+      test.equals(parseInt(conn.querySync(questions).fetchAllSync()[0].Value, 10) - questions_before, 3,
+                  "Identical queries are executed once");
+      
+      conn.closeSync();
+      test.done();
+    }
+  }
+
+  conn.query(query, {coalesce: true}, collect);
+  conn.query(query, {coalesce: true}, collect);
+  conn.query(query, {coalesce: true}, collect);
+};
+
+exports.QueryCoalescedAfterLaterCommand = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT COUNT(*) AS n FROM " + cfg.test_table + ";",
+    first_rows;
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+
+  conn.query("SELECT SLEEP(0.1);", function () {});
+
+  conn.query(query, {coalesce: true}, function (err, rows) {
+    first_rows = rows;
+  });
+  conn.query("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES ('1', '0');", function () {});
+  conn.query(query, {coalesce: true}, function (err, rows) {
+    test.same(first_rows, [{n: 0}], "First query is executed before later command");
+    test.same(rows, [{n: 1}], "Query is not attached to one queued before later command");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.QueryCoalescedShared = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    first_rows;
+
+  conn.query("SELECT SLEEP(0.1);", function () {});
+
+  conn.query("SELECT 1 AS a;", {coalesce: 'shared'}, function (err, rows) {
+    first_rows = rows;
+  });
+  conn.query("SELECT 1 AS a;", {coalesce: 'shared'}, function (err, rows) {
+    test.same(rows, [{a: 1}], "Rows are fetched");
+    test.ok(rows === first_rows, "All callers get one rows array");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.QueryCached = function (test) {
+  test.expect(7);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    options = {cacheTtlMs: 60000, cacheTags: ['test_query_cached']};
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  conn.invalidateResultCacheSync('test_query_cached');
+
+  conn.query("SELECT COUNT(*) AS n FROM " + cfg.test_table + ";", options, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, [{n: 0}], "Query result is stored into cache");
+
+    conn.querySync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES ('1', '0');");
+
+    conn.query("SELECT  COUNT(*)  AS n FROM " + cfg.test_table, options, function (err, rows) {
+      test.ok(err === null, "Error object is not present");
+      test.same(rows, [{n: 0}], "Query with other whitespace is returned from cache");
+
+      test.equals(conn.invalidateResultCacheSync('test_query_cached'), 1, "conn.invalidateResultCacheSync()");
+
+      conn.query("SELECT COUNT(*) AS n FROM " + cfg.test_table + ";", options, function (err, rows) {
+        test.ok(err === null, "Error object is not present");
+        test.same(rows, [{n: 1}], "Query is executed after invalidation");
+
+        conn.closeSync();
+        test.done();
+      });
+    });
+  });
+};
+
+exports.QueryCachedPerSessionScope = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    conn2 = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT CHARSET('a') AS charset;",
+    options = {cacheTtlMs: 60000, cacheTags: ['test_query_cached_scope']};
+
+  conn.invalidateResultCacheSync('test_query_cached_scope');
+  conn.setCharsetSync('utf8');
+  conn2.setCharsetSync('latin1');
+
+  conn.query(query, options, function (err, rows) {
+    test.same(rows, [{charset: 'utf8'}], "Query result is stored into cache");
+
+    conn2.query(query, options, function (err, rows) {
+      test.same(rows, [{charset: 'latin1'}], "Connection with other character set does not share cached result");
+
+      conn.invalidateResultCacheSync('test_query_cached_scope');
+      conn.closeSync();
+      conn2.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.QueryCachedSkipsVariables = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    conn2 = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT @cached AS v;",
+    options = {cacheTtlMs: 60000, cacheTags: ['test_query_cached_variables']};
+
+  conn.invalidateResultCacheSync('test_query_cached_variables');
+  conn.querySync("SET @cached := 1;");
+  conn2.querySync("SET @cached := 2;");
+
+  conn.query(query, options, function (err, rows) {
+    test.same(rows, [{v: 1}], "User variable is read");
+
+    conn2.query(query, options, function (err, rows) {
+      test.same(rows, [{v: 2}], "User variable of other session is not returned from cache");
+
+      conn.invalidateResultCacheSync('test_query_cached_variables');
+      conn.closeSync();
+      conn2.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.QueryWithResultMode = function (test) {
+  test.expect(8);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    query = "SELECT 1 AS n, 'a' AS s, NULL AS x UNION ALL SELECT 2, 'b', NULL;",
+    expected = [{n: 1, s: 'a', x: null}, {n: 2, s: 'b', x: null}];
+
+  test.throws(function () {
+    conn.query(query, {resultMode: 'buffered'}, function () {});
+  }, TypeError, "conn.query() with unknown resultMode");
+
+  conn.query(query, {resultMode: 'use'}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, expected, "Rows are streamed with mysql_use_result");
+
+    conn.query(query, {resultMode: 'store'}, function (err, res) {
+      test.ok(res instanceof cfg.mysql_bindings.MysqlResult, "Result is stored");
+      test.same(res.fetchAllSync(), expected, "Stored result has same rows");
+      res.freeSync();
+
+      // Shape is learned on first run, so second one is streamed
+      conn.setResultModeSync('auto', 1);
+      conn.query(query, function (err, rows) {
+        test.same(rows, expected, "First query of shape is stored");
+
+        conn.query(query.replace("'b'", "'c'"), function (err, rows) {
+          test.ok(err === null, "Error object is not present");
+          test.same(rows[1].s, 'c', "Query of same shape is streamed");
+
+          conn.closeSync();
+          test.done();
+        });
+      });
+    });
+  });
+};
+
+exports.QueryWithResultModeChunked = function (test) {
+  test.expect(8);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    digits = "(SELECT 0 AS n UNION ALL SELECT 1 UNION ALL SELECT 2 UNION ALL SELECT 3 UNION ALL SELECT 4 " +
+             "UNION ALL SELECT 5 UNION ALL SELECT 6 UNION ALL SELECT 7 UNION ALL SELECT 8 UNION ALL SELECT 9)",
+    // About 3 MiB, so result is read in several chunks
+    query = "SELECT a.n + b.n * 10 + c.n * 100 AS n, REPEAT('x', 3000) AS s FROM " +
+            digits + " a, " + digits + " b, " + digits + " c ORDER BY n;",
+    chunks = 0,
+    count = 0,
+    syncThrows = false;
+
+  test.throws(function () {
+    conn.query(query, {resultMode: 'store', onChunk: function () {}}, function () {});
+  }, TypeError, "conn.query() with onChunk for stored result");
+  test.throws(function () {
+    conn.query(query, {resultMode: 'use', onChunk: true}, function () {});
+  }, TypeError, "conn.query() with onChunk which is not a function");
+
+  conn.query(query, {resultMode: 'use'}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.equals(rows.length, 1000, "Rows of all chunks are collected");
+    test.same(rows[999].n, 999, "Rows of chunks are collected in order");
+
+    conn.query(query, {resultMode: 'use', onChunk: function (rows) {
+      chunks++;
+      count += rows.length;
+
+      try {
+        conn.querySync("SELECT 1;");
+      } catch (e) {
+        syncThrows = true;
+      }
+    }}, function (err, rows) {
+      test.strictEqual(rows, null, "Rows are passed to onChunk only");
+      test.ok(chunks > 1 && count === 1000, "Streamed result is passed in several chunks");
+      test.ok(syncThrows, "conn.querySync() throws while result is streamed");
+
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.QueryQueuedInOrder = function (test) {
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    queries_count = 20,
+    results = [],
+    i;
+
+  test.expect(queries_count + 1);
+
+  for (i = 0; i < queries_count; i += 1) {
+    conn.query("SELECT " + i + " AS n;", function (err, res) {
+      test.ok(err === null, "Error object is not present");
+
+      results.push(res.fetchAllSync()[0].n);
+      res.freeSync();
+
+      if (results.length === queries_count) {
+        test.same(results, results.slice().sort(function (a, b) { return a - b; }), "Callbacks are called in queries order");
+
+        conn.closeSync();
+        test.done();
+      }
+    });
+  }
+};
+
+exports.QueryAndQuerySendQueuedInOrder = function (test) {
+  test.expect(3);
+
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    results = [];
+
+  conn.query("SELECT 1 AS n;", function (err, res) {
+    results.push(res.fetchAllSync()[0].n);
+  });
+
+  conn.querySend("SELECT 2 AS n;", function (err, res) {
+    results.push(res.fetchAllSync()[0].n);
+  });
+
+  conn.query("SELECT 3 AS n;", function (err, res) {
+    test.ok(err === null, "Error object is not present");
+    results.push(res.fetchAllSync()[0].n);
+
+    test.same(results, [1, 2, 3], "query() and querySend() share one queue");
+    test.ok(conn.connectedSync());
+
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.QueryCancel = function (test) {
+  test.expect(6);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    running,
+    queued;
+
+  running = conn.query("SELECT SLEEP(10);", function (err, res) {
+    test.ok(err, "Running query is interrupted");
+    test.equals(err.message, "Query is canceled", "Callback exception for running query");
+    
+    conn.query("SELECT 1 AS a;", function (err, res) {
+      test.ok(err === null, "Connection is reusable after cancel");
+      test.ok(!running.cancel(), "Finished query can't be canceled");
+      
+      conn.closeSync();
+      test.done();
+    });
+  });
+
+  queued = conn.query("SELECT 1;", function (err, res) {
+    test.equals(err.message, "Query is canceled", "Callback exception for queued query");
+  });
+
+  test.ok(queued.cancel(), "Queued query is canceled");
+
+  setTimeout(function () {
+    running.cancel();
+  }, 100);
+};
+
+exports.QueryWithAdmissionLimits = function (test) {
+  test.expect(6);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    rejected = false;
+
+  conn.setAdmissionLimitsSync({maxQueued: 1, maxQueueWaitMs: 100});
+
+  conn.query("SELECT SLEEP(0.3);", function (err) {
+    test.ok(err === null, "Running query is not affected");
+    test.ok(rejected, "Stale query is rejected before running query is done");
+    
+    conn.setAdmissionLimitsSync({maxQueued: 0, maxQueueWaitMs: 0});
+    conn.closeSync();
+    test.done();
+  });
+
+  conn.query("SELECT 1;", function (err) {
+    test.ok(err, "Query waited longer than maxQueueWaitMs is rejected");
+    test.equals(err.code, "EOVERLOAD", "Error code is EOVERLOAD");
+    rejected = true;
+  });
+
+  try {
+    conn.query("SELECT 2;", function () {});
+  } catch (e) {
+    test.ok(e, "Query over maxQueued is rejected");
+    test.equals(e.code, "EOVERLOAD", "Exception code is EOVERLOAD");
+  }
+};
+
+exports.QueryWithPriority = function (test) {
+  test.expect(3);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    order = [];
+
+  conn.query("SELECT SLEEP(0.2);", function (err) {
+    order.push('running');
+  });
+
+  conn.query("SELECT 1;", {priority: 'batch'}, function (err) {
+    order.push('batch');
+  });
+
+  conn.query("SELECT 2;", {priority: 'interactive'}, function (err) {
+    order.push('interactive');
+    
+    test.same(order, ['running', 'batch', 'interactive'], "Queries of one connection are dispatched in FIFO order");
+    
+    conn.closeSync();
+    test.done();
+  });
+
+  test.throws(function () {
+    conn.query("SELECT 3;", {priority: 'urgent'}, function () {});
+  }, TypeError, "conn.query() with wrong priority");
+
+  test.ok(conn.queueStatsSync().batch.queued >= 1, "Batch query is queued");
+};
+
+exports.QueryWithTimeout = function (test) {
+  test.expect(4);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    started = Date.now();
+
+  conn.query("SELECT SLEEP(10);", {timeoutMs: 200}, function (err, res) {
+    test.ok(err, "Error object is present");
+    test.equals(err.message, "Query timeout exceeded", "Callback exception in conn.query()");
+    test.ok(Date.now() - started < 5000, "Query is interrupted before it is finished");
+    
+    conn.query("SELECT 1 AS a;", function (err, res) {
+      test.ok(err === null, "Connection is reusable after timeout");
+      
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.QueryWaitForGtidOptions = function (test) {
+  test.expect(6);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  test.throws(function () {
+    conn.query("DELETE FROM " + cfg.test_table + ";", {waitForGtid: "uuid:1"}, function () {});
+  }, TypeError, "waitForGtid is rejected for writes");
+  test.throws(function () {
+    conn.query("SELECT 1;", {waitForGtid: 1}, function () {});
+  }, TypeError, "waitForGtid must be a string");
+  test.throws(function () {
+    conn.querySend("SELECT 1;", {waitForGtid: "uuid:1"}, function () {});
+  }, TypeError, "waitForGtid is rejected by conn.querySend()");
+
+  conn.query("SELECT 1 AS a;", {waitForGtid: null}, function (err, rows) {
+    test.ok(err === null, "Query with null waitForGtid is not waiting");
+
+    // Multi-statements stay off for waiting query
+    conn.query("SELECT 1 AS a; SELECT 2 AS b;", {waitForGtid: ""}, function (err) {
+      test.ok(err, "Waiting query can't run second statement");
+
+      conn.query("SELECT 3 AS c;", function (err, res) {
+        test.ok(err === null, "Connection is in sync after waiting query");
+        res.freeSync();
+
+        conn.closeSync();
+        test.done();
+      });
+    });
+  });
+};
+
 exports.QuerySend = function (test) {
   test.expect(2);
   
@@ -281,3 +852,172 @@ exports.QuerySendWithError = function (test) {
     test.done();
   });
 };
+
+exports.AutoCommit = function (test) {
+  test.expect(3);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.autoCommit(false, function (err) {
+    test.ok(err === null, "Error object is not present");
+    
+    test.equals(conn.querySync("SELECT @@autocommit AS a;").fetchAllSync()[0].a, 0, "conn.autoCommit(false)");
+    
+    conn.autoCommit(true, function (err) {
+      test.equals(conn.querySync("SELECT @@autocommit AS a;").fetchAllSync()[0].a, 1, "conn.autoCommit(true)");
+      
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.ChangeUser = function (test) {
+  test.expect(5);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password);
+
+  conn.changeUser(cfg.user, cfg.password, cfg.database, function (err) {
+    test.ok(err === null, "conn.changeUser() with database selection");
+    
+    conn.changeUser(cfg.user, cfg.password, cfg.database_denied, function (err) {
+      test.ok(err, "conn.changeUser() with denied database selection");
+      test.ok(err.message.match(/^Change user error #\d+: /), "Error message contains command name");
+      
+      test.throws(function () {
+        conn.changeUser(cfg.user, function () {});
+      }, TypeError, "conn.changeUser() without password argument");
+      
+      test.throws(function () {
+        conn.changeUser(cfg.user, cfg.password, 3, function () {});
+      }, TypeError, "conn.changeUser() with not string database argument");
+      
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.Commit = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  conn.autoCommitSync(false);
+  conn.querySync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES (1, 1);");
+
+  conn.commit(function (err) {
+    test.ok(err === null, "Error object is not present");
+    
+    conn.autoCommitSync(true);
+    test.equals(conn.querySync("SELECT COUNT(*) AS c FROM " + cfg.test_table + ";").fetchAllSync()[0].c, 1, "Row is committed");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.GetWarnings = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.query("DROP TABLE IF EXISTS " + cfg.test_table_notexists + ";", function (err) {
+    conn.getWarnings(function (err, warnings) {
+      test.ok(err === null, "Error object is not present");
+      test.same(warnings,
+                [{errno: 1051, reason: "Unknown table '" + cfg.test_table_notexists + "'" }],
+                "conn.getWarnings() after DROP TABLE IF EXISTS test_table_notexists");
+      
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.Ping = function (test) {
+  test.expect(1);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.ping(function (err) {
+    test.ok(err === null, "conn.ping()");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.Rollback = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  conn.autoCommitSync(false);
+  conn.querySync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES (1, 1);");
+
+  conn.rollback(function (err) {
+    test.ok(err === null, "Error object is not present");
+    
+    conn.autoCommitSync(true);
+    test.equals(conn.querySync("SELECT COUNT(*) AS c FROM " + cfg.test_table + ";").fetchAllSync()[0].c, 0, "Row is rolled back");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.SelectDb = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password);
+
+  conn.selectDb(cfg.database, function (err) {
+    test.ok(err === null, "conn.selectDb() for allowed database");
+    
+    conn.selectDb(cfg.database_denied, function (err) {
+      test.ok(err, "conn.selectDb() for denied database");
+      
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.SetCharset = function (test) {
+  test.expect(1);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password);
+
+  conn.setCharset(cfg.charset, function (err) {
+    test.ok(err === null, "conn.setCharset()");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.Stat = function (test) {
+  test.expect(2);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+
+  conn.stat(function (err, status) {
+    test.ok(err === null, "Error object is not present");
+    test.equals(typeof status, "string", "typeof status is a string");
+    
+    conn.closeSync();
+    test.done();
+  });
+};
@@ -76,3 +76,113 @@ exports.ResultObjectManipulationsAfterFetchAll = function (test) {
     test.done();
   });
 };
+
+exports.HashJoin = function (test) {
+  test.expect(6);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    users = conn.querySync("SELECT 1 AS id, 'alice' AS name UNION ALL SELECT 2, 'bob' UNION ALL SELECT 3, 'carol';"),
+    orders = conn.querySync("SELECT 10 AS order_id, 1 AS user_id UNION ALL SELECT 11, 3 UNION ALL SELECT 12, 1;");
+
+  test.throws(function () {
+    users.hashJoin(orders, {leftKey: "id", rightKey: "unknown"}, function () {});
+  }, Error, "res.hashJoin() with unknown key column");
+
+  users.hashJoin(orders, {leftKey: "id", rightKey: "user_id", columns: ["name", "order_id"]}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, [
+      {name: 'alice', order_id: 10},
+      {name: 'carol', order_id: 11},
+      {name: 'alice', order_id: 12}
+    ], "res.hashJoin() inner join");
+
+    users.hashJoin(orders, {leftKey: "id", rightKey: "user_id", type: "left", columns: ["name", "right.order_id"]}, function (err, rows) {
+      test.ok(err === null, "Error object is not present");
+      test.same(rows.filter(function (row) {
+        return row.order_id === null;
+      }), [{name: 'bob', order_id: null}], "res.hashJoin() left join keeps unmatched rows");
+
+      users.freeSync();
+      orders.freeSync();
+      conn.closeSync();
+      test.done();
+    });
+
+    test.throws(function () {
+      orders.freeSync();
+    }, Error, "Result can't be freed while it is joined");
+  });
+};
+
+exports.HashJoinSetColumn = function (test) {
+  test.expect(3);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    users,
+    orders;
+
+  conn.querySync("CREATE TEMPORARY TABLE test_hash_join_set (id INT, colors SET('red', 'green', 'blue'));");
+  conn.querySync("INSERT INTO test_hash_join_set VALUES (1, 'red,blue'), (2, 'green');");
+  users = conn.querySync("SELECT id, colors FROM test_hash_join_set ORDER BY id;");
+  orders = conn.querySync("SELECT 10 AS order_id, 1 AS user_id UNION ALL SELECT 11, 1 UNION ALL SELECT 12, 2;");
+
+  users.hashJoin(orders, {leftKey: "id", rightKey: "user_id", columns: ["colors", "order_id"]}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.same(rows, [
+      {colors: ['red', 'blue'], order_id: 10},
+      {colors: ['red', 'blue'], order_id: 11},
+      {colors: ['green'], order_id: 12}
+    ], "res.hashJoin() returns whole SET value for every match of a row");
+
+    users.dataSeekSync(0);
+    test.same(users.fetchAllSync(), [
+      {id: 1, colors: ['red', 'blue']},
+      {id: 2, colors: ['green']}
+    ], "Joined result is not changed");
+
+    users.freeSync();
+    orders.freeSync();
+    conn.closeSync();
+    test.done();
+  });
+};
+
+exports.FetchAllSliced = function (test) {
+  test.expect(7);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    digits = "(SELECT 0 AS n UNION ALL SELECT 1 UNION ALL SELECT 2 UNION ALL SELECT 3 UNION ALL SELECT 4 " +
+             "UNION ALL SELECT 5 UNION ALL SELECT 6 UNION ALL SELECT 7 UNION ALL SELECT 8 UNION ALL SELECT 9)",
+    query = "SELECT a.n + b.n * 10 + c.n * 100 AS n FROM " + digits + " a, " + digits + " b, " + digits + " c ORDER BY n;",
+    res = conn.querySync(query),
+    chunked = [];
+
+  res.fetchAll({sliceMs: 1}, function (err, rows) {
+    test.ok(err === null, "Error object is not present");
+    test.equals(rows.length, 1000, "res.fetchAll({sliceMs: 1}) returns all rows");
+    res.freeSync();
+
+    res = conn.querySync(query);
+    res.fetchAll({sliceMs: 1, onChunk: function (rows) {
+      chunked = chunked.concat(rows);
+    }}, function (err, rows) {
+      test.ok(err === null, "Error object is not present");
+      test.strictEqual(rows, null, "Rows are passed to onChunk only");
+      test.same(chunked[999], {n: 999}, "res.fetchAll({onChunk: ...}) passes all rows in order");
+      res.freeSync();
+
+      conn.closeSync();
+      test.done();
+    });
+
+    test.throws(function () {
+      res.fetchRowSync();
+    }, Error, "Row cursor can't be moved while sliced fetch is pending");
+    test.throws(function () {
+      res.dataSeekSync(0);
+    }, Error, "Row cursor can't be seeked while sliced fetch is pending");
+  });
+};
@@ -0,0 +1,80 @@
+/*
+Copyright by Oleg Efimov and node-mysql-libmysqlclient contributors
+See contributors list in README
+
+See license text in LICENSE file
+*/
+
+// Load configuration
+var cfg = require('../config.js');
+
+exports.ExecuteBatch = function (test) {
+  test.expect(9);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt,
+    res,
+    rows = [],
+    i;
+
+  conn.querySync("DELETE FROM " + cfg.test_table + ";");
+
+  stmt = conn.initStatementSync();
+  test.ok(stmt.prepareSync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES (?, ?);"));
+
+  for (i = 0; i < 100; i += 1) {
+    rows.push([i, i % 2 === 0]);
+  }
+  // NOT NULL column, only this execution fails
+  rows[50][0] = null;
+
+  test.throws(function () {
+    stmt.executeBatch([[1]], function () {});
+  }, TypeError, "stmt.executeBatch() with wrong parameters count");
+
+  stmt.executeBatch(rows, function (err, result) {
+    test.ok(err === null, "Error object is not present");
+    test.equals(result.executed, 99, "Failed execution is skipped");
+    test.equals(result.affectedRows, 99, "Affected rows of all executions");
+    test.ok(result.firstInsertId > 0 && result.lastInsertId - result.firstInsertId >= 98, "First and last insert ids");
+    test.same(result.errors.map(function (error) { return error.index; }), [50], "Per-row errors");
+
+    stmt.executeBatch({columns: [new Int32Array([1000, 1001, 1002]), [true, false, true]]}, function (err, result) {
+      test.equals(result.affectedRows, 3, "Columnar batch with typed array");
+
+      res = conn.querySync("SELECT COUNT(*) AS n FROM " + cfg.test_table + " WHERE random_number >= 1000;");
+      test.same(res.fetchAllSync(), [{n: 3}], "Rows inserted from columns");
+
+      stmt.closeSync();
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
+
+exports.ExecuteBatchInTransaction = function (test) {
+  test.expect(3);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt;
+
+  stmt = conn.initStatementSync();
+  test.ok(stmt.prepareSync("INSERT INTO " + cfg.test_table + " (random_number, random_boolean) VALUES (?, ?);"));
+
+  stmt.executeBatch([[1, true], [null, true], [3, true]], {transaction: true}, function (err) {
+    test.ok(err.message.match(/^Execute batch error at row 1, transaction is rolled back/), "Batch is stopped and rolled back");
+
+    // START TRANSACTION of batch would commit transaction of caller
+    conn.querySync("START TRANSACTION;");
+    stmt.executeBatch([[4, true]], {transaction: true}, function (err) {
+      test.ok(err.message.match(/^Connection has open transaction/), "Batch is refused inside open transaction");
+
+      conn.rollbackSync();
+      stmt.closeSync();
+      conn.closeSync();
+      test.done();
+    });
+  });
+};
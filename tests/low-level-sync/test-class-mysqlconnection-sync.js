@@ -329,6 +329,24 @@ exports.CloseSync = function (test) {
   test.done();
 };
 
+exports.EnableGtidTrackingSync = function (test) {
+  test.expect(2);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database), enabled;
+  test.ok(conn, "mysql_libmysqlclient.createConnectionSync(host, user, password, database)");
+  
+  try {
+    enabled = conn.enableGtidTrackingSync();
+  } catch (e) {
+    // Client library older than 5.7.4
+    enabled = false;
+  }
+  test.ok(typeof enabled === 'boolean', "conn.enableGtidTrackingSync()");
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.ErrnoSync = function (test) {
   test.expect(4);
   
@@ -520,6 +538,34 @@ exports.InitSync = function (test) {
   initAndRealConnectSync(test);
 };
 
+exports.InvalidateResultCacheSync = function (test) {
+  test.expect(4);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn, "mysql_libmysqlclient.createConnectionSync(host, user, password, database)");
+  
+  test.equals(conn.invalidateResultCacheSync("not_used_tag"), 0, "conn.invalidateResultCacheSync() with unknown tag");
+  test.equals(conn.invalidateResultCacheSync(["not_used_tag", "other_tag"]), 0, "conn.invalidateResultCacheSync() with tags array");
+  test.throws(function () {
+    conn.invalidateResultCacheSync();
+  }, TypeError, "conn.invalidateResultCacheSync() without tags");
+  conn.closeSync();
+  
+  test.done();
+};
+
+exports.LastGtidSync = function (test) {
+  test.expect(2);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn, "mysql_libmysqlclient.createConnectionSync(host, user, password, database)");
+  
+  test.strictEqual(conn.lastGtidSync(), null, "conn.lastGtidSync() without tracking");
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.LastInsertIdSync = function (test) {
   test.expect(5);
   
@@ -608,6 +654,23 @@ exports.QuerySync = function (test) {
   test.done();
 };
 
+exports.QueueStatsSync = function (test) {
+  test.expect(5);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stats = conn.queueStatsSync();
+  
+  test.ok(stats.interactive, "conn.queueStatsSync().interactive");
+  test.ok(stats.batch, "conn.queueStatsSync().batch");
+  test.ok(stats.background, "conn.queueStatsSync().background");
+  test.equals(typeof stats.interactive.waitMaxMs, "number", "typeof conn.queueStatsSync().interactive.waitMaxMs");
+  test.equals(typeof stats.batch.queued, "number", "typeof conn.queueStatsSync().batch.queued");
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.RealConnectSync = function (test) {
   initAndRealConnectSync(test);
 };
@@ -616,6 +679,22 @@ exports.RealQuerySync = function (test) {
   realQueryAndUseAndStoreResultSync(test);
 };
 
+exports.ResultCacheStatsSync = function (test) {
+  test.expect(4);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stats = conn.resultCacheStatsSync();
+  
+  test.equals(typeof stats.hits, "number", "typeof conn.resultCacheStatsSync().hits");
+  test.equals(typeof stats.misses, "number", "typeof conn.resultCacheStatsSync().misses");
+  test.equals(typeof stats.entries, "number", "typeof conn.resultCacheStatsSync().entries");
+  test.ok(stats.bytes <= stats.maxBytes, "conn.resultCacheStatsSync().bytes <= maxBytes");
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.SelectDbSync = function (test) {
   test.expect(3);
   
@@ -629,6 +708,31 @@ exports.SelectDbSync = function (test) {
   test.done();
 };
 
+exports.SetAdmissionLimitsSync = function (test) {
+  test.expect(4);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn, "mysql_libmysqlclient.createConnectionSync(host, user, password, database)");
+  
+  conn.setAdmissionLimitsSync({maxQueued: 10, maxQueueWaitMs: 1000});
+  test.throws(function () {
+    conn.setAdmissionLimitsSync({maxQueued: -1});
+  }, TypeError, "conn.setAdmissionLimitsSync() with negative limit");
+  test.throws(function () {
+    conn.setAdmissionLimitsSync();
+  }, TypeError, "conn.setAdmissionLimitsSync() without limits");
+  conn.setAdmissionLimitsSync({maxQueued: 0, maxQueueWaitMs: 0});
+  conn.closeSync();
+  
+  cfg.mysql_libmysqlclient.setProcessAdmissionLimitsSync({maxQueued: 1000});
+  test.throws(function () {
+    cfg.mysql_libmysqlclient.setProcessAdmissionLimitsSync({maxQueued: -1});
+  }, TypeError, "mysql_libmysqlclient.setProcessAdmissionLimitsSync() with negative limit");
+  cfg.mysql_libmysqlclient.setProcessAdmissionLimitsSync({maxQueued: 0});
+  
+  test.done();
+};
+
 exports.SetCharsetSync = function (test) {
   test.expect(2);
   
@@ -679,6 +783,47 @@ exports.SetOptionSync = function (test) {
   test.done();
 };
 
+exports.SetResultCacheLimitsSync = function (test) {
+  test.expect(4);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn, "mysql_libmysqlclient.createConnectionSync(host, user, password, database)");
+  
+  conn.setResultCacheLimitsSync({maxBytes: 1024 * 1024});
+  test.equals(conn.resultCacheStatsSync().maxBytes, 1024 * 1024, "conn.resultCacheStatsSync().maxBytes");
+  conn.setResultCacheLimitsSync({maxBytes: 16 * 1024 * 1024});
+  test.throws(function () {
+    conn.setResultCacheLimitsSync({maxBytes: -1});
+  }, TypeError, "conn.setResultCacheLimitsSync() with negative limit");
+  test.throws(function () {
+    conn.setResultCacheLimitsSync();
+  }, TypeError, "conn.setResultCacheLimitsSync() without limits");
+  conn.closeSync();
+  
+  test.done();
+};
+
+exports.SetResultModeSync = function (test) {
+  test.expect(4);
+  
+  var conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database);
+  test.ok(conn, "mysql_libmysqlclient.createConnectionSync(host, user, password, database)");
+  
+  conn.setResultModeSync('auto', 64 * 1024);
+  test.throws(function () {
+    conn.setResultModeSync('buffered');
+  }, TypeError, "conn.setResultModeSync() with unknown mode");
+  test.throws(function () {
+    conn.setResultModeSync('use', -1);
+  }, TypeError, "conn.setResultModeSync() with negative threshold");
+  test.throws(function () {
+    conn.setResultModeSync();
+  }, TypeError, "conn.setResultModeSync() without mode");
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.SetSslSync = function (test) {
   test.expect(3);
 
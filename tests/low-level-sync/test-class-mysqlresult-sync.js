@@ -373,6 +373,56 @@ exports.FreeSync = function (test) {
   test.done();
 };
 
+exports.MergeSortedSync = function (test) {
+  test.expect(6);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    res1,
+    res2,
+    rows;
+  
+  res1 = conn.querySync("SELECT 1 AS n, 'a' AS s UNION ALL SELECT 4, 'b' UNION ALL SELECT 10, 'c';");
+  res2 = conn.querySync("SELECT 2 AS n, 'd' AS s UNION ALL SELECT 3, 'e' UNION ALL SELECT 12, 'f';");
+  rows = res1.mergeSortedSync([res2], {orderBy: [{column: "n"}], limit: 4});
+  test.same(rows, [{n: 1, s: 'a'}, {n: 2, s: 'd'}, {n: 3, s: 'e'}, {n: 4, s: 'b'}], "res.mergeSortedSync() with limit");
+  res1.freeSync();
+  res2.freeSync();
+  
+  res1 = conn.querySync("SELECT 10 AS n UNION ALL SELECT 4 UNION ALL SELECT 1;");
+  res2 = conn.querySync("SELECT 12 AS n UNION ALL SELECT 3;");
+  rows = res1.mergeSortedSync([res2], {orderBy: [{column: "n", desc: true}], asArray: true});
+  test.same(rows, [[12], [10], [4], [3], [1]], "res.mergeSortedSync() with descending order");
+  res1.freeSync();
+  
+  test.throws(function () {
+    res2.mergeSortedSync([res2], {orderBy: [{column: "unknown"}]});
+  }, Error, "res.mergeSortedSync() with unknown column");
+  test.throws(function () {
+    res2.mergeSortedSync([{}]);
+  }, TypeError, "res.mergeSortedSync() with not a result");
+  res2.freeSync();
+  
+  // Values differ beyond double precision
+  res1 = conn.querySync("SELECT CAST('12345678901234567891' AS DECIMAL(30,0)) AS d, 'b' AS s;");
+  res2 = conn.querySync("SELECT CAST('12345678901234567890' AS DECIMAL(30,0)) AS d, 'a' AS s UNION ALL " +
+                        "SELECT CAST('12345678901234567892' AS DECIMAL(30,0)), 'c';");
+  rows = res1.mergeSortedSync([res2], {orderBy: [{column: "d"}]});
+  test.same(rows.map(function (row) { return row.s; }), ['a', 'b', 'c'], "res.mergeSortedSync() by DECIMAL is exact");
+  res1.freeSync();
+  res2.freeSync();
+  
+  res1 = conn.querySync("SELECT _utf8'a' COLLATE utf8_general_ci AS s;");
+  test.throws(function () {
+    res1.mergeSortedSync([], {orderBy: [{column: "s"}]});
+  }, Error, "res.mergeSortedSync() by string of case-insensitive collation");
+  res1.freeSync();
+  
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.NumRowsSync = function (test) {
   test.expect(9);
   
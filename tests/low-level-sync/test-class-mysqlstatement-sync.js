@@ -222,6 +222,63 @@ exports.BindParamsSync = function (test) {
   testBindParamsAndExecuteSync(test);
 };
 
+exports.BindParamsSyncRebind = function (test) {
+  test.expect(9);
+  
+  var
+    conn = cfg.mysql_libmysqlclient.createConnectionSync(cfg.host, cfg.user, cfg.password, cfg.database),
+    stmt,
+    res,
+    rows,
+    i;
+
+  res = conn.querySync("DELETE FROM " + cfg.test_table + ";");
+  test.strictEqual(res, true);
+  
+  res = conn.querySync("ALTER TABLE " + cfg.test_table + " ADD message TEXT;");
+  test.strictEqual(res, true);
+
+  stmt = conn.initStatementSync();
+  test.ok(stmt.prepareSync("INSERT INTO " + cfg.test_table + " (random_number, message) VALUES (?, ?);"));
+
+  // Binds are reused, so string of other length, Buffer and NULL follow each other
+  for (i = 0; i < 300; i += 1) {
+    if (i % 3 === 0) {
+      stmt.bindParamsSync([i, new Array(i + 2).join("s")]);
+    } else if (i % 3 === 1) {
+      stmt.bindParamsSync([i, new Buffer("buffer " + i)]);
+    } else {
+      stmt.bindParamsSync([i, null]);
+    }
+    stmt.executeSync();
+  }
+
+  rows = conn.querySync("SELECT random_number, message FROM " + cfg.test_table +
+                        " WHERE random_number IN (297, 298, 299) ORDER BY random_number;").fetchAllSync();
+  test.same(rows[0], {random_number: 297, message: new Array(299).join("s")}, "String parameter");
+  test.same(rows[1], {random_number: 298, message: "buffer 298"}, "Buffer parameter");
+  test.same(rows[2], {random_number: 299, message: null}, "NULL parameter");
+
+  // Failed rebind keeps previously bound parameters
+  stmt.bindParamsSync([1000, new Buffer("kept")]);
+  test.throws(function () {
+    stmt.bindParamsSync([1001, undefined]);
+  }, Error, "stmt.bindParamsSync() with undefined parameter");
+  stmt.executeSync();
+  rows = conn.querySync("SELECT random_number, message FROM " + cfg.test_table +
+                        " WHERE random_number >= 1000;").fetchAllSync();
+  test.same(rows, [{random_number: 1000, message: "kept"}], "Parameters bound before failed rebind");
+
+  stmt.closeSync();
+
+  res = conn.querySync("ALTER TABLE " + cfg.test_table + " DROP message;");
+  test.strictEqual(res, true);
+
+  conn.closeSync();
+  
+  test.done();
+};
+
 exports.CloseSync = function (test) {
   test.expect(3);
   
@@ -51,7 +51,13 @@ function getBindingsClasses() {
     if (source_files[i].match(regex_class_source_filename)) {
       file_content = fs.readFileSync(source_dir + "/" + source_files[i]).toString();
 
-      class_name = file_content.match(regex_class_name)[1];
+      class_name = file_content.match(regex_class_name);
+
+      // Native helpers without JS class, e.g. result cache
+      if (!class_name) {
+        continue;
+      }
+      class_name = class_name[1];
       
       class_properties_getters = [];
       